@@ -533,24 +533,21 @@ static sk_err_t cli_list(sk_cli_ctx_t *ctx)
 {
     if (sk_cli_is_machine_mode(ctx)) {
         // {"groups":[{"id":N,"name":"...","enabled":true,"recipients":3},...]}
-        char buf[1024];
-        int  off = 0;
-        off += snprintf(buf + off, sizeof(buf) - off, "{\"groups\":[");
-        bool first = true;
+        sk_cli_json_t j;
+        sk_cli_json_begin(&j, ctx);
+        sk_cli_json_begin_object(&j);
+        sk_cli_json_key(&j, "groups");
+        sk_cli_json_begin_array(&j);
         for (int i = 0; i < LS_MAIL_GROUP_MAX; ++i) {
             if (!s_groups[i].used) continue;
-            char name_e[LS_MAIL_GROUP_NAME_MAX * 2 + 2];
-            json_esc(name_e, sizeof(name_e), s_groups[i].name);
-            off += snprintf(buf + off, sizeof(buf) - off,
-                "%s{\"id\":%d,\"name\":\"%s\",\"enabled\":%s,\"recipients\":%u}",
-                first ? "" : ",",
-                i, name_e,
-                s_groups[i].enabled ? "true" : "false",
-                (unsigned)s_groups[i].recipient_count);
-            first = false;
+            sk_cli_json_begin_object(&j);
+            sk_cli_json_key(&j, "id");         sk_cli_json_number(&j, i);
+            sk_cli_json_key(&j, "name");       sk_cli_json_string(&j, s_groups[i].name);
+            sk_cli_json_key(&j, "enabled");    sk_cli_json_bool(&j, s_groups[i].enabled);
+            sk_cli_json_key(&j, "recipients"); sk_cli_json_number(&j, s_groups[i].recipient_count);
+            sk_cli_json_end(&j);
         }
-        off += snprintf(buf + off, sizeof(buf) - off, "]}");
-        sk_cli_ok(ctx, buf);
+        sk_cli_json_finish(&j);
         return SK_OK;
     }
 
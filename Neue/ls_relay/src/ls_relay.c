@@ -894,6 +894,10 @@ esp_err_t ls_relay_init(int default_gpio_num)
     BaseType_t ok = xTaskCreate(worker_task, "ls_relay", 3072, NULL, 5, NULL);
     if (ok != pdPASS) return ESP_ERR_NO_MEM;
 
+    // Retained so a peer connecting mid-fire sees relay.fire.start (and
+    // the matching .end once it is over) without polling relay.status.
+    sk_event_bus_set_retained("relay.fire.*");
+
     // Subscribe to timer.triggered for auto-fire.
     int sub;
     sk_event_bus_subscribe("timer.triggered", on_timer_triggered, NULL, &sub);
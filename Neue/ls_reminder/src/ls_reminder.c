@@ -24,6 +24,7 @@
 #include "nvs_flash.h"
 
 #include "ls_smtp.h"
+#include "ls_timer_engine.h"
 #include "sk_cli.h"
 #include "sk_errors.h"
 #include "sk_event_bus.h"
@@ -75,24 +76,6 @@ static void json_esc(char *out, size_t cap, const char *in)
     out[o] = '\0';
 }
 
-// Extract an integer field from a flat JSON object (device-owned payloads
-// like {"index":1,"of":3,"remaining_sec":60}). Returns true on success.
-static bool json_get_int(const char *json, const char *key, int *out)
-{
-    if (!json || !key || !out) return false;
-    char pat[24];
-    snprintf(pat, sizeof(pat), "\"%s\"", key);
-    const char *p = strstr(json, pat);
-    if (!p) return false;
-    p += strlen(pat);
-    while (*p == ' ' || *p == ':' || *p == '\t') p++;
-    char *end = NULL;
-    long v = strtol(p, &end, 10);
-    if (end == p) return false;
-    *out = (int)v;
-    return true;
-}
-
 // ---------------------------------------------------------------------
 // NVS persistence - flat per-field keys
 // ---------------------------------------------------------------------
@@ -181,9 +164,10 @@ static void on_timer_alarm(const sk_event_t *evt, void *user_ctx)
     if (!s_cfg.enabled) return;   // reminders disabled — nudge nothing
 
     fire_msg_t m = { .index = 0, .of = 0 };
-    if (evt && evt->payload_json) {
-        json_get_int(evt->payload_json, "index", &m.index);
-        json_get_int(evt->payload_json, "of",    &m.of);
+    const ls_timer_alarm_evt_t *a = sk_event_data(evt, &ls_timer_alarm_evt_type);
+    if (a) {
+        m.index = a->index;
+        m.of    = (int)a->of;
     }
     xQueueSend(s_fire_q, &m, 0);
 }
@@ -21,8 +21,6 @@
 #include "esp_err.h"
 #include "esp_log.h"
 #include "esp_tls.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
 #include "mbedtls/base64.h"
 #include "nvs.h"
 #include "nvs_flash.h"
@@ -492,19 +490,21 @@ static sk_err_t cli_get(sk_cli_ctx_t *ctx)
 }
 
 // The SMTPS handshake + send can take 5-15 seconds; to keep the CLI
-// transport task (USB CLI / TCP client) unblocked we dispatch to a
-// separate task. The outcome is published on the event bus
-// (smtp.send.end) - this command itself just returns
-// "{\"started\":true}". The original LebensSpur smtp.test handler used
-// the same model (ls_mail_cmds.c).
-static void smtp_test_task(void *arg)
+// transport task (USB CLI / TCP client) unblocked the send runs on
+// an sk_cli async worker (8 KB stack: safe for esp_tls + mbedtls handshake)
+// and the command answers when it is done — {"sent":true} or the
+// ls_smtp_send error. The outcome is still published on the event bus
+// (smtp.send.end) for listeners that did not ask. Up to protocol v1 1.2.0
+// the command answered {"started":true} at once (commands.json).
+static void smtp_test_job(sk_cli_pending_t *p, void *arg)
 {
     (void)arg;
     const char *rcpt[1] = { s_cfg.sender };
-    (void)ls_smtp_send("LebensSpur SMTP test",
-                       "This is an SMTP configuration test from the LebensSpur device.\r\n",
-                       rcpt, 1);
-    vTaskDelete(NULL);
+    sk_err_t rc = ls_smtp_send("LebensSpur SMTP test",
+                               "This is an SMTP configuration test from the LebensSpur device.\r\n",
+                               rcpt, 1);
+    if (rc == SK_OK) sk_cli_complete(p, "{\"sent\":true}");
+    else             sk_cli_complete_err(p, rc, NULL);
 }
 
 static sk_err_t cli_test(sk_cli_ctx_t *ctx)
@@ -513,22 +513,15 @@ static sk_err_t cli_test(sk_cli_ctx_t *ctx)
         sk_cli_err(ctx, SK_ERR_SMTP_NO_CONFIG, NULL);
         return SK_ERR_SMTP_NO_CONFIG;
     }
-    // 8192 byte stack: safe for esp_tls + mbedtls handshake (the original
-    // LebensSpur used 10240; modern esp_tls is slightly leaner).
-    BaseType_t ok = xTaskCreate(smtp_test_task, "smtp_test",
-                                8192, NULL, 4, NULL);
-    if (ok != pdPASS) {
-        sk_cli_err(ctx, SK_ERR_BUSY, "{\"reason\":\"oom\"}");
+    sk_cli_pending_t *p = sk_cli_defer(ctx);
+    if (!p) {
+        sk_cli_err(ctx, SK_ERR_BUSY, "{\"reason\":\"pending_full\"}");
         return SK_ERR_BUSY;
     }
-
-    if (sk_cli_is_machine_mode(ctx)) {
-        sk_cli_ok(ctx, "{\"started\":true}");
-    } else {
-        sk_cli_kv(ctx, "Result", "test mail queued");
-        sk_cli_ok(ctx, NULL);
+    if (sk_cli_async(p, smtp_test_job, NULL) != ESP_OK) {
+        sk_cli_complete_err(p, SK_ERR_BUSY, "{\"reason\":\"oom\"}");
     }
-    return SK_OK;
+    return SK_PENDING;
 }
 
 // Atomic multi-field save. SKAPP pushes host+port+sender+key as one unit;
@@ -703,8 +696,8 @@ static const sk_cli_command_t s_cmds[] = {
           "\n"
           "Use this after `smtp host` / `smtp port` / `smtp sender` /\n"
           "`smtp key` (or `smtp save`) to verify the server accepts the\n"
-          "credentials and routes mail. The test runs asynchronously;\n"
-          "watch the `smtp.send.end` event for the outcome.\n"
+          "credentials and routes mail. The reply arrives when the\n"
+          "server has answered (5-15 s): `sent: true` or the SMTP error.\n"
           "\n"
           "Examples:\n"
           "  smtp test",
@@ -4,6 +4,7 @@
 #include <stdint.h>
 
 #include "esp_err.h"
+#include "sk_event_bus.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -53,6 +54,11 @@ extern "C" {
 //   timer.vacation   {"active":true,"end_epoch":N} / {"active":false}
 //                    vacation moduna giriş/çıkış
 //
+// state/tick/alarm/triggered typed payload olarak yayınlanır (aşağıdaki
+// ls_timer_*_evt_t struct'ları, sk_event_data() ile okunur); yukarıdaki
+// JSON biçimi yalnızca transport/webhook sk_event_json() istediğinde
+// üretilir. reset/vacation düz JSON kalır.
+//
 // CLI komutları (kayıt component'in init'inde):
 //   timer.set, timer.start, timer.stop, timer.reset, timer.status,
 //   timer.get, vacation.set, vacation.cancel
@@ -71,6 +77,31 @@ typedef enum {
     LS_TIMER_TRIGGERED = 3,
 } ls_timer_state_t;
 
+// -- Typed event payloads ------------------------------------------------
+typedef struct {
+    const char *state;          // ls_timer_engine_state_str(), string literal
+    uint32_t    remaining_sec;
+} ls_timer_state_evt_t;
+
+typedef struct {
+    uint32_t remaining_sec;
+} ls_timer_tick_evt_t;
+
+typedef struct {
+    int      index;             // 1-based
+    unsigned of;
+    uint32_t remaining_sec;
+} ls_timer_alarm_evt_t;
+
+typedef struct {
+    uint32_t duration_sec;
+} ls_timer_triggered_evt_t;
+
+extern const sk_event_type_t ls_timer_state_evt_type;      // "timer.state"
+extern const sk_event_type_t ls_timer_tick_evt_type;       // "timer.tick"
+extern const sk_event_type_t ls_timer_alarm_evt_type;      // "timer.alarm"
+extern const sk_event_type_t ls_timer_triggered_evt_type;  // "timer.triggered"
+
 typedef enum {
     LS_TIMER_UNIT_MINUTE = 0,
     LS_TIMER_UNIT_HOUR   = 1,
@@ -271,31 +271,84 @@ static uint32_t remaining_sec_now(void)
     return (uint32_t)d;
 }
 
+// -- Typed payload renderers ---------------------------------------------
+// Tick'ler saniyede bir yayınlanıyor; JSON'u her seferinde üretmek yerine
+// struct yayınlıyoruz, string'e yalnızca transport ya da webhook bakarsa
+// çevriliyor.
+
+static int render_state(const void *data, char *out, size_t cap)
+{
+    const ls_timer_state_evt_t *e = data;
+    return snprintf(out, cap, "{\"state\":\"%s\",\"remaining_sec\":%" PRIu32 "}",
+                    e->state, e->remaining_sec);
+}
+
+static int render_tick(const void *data, char *out, size_t cap)
+{
+    const ls_timer_tick_evt_t *e = data;
+    return snprintf(out, cap, "{\"remaining_sec\":%" PRIu32 "}", e->remaining_sec);
+}
+
+static int render_alarm(const void *data, char *out, size_t cap)
+{
+    const ls_timer_alarm_evt_t *e = data;
+    return snprintf(out, cap,
+                    "{\"index\":%d,\"of\":%u,\"remaining_sec\":%" PRIu32 "}",
+                    e->index, e->of, e->remaining_sec);
+}
+
+static int render_triggered(const void *data, char *out, size_t cap)
+{
+    const ls_timer_triggered_evt_t *e = data;
+    return snprintf(out, cap, "{\"duration_sec\":%" PRIu32 "}", e->duration_sec);
+}
+
+const sk_event_type_t ls_timer_state_evt_type = {
+    .name = "timer.state", .size = sizeof(ls_timer_state_evt_t),
+    .render_json = render_state,
+};
+const sk_event_type_t ls_timer_tick_evt_type = {
+    .name = "timer.tick", .size = sizeof(ls_timer_tick_evt_t),
+    .render_json = render_tick,
+};
+const sk_event_type_t ls_timer_alarm_evt_type = {
+    .name = "timer.alarm", .size = sizeof(ls_timer_alarm_evt_t),
+    .render_json = render_alarm,
+};
+const sk_event_type_t ls_timer_triggered_evt_type = {
+    .name = "timer.triggered", .size = sizeof(ls_timer_triggered_evt_t),
+    .render_json = render_triggered,
+};
+
 static void publish_state(void)
 {
-    uint32_t rem = remaining_sec_now();
-    sk_event_bus_publishf("timer.state",
-        "{\"state\":\"%s\",\"remaining_sec\":%" PRIu32 "}",
-        ls_timer_engine_state_str(), rem);
+    ls_timer_state_evt_t e = {
+        .state         = ls_timer_engine_state_str(),
+        .remaining_sec = remaining_sec_now(),
+    };
+    sk_event_bus_publish_typed("timer.state", &ls_timer_state_evt_type, &e);
 }
 
 static void publish_tick(uint32_t rem)
 {
-    sk_event_bus_publishf("timer.tick",
-        "{\"remaining_sec\":%" PRIu32 "}", rem);
+    ls_timer_tick_evt_t e = { .remaining_sec = rem };
+    sk_event_bus_publish_typed("timer.tick", &ls_timer_tick_evt_type, &e);
 }
 
 static void publish_alarm(int index, uint32_t rem)
 {
-    sk_event_bus_publishf("timer.alarm",
-        "{\"index\":%d,\"of\":%u,\"remaining_sec\":%" PRIu32 "}",
-        index + 1, (unsigned)s_cfg.alarm_count, rem);
+    ls_timer_alarm_evt_t e = {
+        .index         = index + 1,
+        .of            = (unsigned)s_cfg.alarm_count,
+        .remaining_sec = rem,
+    };
+    sk_event_bus_publish_typed("timer.alarm", &ls_timer_alarm_evt_type, &e);
 }
 
 static void publish_triggered(uint32_t duration_sec)
 {
-    sk_event_bus_publishf("timer.triggered",
-        "{\"duration_sec\":%" PRIu32 "}", duration_sec);
+    ls_timer_triggered_evt_t e = { .duration_sec = duration_sec };
+    sk_event_bus_publish_typed("timer.triggered", &ls_timer_triggered_evt_type, &e);
 }
 
 static void publish_reset(const char *by)
@@ -1299,6 +1352,16 @@ esp_err_t ls_timer_engine_init(void)
         }
     }
 
+    // timer.tick sadece "son değer" taşır: yavaş bir peer'a (BLE kuyruğu)
+    // birikmiş eski tick'ler yerine yalnızca en yenisi gitsin.
+    sk_event_bus_set_coalesced("timer.tick");
+
+    // timer.state retained: yeni bağlanan SKAPP oturumu timer.status
+    // sormadan güncel durumu alır. Boot'taki durum da bir kere yayınlanır,
+    // yoksa ilk geçişe kadar retained tablo boş kalırdı.
+    sk_event_bus_set_retained("timer.state");
+    publish_state();
+
     // External reset request channel: ls_reset_api → timer.reset.requested
     int sub;
     sk_event_bus_subscribe("timer.reset.requested",
@@ -218,6 +218,7 @@ void app_main(void)
     sk_cli_register_topic("device",    "Identity, restart, factory reset",                    "SYSTEM");
     sk_cli_register_topic("reset_api", "Inbound HTTP /api/reset endpoint",                    "SYSTEM");
     sk_cli_register_topic("logs",      "Log entries (ring buffer)",                           "SYSTEM");
+    sk_cli_register_topic("events",    "Event bus subscribers and delivery stats",            "SYSTEM");
 
     // SKAPP
     sk_cli_register_topic("pairing",   "SKAPP pairing window (open / status / close)",        "SKAPP");
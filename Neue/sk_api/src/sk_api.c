@@ -1317,107 +1317,49 @@ static void mask_token(const char *tok, char *out, size_t cap)
     snprintf(out, cap, "%.4s...%s", tok, tok + n - 4);
 }
 
-// Minimal JSON string escaper for the stored payload template. Quotes and
-// backslashes are escaped; \n \r \t become their two-char escapes; any
-// other control char (<0x20) is dropped. Worst-case growth is 2x, which
-// sizes the caller's scratch buffer.
-static void json_escape(const char *in, char *out, size_t cap)
+// Stream one endpoint as a JSON object. Every string goes through the
+// writer's inline escaping — the payload template may legally contain
+// quotes and backslashes, and name/url are user input too.
+static void stream_ep_json(sk_cli_json_t *j, const sk_api_endpoint_t *ep, int slot)
 {
-    size_t off = 0;
-    for (const char *p = in; *p && off + 2 < cap; p++) {
-        unsigned char c = (unsigned char)*p;
-        switch (c) {
-        case '"':  out[off++] = '\\'; out[off++] = '"';  break;
-        case '\\': out[off++] = '\\'; out[off++] = '\\'; break;
-        case '\n': out[off++] = '\\'; out[off++] = 'n';  break;
-        case '\r': out[off++] = '\\'; out[off++] = 'r';  break;
-        case '\t': out[off++] = '\\'; out[off++] = 't';  break;
-        default:
-            if (c >= 0x20) out[off++] = (char)c;
-            break;
-        }
-    }
-    out[off] = '\0';
-}
-
-// Append one endpoint as JSON to the buffer at *off. Returns updated
-// offset; truncation is silent (off may exceed BUF, in which case the
-// caller still emits the closing bracket and the result is invalid JSON
-// — but with BUF=2048 vs the bounded slot count this is practical).
-static size_t append_ep_json(char *buf, size_t off, size_t cap,
-                             const sk_api_endpoint_t *ep, int slot,
-                             bool first)
-{
-    if (off >= cap) return off;
     char masked[SK_API_TOKEN_MAX + 1] = {0};
     mask_token(ep->token, masked, sizeof(masked));
     char pid_hex[SK_API_PEER_ID_LEN * 2 + 1] = {0};
     if (ep->kind == SK_API_KIND_SYSTEM) {
         bytes_to_hex(ep->peer_id, SK_API_PEER_ID_LEN, pid_hex);
     }
-    // Payload template needs escaping — unlike name/url it may legally
-    // contain quotes and backslashes. Heap scratch: worst case is every
-    // char escaped to two bytes. NULL fallback keeps the row valid (empty
-    // payload) instead of dropping the whole listing on OOM.
-    char *pl_esc = malloc(SK_API_EP_PAYLOAD_MAX * 2 + 1);
-    if (pl_esc) {
-        json_escape(ep->payload, pl_esc, SK_API_EP_PAYLOAD_MAX * 2 + 1);
-    }
-    off += snprintf(buf + off, cap - off,
-                    "%s{\"slot\":%d,\"kind\":\"%s\",\"class\":\"%s\","
-                    "\"name\":\"%s\","
-                    "\"type\":\"%s\",\"url\":\"%s\","
-                    "\"method\":\"%s\",\"auth\":\"%s\",\"header\":\"%s\","
-                    "\"content_type\":\"%s\",\"masked_token\":\"%s\","
-                    "\"payload\":\"%s\","
-                    "\"delay_after_sec\":%u,\"peer_id\":\"%s\"}",
-                    first ? "" : ",",
-                    slot,
-                    sk_api_kind_str(ep->kind),
-                    sk_api_trigclass_str(ep->trigclass),
-                    ep->name,
-                    sk_api_type_str(ep->type),
-                    ep->url,
-                    sk_api_method_str(ep->method),
-                    sk_api_auth_str(ep->auth),
-                    ep->header_name,
-                    ep->content_type,
-                    masked,
-                    pl_esc ? pl_esc : "",
-                    (unsigned)ep->delay_after_sec,
-                    pid_hex);
-    free(pl_esc);
-    return off;
+    sk_cli_json_begin_object(j);
+    sk_cli_json_key(j, "slot");            sk_cli_json_number(j, slot);
+    sk_cli_json_key(j, "kind");            sk_cli_json_string(j, sk_api_kind_str(ep->kind));
+    sk_cli_json_key(j, "class");           sk_cli_json_string(j, sk_api_trigclass_str(ep->trigclass));
+    sk_cli_json_key(j, "name");            sk_cli_json_string(j, ep->name);
+    sk_cli_json_key(j, "type");            sk_cli_json_string(j, sk_api_type_str(ep->type));
+    sk_cli_json_key(j, "url");             sk_cli_json_string(j, ep->url);
+    sk_cli_json_key(j, "method");          sk_cli_json_string(j, sk_api_method_str(ep->method));
+    sk_cli_json_key(j, "auth");            sk_cli_json_string(j, sk_api_auth_str(ep->auth));
+    sk_cli_json_key(j, "header");          sk_cli_json_string(j, ep->header_name);
+    sk_cli_json_key(j, "content_type");    sk_cli_json_string(j, ep->content_type);
+    sk_cli_json_key(j, "masked_token");    sk_cli_json_string(j, masked);
+    sk_cli_json_key(j, "payload");         sk_cli_json_string(j, ep->payload);
+    sk_cli_json_key(j, "delay_after_sec"); sk_cli_json_number(j, ep->delay_after_sec);
+    sk_cli_json_key(j, "peer_id");         sk_cli_json_string(j, pid_hex);
+    sk_cli_json_end(j);
 }
 
 static sk_err_t cmd_api_endpoint_list(sk_cli_ctx_t *ctx)
 {
-    // 5 USER slots up to ~560 B base + ~1 KB escaped payload each, plus
-    // 8 SYSTEM slots at ~560 B -> ~12 KB worst case.
-    enum { BUF = 16384 };
-    char *buf = malloc(BUF);
-    if (!buf) {
-        sk_cli_err(ctx, SK_ERR_INTERNAL, "{\"reason\":\"oom\"}");
-        return SK_OK;
-    }
-
-    size_t off = 0;
-    off += snprintf(buf + off, BUF - off, "[");
-    bool first = true;
+    // Streamed row by row — 5 USER slots with up to ~1 KB escaped payload
+    // each used to need a 16 KB heap buffer for one response.
+    sk_cli_json_t j;
+    sk_cli_json_begin(&j, ctx);
+    sk_cli_json_begin_array(&j);
     for (int i = 0; i < SK_API_USER_SLOTS; i++) {
-        if (!s_user[i].in_use) continue;
-        off = append_ep_json(buf, off, BUF, &s_user[i], i, first);
-        first = false;
+        if (s_user[i].in_use) stream_ep_json(&j, &s_user[i], i);
     }
     for (int i = 0; i < SK_API_SYSTEM_SLOTS; i++) {
-        if (!s_system[i].in_use) continue;
-        off = append_ep_json(buf, off, BUF, &s_system[i], i, first);
-        first = false;
+        if (s_system[i].in_use) stream_ep_json(&j, &s_system[i], i);
     }
-    if (off < BUF) off += snprintf(buf + off, BUF - off, "]");
-    sk_cli_ok(ctx, buf);
-
-    free(buf);
+    sk_cli_json_finish(&j);
     return SK_OK;
 }
 
@@ -1641,23 +1583,13 @@ static sk_err_t cmd_api_system_purge(sk_cli_ctx_t *ctx)
 
 static sk_err_t cmd_api_system_list(sk_cli_ctx_t *ctx)
 {
-    enum { BUF = 1024 };
-    char *buf = malloc(BUF);
-    if (!buf) {
-        sk_cli_err(ctx, SK_ERR_INTERNAL, "{\"reason\":\"oom\"}");
-        return SK_OK;
-    }
-    size_t off = 0;
-    off += snprintf(buf + off, BUF - off, "[");
-    bool first = true;
+    sk_cli_json_t j;
+    sk_cli_json_begin(&j, ctx);
+    sk_cli_json_begin_array(&j);
     for (int i = 0; i < SK_API_SYSTEM_SLOTS; i++) {
-        if (!s_system[i].in_use) continue;
-        off = append_ep_json(buf, off, BUF, &s_system[i], i, first);
-        first = false;
+        if (s_system[i].in_use) stream_ep_json(&j, &s_system[i], i);
     }
-    if (off < BUF) off += snprintf(buf + off, BUF - off, "]");
-    sk_cli_ok(ctx, buf);
-    free(buf);
+    sk_cli_json_finish(&j);
     return SK_OK;
 }
 
@@ -1919,7 +1851,10 @@ static const sk_cli_command_t s_cmds[] = {
 
 static void fire_class_for_event(const sk_event_t *evt, sk_api_trigclass_t cls)
 {
-    const char *pj = (evt && evt->payload_json) ? evt->payload_json : "{}";
+    // timer.alarm / timer.triggered are typed events; the webhook body
+    // wants their JSON form.
+    const char *pj = sk_event_json(evt);
+    if (!pj) pj = "{}";
     // Runs synchronously on the publisher (timer) task — keep the stack
     // footprint small. Timer payloads are tiny ({"duration_sec":N} etc.),
     // so 256 bytes is ample; chain_run copies it into its own job buffer.
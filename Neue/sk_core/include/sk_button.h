@@ -3,6 +3,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include "esp_err.h"
+#include "sk_event_bus.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -27,6 +28,21 @@ typedef void (*sk_button_cb_t)(sk_button_event_t evt, uint32_t meta, void *user)
 
 esp_err_t sk_button_init(const sk_button_cfg_t *cfg, sk_button_cb_t cb, void *user);
 
+// Typed event payloads (see sk_event_data()). JSON rendering is unchanged
+// for peers: {"duration_ms":N} / {"count":N}.
+typedef struct {
+    uint32_t duration_ms;
+} sk_button_press_evt_t;
+
+typedef struct {
+    uint32_t count;
+} sk_button_tap_evt_t;
+
+// "button.released", "button.pressed", "button.long-press"
+extern const sk_event_type_t sk_button_press_evt_type;
+// "button.multi-tap"
+extern const sk_event_type_t sk_button_tap_evt_type;
+
 // Returns true if the button is currently physically pressed.
 bool sk_button_is_pressed(void);
 
@@ -16,6 +16,7 @@ typedef struct sk_cli_ctx sk_cli_ctx_t;
 // Handler contract. Writes response via sk_cli_write_ok / sk_cli_write_err.
 // Returning a non-SK_OK value causes the dispatcher to emit an error
 // envelope automatically if the handler did not already call write_*.
+// SK_PENDING (after sk_cli_defer) means the reply comes later.
 typedef sk_err_t (*sk_cli_handler_t)(sk_cli_ctx_t *ctx);
 
 // Declarative command definition. All strings must have static lifetime
@@ -59,8 +60,32 @@ esp_err_t sk_cli_init(void);
 
 // Register a command. `cmd` and its string fields must remain valid for the
 // lifetime of the program — typically file-scope static structs.
+// A registered command overrides an SK_CLI_COMMAND of the same name.
 esp_err_t sk_cli_register(const sk_cli_command_t *cmd);
 
+// Link-time registration. Places the descriptor in the `.sk_cli_cmds.<name>`
+// flash section; sk_core's linker.lf collects those sorted by section name
+// (= strcmp order of the command name), so lookup binary-searches them in
+// place: no RAM slot, no sk_cli_register() call, no table cap.
+//
+//   SK_CLI_COMMAND(s_cmd_events_stats, "events.stats",
+//       .summary = "Event bus subscribers and delivery counters",
+//       .usage   = "events stats",
+//       .handler = cmd_events_stats);
+//
+// `name` must be a string literal. The command is live from boot, before
+// the owning component's init ran — use it for handlers that cope with
+// that, keep sk_cli_register() for ones that need init state first. The
+// object file must be linked in for another reason (e.g. its init function
+// is called); a file holding nothing but commands is dropped by the linker.
+// The explicit alignment stops the compiler from padding descriptors
+// apart — the section must read back as a plain array.
+#define SK_CLI_COMMAND(ident, cmd_name, ...)                                  \
+    static const sk_cli_command_t ident                                       \
+        __attribute__((used, aligned(__alignof__(sk_cli_command_t)),          \
+                       section(".sk_cli_cmds." cmd_name))) = {                \
+            .name = cmd_name, __VA_ARGS__ }
+
 // Primary entrypoint: feed a single line (no trailing newline). Detects
 // machine vs human mode on the fly (leading '{' = machine). The response —
 // whether ok envelope, error envelope, or multi-line inline-help — is
@@ -90,6 +115,12 @@ const char    *sk_cli_arg_named(sk_cli_ctx_t *ctx, const char *key);     // --ke
 // *out_value on success; returns false if the key is absent or the value
 // is not a parseable integer.
 bool           sk_cli_arg_long(sk_cli_ctx_t *ctx, const char *key, long *out_value);
+// List argument: machine mode args[key] as a JSON array of strings (a
+// lone string counts as a one-element list), human mode every positional
+// word (`events subscribe timer.* relay.*`). Fills out[] with pointers
+// valid for the handler call and returns the count; 0 when absent, -1
+// for a non-string element or more than `max` entries.
+int            sk_cli_arg_list(sk_cli_ctx_t *ctx, const char *key, const char **out, int max);
 
 // Keyword-pair argument lookup for human mode (and machine-mode JSON key
 // fallback). Returns the token immediately FOLLOWING `keyword` in argv,
@@ -117,6 +148,52 @@ bool           sk_cli_is_authenticated(sk_cli_ctx_t *ctx);               // true
 void           sk_cli_write(sk_cli_ctx_t *ctx, const char *chunk, size_t len);
 void           sk_cli_writef(sk_cli_ctx_t *ctx, const char *fmt, ...);
 
+// Push anything sk_cli_write has buffered for this response to the
+// transport now. The dispatcher flushes when the handler returns; call
+// this only before a long wait mid-response (progress lines).
+void           sk_cli_flush(sk_cli_ctx_t *ctx);
+
+// === Output coalescing ======================================================
+//
+// sk_cli_writef / sk_cli_kv / the pretty-printer produce many small writes;
+// handed straight to the transport each one is a send() on TCP and at least
+// one notify PDU on BLE. The dispatcher therefore routes sk_cli_write
+// through a coalescer for the duration of one command and flushes it at
+// envelope end. Transports can wrap their own multi-part output the same
+// way:
+//
+//   sk_cli_coalesce_t out;
+//   sk_cli_coalesce_init(&out, ble_writer, NULL);
+//   sk_cli_coalesce_writer(part1, n1, &out);   // an sk_cli_writer_t
+//   sk_cli_coalesce_writer(part2, n2, &out);
+//   sk_cli_coalesce_flush(&out);
+//
+// A coalescer belongs to one task and one response; it has no lock. Code
+// that keeps writing after the handler returned (async replies, log tails)
+// must capture the transport's own writer, never a coalescer.
+#define SK_CLI_COALESCE_BUF   512
+
+typedef struct {
+    sk_cli_writer_t  sink;
+    void            *sink_user;
+    uint16_t         limit;       // flush threshold, whole segments
+    uint16_t         len;
+    char             buf[SK_CLI_COALESCE_BUF];
+} sk_cli_coalesce_t;
+
+void           sk_cli_coalesce_init(sk_cli_coalesce_t *c, sk_cli_writer_t sink, void *sink_user);
+// sk_cli_writer_t-compatible; `user` is the coalescer. len == 0 flushes.
+void           sk_cli_coalesce_writer(const char *chunk, size_t len, void *user);
+void           sk_cli_coalesce_flush(sk_cli_coalesce_t *c);
+
+// Tell coalescers how many bytes `writer` puts in one packet (BLE: ATT_MTU
+// - 3). Buffers then flush in whole packets instead of leaving a short
+// one every SK_CLI_COALESCE_BUF bytes. `user` narrows the entry to one
+// writer_user (a session handle); NULL matches any. 0 forgets the entry.
+// Writers never registered (TCP, USB) just get SK_CLI_COALESCE_BUF-sized
+// writes.
+esp_err_t      sk_cli_set_writer_segment(sk_cli_writer_t writer, void *user, size_t segment);
+
 // Structured usage hint. In HUMAN mode prints (no leading "error:" — the
 // caller decides whether this is an error or just a discovery aid):
 //
@@ -172,6 +249,103 @@ size_t         sk_cli_fmt_duration(char *out, size_t cap, uint32_t seconds);
 void           sk_cli_ok(sk_cli_ctx_t *ctx, const char *data_json_or_null);
 void           sk_cli_err(sk_cli_ctx_t *ctx, sk_err_t err, const char *params_json_or_null);
 
+// Streaming alternative to sk_cli_ok for responses whose size depends on
+// runtime state (command lists, endpoint tables, group lists). Instead of
+// snprintf'ing the whole data payload into a buffer sized for the worst
+// case, the handler emits it value by value; output goes to the transport
+// in SK_CLI_JSON_CHUNK-sized pieces, so the response has no size limit
+// and the stack cost is this struct.
+//
+//   sk_cli_json_t j;
+//   sk_cli_json_begin(&j, ctx);           // envelope / "ok." prefix
+//   sk_cli_json_begin_array(&j);
+//   sk_cli_json_begin_object(&j);
+//   sk_cli_json_key(&j, "id");   sk_cli_json_number(&j, 3);
+//   sk_cli_json_key(&j, "name"); sk_cli_json_string(&j, name);
+//   sk_cli_json_end(&j);
+//   sk_cli_json_end(&j);
+//   sk_cli_json_finish(&j);               // closes anything still open
+//
+// MACHINE mode produces exactly what sk_cli_ok(ctx, "<data>") would, with
+// strings escaped inline. HUMAN mode produces the same layout sk_cli_ok's
+// pretty-printer renders for that data. Commas are tracked here; the
+// caller is responsible for key/value alternation inside objects.
+// finish() sets ctx->wrote_envelope, so do not call sk_cli_ok/err after
+// begin() — an error discovered mid-stream has to be reported in-band.
+#define SK_CLI_JSON_CHUNK   128
+#define SK_CLI_JSON_DEPTH   15      // nested containers; deeper ones are dropped
+
+typedef struct {
+    sk_cli_ctx_t *ctx;
+    uint16_t      is_obj;     // bit d: container at depth d is an object
+    uint16_t      has_item;   // bit d: depth d is non-empty (0 = data root)
+    uint8_t       depth;
+    uint8_t       skip;       // containers opened past SK_CLI_JSON_DEPTH
+    uint8_t       indent;     // human mode: enclosing object count
+    bool          after_key;
+    uint16_t      len;
+    char          buf[SK_CLI_JSON_CHUNK];
+} sk_cli_json_t;
+
+void           sk_cli_json_begin(sk_cli_json_t *j, sk_cli_ctx_t *ctx);
+void           sk_cli_json_begin_object(sk_cli_json_t *j);
+void           sk_cli_json_begin_array(sk_cli_json_t *j);
+void           sk_cli_json_end(sk_cli_json_t *j);
+void           sk_cli_json_key(sk_cli_json_t *j, const char *key);
+void           sk_cli_json_string(sk_cli_json_t *j, const char *s);   // NULL -> ""
+void           sk_cli_json_number(sk_cli_json_t *j, int64_t v);
+void           sk_cli_json_bool(sk_cli_json_t *j, bool v);
+void           sk_cli_json_null(sk_cli_json_t *j);
+void           sk_cli_json_finish(sk_cli_json_t *j);
+
+// === Deferred responses =====================================================
+//
+// For handlers whose answer takes seconds (wifi.scan, smtp.test). Instead
+// of blocking the transport task or spawning a task of its own, the
+// handler takes a completion token, queues the slow part on sk_cli's
+// shared async workers and returns SK_PENDING:
+//
+//   static void scan_job(sk_cli_pending_t *p, void *arg)
+//   {
+//       ...                                  // sk_cli async worker
+//       sk_cli_complete(p, "[...]");         // or sk_cli_complete_err
+//   }
+//
+//   sk_cli_pending_t *p = sk_cli_defer(ctx);
+//   if (!p) { sk_cli_err(ctx, SK_ERR_BUSY, "{\"reason\":\"pending_full\"}"); return SK_OK; }
+//   if (sk_cli_async(p, scan_job, NULL) != ESP_OK) {
+//       sk_cli_complete_err(p, SK_ERR_INTERNAL, "{\"reason\":\"async_queue\"}");
+//   }
+//   return SK_PENDING;
+//
+// The token remembers the originating writer, mode and request id, so the
+// completion — from any task — is the same envelope (or human "ok." block)
+// sk_cli_ok/err would have produced inline, sent to the session that
+// asked. Session transports hand sk_cli a writer that goes quiet once the
+// connection is gone, so a late completion is simply dropped. Every token
+// must be completed exactly once; completing frees it. In a batch the
+// item's slot reads {"id":N,"async":true} and the envelope follows on its
+// own line.
+#define SK_CLI_PENDING_MAX   8
+
+typedef struct sk_cli_pending sk_cli_pending_t;
+typedef void (*sk_cli_async_fn_t)(sk_cli_pending_t *p, void *arg);
+
+// NULL when SK_CLI_PENDING_MAX replies are already outstanding.
+sk_cli_pending_t *sk_cli_defer(sk_cli_ctx_t *ctx);
+void           sk_cli_complete(sk_cli_pending_t *p, const char *data_json_or_null);
+void           sk_cli_complete_err(sk_cli_pending_t *p, sk_err_t err, const char *params_json_or_null);
+
+// Run fn(p, arg) on one of sk_cli's async workers (up to 2, 8 KB stack
+// each — enough for an esp_tls handshake). Jobs start in FIFO order; the
+// second worker is created the first time a job arrives while the first
+// one is busy, so one slow job (smtp.test) never delays another (wifi.scan).
+// Two slow jobs at once still queue the rest. `p` may be NULL for
+// background work that has already replied (wifi.connect).
+// ESP_ERR_NO_MEM / ESP_ERR_TIMEOUT when no worker can be started or the
+// queue is full; fn has then not been called.
+esp_err_t      sk_cli_async(sk_cli_pending_t *p, sk_cli_async_fn_t fn, void *arg);
+
 // Walk registered commands — used by `help` and sk_capabilities.
 typedef void (*sk_cli_walk_cb_t)(const sk_cli_command_t *cmd, void *user);
 void           sk_cli_walk(sk_cli_walk_cb_t cb, void *user);
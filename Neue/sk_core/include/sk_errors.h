@@ -72,10 +72,13 @@ extern "C" {
     X(SK_ERR_API_NOT_CONFIGURED,       "ERR_API_NOT_CONFIGURED",       "Endpoint missing required field")    \
     X(SK_ERR_API_DISABLED,             "ERR_API_DISABLED",             "API master switch is off")           \
     X(SK_ERR_API_OFFLINE,              "ERR_API_OFFLINE",              "WiFi STA not connected")             \
+    /* event stream */                                                          \
+    X(SK_ERR_EVENTS_GAP,               "ERR_EVENTS_GAP",               "Missed events no longer in history; resync") \
     /* internal / catch-all */                                                  \
     X(SK_ERR_INTERNAL,                 "ERR_INTERNAL",                 "Internal device error")
 
 typedef enum {
+    SK_PENDING = -1,    // handler deferred its reply (sk_cli_defer); never on the wire
     SK_OK = 0,
 #define X(sym, ...) sym,
     SK_ERROR_TABLE(X)
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "esp_err.h"
@@ -9,14 +10,43 @@
 extern "C" {
 #endif
 
+#include <stdarg.h>
+
+// Refcounted, immutable JSON payload. Allocated from a small slab pool
+// inside the bus (heap fallback for large or pool-exhausted payloads) and
+// shared by reference between the publisher, every subscriber and every
+// async queue — formatted once, never copied per hop, freed when the last
+// holder releases it.
+typedef struct sk_event_payload sk_event_payload_t;
+
+// Descriptor of a typed event payload. A typed event carries the
+// producer's plain C struct instead of a JSON string: local subscribers
+// read fields through sk_event_data(), and `render_json` runs only when
+// something asks for the JSON (sk_event_json(), i.e. a transport forwarding
+// the event to a peer) — at most once per event, the result is cached.
+// Descriptors are static const objects owned by the producer; subscribers
+// match on the descriptor's address, so declare it `extern` in the
+// producer's public header.
+typedef struct sk_event_type {
+    const char *name;   // diagnostic label, e.g. "timer.alarm"
+    size_t      size;   // sizeof the payload struct (copied at publish)
+    // Write the JSON object for `data` into out[cap] with snprintf
+    // semantics: return the full length, truncate if it doesn't fit.
+    int       (*render_json)(const void *data, char *out, size_t cap);
+} sk_event_type_t;
+
 // An event as delivered to subscribers. All fields are owned by the bus and
-// valid only for the duration of the handler call — copy strings out if you
-// need to keep them.
+// valid only for the duration of the handler call. To keep the payload,
+// retain `payload` (or sk_event_payload_get(evt)) instead of copying the
+// string.
 typedef struct {
-    const char *name;         // e.g. "timer.tick", not NULL
-    uint32_t    seq;          // monotonic, starts at 1
-    int64_t     ts_uptime_us; // esp_timer_get_time() at publish
-    const char *payload_json; // JSON object body, may be NULL if event has no data
+    const char         *name;         // e.g. "timer.tick", not NULL
+    uint32_t            seq;          // monotonic, starts at 1
+    int64_t             ts_uptime_us; // esp_timer_get_time() at publish
+    const char         *payload_json; // JSON object body, NULL if event has no data
+                                      // or is typed — prefer sk_event_json(evt)
+    sk_event_payload_t *payload;      // backing object (JSON or typed), NULL for a
+                                      // borrowed string (plain publish, SYNC only)
 } sk_event_t;
 
 typedef void (*sk_event_handler_t)(const sk_event_t *evt, void *user_ctx);
@@ -30,21 +60,187 @@ esp_err_t sk_event_bus_init(void);
 //   "*"         — all events
 // Returns a handle in `out_sub_id` for later unsubscribe. `user_ctx` is
 // passed verbatim to the handler.
+//
+// Subscribe/unsubscribe recompile the bus's topic index (exact-name hash +
+// prefix trie) and swap it in, so they cost a heap allocation; publish
+// itself takes no lock. Neither blocks on in-flight publishers: the old
+// index is retired by epoch and freed once no publisher can still be
+// reading it. (Only a subscribe that finds the table full while
+// unsubscribed slots are still retiring waits, a few ticks at most.)
+// Subscribe at init, not per event.
 esp_err_t sk_event_bus_subscribe(const char         *filter,
                                  sk_event_handler_t  handler,
                                  void               *user_ctx,
                                  int                *out_sub_id);
 
+// Delivery mode for a subscription. SYNC is the legacy behaviour of
+// sk_event_bus_subscribe(): the handler runs on the publisher's task, inside
+// sk_event_bus_publish(). The async modes copy the event once per publish
+// and hand it over through a bounded FreeRTOS queue, so the publisher never
+// waits on the handler — use them for anything that may block (BLE notify
+// retries, socket writes, NVS commits).
+typedef enum {
+    SK_EVT_DELIVER_SYNC = 0,    // publisher task (default)
+    SK_EVT_DELIVER_DISPATCHER,  // shared "sk_evt_disp" task, shared queue
+    SK_EVT_DELIVER_QUEUE,       // own task + own bounded queue
+} sk_event_delivery_t;
+
+// What to do when an async queue is full at publish time. The publisher
+// never blocks either way; the subscriber's drop counter is bumped.
+// DISPATCHER mode always drops the newest event — evicting from the shared
+// queue would punish other subscribers for one slow handler.
+typedef enum {
+    SK_EVT_DROP_NEWEST = 0,     // discard the event being published
+    SK_EVT_DROP_OLDEST,         // evict the oldest queued event, enqueue new
+} sk_event_drop_policy_t;
+
+typedef struct {
+    sk_event_delivery_t     delivery;
+    sk_event_drop_policy_t  drop_policy;    // QUEUE mode only
+    uint16_t                queue_depth;    // QUEUE mode; 0 = default (16)
+    uint32_t                task_stack;     // QUEUE mode; 0 = default (4096)
+    uint8_t                 task_priority;  // QUEUE mode; 0 = default (4)
+    const char             *task_name;      // QUEUE mode; NULL = "sk_evt_q"
+    uint32_t                coalesce_ms;    // QUEUE mode; min spacing of coalesced
+                                            // topics, 0 = default (1000)
+} sk_event_sub_opts_t;
+
+// Like sk_event_bus_subscribe(), with an explicit delivery mode. `opts` may
+// be NULL (== SYNC). Async handlers see the same sk_event_t contract —
+// fields valid only for the duration of the call — but run on the
+// dispatcher / own task, after the publisher has already returned.
+esp_err_t sk_event_bus_subscribe_ex(const char                *filter,
+                                    sk_event_handler_t         handler,
+                                    void                      *user_ctx,
+                                    const sk_event_sub_opts_t *opts,
+                                    int                       *out_sub_id);
+
+// Unsubscribing an async subscriber stops delivery immediately: events still
+// queued for it are released without calling the handler. A QUEUE-mode
+// subscriber's task exits on its own once it sees the stop marker, so this
+// is safe to call from inside that subscriber's handler.
 esp_err_t sk_event_bus_unsubscribe(int sub_id);
 
+#define SK_EVENT_BUS_FILTER_MAXLEN  48
+
+// Latest-value topics. Events published under a coalesced name (exact name,
+// no wildcards) are not queued for QUEUE-mode subscribers: each such
+// subscriber keeps one slot per coalesced topic holding only the newest
+// event, replacing whatever was still pending. Its task delivers the slot
+// as soon as its queue is idle, and between queued events under backlog,
+// but never more often than the subscriber's `coalesce_ms`. A slow peer
+// link therefore sees the newest `timer.tick`, never a backlog of stale
+// ones. A coalesced event may overtake events published before it; `seq`
+// keeps the publish order. SYNC and DISPATCHER subscribers are unaffected.
+// At most SK_EVENT_BUS_MAX_COALESCED topics, registered at init; cannot be
+// undone.
+#define SK_EVENT_BUS_MAX_COALESCED  4
+esp_err_t sk_event_bus_set_coalesced(const char *name);
+
+// Retained topics, in the spirit of MQTT retained messages: the bus keeps
+// the last event of every name matching a retained filter (exact or
+// "prefix.*"), so a peer that connects later can be handed the current
+// state without polling each component's *.status command. Producers
+// register their state topics at init. Up to SK_EVENT_BUS_MAX_RETAINED
+// distinct names are kept; further names are not retained (logged).
+#define SK_EVENT_BUS_MAX_RETAINED  16
+esp_err_t sk_event_bus_set_retained(const char *filter);
+
+// Call `fn` for every retained event, oldest seq first, on the caller's
+// task. The sk_event_t contract holds (valid for the duration of the call;
+// sk_event_json()/sk_event_data() work). Returns the number of events.
+size_t sk_event_bus_for_each_retained(sk_event_handler_t fn, void *user_ctx);
+
+// Event history for resumable peer streams. Once enabled, the bus keeps the
+// most recent events a peer would be forwarded (everything except auth.*
+// and coalesced topics) as ready-made NDJSON objects —
+// {"evt":"<name>","seq":N,"data":{...}}, the BLE forwarder's line format —
+// in a SK_EVENT_BUS_HISTORY_BYTES ring, fed from the dispatcher task. A peer
+// that lost its link replays what it missed with `events.since <seq>`.
+#define SK_EVENT_BUS_HISTORY_BYTES  4096
+esp_err_t sk_event_bus_history_enable(void);
+
+typedef struct {
+    uint32_t seq;      // bus seq at the time of the call
+    uint32_t oldest;   // smallest `since` the history can still answer
+    size_t   count;    // events written to `out`
+    size_t   len;      // bytes written to `out`, excluding the terminator
+} sk_event_history_t;
+
+// Write every history event with seq > `since` into `out` as a
+// comma-separated list of JSON objects (oldest first), NUL-terminated.
+// Returns ESP_ERR_NOT_FOUND when the peer cannot be resumed: events after
+// `since` were already evicted or dropped, or `since` is ahead of the bus
+// (the device rebooted) — the peer must resync through the *.status
+// commands. ESP_ERR_INVALID_SIZE if `cap` is too small (allow
+// SK_EVENT_BUS_HISTORY_BYTES), ESP_ERR_INVALID_STATE if not enabled.
+esp_err_t sk_event_bus_history_since(uint32_t since, char *out, size_t cap,
+                                     sk_event_history_t *res);
+
+// Per-subscriber delivery counters (see `events stats`).
+typedef struct {
+    int                  sub_id;
+    char                 filter[SK_EVENT_BUS_FILTER_MAXLEN];
+    sk_event_delivery_t  delivery;
+    uint16_t             queue_depth;   // 0 for SYNC
+    uint16_t             queue_hwm;     // highest queue fill seen at publish
+    uint32_t             delivered;     // handler invocations
+    uint32_t             dropped;       // events lost to a full queue / OOM
+    uint32_t             coalesced;     // superseded in a latest-value slot
+} sk_event_sub_stats_t;
+
+// Copy up to `max` subscriber stat records into `out`. Returns the number
+// written. Pass `out_total` to learn how many subscribers exist.
+size_t sk_event_bus_get_stats(sk_event_sub_stats_t *out, size_t max, size_t *out_total);
+
 // Publish an event. `payload_json` may be NULL or a JSON object/array string
-// (caller-owned; the bus copies it for each delivery if needed). Handlers
-// are called synchronously on the publisher task — keep them short. Use an
-// internal FreeRTOS queue inside a handler if heavy work is required.
+// (caller-owned, borrowed for the call; the bus copies it into one payload
+// object only if an async subscriber matches).
+// SYNC handlers are called on the publisher task — keep them short; async
+// subscribers only cost a queue send here.
 void sk_event_bus_publish(const char *name, const char *payload_json);
 
-// Convenience: publish with a printf-formatted JSON payload.
-void sk_event_bus_publishf(const char *name, const char *payload_fmt, ...);
+// Convenience: publish with a printf-formatted JSON payload. Formats once,
+// straight into a pooled payload object — no size limit, no truncation.
+void sk_event_bus_publishf(const char *name, const char *payload_fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+// Publish a payload object. Consumes the caller's reference: do not touch
+// `payload` afterwards unless you retained it first. NULL == no data.
+void sk_event_bus_publish_payload(const char *name, sk_event_payload_t *payload);
+
+// Publish a typed event: `data` (type->size bytes) is copied into a pooled
+// payload object. No JSON is produced unless a subscriber asks for it.
+void sk_event_bus_publish_typed(const char *name, const sk_event_type_t *type,
+                                const void *data);
+
+// Typed view of an event: the payload struct if the event was published
+// with exactly `type`, else NULL (JSON publish, other type, no data).
+const void *sk_event_data(const sk_event_t *evt, const sk_event_type_t *type);
+
+// JSON view of an event, whatever way it was published: payload_json as is,
+// or the typed payload rendered (once, cached on the payload). Valid for
+// the duration of the handler. NULL if the event has no data (or OOM).
+const char *sk_event_json(const sk_event_t *evt);
+
+// -- Payload objects ---------------------------------------------------------
+// All constructors return a payload holding one reference, or NULL on OOM.
+
+sk_event_payload_t *sk_event_payload_new(const char *json);
+sk_event_payload_t *sk_event_payload_printf(const char *fmt, ...)
+    __attribute__((format(printf, 1, 2)));
+sk_event_payload_t *sk_event_payload_vprintf(const char *fmt, va_list ap);
+sk_event_payload_t *sk_event_payload_typed(const sk_event_type_t *type, const void *data);
+
+sk_event_payload_t *sk_event_payload_retain(sk_event_payload_t *p);  // returns p
+void                sk_event_payload_release(sk_event_payload_t *p); // NULL-safe
+const char         *sk_event_payload_json(const sk_event_payload_t *p);  // renders typed
+size_t              sk_event_payload_len(const sk_event_payload_t *p);   // JSON length
+
+// New reference to an event's payload from inside a handler: retains
+// evt->payload when present, otherwise copies evt->payload_json. NULL if
+// the event has no data (or OOM).
+sk_event_payload_t *sk_event_payload_get(const sk_event_t *evt);
 
 // Returns the next sequence number without publishing — rarely needed, useful
 // when building a snapshot that must align with a future event stream.
@@ -7,10 +7,13 @@
 // write into the on-device ring buffer that `logs.get` returns.
 //
 // Concurrency: sk_log_event is non-blocking and safe to call from any
-// task including NimBLE host. The call formats into a stack buffer and
-// pushes a record onto a FreeRTOS queue; a dedicated background task
-// drains the queue and writes the ring under a mutex. Queue full means
+// task including NimBLE host. The call does not format: it copies the
+// fmt pointer and raw argument values into a small record on a ring
+// buffer; a dedicated background task formats, then writes the ring
+// under a mutex. Queue full means
 // the entry is silently dropped (best-effort), never blocks the caller.
+// The ring stores variable-length packed records and collapses identical
+// consecutive entries into one with a repeat count (see sk_log.c).
 
 #include <stdarg.h>
 #include <stdbool.h>
@@ -38,10 +41,10 @@ esp_err_t sk_log_init(void);
 // Write one event. `tag` is the component name (e.g. "wifi"), `event`
 // is the dot-event name (e.g. "connect.fail"). `fmt` and args build the
 // `msg` payload (key=value style recommended, e.g. "ssid=Home rssi=-52").
-// All string arguments to the resulting `msg` must outlive the call;
-// the implementation copies into the queue record. `tag` and `event`
-// pointers are stored as-is so they MUST have static lifetime (string
-// literals).
+// %s arguments only need to outlive the call; their content is copied
+// into the queue record. `tag`, `event` and `fmt` pointers are stored
+// as-is (formatting is deferred to the drain task) so they MUST have
+// static lifetime (string literals).
 void sk_log_event(sk_log_level_t level,
                   const char *tag, const char *event,
                   const char *fmt, ...) __attribute__((format(printf, 4, 5)));
@@ -65,6 +68,9 @@ typedef struct {
     const char    *tag;           // static literal, no lifetime concern
     const char    *event;         // static literal
     const char    *msg;           // valid only during the callback
+    uint32_t       repeat;        // >1: identical consecutive entries
+                                  // collapsed into this one (ts = first)
+    uint32_t       boot;          // boot counter (0 without a log partition)
 } sk_log_entry_view_t;
 
 // Return false from the callback to stop walking early.
@@ -77,6 +83,52 @@ typedef bool (*sk_log_walk_cb_t)(const sk_log_entry_view_t *entry, void *user);
 void sk_log_walk(sk_log_level_t min_level, size_t max_count,
                  sk_log_walk_cb_t cb, void *user);
 
+// Boot counter kept by the flash log store: 1 on the first boot after the
+// log partition was erased, +1 every boot. 0 when the partition table has
+// no "sklog" partition (RAM-only logging).
+uint32_t sk_log_boot_count(void);
+
+// Walk entries persisted on flash (oldest first), across reboots.
+//   boot   — only entries of this boot; 0 = all boots still on flash
+//   since  — cursor: skip entries stored before it; 0 = from the oldest
+//   next   — receives the cursor to pass as `since` to continue after the
+//            last entry delivered (stable across reboots)
+// Pending writes are flushed first, so the result includes the newest
+// entries. Returning false from cb means the entry was NOT consumed
+// (e.g. the caller's buffer is full): `next` then points at it.
+// tag/event/msg point into walk-local buffers, valid only during the
+// callback. ESP_ERR_NOT_SUPPORTED without a log partition.
+esp_err_t sk_log_walk_stored(uint32_t boot, uint64_t since,
+                             sk_log_level_t min_level, size_t max_count,
+                             sk_log_walk_cb_t cb, void *user, uint64_t *next);
+
+// --- Live tail ---------------------------------------------------------------
+// Push new entries to a session as they are logged (`logs.tail`). Lines are
+// batched by the sk_log drain task and written by a per-subscription sender
+// task as one NDJSON event:
+//   {"evt":"log.lines","data":{"lines":[{ts,up_us,lvl,tag,event,msg},...]}}
+// A batch that finds the previous one still being written is dropped; the
+// next one then carries "dropped":N after "lines".
+// Same shape as sk_cli_writer_t so a CLI context's writer can be passed.
+typedef void (*sk_log_tail_writer_t)(const char *chunk, size_t len, void *user);
+
+#define SK_LOG_TAIL_MAX      4    // concurrent subscriptions
+#define SK_LOG_TAIL_TAGS     4    // tag filter entries per subscription
+#define SK_LOG_TAIL_TAG_MAX  15
+
+// Subscribe (writer, user) to entries >= min_level. tags_csv ("wifi,ble")
+// restricts to those tags; NULL or "" = all. Replaces an existing
+// subscription of the same (writer, user). ESP_ERR_INVALID_ARG for a bad
+// tag list, ESP_ERR_NO_MEM when all slots are taken.
+esp_err_t sk_log_tail_start(sk_log_tail_writer_t writer, void *user,
+                            sk_log_level_t min_level, const char *tags_csv);
+
+// Drop the subscription of (writer, user); pending lines are discarded.
+// Safe to call when none exists (returns false). Never waits: a write
+// already in flight finishes on the sender task, so `writer` must ignore
+// writes for a connection that is gone (session handle writers do).
+bool sk_log_tail_stop(sk_log_tail_writer_t writer, void *user);
+
 // Returns the textual level name ("D" / "I" / "W" / "E"). Always a
 // valid one-char static string.
 const char *sk_log_level_str(sk_log_level_t level);
@@ -9,14 +9,17 @@ extern "C" {
 
 typedef struct {
     uint16_t port;           // default 8080
-    uint8_t  max_clients;    // default 2
+    uint8_t  max_clients;    // default 4 (also the ceiling)
     int      task_priority;  // default 4
-    int      task_stack;     // default 6144
+    int      task_stack;     // default 10240; the one select() loop task
 } sk_transport_tcp_cfg_t;
 
-// Bring up the TCP NDJSON server. Starts listening only once WiFi STA is
-// connected (subscribes to wifi.state). Each accepted client must complete
-// Mutual Challenge-Response within 5 s or the connection is dropped.
+// Bring up the TCP NDJSON server. The listener binds at init; wifi.state
+// only respawns it if socket setup failed. Each accepted client must
+// complete Mutual Challenge-Response within 5 s or the connection is
+// dropped. A full server makes room only by evicting a client that has not
+// authenticated or has been silent for 2 min; otherwise it refuses the
+// newcomer.
 esp_err_t sk_transport_tcp_init(const sk_transport_tcp_cfg_t *cfg);
 
 #ifdef __cplusplus
@@ -2,6 +2,7 @@
 
 #include <stdbool.h>
 #include "esp_err.h"
+#include "sk_event_bus.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -25,6 +26,20 @@ typedef struct {
     bool static_ip;
 } sk_wifi_status_t;
 
+// Typed payload of the "wifi.state" event (see sk_event_data()). `state`
+// is one of "connecting" / "connected" / "disconnected" and, like `slot`
+// ("primary" / "backup" / "none"), points at a string literal.
+typedef struct {
+    const char *state;
+    char        ssid[SK_WIFI_SSID_MAX + 1];
+    char        ip[16];
+    int         rssi;
+    bool        static_ip;
+    const char *slot;
+} sk_wifi_state_evt_t;
+
+extern const sk_event_type_t sk_wifi_state_evt_type;
+
 // Initialize WiFi STA (no SoftAP). Reads primary credentials from NVS and
 // auto-connects on boot. Publishes wifi.state events.
 esp_err_t sk_wifi_init(void);
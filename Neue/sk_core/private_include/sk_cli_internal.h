@@ -1,21 +1,28 @@
 #pragma once
 
 #include "sk_cli.h"
-#include "cJSON.h"
+#include "sk_json_tok.h"
 
 // Internal CLI context, exposed only to sk_cli_*.c files via private_include.
 
 struct sk_cli_ctx {
     bool              is_machine_mode;
+    // The transport's own writer. Stays valid after the handler returns,
+    // so async replies (wifi.scan) and logs.tail capture this pair.
     sk_cli_writer_t   writer;
     void             *writer_user;
+    // Per-dispatch coalescer (dispatcher's stack) that sk_cli_write goes
+    // through; NULL routes straight to `writer`.
+    sk_cli_coalesce_t *out;
     const char       *command_name;      // canonical name ("timer.set")
     const char       *confirm_token;
     bool              authenticated;     // dispatched via *_authenticated path
 
-    // Machine mode: parsed top-level JSON object (owned by dispatcher).
-    cJSON            *machine_msg;
-    cJSON            *machine_args;      // borrowed
+    // Machine mode: the line tokenized in place (sk_json_tok); buffer and
+    // token array live on the dispatcher's stack.
+    const char       *machine_json;
+    const sk_jtok_t  *machine_toks;
+    int               machine_args;      // token index of "args", -1 if absent
     int               machine_id;        // request id, -1 if absent
 
     // Human mode: tokenized args past the command words.
@@ -25,4 +32,34 @@ struct sk_cli_ctx {
     // Set once the handler called sk_cli_ok/err so the dispatcher does not
     // auto-emit.
     bool              wrote_envelope;
+    // Last code passed to sk_cli_err (SK_OK if none) — cli.stats errors.
+    sk_err_t          err;
+
+    // Item of a {"batch":[...]} line: sk_cli_write drops newlines so the
+    // envelope nests in the combined response, and counts what it wrote.
+    bool              in_batch;
+    size_t            batch_bytes;
 };
+
+// === Per-command statistics (sk_cli_stats.c) ================================
+//
+// The dispatcher brackets every handler call with begin/end; cli.stats
+// reads the result. sk_cli_err feeds the error-by-code counters, which
+// also see errors no handler produced (unknown command, auth).
+
+typedef struct {
+    int64_t  t0_us;
+    uint32_t heap0;
+} sk_cli_stats_mark_t;
+
+void sk_cli_stats_begin(sk_cli_stats_mark_t *m);
+void sk_cli_stats_end(const sk_cli_stats_mark_t *m, const sk_cli_command_t *cmd,
+                      sk_err_t rc, sk_err_t err);
+void sk_cli_stats_error(sk_err_t err);
+
+// Stable small index per command for per-command tables: registered
+// commands first (0..SK_CLI_MAX_COMMANDS-1), then the SK_CLI_COMMAND
+// array. -1 for a descriptor sk_cli does not know. A registration that
+// replaces a name keeps its slot.
+int  sk_cli_command_slots(void);
+int  sk_cli_command_slot(const sk_cli_command_t *cmd);
@@ -0,0 +1,95 @@
+// sk_event_bus_internal.h — sk_core-private event bus hooks.
+//
+// Not part of the public API: only sk_core's own CLI/diagnostics include
+// this header.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Payload/record slab pool occupancy. heap_allocs counts allocations that
+// missed the pool (too large, or the class was exhausted) since boot.
+typedef struct {
+    uint16_t small_free;
+    uint16_t small_total;
+    uint16_t large_free;
+    uint16_t large_total;
+    uint32_t heap_allocs;
+} sk_event_pool_stats_t;
+
+void sk_event_bus_pool_stats(sk_event_pool_stats_t *out);
+
+// Result of one sk_event_bus_bench() run. Index [0] is an event nobody in
+// the synthetic table subscribes to exactly ("timer.tick" — only prefix /
+// "*" hits), [1] one with exact subscribers ("timer.triggered").
+typedef struct {
+    int      subs;
+    uint32_t index_ns[2];   // topic index lookup, per publish
+    uint32_t linear_ns[2];  // legacy per-slot filter scan, per publish
+} sk_event_bench_t;
+
+// Resolve cost of publish vs. subscriber count. Builds a throwaway index
+// over `n_subs` synthetic filters (no handlers run, nothing is published)
+// so it is safe to call on a live device.
+esp_err_t sk_event_bus_bench(int n_subs, int iters, sk_event_bench_t *out);
+
+// True if `name` was registered with sk_event_bus_set_coalesced().
+bool sk_event_bus_is_coalesced(const char *name);
+
+// -- Per-session event push (sk_event_push.c) --------------------------------
+//
+// `events.subscribe` on a BLE / TCP session: every event matching one of
+// the session's filters is queued for it and written by that session's own
+// sk_evt_push sender task in the BLE forwarder's line format,
+//   {"evt":"<name>","seq":N,"data":{...}}
+// Sessions are keyed by their (writer, user) pair, like logs.tail, and
+// dropped by sk_secure_session_reset().
+
+#define SK_EVENT_PUSH_MAX      4    // sessions with a subscription
+#define SK_EVENT_PUSH_FILTERS  8    // filters per session
+#define SK_EVENT_PUSH_QUEUE    16   // events queued per session
+
+typedef void (*sk_event_push_writer_t)(const char *chunk, size_t len, void *user);
+
+// Subscribe the bus side once, at init. Each session's sender task starts
+// with its subscription.
+esp_err_t sk_event_push_init(void);
+
+// Replace (writer, user)'s filter set. Filters use the bus grammar
+// ("a.b", "a.*", "*"). ESP_ERR_INVALID_ARG for a bad filter or too many,
+// ESP_ERR_NO_MEM when every session slot is taken.
+esp_err_t sk_event_push_start(sk_event_push_writer_t writer, void *user,
+                              const char *const *filters, int n_filters);
+
+// Drop (writer, user)'s subscription and its queued events. Returns false
+// if it had none. Never waits: a write already in flight finishes on the
+// sender task, which then frees the slot — the session writer must
+// tolerate a call after its transport went away (sk_secure_session's does).
+bool sk_event_push_stop(sk_event_push_writer_t writer, void *user);
+
+// True if (writer, user) has a subscription. The BLE forwarder skips a
+// session that chose its own topics, so no event reaches it twice.
+bool sk_event_push_active(sk_event_push_writer_t writer, void *user);
+
+typedef struct {
+    uint8_t  filters;
+    uint8_t  queued;
+    uint8_t  queue_hwm;
+    uint32_t sent;
+    uint32_t dropped;    // oldest evicted from a full queue
+} sk_event_push_stats_t;
+
+// Snapshot of the active sessions, up to `max`. Returns the count.
+size_t sk_event_push_get_stats(sk_event_push_stats_t *out, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,64 @@
+// sk_json_tok.h — in-place JSON tokenizer for machine-mode dispatch.
+//
+// jsmn-style: the parser walks the caller's buffer once and fills a
+// caller-supplied token array — no heap, no tree. After a successful
+// parse every string token is unescaped and NUL-terminated in place and
+// every primitive is NUL-terminated too, so `json + tok.start` is a plain
+// C string for both. The buffer's JSON structure is destroyed in the
+// process; tokens are the only way back into it.
+//
+// Strict RFC 8259 subset: one top-level value, no trailing garbage,
+// strings must be valid escapes (\u0000 and lone surrogates rejected).
+// Offsets are 16-bit — inputs longer than SK_JTOK_MAX_LEN are refused.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SK_JTOK_MAX_LEN    0xFFFE
+#define SK_JTOK_MAX_DEPTH  16
+
+typedef enum {
+    SK_JTOK_OBJECT = 1,
+    SK_JTOK_ARRAY,
+    SK_JTOK_STRING,
+    SK_JTOK_PRIMITIVE,   // number, true, false, null
+} sk_jtok_type_t;
+
+typedef struct {
+    uint8_t  type;       // sk_jtok_type_t
+    uint16_t start;      // first byte (after the opening quote for strings)
+    uint16_t end;        // one past the last byte
+    uint16_t size;       // object: member count, array: element count
+    uint16_t next;       // index of the first token after this subtree
+} sk_jtok_t;
+
+// Parse errors (negative return of sk_json_tok_parse).
+#define SK_JTOK_ERR_NOMEM  (-1)   // more tokens than max_toks
+#define SK_JTOK_ERR_INVAL  (-2)   // malformed JSON, too deep or too long
+
+// Tokenize `json` (len bytes, modified in place). json[len] must be
+// writable — normally the string's NUL — since a trailing primitive is
+// terminated there. Token 0 is the top-level value; object members are
+// laid out key, value, key, value... Returns the token count or an
+// SK_JTOK_ERR_* code.
+int sk_json_tok_parse(char *json, size_t len, sk_jtok_t *toks, int max_toks);
+
+// Value token of member `key` in the object at index `obj`, or -1.
+int sk_json_tok_get(const char *json, const sk_jtok_t *toks, int obj, const char *key);
+
+// String token → C string; NULL for any other type or idx < 0.
+const char *sk_json_tok_str(const char *json, const sk_jtok_t *toks, int idx);
+
+// Numeric primitive → *out (strtod semantics). False for anything else.
+bool sk_json_tok_number(const char *json, const sk_jtok_t *toks, int idx, double *out);
+
+#ifdef __cplusplus
+}
+#endif
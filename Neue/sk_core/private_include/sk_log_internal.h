@@ -0,0 +1,45 @@
+// sk_log_internal.h — sk_core-private hooks between the sk_log drain task,
+// the flash segment store (sk_log_store.c) and live tails (sk_log_tail.c).
+//
+// Not part of the public API: readers use sk_log_walk_stored() from
+// sk_log.h. Only the drain task appends.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "sk_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Mount the "sklog" partition, write back a batch that survived a crash
+// in RTC memory, and open the next boot. ESP_ERR_NOT_FOUND when the
+// partition table has no log partition — sk_log then stays RAM-only.
+esp_err_t sk_log_store_init(void);
+
+// Queue one formatted entry into the write batch. The batch goes to
+// flash when full, when an error is logged, or once
+// sk_log_store_flush_in_ms() reaches 0.
+void sk_log_store_append(const sk_log_entry_view_t *e);
+
+// Milliseconds until the pending batch is due; UINT32_MAX when empty.
+uint32_t sk_log_store_flush_in_ms(void);
+
+void sk_log_store_flush(void);
+
+// Hand one formatted entry to every matching logs.tail subscription.
+void sk_log_tail_feed(const sk_log_entry_view_t *e);
+
+// Milliseconds until the oldest pending tail batch is due; UINT32_MAX
+// when nothing is pending.
+uint32_t sk_log_tail_flush_in_ms(void);
+
+void sk_log_tail_flush(void);
+
+#ifdef __cplusplus
+}
+#endif
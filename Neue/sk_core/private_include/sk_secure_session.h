@@ -21,7 +21,11 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
 
 #include "sk_auth.h"
 #include "sk_cli.h"
@@ -42,6 +46,9 @@ typedef enum {
 // Sender callback. `chunk` is one complete NDJSON line (including trailing
 // '\n'). The transport is responsible for any extra framing (BLE length
 // prefix, etc.) — the session itself only emits lines.
+// Writers that may be skipping the rest of a dropped frame at once.
+#define SK_SESSION_TX_SKIP  4
+
 typedef void (*sk_session_send_fn)(const char *chunk, size_t len, void *user);
 
 typedef struct {
@@ -66,8 +73,25 @@ typedef struct {
     // Replay window for THIS connection. Global before — two peers sharing
     // one ring rejected each other's nonces (both CliSigners start at 1).
     sk_auth_replay_t replay;
+
+    // Pipelined dispatch. Verified commands run on the shared worker pool,
+    // at most SK_SESSION_INFLIGHT at a time per session; responses go out
+    // in completion order, correlated by their `id`. These fields survive
+    // begin()/reset(): `gen` is bumped on both, so a worker finishing after
+    // the peer left (or after the slot was reused) writes nothing.
+    uint8_t           slot;          // session registry index + 1; 0 = none
+    uint16_t          gen;
+    uint8_t           inflight;      // jobs queued or running
+    SemaphoreHandle_t tx_lock;       // recursive; keeps one reply frame contiguous
+    uint8_t           sending;       // writers inside send() right now
+    uint16_t          segment;       // coalescer packet size, 0 = none
+    uint32_t          tx_dropped;    // frames dropped: lock wait timed out
+    TaskHandle_t      tx_holder;     // keeps tx_lock until its frame's '\n'
+    TaskHandle_t      tx_skip[SK_SESSION_TX_SKIP];  // lost the wait mid-frame
 } sk_secure_session_t;
 
+#define SK_SESSION_INFLIGHT  4
+
 // Outcome of sk_secure_session_feed_line().
 typedef enum {
     SK_SESSION_FEED_AUTH_PROGRESSED,  // line was an auth message; session advanced
@@ -96,9 +120,35 @@ static inline bool sk_secure_session_authed(const sk_secure_session_t *s)
 // drops the connection when it returns true.
 bool sk_secure_session_timed_out(const sk_secure_session_t *s);
 
-// Reset to FRESH (call on disconnect).
+// Reset to FRESH (call on disconnect). Never blocks: queued and running
+// commands, log tails and event pushes write nothing from here on. A
+// send() that had already started may still be running on another task —
+// release whatever `send_user` refers to (a socket) only once
+// sk_secure_session_tx_busy() returns false.
 void sk_secure_session_reset(sk_secure_session_t *s);
 
+// True while another task is inside this session's `send`.
+bool sk_secure_session_tx_busy(const sk_secure_session_t *s);
+
+// True if the peer named its own topics with events.subscribe.
+bool sk_secure_session_push_active(const sk_secure_session_t *s);
+
+// Bytes per transport packet (BLE: ATT_MTU - 3), so command replies are
+// coalesced into whole packets. Survives begin()/reset(); 0 = none.
+void sk_secure_session_set_segment(sk_secure_session_t *s, size_t segment);
+
+// Write one complete line to the peer outside any command (event
+// forwarders). Serialized against pipelined responses so it never lands
+// in the middle of one; dropped if a reply holds the line for longer than
+// SK_SESSION_TX_WAIT_MS.
+void sk_secure_session_send(sk_secure_session_t *s, const char *chunk, size_t len);
+
+// Run fn(arg) on the session worker pool — transport work too slow for a
+// transport's own task (TCP pairing: X25519 ECDH). False if the pool is
+// not running or its queue is full; `arg` is then still the caller's and
+// the caller runs fn inline.
+bool sk_secure_session_run(void (*fn)(void *arg), void *arg);
+
 // -- Per-message authentication envelope -------------------------------------
 //
 // After connection-level mutual C-R completes (state == AUTHENTICATED), every
@@ -110,9 +160,15 @@ void sk_secure_session_reset(sk_secure_session_t *s);
 // `nonce` is monotonic, replay-protected via a 64-slot sliding window. `ts`
 // is currently advisory (cihazda SNTP yok); accepted as 0 too.
 //
-// Verifies the envelope, then dispatches the inner body through sk_cli on
-// success. On failure emits an ERR_HMAC_INVALID response via writer and
-// returns without dispatching. Used by BLE GATT and TCP transports after the
+// Verifies the envelope, then hands the inner body to the worker pool
+// (inline when the pool is unavailable); the response is written later
+// from the worker through the session's `send`, so `writer` must be the
+// same sink that was given to begin(). Over SK_SESSION_INFLIGHT the
+// command is refused with ERR_BUSY {"reason":"inflight_limit"}. Pipelined
+// commands may complete in any order — a peer that needs ordering waits
+// for the reply or sends a {"batch":[...]}, which runs as one job.
+// On failure emits an ERR_HMAC_INVALID response via writer and returns
+// without dispatching. Used by BLE GATT and TCP transports after the
 // session reaches AUTHENTICATED.
 //
 // The session pointer is consulted for the passphrase gate: while
@@ -16,6 +16,39 @@ void      skbt_gatt_on_cmd_rx(uint16_t conn_handle, const char *line, size_t len
 // event bus bridge.
 void      skbt_gatt_notify_event(const char *payload, size_t len);
 
+// Block until the TX ring has room for `len` bytes on top of the share
+// kept free for command replies, or `timeout_ms` passes / the peer
+// leaves. False = congested; the caller drops (event forwarder). A `len`
+// that would not fit even an empty ring fails at once. Both count in
+// dropped_bytes.
+bool      skbt_gatt_tx_wait_room(size_t len, uint32_t timeout_ms);
+
+typedef struct {
+    uint16_t queued;         // bytes in the TX ring now
+    uint16_t ring_hwm;       // fill high-water mark
+    uint32_t pdus;           // notifies handed to NimBLE
+    uint32_t enomem;         // BLE_HS_ENOMEM, each one a backoff-and-retry
+    uint32_t dropped_bytes;  // writer gave up (ring full / no room) or link error
+} skbt_tx_stats_t;
+
+void      skbt_gatt_tx_stats(skbt_tx_stats_t *out);
+
+// ATT_MTU negotiated for the current link (BLE_GAP_EVENT_MTU). Sizes
+// outbound notify PDUs and the CLI coalescer's segment.
+void      skbt_gatt_set_mtu(uint16_t mtu);
+uint16_t  skbt_gatt_mtu(void);
+
+// Link tuning, implemented in sk_transport_ble.c next to the GAP handler.
+// negotiate: after authentication, request DLE (251-byte LL payloads) and
+// the 2M PHY, once per link, and start the activity policy. The other
+// two feed that policy: note_cmd on every authenticated command
+// (interactive level), set_bulk while skbt_tx holds a backlog. Both are
+// no-ops for the link parameters before negotiate().
+void      skbt_link_negotiate(uint16_t conn_handle);
+void      skbt_link_note_cmd(void);
+void      skbt_link_set_bulk(bool bulk);
+bool      skbt_link_is_bulk(void);
+
 // Lifecycle hooks called from the GAP event handler in sk_transport_ble.c.
 void      skbt_gatt_on_connect(uint16_t conn_handle);
 void      skbt_gatt_on_disconnect(uint16_t conn_handle);
@@ -36,3 +69,8 @@ bool      skbt_gatt_is_connected(void);
 // in face/timer/power notifications, which both confuses the APP and
 // blocks its `pairing.ecdh.exchange` write behind the notify queue.
 bool      skbt_gatt_is_authenticated(void);
+
+// True once the authenticated peer ran events.subscribe: from then on it
+// gets only its own topics, through the push sender, and the event-bus
+// bridge leaves it alone.
+bool      skbt_gatt_event_push_active(void);
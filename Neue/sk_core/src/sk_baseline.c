@@ -1,11 +1,12 @@
 // sk_baseline.c — APP-facing baseline commands per shared/cli_contract.md §3.
 //
-// Six commands registered here:
+// Commands registered here:
 //   device.info       — model/serial/protocol_version/...
 //   device.commands   — JSON array of every registered command name
 //   device.status     — uptime + wifi + ble + time (battery added later by hook)
 //   device.manifest   — runtime UI manifest (commands + summaries + group hint)
 //   logs.get          — ring buffer dump (stub: returns []; ring buffer TBD)
+//   logs.tail[.stop]  — live log push to the calling BLE / TCP session
 //   time.set          — APP pushes UNIX time when device has no NTP
 //
 // Implementation note: we hand-roll JSON via snprintf instead of cJSON to
@@ -29,6 +30,7 @@
 #include "nvs_flash.h"
 
 #include "sk_cli.h"
+#include "sk_cli_internal.h"   // logs.tail subscribes the session's writer
 #include "sk_identity.h"
 #include "sk_errors.h"
 #include "sk_wifi.h"
@@ -209,53 +211,20 @@ static const sk_cli_command_t s_cmd_device_info = {
 
 // === device.commands ========================================================
 
-typedef struct {
-    char  *out;
-    size_t cap;
-    size_t off;
-    bool   first;
-    bool   overflow;
-} cmd_walk_state_t;
-
 static void cmd_walk_collect(const sk_cli_command_t *cmd, void *user)
 {
-    cmd_walk_state_t *st = (cmd_walk_state_t *)user;
-    if (st->overflow) return;
-    int n = snprintf(st->out + st->off, st->cap - st->off,
-                     "%s\"%s\"", st->first ? "" : ",", cmd->name);
-    if (n < 0 || (size_t)n >= st->cap - st->off) {
-        st->overflow = true;
-        return;
-    }
-    st->off  += (size_t)n;
-    st->first = false;
+    sk_cli_json_string((sk_cli_json_t *)user, cmd->name);
 }
 
 static sk_err_t cmd_device_commands(sk_cli_ctx_t *ctx)
 {
-    enum { BUF = 2048 };
-    char *buf = malloc(BUF);
-    if (!buf) {
-        sk_cli_err(ctx, SK_ERR_INTERNAL, "{\"reason\":\"oom\"}");
-        return SK_OK;
-    }
-    cmd_walk_state_t st = { .out = buf, .cap = BUF, .off = 0, .first = true, .overflow = false };
-    int n = snprintf(buf + st.off, BUF - st.off, "[");
-    st.off += (size_t)n;
-    sk_cli_walk(cmd_walk_collect, &st);
-    if (st.overflow) {
-        free(buf);
-        sk_cli_err(ctx, SK_ERR_INTERNAL, "{\"reason\":\"commands_truncated\"}");
-        return SK_OK;
-    }
-    n = snprintf(buf + st.off, BUF - st.off, "]");
-    if (n < 0 || (size_t)n >= BUF - st.off) {
-        free(buf);
-        sk_cli_err(ctx, SK_ERR_INTERNAL, "{\"reason\":\"commands_truncated\"}");
-        return SK_OK;
-    }
-    sk_cli_ok(ctx, buf);
-    free(buf);
+    // Streamed: the list grows with every component that registers
+    // commands, so no fixed buffer to outgrow.
+    sk_cli_json_t j;
+    sk_cli_json_begin(&j, ctx);
+    sk_cli_json_begin_array(&j);
+    sk_cli_walk(cmd_walk_collect, &j);
+    sk_cli_json_finish(&j);
     return SK_OK;
 }
 
@@ -414,6 +383,8 @@ static const sk_cli_command_t s_cmd_device_manifest = {
 // Reads the structured event ring buffer maintained by sk_log (see
 // sk_log.c). Returns JSON: {"lines":[{ts,lvl,tag,event,msg}, ...]}.
 // Supports --limit (default 50, max 200) and --level (debug|info|warn|error).
+// --boot / --since read the flash history instead (sk_log_store.c) and
+// add "boot" per line plus a "next" cursor to continue from.
 
 #define SK_LOG_RING_LINE_ESC  300  // 128 raw msg + worst-case JSON escape headroom
 
@@ -443,6 +414,7 @@ typedef struct {
     size_t off;
     bool   first;
     bool   overflow;
+    bool   stored;     // flash history: per-line "boot"
 } logs_walk_ctx_t;
 
 static bool logs_walk_emit(const sk_log_entry_view_t *e, void *user) {
@@ -453,7 +425,7 @@ static bool logs_walk_emit(const sk_log_entry_view_t *e, void *user) {
     json_escape(e->msg ? e->msg : "", msg_esc, sizeof(msg_esc));
 
     int n = snprintf(st->buf + st->off, st->cap - st->off,
-                     "%s{\"ts\":%lld,\"up_us\":%lld,\"lvl\":\"%s\",\"tag\":\"%s\",\"event\":\"%s\",\"msg\":\"%s\"}",
+                     "%s{\"ts\":%lld,\"up_us\":%lld,\"lvl\":\"%s\",\"tag\":\"%s\",\"event\":\"%s\",\"msg\":\"%s\"",
                      st->first ? "" : ",",
                      (long long)e->ts_unix,
                      (long long)e->ts_uptime_us,
@@ -461,6 +433,23 @@ static bool logs_walk_emit(const sk_log_entry_view_t *e, void *user) {
                      e->tag ? e->tag : "?",
                      e->event ? e->event : "?",
                      msg_esc);
+    if (n >= 0 && (size_t)n < st->cap - st->off) {
+        // "repeat" only when collapsed, so old parsers see the same shape.
+        int m = (e->repeat > 1)
+              ? snprintf(st->buf + st->off + n, st->cap - st->off - n,
+                         ",\"repeat\":%lu", (unsigned long)e->repeat)
+              : 0;
+        if (m >= 0 && st->stored) {
+            int b = snprintf(st->buf + st->off + n + m, st->cap - st->off - n - m,
+                             ",\"boot\":%lu", (unsigned long)e->boot);
+            m = (b < 0) ? b : m + b;
+        }
+        if (m >= 0) {
+            int c = snprintf(st->buf + st->off + n + m, st->cap - st->off - n - m, "}");
+            m = (c < 0) ? c : m + c;
+        }
+        n = (m < 0) ? m : n + m;
+    }
     if (n < 0 || (size_t)n >= st->cap - st->off) {
         st->overflow = true;
         return false;
@@ -485,22 +474,66 @@ static sk_err_t cmd_logs_get(sk_cli_ctx_t *ctx) {
         return SK_OK;
     }
 
+    // --boot N (N <= 0: relative, -1 = previous boot) and --since <cursor>
+    // switch to the flash history. The cursor is a 64-bit number, so it is
+    // parsed from the string rather than sk_cli_arg_long.
+    long boot_l = 0;
+    bool has_boot = sk_cli_arg_long(ctx, "boot", &boot_l);
+    const char *since_str = sk_cli_arg_named(ctx, "since");
+    bool stored = has_boot || since_str;
+    uint32_t boot = 0;
+    uint64_t since = 0;
+    if (stored) {
+        uint32_t cur = sk_log_boot_count();
+        if (cur == 0) {
+            sk_cli_err(ctx, SK_ERR_NOT_FOUND, "{\"reason\":\"no_log_partition\"}");
+            return SK_OK;
+        }
+        if (has_boot) {
+            long b = (boot_l <= 0) ? (long)cur + boot_l : boot_l;
+            if (b < 1 || b > (long)cur) {
+                sk_cli_err(ctx, SK_ERR_INVALID_VALUE, "{\"field\":\"boot\"}");
+                return SK_OK;
+            }
+            boot = (uint32_t)b;
+        }
+        if (since_str) {
+            char *end = NULL;
+            since = strtoull(since_str, &end, 10);
+            if (!end || *end) {
+                sk_cli_err(ctx, SK_ERR_INVALID_ARG, "{\"field\":\"since\"}");
+                return SK_OK;
+            }
+        }
+    }
+
     enum { BUF_CAP = 8192 };
     char *buf = malloc(BUF_CAP);
     if (!buf) { sk_cli_err(ctx, SK_ERR_INTERNAL, NULL); return SK_OK; }
 
     logs_walk_ctx_t st = {
-        .buf = buf, .cap = BUF_CAP, .off = 0, .first = true, .overflow = false
+        .buf = buf, .cap = BUF_CAP, .off = 0, .first = true, .overflow = false,
+        .stored = stored,
     };
-    int n = snprintf(buf + st.off, BUF_CAP - st.off, "{\"lines\":[");
+    int n = stored
+          ? snprintf(buf, BUF_CAP, "{\"boot\":%lu,\"lines\":[",
+                     (unsigned long)sk_log_boot_count())
+          : snprintf(buf, BUF_CAP, "{\"lines\":[");
     if (n < 0 || (size_t)n >= BUF_CAP - st.off) {
         free(buf); sk_cli_err(ctx, SK_ERR_INTERNAL, NULL); return SK_OK;
     }
     st.off += (size_t)n;
 
-    sk_log_walk(min_level, limit, logs_walk_emit, &st);
+    char next_json[40] = "";
+    if (stored) {
+        uint64_t next = 0;
+        sk_log_walk_stored(boot, since, min_level, limit, logs_walk_emit, &st, &next);
+        snprintf(next_json, sizeof(next_json), ",\"next\":%llu", (unsigned long long)next);
+    } else {
+        sk_log_walk(min_level, limit, logs_walk_emit, &st);
+    }
 
-    n = snprintf(buf + st.off, BUF_CAP - st.off, "]%s}",
+    n = snprintf(buf + st.off, BUF_CAP - st.off, "]%s%s}", next_json,
                  st.overflow ? ",\"truncated\":true" : "");
     if (n < 0 || (size_t)n >= BUF_CAP - st.off) {
         free(buf); sk_cli_err(ctx, SK_ERR_INTERNAL, NULL); return SK_OK;
@@ -510,10 +543,9 @@ static sk_err_t cmd_logs_get(sk_cli_ctx_t *ctx) {
     return SK_OK;
 }
 
-static const sk_cli_command_t s_cmd_logs_get = {
-    .name       = "logs.get",
+SK_CLI_COMMAND(s_cmd_logs_get, "logs.get",
     .summary    = "Read recent log entries from the ring buffer",
-    .usage      = "logs get [--limit N] [--level LVL]",
+    .usage      = "logs get [--limit N] [--level LVL] [--boot N] [--since CURSOR]",
     .help_block =
         "Returns structured event entries from the on-device ring buffer.\n"
         "Both CLI and SKAPP use this for diagnostics: what happened on the\n"
@@ -521,16 +553,100 @@ static const sk_cli_command_t s_cmd_logs_get = {
         "\n"
         "--limit  number of entries to return (default 50, max 200)\n"
         "--level  minimum severity: debug | info | warn | error (default info)\n"
+        "--boot   read the flash history of boot N instead of the RAM ring;\n"
+        "         0 = this boot, -1 = the previous one (what ran before a crash)\n"
+        "--since  flash history from a cursor on; every flash reply carries\n"
+        "         \"next\" — pass it back to fetch only what came after\n"
         "\n"
         "Each entry: {ts (unix), up_us (uptime us), lvl, tag, event, msg}.\n"
         "ts=0 means the device clock was not set when the entry was written.\n"
+        "Identical back-to-back entries are collapsed into the first one\n"
+        "with \"repeat\":N.\n"
         "\n"
         "Examples:\n"
         "  logs get\n"
         "  logs get --limit 100\n"
-        "  logs get --level warn",
-    .handler    = cmd_logs_get,
-};
+        "  logs get --level warn\n"
+        "  logs get --boot -1 --level warn\n"
+        "  logs get --since 25165836",
+    .handler    = cmd_logs_get);
+
+// === logs.tail ==============================================================
+
+static sk_err_t cmd_logs_tail(sk_cli_ctx_t *ctx)
+{
+    sk_log_level_t min_level = SK_LOG_INFO;
+    const char *lvl_str = sk_cli_arg_named(ctx, "level");
+    if (lvl_str && !sk_log_level_parse(lvl_str, &min_level)) {
+        sk_cli_err(ctx, SK_ERR_INVALID_ARG, "{\"field\":\"level\"}");
+        return SK_OK;
+    }
+    const char *tags = sk_cli_arg_named(ctx, "tags");
+
+    // The subscription is keyed by this session's writer; the transport
+    // drops it in sk_secure_session_reset() on disconnect.
+    esp_err_t err = sk_log_tail_start(ctx->writer, ctx->writer_user, min_level, tags);
+    if (err == ESP_ERR_INVALID_ARG) {
+        char p[80];
+        snprintf(p, sizeof(p), "{\"field\":\"tags\",\"max\":%d,\"max_len\":%d}",
+                 SK_LOG_TAIL_TAGS, SK_LOG_TAIL_TAG_MAX);
+        sk_cli_err(ctx, SK_ERR_INVALID_ARG, p);
+        return SK_OK;
+    }
+    if (err != ESP_OK) {
+        sk_cli_err(ctx, SK_ERR_BUSY, "{\"reason\":\"tail_slots_full\"}");
+        return SK_OK;
+    }
+
+    // Echo the tag filter back unless it would need JSON escaping.
+    char out[128];
+    bool echo = tags && !strpbrk(tags, "\"\\");
+    snprintf(out, sizeof(out), "{\"tail\":true,\"level\":\"%s\",\"tags\":\"%s\"}",
+             sk_log_level_str(min_level), echo ? tags : "");
+    sk_cli_ok(ctx, out);
+    return SK_OK;
+}
+
+static sk_err_t cmd_logs_tail_stop(sk_cli_ctx_t *ctx)
+{
+    bool was = sk_log_tail_stop(ctx->writer, ctx->writer_user);
+    sk_cli_ok(ctx, was ? "{\"tail\":false,\"stopped\":true}"
+                       : "{\"tail\":false,\"stopped\":false}");
+    return SK_OK;
+}
+
+SK_CLI_COMMAND(s_cmd_logs_tail, "logs.tail",
+    .summary    = "Stream new log entries to this session",
+    .usage      = "logs tail [--level LVL] [--tags TAG1,TAG2]",
+    .requires_auth = true,
+    .help_block =
+        "After the OK reply, every new entry at or above --level (default\n"
+        "info) is pushed to this connection as it is logged, batched for up\n"
+        "to 0.5 s into one event:\n"
+        "  {\"evt\":\"log.lines\",\"data\":{\"lines\":[{ts,up_us,lvl,tag,event,msg},...]}}\n"
+        "Entry fields are the same as logs.get (repeats are not collapsed).\n"
+        "A batch that arrives while the previous one is still being sent to\n"
+        "a slow connection is dropped; the next one adds \"dropped\":N.\n"
+        "\n"
+        "--level  minimum severity: debug | info | warn | error (default info)\n"
+        "--tags   comma-separated tag filter, up to 4 tags of 15 chars;\n"
+        "         omitted = all tags\n"
+        "\n"
+        "Issuing it again replaces the filter. The tail ends with logs.tail.stop\n"
+        "or when the connection closes. At most 4 sessions can tail at once\n"
+        "(ERR_BUSY). BLE and WiFi/TCP only — USB has the serial console.\n"
+        "\n"
+        "Examples:\n"
+        "  logs tail\n"
+        "  logs tail --level warn\n"
+        "  logs tail --level debug --tags wifi,sk_ble",
+    .handler    = cmd_logs_tail);
+
+SK_CLI_COMMAND(s_cmd_logs_tail_stop, "logs.tail.stop",
+    .summary    = "Stop streaming log entries to this session",
+    .usage      = "logs tail stop",
+    .requires_auth = true,
+    .handler    = cmd_logs_tail_stop);
 
 // === time.set ===============================================================
 
@@ -567,16 +683,14 @@ static sk_err_t cmd_time_set(sk_cli_ctx_t *ctx)
     return SK_OK;
 }
 
-static const sk_cli_command_t s_cmd_time_set = {
-    .name       = "time.set",
+SK_CLI_COMMAND(s_cmd_time_set, "time.set",
     .summary    = "Push UNIX time to device (SKAPP-only, when no NTP)",
     .usage      = "time set <unix>",
     .hidden     = true,   // SKAPP-only: human users don't push UTC epochs
     .help_block = "Sets the system clock to the given UTC unix timestamp. SKAPP\n"
                   "calls this on every connect before WiFi/NTP is available, so\n"
                   "log timestamps and webhook payloads carry real time.",
-    .handler    = cmd_time_set,
-};
+    .handler    = cmd_time_set);
 
 // === init ===================================================================
 
@@ -596,14 +710,13 @@ esp_err_t sk_baseline_init(const char *fw_version, const char *build_info)
     sk_cli_register(&s_cmd_device_commands);
     // s_cmd_device_status REMOVED — fields merged into device.info above.
     sk_cli_register(&s_cmd_device_manifest);
-    sk_cli_register(&s_cmd_logs_get);
+    // logs.* and time.set are SK_CLI_COMMAND entries — no registration.
     // Structured event log (NimBLE-safe async queue). Replaces the old
     // esp_log_set_vprintf hook, which blocked the NimBLE host task and
     // had to be disabled. See esp32/COMMON_LOG_SPEC.md.
     if (sk_log_init() != ESP_OK) {
         ESP_LOGW(TAG, "sk_log_init failed; logs.get will be empty");
     }
-    sk_cli_register(&s_cmd_time_set);
 
     ESP_LOGI(TAG, "baseline cmds registered (protocol %s)", SK_PROTOCOL_VERSION);
     return ESP_OK;
@@ -1,6 +1,7 @@
 #include "sk_button.h"
 #include "sk_event_bus.h"
 
+#include <stdio.h>
 #include <string.h>
 
 #include "driver/gpio.h"
@@ -55,6 +56,34 @@ static bool read_pressed(void)
 
 bool sk_button_is_pressed(void) { return s_ready ? read_pressed() : false; }
 
+// ---------------------------------------------------------------------
+// Typed payloads. The producer only fills a struct; JSON is rendered
+// lazily, and only if a transport or a legacy subscriber asks for it.
+// ---------------------------------------------------------------------
+static int render_press(const void *data, char *out, size_t cap)
+{
+    const sk_button_press_evt_t *e = data;
+    return snprintf(out, cap, "{\"duration_ms\":%lu}", (unsigned long)e->duration_ms);
+}
+
+static int render_tap(const void *data, char *out, size_t cap)
+{
+    const sk_button_tap_evt_t *e = data;
+    return snprintf(out, cap, "{\"count\":%lu}", (unsigned long)e->count);
+}
+
+const sk_event_type_t sk_button_press_evt_type = {
+    .name        = "button.press",
+    .size        = sizeof(sk_button_press_evt_t),
+    .render_json = render_press,
+};
+
+const sk_event_type_t sk_button_tap_evt_type = {
+    .name        = "button.tap",
+    .size        = sizeof(sk_button_tap_evt_t),
+    .render_json = render_tap,
+};
+
 static void button_task(void *arg)
 {
     (void)arg;
@@ -105,8 +134,9 @@ static void button_task(void *arg)
             if (!long_reported && held_ms >= s_cfg.long_press_ms) {
                 long_reported = true;
                 if (s_cb) s_cb(SK_BUTTON_EVT_LONG_PRESS, held_ms, s_user);
-                sk_event_bus_publishf("button.long-press",
-                                      "{\"duration_ms\":%lu}", (unsigned long)held_ms);
+                sk_button_press_evt_t ev = { .duration_ms = held_ms };
+                sk_event_bus_publish_typed("button.long-press",
+                                           &sk_button_press_evt_type, &ev);
             }
         }
 
@@ -115,15 +145,16 @@ static void button_task(void *arg)
             s_last_edge_us = now_us;
             uint32_t held_ms = (uint32_t)((now_us - press_start) / 1000);
             if (held_ms >= DEBOUNCE_MS) {
-                sk_event_bus_publishf("button.released",
-                                      "{\"duration_ms\":%lu}", (unsigned long)held_ms);
+                sk_button_press_evt_t ev = { .duration_ms = held_ms };
+                sk_event_bus_publish_typed("button.released",
+                                           &sk_button_press_evt_type, &ev);
 
                 if (!long_reported) {
                     // Legacy short-press event for short tap subscribers
                     // (existed before button.down/hold).
                     if (s_cb) s_cb(SK_BUTTON_EVT_SHORT_PRESS, held_ms, s_user);
-                    sk_event_bus_publishf("button.pressed",
-                                          "{\"duration_ms\":%lu}", (unsigned long)held_ms);
+                    sk_event_bus_publish_typed("button.pressed",
+                                               &sk_button_press_evt_type, &ev);
 
                     // Multi-tap window
                     if (s_tap_count == 0 ||
@@ -134,8 +165,9 @@ static void button_task(void *arg)
                         s_tap_count++;
                         if (s_tap_count >= s_cfg.multi_tap_threshold) {
                             if (s_cb) s_cb(SK_BUTTON_EVT_MULTI_TAP, s_tap_count, s_user);
-                            sk_event_bus_publishf("button.multi-tap",
-                                                  "{\"count\":%d}", s_tap_count);
+                            sk_button_tap_evt_t tap = { .count = (uint32_t)s_tap_count };
+                            sk_event_bus_publish_typed("button.multi-tap",
+                                                       &sk_button_tap_evt_type, &tap);
                             s_tap_count = 0;
                         }
                     }
@@ -7,10 +7,12 @@
 #include <stdlib.h>
 #include <string.h>
 
-#include "cJSON.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 #include "freertos/semphr.h"
+#include "freertos/task.h"
 
 #include "sk_core.h"   // sk_core_write_banner for help header
 
@@ -20,10 +22,41 @@ static const char *TAG = "sk_cli";
 #define SK_CLI_MAX_TOPICS     32
 #define SK_CLI_MAX_ARGV       16
 #define SK_CLI_LINE_BUF       1024
+#define SK_CLI_MAX_TOKENS     96     // machine-mode JSON tokens per line
+#define SK_CLI_BATCH_MAX      16     // commands per {"batch":[...]} line
+
+// Two command sources:
+//
+// SK_CLI_COMMAND descriptors — one flash array, sorted by name at link
+// time (linker.lf), bracketed by the symbols below. Looked up by binary
+// search; costs no RAM and exists before sk_cli_init().
+//
+// s_commands — sk_cli_register() at runtime, for commands that need
+// their component's init first. A registered name shadows a static one.
+extern const sk_cli_command_t _sk_cli_cmds_start[];
+extern const sk_cli_command_t _sk_cli_cmds_end[];
+#define SK_CLI_STATIC_COUNT   ((int)(_sk_cli_cmds_end - _sk_cli_cmds_start))
 
 static const sk_cli_command_t *s_commands[SK_CLI_MAX_COMMANDS];
 static int                     s_command_count = 0;
 
+// Lookup indexes over s_commands, both maintained by sk_cli_register():
+//
+// s_hash — open-addressing table (linear probing) over FNV-1a of the full
+// name. Slot holds command index + 1; 0 = empty. Twice the command cap
+// keeps the load factor <= 0.5, so a miss ends after a probe or two.
+// Every dispatched line used to strcmp its way through ~100 names.
+//
+// s_by_ns — command indexes ordered by namespace (chars before the first
+// '.'), registration order kept within a namespace. help <topic> and the
+// overview counters binary-search their namespace instead of scanning the
+// whole table once per topic.
+#define SK_CLI_HASH_SLOTS     (SK_CLI_MAX_COMMANDS * 2)   // power of two
+
+static uint32_t                s_cmd_hash[SK_CLI_MAX_COMMANDS];
+static uint8_t                 s_hash[SK_CLI_HASH_SLOTS];
+static uint8_t                 s_by_ns[SK_CLI_MAX_COMMANDS];
+
 typedef struct {
     const char *name;
     const char *summary;
@@ -48,27 +81,42 @@ esp_err_t sk_cli_set_confirm_issuer(sk_cli_confirm_issuer_t issuer)
 static sk_err_t builtin_help(sk_cli_ctx_t *ctx);
 static sk_err_t builtin_json_on(sk_cli_ctx_t *ctx);
 static sk_err_t builtin_json_off(sk_cli_ctx_t *ctx);
-
-static const sk_cli_command_t s_builtins[] = {
-    { .name = "help",
-      .summary  = "List commands or show detail of one",
-      .usage    = "help [<command>]",
-      .help_block = "help\n  Show the namespace list.\nhelp <command>\n  Show usage, parameters and example for a specific command.",
-      .handler  = builtin_help },
-    // json.on/off are protocol switches the SKAPP / clients flip
-    // automatically. Humans interactively never type them, so they're
-    // hidden from the help overview but still callable by name.
-    { .name = "json.on",
-      .summary  = "Switch to NDJSON machine mode",
-      .usage    = "json on",
-      .hidden   = true,
-      .handler  = builtin_json_on },
-    { .name = "json.off",
-      .summary  = "Switch to human mode",
-      .usage    = "json off",
-      .hidden   = true,
-      .handler  = builtin_json_off },
-};
+static sk_err_t builtin_cli_bench(sk_cli_ctx_t *ctx);
+
+// Builtins go in the link-time table — always present, nothing to init.
+SK_CLI_COMMAND(s_cmd_help, "help",
+    .summary  = "List commands or show detail of one",
+    .usage    = "help [<command>]",
+    .help_block = "help\n  Show the namespace list.\nhelp <command>\n  Show usage, parameters and example for a specific command.",
+    .handler  = builtin_help);
+
+// json.on/off are protocol switches the SKAPP / clients flip
+// automatically. Humans interactively never type them, so they're
+// hidden from the help overview but still callable by name.
+SK_CLI_COMMAND(s_cmd_json_on, "json.on",
+    .summary  = "Switch to NDJSON machine mode",
+    .usage    = "json on",
+    .hidden   = true,
+    .handler  = builtin_json_on);
+
+SK_CLI_COMMAND(s_cmd_json_off, "json.off",
+    .summary  = "Switch to human mode",
+    .usage    = "json off",
+    .hidden   = true,
+    .handler  = builtin_json_off);
+
+SK_CLI_COMMAND(s_cmd_cli_bench, "cli.bench",
+    .summary  = "Benchmark command lookup",
+    .usage    = "cli bench [iters <n>]",
+    .hidden   = true,  // developer diagnostic
+    .help_block =
+        "Times sk_cli_lookup over every command: the link-time table's\n"
+        "binary search and the hash index of registered commands vs. the\n"
+        "old linear strcmp scan, for names that exist (`hit`, averaged)\n"
+        "and one that does not (`miss`). `resolve` is a full human-mode\n"
+        "resolve of a 3-word command followed by 2 arguments (longest\n"
+        "match first). Nothing is dispatched. Default 1000 iterations.",
+    .handler  = builtin_cli_bench);
 
 esp_err_t sk_cli_init(void)
 {
@@ -76,51 +124,227 @@ esp_err_t sk_cli_init(void)
     s_mtx = xSemaphoreCreateMutex();
     if (!s_mtx) return ESP_ERR_NO_MEM;
     s_command_count = 0;
+    memset(s_hash, 0, sizeof(s_hash));
     s_ready = true;
-    for (size_t i = 0; i < sizeof(s_builtins)/sizeof(s_builtins[0]); i++) {
-        sk_cli_register(&s_builtins[i]);
+    // Binary search relies on linker.lf's SORT(name); a duplicate name
+    // would leave one of the two unreachable. Both are build mistakes —
+    // say so at boot instead of at the first failed lookup.
+    for (int i = 1; i < SK_CLI_STATIC_COUNT; i++) {
+        int c = strcmp(_sk_cli_cmds_start[i - 1].name, _sk_cli_cmds_start[i].name);
+        if (c >= 0) {
+            ESP_LOGE(TAG, "SK_CLI_COMMAND %s: %s", _sk_cli_cmds_start[i].name,
+                     c ? "table not sorted (linker.lf missing?)" : "duplicate name");
+        }
     }
     return ESP_OK;
 }
 
+// -- Lookup indexes ---------------------------------------------------------
+
+static uint32_t name_hash(const char *name)
+{
+    uint32_t h = 2166136261u;
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++) {
+        h = (h ^ *p) * 16777619u;
+    }
+    return h;
+}
+
+// Slot holding `name`, or the empty slot where it would go.
+static uint32_t hash_probe(const char *name, uint32_t h)
+{
+    uint32_t slot = h & (SK_CLI_HASH_SLOTS - 1);
+    while (s_hash[slot]) {
+        int i = s_hash[slot] - 1;
+        if (s_cmd_hash[i] == h && strcmp(s_commands[i]->name, name) == 0) break;
+        slot = (slot + 1) & (SK_CLI_HASH_SLOTS - 1);
+    }
+    return slot;
+}
+
+// Length of the namespace prefix (chars before first '.') in a command
+// name. Returns 0 for namespaceless commands like "help" or "?".
+static size_t namespace_len(const char *name)
+{
+    const char *dot = strchr(name, '.');
+    return dot ? (size_t)(dot - name) : 0;
+}
+
+static int ns_cmp(const char *a, size_t alen, const char *b, size_t blen)
+{
+    int c = memcmp(a, b, alen < blen ? alen : blen);
+    if (c) return c;
+    return (alen > blen) - (alen < blen);
+}
+
+// First position in s_by_ns whose namespace is >= (ns, len) — or > when
+// `after` is set, which gives the end of that namespace's run.
+static int ns_bound(const char *ns, size_t len, bool after)
+{
+    int lo = 0, hi = s_command_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        const char *name = s_commands[s_by_ns[mid]]->name;
+        int c = ns_cmp(name, namespace_len(name), ns, len);
+        if (c < 0 || (after && c == 0)) lo = mid + 1;
+        else                           hi = mid;
+    }
+    return lo;
+}
+
+// Runtime-registered command by name, or NULL.
+static const sk_cli_command_t *runtime_lookup(const char *name)
+{
+    uint32_t slot = hash_probe(name, name_hash(name));
+    return s_hash[slot] ? s_commands[s_hash[slot] - 1] : NULL;
+}
+
+// First static entry whose name sorts >= ns + sep (ns is `len` chars).
+// With sep '.' and '/' (the next byte) this brackets the names under
+// "ns." — the sorted table keeps them contiguous.
+static int static_bound(const char *ns, size_t len, char sep)
+{
+    int lo = 0, hi = SK_CLI_STATIC_COUNT;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        const char *name = _sk_cli_cmds_start[mid].name;
+        int c = strncmp(name, ns, len);
+        if (c == 0) c = (int)(unsigned char)name[len] - (int)(unsigned char)sep;
+        if (c < 0) lo = mid + 1;
+        else       hi = mid;
+    }
+    return lo;
+}
+
+static const sk_cli_command_t *static_lookup(const char *name)
+{
+    int lo = 0, hi = SK_CLI_STATIC_COUNT;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        int c = strcmp(_sk_cli_cmds_start[mid].name, name);
+        if (c == 0) return &_sk_cli_cmds_start[mid];
+        if (c < 0) lo = mid + 1;
+        else       hi = mid;
+    }
+    return NULL;
+}
+
+// Every command: the static table first, then registration order. NULL
+// for a static entry shadowed by a registered override — callers skip it.
+static int cmd_total(void) { return SK_CLI_STATIC_COUNT + s_command_count; }
+
+static const sk_cli_command_t *cmd_at(int i)
+{
+    if (i >= SK_CLI_STATIC_COUNT) return s_commands[i - SK_CLI_STATIC_COUNT];
+    const sk_cli_command_t *c = &_sk_cli_cmds_start[i];
+    return runtime_lookup(c->name) ? NULL : c;
+}
+
+// Commands that can sit under `topic` (its first segment): the matching
+// static run, then the matching s_by_ns run. `root` walks namespaceless
+// commands instead.
+typedef struct {
+    int  s, s_end;
+    int  r, r_end;
+    bool root;
+} ns_iter_t;
+
+static void ns_iter_init(ns_iter_t *it, const char *topic)
+{
+    size_t len = namespace_len(topic);
+    if (len == 0) len = strlen(topic);
+    it->s     = static_bound(topic, len, '.');
+    it->s_end = static_bound(topic, len, '.' + 1);
+    it->r     = ns_bound(topic, len, false);
+    it->r_end = ns_bound(topic, len, true);
+    it->root  = false;
+}
+
+static void ns_iter_init_root(ns_iter_t *it)
+{
+    // Namespaceless names are spread through the sorted static table;
+    // in s_by_ns they sort first (empty namespace).
+    it->s     = 0;
+    it->s_end = SK_CLI_STATIC_COUNT;
+    it->r     = 0;
+    it->r_end = ns_bound("", 0, true);
+    it->root  = true;
+}
+
+static const sk_cli_command_t *ns_iter_next(ns_iter_t *it)
+{
+    while (it->s < it->s_end) {
+        const sk_cli_command_t *c = &_sk_cli_cmds_start[it->s++];
+        if (it->root && namespace_len(c->name) != 0) continue;
+        if (!runtime_lookup(c->name)) return c;
+    }
+    if (it->r < it->r_end) return s_commands[s_by_ns[it->r++]];
+    return NULL;
+}
+
 esp_err_t sk_cli_register(const sk_cli_command_t *cmd)
 {
     if (!s_ready || !cmd || !cmd->name || !cmd->handler) return ESP_ERR_INVALID_ARG;
     xSemaphoreTake(s_mtx, portMAX_DELAY);
+    // Replace on duplicate name so devices can override library defaults.
+    uint32_t h    = name_hash(cmd->name);
+    uint32_t slot = hash_probe(cmd->name, h);
+    if (s_hash[slot]) {
+        s_commands[s_hash[slot] - 1] = cmd;
+        xSemaphoreGive(s_mtx);
+        return ESP_OK;
+    }
     if (s_command_count >= SK_CLI_MAX_COMMANDS) {
         xSemaphoreGive(s_mtx);
         ESP_LOGE(TAG, "command table full registering %s", cmd->name);
         return ESP_ERR_NO_MEM;
     }
-    // Replace on duplicate name so devices can override library defaults.
-    for (int i = 0; i < s_command_count; i++) {
-        if (strcmp(s_commands[i]->name, cmd->name) == 0) {
-            s_commands[i] = cmd;
-            xSemaphoreGive(s_mtx);
-            return ESP_OK;
-        }
-    }
-    s_commands[s_command_count++] = cmd;
+    int idx = s_command_count;
+    s_commands[idx] = cmd;
+    s_cmd_hash[idx] = h;
+    s_hash[slot]    = (uint8_t)(idx + 1);
+
+    // Insert after the last command of the same namespace.
+    int pos = ns_bound(cmd->name, namespace_len(cmd->name), true);
+    memmove(&s_by_ns[pos + 1], &s_by_ns[pos], (size_t)(idx - pos));
+    s_by_ns[pos] = (uint8_t)idx;
+    s_command_count++;
     xSemaphoreGive(s_mtx);
     return ESP_OK;
 }
 
+int sk_cli_command_slots(void)
+{
+    return SK_CLI_MAX_COMMANDS + SK_CLI_STATIC_COUNT;
+}
+
+int sk_cli_command_slot(const sk_cli_command_t *cmd)
+{
+    if (cmd >= _sk_cli_cmds_start && cmd < _sk_cli_cmds_end) {
+        return SK_CLI_MAX_COMMANDS + (int)(cmd - _sk_cli_cmds_start);
+    }
+    if (!cmd || !cmd->name) return -1;
+    uint32_t slot = hash_probe(cmd->name, name_hash(cmd->name));
+    int idx = (int)s_hash[slot] - 1;
+    return (idx >= 0 && s_commands[idx] == cmd) ? idx : -1;
+}
+
 void sk_cli_set_mode(sk_cli_mode_t mode) { s_mode = mode; }
 sk_cli_mode_t sk_cli_get_mode(void)      { return s_mode; }
 
 const sk_cli_command_t *sk_cli_lookup(const char *name)
 {
-    for (int i = 0; i < s_command_count; i++) {
-        if (strcmp(s_commands[i]->name, name) == 0) return s_commands[i];
-    }
-    return NULL;
+    if (!name) return NULL;
+    const sk_cli_command_t *c = runtime_lookup(name);
+    return c ? c : static_lookup(name);
 }
 
 void sk_cli_walk(sk_cli_walk_cb_t cb, void *user)
 {
     if (!cb) return;
-    for (int i = 0; i < s_command_count; i++) {
-        cb(s_commands[i], user);
+    for (int i = 0; i < cmd_total(); i++) {
+        const sk_cli_command_t *c = cmd_at(i);
+        if (c) cb(c, user);
     }
 }
 
@@ -176,7 +400,29 @@ void sk_cli_write(sk_cli_ctx_t *ctx, const char *chunk, size_t len)
 {
     if (!ctx || !ctx->writer || !chunk) return;
     if (len == 0) len = strlen(chunk);
-    ctx->writer(chunk, len, ctx->writer_user);
+    if (len == 0) return;
+    if (ctx->in_batch) {
+        // Batch item: the envelope becomes one element of the combined
+        // line, so its NDJSON terminator (and any other raw newline —
+        // insignificant whitespace in JSON) is dropped.
+        ctx->batch_bytes += len;
+        while (len) {
+            const char *nl = memchr(chunk, '\n', len);
+            size_t run = nl ? (size_t)(nl - chunk) : len;
+            if (run) sk_cli_coalesce_writer(chunk, run, ctx->out);
+            if (!nl) break;
+            chunk += run + 1;
+            len   -= run + 1;
+        }
+        return;
+    }
+    if (ctx->out) sk_cli_coalesce_writer(chunk, len, ctx->out);
+    else          ctx->writer(chunk, len, ctx->writer_user);
+}
+
+void sk_cli_flush(sk_cli_ctx_t *ctx)
+{
+    if (ctx && ctx->out) sk_cli_coalesce_flush(ctx->out);
 }
 
 void sk_cli_writef(sk_cli_ctx_t *ctx, const char *fmt, ...)
@@ -197,6 +443,110 @@ void sk_cli_writef(sk_cli_ctx_t *ctx, const char *fmt, ...)
     sk_cli_write(ctx, buf, (size_t)n);
 }
 
+// -- Output coalescing ------------------------------------------------------
+
+// Packet size per transport writer. Written from transport tasks (BLE MTU
+// exchange), read at every dispatch; a handful of entries, so a spinlock
+// and a linear scan.
+#define SK_CLI_MAX_WRITER_SEGS  4
+
+typedef struct {
+    sk_cli_writer_t writer;
+    void           *user;        // NULL = any writer_user
+    uint16_t        segment;
+} writer_seg_t;
+
+static writer_seg_t s_writer_seg[SK_CLI_MAX_WRITER_SEGS];
+static portMUX_TYPE s_writer_seg_lock = portMUX_INITIALIZER_UNLOCKED;
+
+esp_err_t sk_cli_set_writer_segment(sk_cli_writer_t writer, void *user, size_t segment)
+{
+    if (!writer || segment > UINT16_MAX) return ESP_ERR_INVALID_ARG;
+    esp_err_t err = ESP_OK;
+    portENTER_CRITICAL(&s_writer_seg_lock);
+    writer_seg_t *slot = NULL;
+    for (int i = 0; i < SK_CLI_MAX_WRITER_SEGS; i++) {
+        writer_seg_t *e = &s_writer_seg[i];
+        if (e->writer == writer && e->user == user) { slot = e; break; }
+        if (!slot && !e->writer) slot = e;
+    }
+    if (!slot) {
+        err = segment ? ESP_ERR_NO_MEM : ESP_OK;
+    } else if (segment) {
+        slot->writer  = writer;
+        slot->user    = user;
+        slot->segment = (uint16_t)segment;
+    } else if (slot->writer == writer) {
+        slot->writer  = NULL;
+        slot->user    = NULL;
+        slot->segment = 0;
+    }
+    portEXIT_CRITICAL(&s_writer_seg_lock);
+    return err;
+}
+
+void sk_cli_coalesce_init(sk_cli_coalesce_t *c, sk_cli_writer_t sink, void *sink_user)
+{
+    size_t segment = 0;
+    portENTER_CRITICAL(&s_writer_seg_lock);
+    for (int i = 0; i < SK_CLI_MAX_WRITER_SEGS; i++) {
+        const writer_seg_t *e = &s_writer_seg[i];
+        if (e->writer == sink && (!e->user || e->user == sink_user)) {
+            segment = e->segment;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_writer_seg_lock);
+
+    c->sink      = sink;
+    c->sink_user = sink_user;
+    c->len       = 0;
+    // Whole packets only: with a 244-byte BLE segment the buffer goes out
+    // as 2 full notifies (488 B) rather than 244 + 244 + 24.
+    c->limit = SK_CLI_COALESCE_BUF;
+    if (segment && segment < SK_CLI_COALESCE_BUF) {
+        c->limit = (uint16_t)((SK_CLI_COALESCE_BUF / segment) * segment);
+    }
+}
+
+void sk_cli_coalesce_flush(sk_cli_coalesce_t *c)
+{
+    if (!c || !c->len) return;
+    if (c->sink) c->sink(c->buf, c->len, c->sink_user);
+    c->len = 0;
+}
+
+void sk_cli_coalesce_writer(const char *chunk, size_t len, void *user)
+{
+    sk_cli_coalesce_t *c = (sk_cli_coalesce_t *)user;
+    if (!c) return;
+    if (!chunk || len == 0) { sk_cli_coalesce_flush(c); return; }
+
+    if (c->len + len > c->limit) {
+        // Top the buffer up to a whole segment count before it goes out,
+        // then decide what to do with the remainder.
+        if (c->len) {
+            size_t take = c->limit - c->len;
+            memcpy(c->buf + c->len, chunk, take);
+            c->len = c->limit;
+            chunk += take;
+            len   -= take;
+            sk_cli_coalesce_flush(c);
+        }
+        // Large payloads (userdata.read base64) skip the copy: the
+        // transport splits them itself; only the tail is buffered.
+        if (len >= c->limit) {
+            size_t direct = len - len % c->limit;
+            if (c->sink) c->sink(chunk, direct, c->sink_user);
+            chunk += direct;
+            len   -= direct;
+        }
+    }
+    memcpy(c->buf + c->len, chunk, len);
+    c->len += (uint16_t)len;
+    if (c->len == c->limit) sk_cli_coalesce_flush(c);
+}
+
 bool sk_cli_is_machine_mode(sk_cli_ctx_t *ctx) { return ctx && ctx->is_machine_mode; }
 int  sk_cli_argc(sk_cli_ctx_t *ctx)            { return ctx ? ctx->human_argc : 0; }
 
@@ -206,15 +556,38 @@ const char *sk_cli_arg(sk_cli_ctx_t *ctx, int idx)
     return ctx->human_argv[idx];
 }
 
+// Token of args[key] in machine mode, -1 when absent.
+static int machine_arg(sk_cli_ctx_t *ctx, const char *key)
+{
+    return sk_json_tok_get(ctx->machine_json, ctx->machine_toks, ctx->machine_args, key);
+}
+
+// Numeric JSON value or numeric string → long (the cJSON-era semantics:
+// native numbers are truncated, strings go through strtol).
+static bool machine_arg_long(sk_cli_ctx_t *ctx, const char *key, long *out)
+{
+    int t = machine_arg(ctx, key);
+    if (t < 0) return false;
+    double d;
+    if (sk_json_tok_number(ctx->machine_json, ctx->machine_toks, t, &d)) {
+        *out = (long)d;
+        return true;
+    }
+    const char *s = sk_json_tok_str(ctx->machine_json, ctx->machine_toks, t);
+    if (s) {
+        char *end = NULL;
+        long n = strtol(s, &end, 10);
+        if (end != s) { *out = n; return true; }
+    }
+    return false;
+}
+
 const char *sk_cli_arg_named(sk_cli_ctx_t *ctx, const char *key)
 {
     if (!ctx || !key) return NULL;
     if (ctx->is_machine_mode) {
-        if (!ctx->machine_args) return NULL;
-        cJSON *v = cJSON_GetObjectItemCaseSensitive(ctx->machine_args, key);
-        if (!v) return NULL;
-        if (cJSON_IsString(v)) return v->valuestring;
-        return NULL;  // numeric values: handlers should read via args directly
+        // numeric values: handlers read them via sk_cli_arg_long
+        return sk_json_tok_str(ctx->machine_json, ctx->machine_toks, machine_arg(ctx, key));
     } else {
         // Look for --key value pairs in human argv.
         char flag[48];
@@ -231,23 +604,10 @@ bool sk_cli_arg_long(sk_cli_ctx_t *ctx, const char *key, long *out_value)
     if (!ctx || !key || !out_value) return false;
 
     if (ctx->is_machine_mode) {
-        if (!ctx->machine_args) return false;
-        cJSON *v = cJSON_GetObjectItemCaseSensitive(ctx->machine_args, key);
-        if (!v) return false;
         // Native JSON numbers (SKAPP's typical shape: `{"offset":42}`) are
-        // the primary case — read them straight off the parsed tree
-        // without re-stringifying. Numeric strings (`{"offset":"42"}`)
-        // and human mode --key 42 fall through to strtol.
-        if (cJSON_IsNumber(v)) {
-            *out_value = (long)v->valuedouble;
-            return true;
-        }
-        if (cJSON_IsString(v) && v->valuestring) {
-            char *end = NULL;
-            long n = strtol(v->valuestring, &end, 10);
-            if (end != v->valuestring) { *out_value = n; return true; }
-        }
-        return false;
+        // the primary case; numeric strings (`{"offset":"42"}`) and human
+        // mode --key 42 fall through to strtol.
+        return machine_arg_long(ctx, key, out_value);
     }
 
     // Human mode: --key <number>
@@ -260,6 +620,37 @@ bool sk_cli_arg_long(sk_cli_ctx_t *ctx, const char *key, long *out_value)
     return true;
 }
 
+int sk_cli_arg_list(sk_cli_ctx_t *ctx, const char *key, const char **out, int max)
+{
+    if (!ctx || !key || !out || max <= 0) return 0;
+
+    if (!ctx->is_machine_mode) {
+        if (ctx->human_argc > max) return -1;
+        for (int i = 0; i < ctx->human_argc; i++) out[i] = ctx->human_argv[i];
+        return ctx->human_argc;
+    }
+
+    const char      *json = ctx->machine_json;
+    const sk_jtok_t *toks = ctx->machine_toks;
+    int t = machine_arg(ctx, key);
+    if (t < 0) return 0;
+    if (toks[t].type == SK_JTOK_STRING) {
+        out[0] = json + toks[t].start;
+        return 1;
+    }
+    if (toks[t].type != SK_JTOK_ARRAY) return -1;
+    if (toks[t].size > max) return -1;
+    // Elements follow the array token; `next` skips each one's subtree.
+    int e = t + 1;
+    for (int i = 0; i < toks[t].size; i++) {
+        const char *s = sk_json_tok_str(json, toks, e);
+        if (!s) return -1;
+        out[i] = s;
+        e = toks[e].next;
+    }
+    return toks[t].size;
+}
+
 const char *sk_cli_arg_after(sk_cli_ctx_t *ctx, const char *keyword)
 {
     if (!ctx || !keyword || !keyword[0]) return NULL;
@@ -267,10 +658,7 @@ const char *sk_cli_arg_after(sk_cli_ctx_t *ctx, const char *keyword)
     // Machine mode: fall back to JSON key lookup so handlers can use one
     // helper across modes. Same semantics as sk_cli_arg_named for strings.
     if (ctx->is_machine_mode) {
-        if (!ctx->machine_args) return NULL;
-        cJSON *v = cJSON_GetObjectItemCaseSensitive(ctx->machine_args, keyword);
-        if (cJSON_IsString(v)) return v->valuestring;
-        return NULL;
+        return sk_json_tok_str(ctx->machine_json, ctx->machine_toks, machine_arg(ctx, keyword));
     }
 
     // Human mode: scan argv pairwise. The keyword must NOT be the last
@@ -289,16 +677,7 @@ bool sk_cli_arg_after_long(sk_cli_ctx_t *ctx, const char *keyword, long *out)
 
     // Machine mode: accept native JSON numbers in addition to strings.
     if (ctx->is_machine_mode) {
-        if (!ctx->machine_args) return false;
-        cJSON *v = cJSON_GetObjectItemCaseSensitive(ctx->machine_args, keyword);
-        if (!v) return false;
-        if (cJSON_IsNumber(v)) { *out = (long)v->valuedouble; return true; }
-        if (cJSON_IsString(v) && v->valuestring) {
-            char *end = NULL;
-            long n = strtol(v->valuestring, &end, 10);
-            if (end != v->valuestring) { *out = n; return true; }
-        }
-        return false;
+        return machine_arg_long(ctx, keyword, out);
     }
 
     const char *s = sk_cli_arg_after(ctx, keyword);
@@ -673,6 +1052,345 @@ void sk_cli_err(sk_cli_ctx_t *ctx, sk_err_t err, const char *params_json_or_null
         sk_cli_writef(ctx, "error: %s - %s\n", code, msg);
     }
     ctx->wrote_envelope = true;
+    ctx->err = err;
+    sk_cli_stats_error(err);
+}
+
+// -- Streaming JSON responses -----------------------------------------------
+
+// Depth 0 is the data root; containers occupy depths 1..SK_CLI_JSON_DEPTH.
+// Human-mode layout mirrors pp_render: object members go on their own line,
+// indented two spaces per enclosing object; arrays stay inline with ", ";
+// keys and strings are printed without quotes or escapes.
+
+static void json_flush(sk_cli_json_t *j)
+{
+    if (j->len) sk_cli_write(j->ctx, j->buf, j->len);
+    j->len = 0;
+}
+
+static void json_put(sk_cli_json_t *j, const char *s, size_t n)
+{
+    while (n) {
+        size_t room = sizeof(j->buf) - j->len;
+        size_t take = n < room ? n : room;
+        memcpy(j->buf + j->len, s, take);
+        j->len += (uint16_t)take;
+        s += take;
+        n -= take;
+        if (j->len == sizeof(j->buf)) json_flush(j);
+    }
+}
+
+static void json_put_escaped(sk_cli_json_t *j, const char *s)
+{
+    while (*s) {
+        const char *run = s;
+        while (*s && *s != '"' && *s != '\\' && (unsigned char)*s >= 0x20) s++;
+        if (s > run) json_put(j, run, (size_t)(s - run));
+        if (!*s) break;
+        char esc[7];
+        unsigned char c = (unsigned char)*s++;
+        switch (c) {
+            case '"':  json_put(j, "\\\"", 2); break;
+            case '\\': json_put(j, "\\\\", 2); break;
+            case '\n': json_put(j, "\\n", 2);  break;
+            case '\r': json_put(j, "\\r", 2);  break;
+            case '\t': json_put(j, "\\t", 2);  break;
+            default:
+                snprintf(esc, sizeof(esc), "\\u%04x", c);
+                json_put(j, esc, 6);
+                break;
+        }
+    }
+}
+
+static void json_indent(sk_cli_json_t *j)
+{
+    json_put(j, "\n", 1);
+    for (int i = 0; i < j->indent; i++) json_put(j, "  ", 2);
+}
+
+// Separator / envelope bytes owed before a value at the current depth.
+// Returns false when the value sits below the depth limit and is dropped.
+static bool json_value_prefix(sk_cli_json_t *j)
+{
+    if (j->skip) return false;
+    uint16_t bit = (uint16_t)(1u << j->depth);
+    if (j->after_key) {
+        j->after_key = false;
+    } else if (j->depth == 0) {
+        if (j->has_item & bit) return false;            // one root value only
+        if (j->ctx->is_machine_mode) json_put(j, ",\"data\":", 8);
+    } else if (j->has_item & bit) {
+        if (j->ctx->is_machine_mode) json_put(j, ",", 1);
+        else                         json_put(j, ", ", 2);
+    }
+    j->has_item |= bit;
+    return true;
+}
+
+void sk_cli_json_begin(sk_cli_json_t *j, sk_cli_ctx_t *ctx)
+{
+    memset(j, 0, offsetof(sk_cli_json_t, buf));
+    j->ctx = ctx;
+    if (ctx->is_machine_mode) {
+        int n = snprintf(j->buf, sizeof(j->buf), "{\"id\":%d,\"ok\":true", ctx->machine_id);
+        j->len = (uint16_t)n;
+    } else {
+        json_put(j, "ok.", 3);
+    }
+}
+
+static void json_open(sk_cli_json_t *j, bool is_obj)
+{
+    if (!j->skip && j->depth >= SK_CLI_JSON_DEPTH) {
+        // Too deep: a null keeps the output valid JSON; the container's
+        // contents and its end() are swallowed.
+        sk_cli_json_null(j);
+        j->skip = 1;
+        return;
+    }
+    if (!json_value_prefix(j)) {
+        if (j->skip < UINT8_MAX) j->skip++;
+        return;
+    }
+    j->depth++;
+    uint16_t bit = (uint16_t)(1u << j->depth);
+    j->has_item &= (uint16_t)~bit;
+    if (is_obj) {
+        j->is_obj |= bit;
+        j->indent++;
+        if (j->ctx->is_machine_mode) json_put(j, "{", 1);
+    } else {
+        j->is_obj &= (uint16_t)~bit;
+        json_put(j, "[", 1);
+    }
+}
+
+void sk_cli_json_begin_object(sk_cli_json_t *j) { json_open(j, true); }
+void sk_cli_json_begin_array(sk_cli_json_t *j)  { json_open(j, false); }
+
+void sk_cli_json_end(sk_cli_json_t *j)
+{
+    if (j->skip) { j->skip--; return; }
+    if (j->depth == 0) return;
+    uint16_t bit = (uint16_t)(1u << j->depth);
+    if (j->is_obj & bit) {
+        if (j->ctx->is_machine_mode)  json_put(j, "}", 1);
+        else if (!(j->has_item & bit)) json_put(j, "{}", 2);
+        j->indent--;
+    } else {
+        json_put(j, "]", 1);
+    }
+    j->depth--;
+    j->after_key = false;
+}
+
+void sk_cli_json_key(sk_cli_json_t *j, const char *key)
+{
+    if (j->skip || j->depth == 0 || !key) return;
+    uint16_t bit = (uint16_t)(1u << j->depth);
+    if (j->ctx->is_machine_mode) {
+        json_put(j, (j->has_item & bit) ? ",\"" : "\"", (j->has_item & bit) ? 2 : 1);
+        json_put_escaped(j, key);
+        json_put(j, "\":", 2);
+    } else {
+        json_indent(j);
+        json_put(j, key, strlen(key));
+        json_put(j, ": ", 2);
+    }
+    j->has_item |= bit;
+    j->after_key = true;
+}
+
+void sk_cli_json_string(sk_cli_json_t *j, const char *s)
+{
+    if (!json_value_prefix(j)) return;
+    if (!s) s = "";
+    if (j->ctx->is_machine_mode) {
+        json_put(j, "\"", 1);
+        json_put_escaped(j, s);
+        json_put(j, "\"", 1);
+    } else {
+        json_put(j, s, strlen(s));
+    }
+}
+
+void sk_cli_json_number(sk_cli_json_t *j, int64_t v)
+{
+    if (!json_value_prefix(j)) return;
+    char num[24];
+    int n = snprintf(num, sizeof(num), "%lld", (long long)v);
+    json_put(j, num, (size_t)n);
+}
+
+void sk_cli_json_bool(sk_cli_json_t *j, bool v)
+{
+    if (!json_value_prefix(j)) return;
+    if (v) json_put(j, "true", 4);
+    else   json_put(j, "false", 5);
+}
+
+void sk_cli_json_null(sk_cli_json_t *j)
+{
+    if (!json_value_prefix(j)) return;
+    json_put(j, "null", 4);
+}
+
+void sk_cli_json_finish(sk_cli_json_t *j)
+{
+    while (j->skip || j->depth) sk_cli_json_end(j);
+    if (j->ctx->is_machine_mode) json_put(j, "}\n", 2);
+    else                         json_put(j, "\n", 1);
+    json_flush(j);
+    j->ctx->wrote_envelope = true;
+}
+
+// -- Deferred responses -----------------------------------------------------
+
+// Tokens are a fixed pool: the handler runs on a transport task and must
+// not fail on a fragmented heap just to say "later". A completion builds a
+// stand-in ctx from the token so sk_cli_ok/err render exactly as inline.
+#define SK_CLI_ASYNC_STACK   8192    // esp_tls handshake (smtp.test)
+#define SK_CLI_ASYNC_PRIO    4       // same as the per-command tasks it replaces
+// Workers share one FIFO queue. A second one is started only when a job
+// arrives while every worker is taken, so a 15 s smtp.test doesn't hold
+// wifi.scan / wifi.connect behind it — and a device that only ever scans
+// pays for one 8 KB stack.
+#define SK_CLI_ASYNC_WORKERS 2
+
+struct sk_cli_pending {
+    bool             used;
+    bool             is_machine_mode;
+    int              machine_id;
+    sk_cli_writer_t  writer;
+    void            *writer_user;
+};
+
+typedef struct {
+    sk_cli_pending_t  *p;
+    sk_cli_async_fn_t  fn;
+    void              *arg;
+} async_job_t;
+
+static sk_cli_pending_t s_pending[SK_CLI_PENDING_MAX];
+static portMUX_TYPE     s_pending_lock = portMUX_INITIALIZER_UNLOCKED;
+static QueueHandle_t    s_async_q;
+static bool             s_async_claimed;
+static int              s_async_workers;   // started
+static int              s_async_load;      // jobs queued or running
+
+sk_cli_pending_t *sk_cli_defer(sk_cli_ctx_t *ctx)
+{
+    if (!ctx || !ctx->writer) return NULL;
+    sk_cli_pending_t *p = NULL;
+    portENTER_CRITICAL(&s_pending_lock);
+    for (int i = 0; i < SK_CLI_PENDING_MAX; i++) {
+        if (!s_pending[i].used) { p = &s_pending[i]; p->used = true; break; }
+    }
+    portEXIT_CRITICAL(&s_pending_lock);
+    if (!p) return NULL;
+
+    // The transport's own pair, never ctx->out: the coalescer lives on the
+    // dispatcher's stack.
+    p->is_machine_mode = ctx->is_machine_mode;
+    p->machine_id      = ctx->machine_id;
+    p->writer          = ctx->writer;
+    p->writer_user     = ctx->writer_user;
+    ctx->wrote_envelope = true;
+    return p;
+}
+
+static void pending_finish(sk_cli_pending_t *p, bool ok, sk_err_t err, const char *json)
+{
+    if (!p || !p->used) return;
+    sk_cli_coalesce_t out;
+    sk_cli_coalesce_init(&out, p->writer, p->writer_user);
+    sk_cli_ctx_t ctx = {
+        .is_machine_mode = p->is_machine_mode,
+        .writer          = p->writer,
+        .writer_user     = p->writer_user,
+        .out             = &out,
+        .machine_id      = p->machine_id,
+        .machine_args    = -1,
+    };
+    if (ok) sk_cli_ok(&ctx, json);
+    else    sk_cli_err(&ctx, err, json);
+    sk_cli_coalesce_flush(&out);
+
+    portENTER_CRITICAL(&s_pending_lock);
+    p->used = false;
+    portEXIT_CRITICAL(&s_pending_lock);
+}
+
+void sk_cli_complete(sk_cli_pending_t *p, const char *data_json_or_null)
+{
+    pending_finish(p, true, SK_OK, data_json_or_null);
+}
+
+void sk_cli_complete_err(sk_cli_pending_t *p, sk_err_t err, const char *params_json_or_null)
+{
+    pending_finish(p, false, err, params_json_or_null);
+}
+
+static void async_task(void *arg)
+{
+    QueueHandle_t q = (QueueHandle_t)arg;
+    for (;;) {
+        async_job_t job;
+        if (xQueueReceive(q, &job, portMAX_DELAY) != pdTRUE) continue;
+        job.fn(job.p, job.arg);
+        portENTER_CRITICAL(&s_pending_lock);
+        s_async_load--;
+        portEXIT_CRITICAL(&s_pending_lock);
+    }
+}
+
+esp_err_t sk_cli_async(sk_cli_pending_t *p, sk_cli_async_fn_t fn, void *arg)
+{
+    if (!fn) return ESP_ERR_INVALID_ARG;
+
+    // First caller creates the queue; a failed create is not retried.
+    portENTER_CRITICAL(&s_pending_lock);
+    bool mine = !s_async_claimed;
+    s_async_claimed = true;
+    portEXIT_CRITICAL(&s_pending_lock);
+    if (mine) {
+        s_async_q = xQueueCreate(SK_CLI_PENDING_MAX, sizeof(async_job_t));
+        if (!s_async_q) ESP_LOGE(TAG, "async queue create failed");
+    }
+    if (!s_async_q) return ESP_ERR_NO_MEM;
+
+    // Every worker busy (or none yet): start another, up to the pool size.
+    portENTER_CRITICAL(&s_pending_lock);
+    bool spawn = s_async_load >= s_async_workers &&
+                 s_async_workers < SK_CLI_ASYNC_WORKERS;
+    if (spawn) s_async_workers++;
+    portEXIT_CRITICAL(&s_pending_lock);
+    if (spawn && xTaskCreate(async_task, "sk_cli_async", SK_CLI_ASYNC_STACK,
+                             s_async_q, SK_CLI_ASYNC_PRIO, NULL) != pdPASS) {
+        portENTER_CRITICAL(&s_pending_lock);
+        s_async_workers--;
+        portEXIT_CRITICAL(&s_pending_lock);
+        ESP_LOGE(TAG, "async worker start failed");
+    }
+
+    // Counted before the send, so a worker never sees its job uncounted.
+    portENTER_CRITICAL(&s_pending_lock);
+    bool have_worker = s_async_workers > 0;
+    if (have_worker) s_async_load++;
+    portEXIT_CRITICAL(&s_pending_lock);
+    if (!have_worker) return ESP_ERR_NO_MEM;
+
+    async_job_t job = { .p = p, .fn = fn, .arg = arg };
+    if (xQueueSend(s_async_q, &job, 0) != pdTRUE) {
+        portENTER_CRITICAL(&s_pending_lock);
+        s_async_load--;
+        portEXIT_CRITICAL(&s_pending_lock);
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
 }
 
 // -- Tokenizer (human mode) -------------------------------------------------
@@ -761,6 +1479,23 @@ static const sk_cli_command_t *resolve_human(const char **tokens, int token_coun
 
 // -- Dispatcher -------------------------------------------------------------
 
+// Handler call plus the dispatcher's fallback envelope, measured for
+// cli.stats (sk_cli_stats.c). In machine mode SK_OK without output still
+// gets an ok envelope; human mode stays silent then.
+static void run_handler(sk_cli_ctx_t *ctx, const sk_cli_command_t *cmd)
+{
+    sk_cli_stats_mark_t mark;
+    sk_cli_stats_begin(&mark);
+    sk_err_t rc = cmd->handler(ctx);
+    if (!ctx->wrote_envelope) {
+        // SK_PENDING without sk_cli_defer: nobody will ever answer.
+        sk_err_t code = rc == SK_PENDING ? SK_ERR_INTERNAL : rc;
+        if (code != SK_OK)             sk_cli_err(ctx, code, NULL);
+        else if (ctx->is_machine_mode) sk_cli_ok(ctx, NULL);
+    }
+    sk_cli_stats_end(&mark, cmd, rc, ctx->err);
+}
+
 // Returns true if the auth gate fires (and an error envelope was emitted),
 // in which case the caller skips invoking the handler.
 static bool reject_if_unauthenticated(sk_cli_ctx_t *ctx, const sk_cli_command_t *cmd)
@@ -770,74 +1505,69 @@ static bool reject_if_unauthenticated(sk_cli_ctx_t *ctx, const sk_cli_command_t
     return true;
 }
 
-static void dispatch_machine(char *line, sk_cli_writer_t writer, void *user, bool authenticated)
+// One machine-mode request: the object at token `obj`. Returns the bytes
+// the response took (only tracked for batch items).
+static size_t dispatch_machine_obj(char *line, const sk_jtok_t *toks, int obj,
+                                   sk_cli_writer_t writer, void *user, bool authenticated,
+                                   sk_cli_coalesce_t *out, bool in_batch)
 {
-    sk_cli_set_mode(SK_CLI_MODE_MACHINE);
-
-    cJSON *msg = cJSON_Parse(line);
-    if (!msg) {
-        char errbuf[128];
-        snprintf(errbuf, sizeof(errbuf),
-                 "{\"ok\":false,\"err\":\"ERR_INVALID_ARG\",\"params\":{\"reason\":\"json_parse\"}}\n");
-        writer(errbuf, strlen(errbuf), user);
-        return;
-    }
-
-    cJSON *cmd_node    = cJSON_GetObjectItemCaseSensitive(msg, "cmd");
-    cJSON *id_node     = cJSON_GetObjectItemCaseSensitive(msg, "id");
-    cJSON *args_node   = cJSON_GetObjectItemCaseSensitive(msg, "args");
-    cJSON *argv_node   = cJSON_GetObjectItemCaseSensitive(msg, "argv");
-    cJSON *tok_node    = cJSON_GetObjectItemCaseSensitive(msg, "confirm_token");
+    int cmd_node  = sk_json_tok_get(line, toks, obj, "cmd");
+    int id_node   = sk_json_tok_get(line, toks, obj, "id");
+    int args_node = sk_json_tok_get(line, toks, obj, "args");
+    int argv_node = sk_json_tok_get(line, toks, obj, "argv");
+    int tok_node  = sk_json_tok_get(line, toks, obj, "confirm_token");
+    if (args_node >= 0 && toks[args_node].type != SK_JTOK_OBJECT) args_node = -1;
 
     // Machine mode pozisyonel argümanlar: SKAPP `argv: ["X","Y"]` array'i
     // gönderirse string pointerlarını human_argv slotuna doldur. Böylece
     // sk_cli_arg(ctx, i) / sk_cli_argc(ctx) machine mode'da da pozisyonel
     // erişim verir; positional fallback yazan handler'lar
     // (cmd_wifi_connect gibi) machine_mode kısıtı olmadan çalışır.
-    // Pointerlar msg lifetime'ına bağlı — cJSON_Delete(msg) bu dispatcher
-    // sonunda çağrılır, ctx çoktan handler'dan dönmüş olur.
+    // Pointerlar `line` buffer'ının içine işaret eder — dispatcher dönene
+    // kadar geçerli, ctx çoktan handler'dan dönmüş olur.
     const char *machine_argv_buf[SK_CLI_MAX_ARGV];
     int machine_argc = 0;
-    if (cJSON_IsArray(argv_node)) {
-        cJSON *item;
-        cJSON_ArrayForEach(item, argv_node) {
+    if (argv_node >= 0 && toks[argv_node].type == SK_JTOK_ARRAY) {
+        int item = argv_node + 1;
+        for (int i = 0; i < toks[argv_node].size; i++, item = toks[item].next) {
             if (machine_argc >= SK_CLI_MAX_ARGV) break;
-            if (cJSON_IsString(item) && item->valuestring) {
-                machine_argv_buf[machine_argc++] = item->valuestring;
-            }
+            const char *v = sk_json_tok_str(line, toks, item);
+            if (v) machine_argv_buf[machine_argc++] = v;
         }
     }
+    double id_num = -1;
+    bool   has_id = sk_json_tok_number(line, toks, id_node, &id_num);
 
     sk_cli_ctx_t ctx = {
         .is_machine_mode = true,
         .writer          = writer,
         .writer_user     = user,
-        .machine_msg     = msg,
+        .out             = out,
+        .machine_json    = line,
+        .machine_toks    = toks,
         .machine_args    = args_node,
-        .machine_id      = cJSON_IsNumber(id_node) ? id_node->valueint : -1,
-        .confirm_token   = cJSON_IsString(tok_node) ? tok_node->valuestring : NULL,
+        .machine_id      = has_id ? (int)id_num : -1,
+        .confirm_token   = sk_json_tok_str(line, toks, tok_node),
         .authenticated   = authenticated,
         .human_argv      = machine_argc > 0 ? machine_argv_buf : NULL,
         .human_argc      = machine_argc,
+        .in_batch        = in_batch,
     };
 
-    if (!cJSON_IsString(cmd_node)) {
+    ctx.command_name = sk_json_tok_str(line, toks, cmd_node);
+    if (!ctx.command_name) {
         sk_cli_err(&ctx, SK_ERR_MISSING_ARG, "{\"field\":\"cmd\"}");
-        cJSON_Delete(msg);
-        return;
+        return ctx.batch_bytes;
     }
-    ctx.command_name = cmd_node->valuestring;
 
     const sk_cli_command_t *cmd = sk_cli_lookup(ctx.command_name);
     if (!cmd) {
         sk_cli_err(&ctx, SK_ERR_UNKNOWN_COMMAND, NULL);
-        cJSON_Delete(msg);
-        return;
+        return ctx.batch_bytes;
     }
 
     if (reject_if_unauthenticated(&ctx, cmd)) {
-        cJSON_Delete(msg);
-        return;
+        return ctx.batch_bytes;
     }
 
     // Auto-issue confirm token (machine-mode counterpart of the human path).
@@ -854,21 +1584,91 @@ static void dispatch_machine(char *line, sk_cli_writer_t writer, void *user, boo
                      "{\"confirm_token\":\"%s\",\"ttl_sec\":%lu,\"cmd\":\"%s\"}",
                      hex, (unsigned long)ttl, cmd->name);
             sk_cli_err(&ctx, SK_ERR_CONFIRM_TOKEN_REQUIRED, params);
-            cJSON_Delete(msg);
-            return;
+            return ctx.batch_bytes;
         }
         // Issuer failed — fall through to legacy handler-emitted error.
     }
 
-    sk_err_t rc = cmd->handler(&ctx);
-    if (!ctx.wrote_envelope) {
-        if (rc == SK_OK) sk_cli_ok(&ctx, NULL);
-        else             sk_cli_err(&ctx, rc, NULL);
+    run_handler(&ctx, cmd);
+    return ctx.batch_bytes;
+}
+
+// {"id":N,"batch":[{"id":1,"cmd":...},{"id":2,"cmd":...}]}
+//   -> {"id":N,"batch":[{"id":1,"ok":true,...},{"id":2,...}]}\n
+//
+// SKAPP's connect flow is a run of independent reads (device.info,
+// timer.get, relay.get, ...). On BLE each one costs a round trip and, once
+// authenticated, its own HMAC envelope; a batch rides in one signed body
+// (verified once by sk_secure_session) and comes back as one line. Items
+// run in order, each with its own id, auth and confirm-token checks — a
+// failing item is just an error element, the rest still run. A handler
+// that answers later on its own (wifi.scan) leaves {"id":N,"async":true}
+// in its slot; the real envelope follows as a separate line.
+static void dispatch_batch(char *line, const sk_jtok_t *toks, int batch_node, int id_node,
+                           sk_cli_writer_t writer, void *user, bool authenticated,
+                           sk_cli_coalesce_t *out)
+{
+    double id_num = -1;
+    char   head[40];
+    int    hn;
+    if (sk_json_tok_number(line, toks, id_node, &id_num)) {
+        hn = snprintf(head, sizeof(head), "{\"id\":%d,\"batch\":[", (int)id_num);
+    } else {
+        hn = snprintf(head, sizeof(head), "{\"batch\":[");
     }
-    cJSON_Delete(msg);
+    sk_cli_coalesce_writer(head, (size_t)hn, out);
+
+    int item = batch_node + 1;
+    for (int i = 0; i < toks[batch_node].size; i++, item = toks[item].next) {
+        if (i) sk_cli_coalesce_writer(",", 1, out);
+        if (i >= SK_CLI_BATCH_MAX || toks[item].type != SK_JTOK_OBJECT ||
+            sk_json_tok_get(line, toks, item, "batch") >= 0) {
+            static const char bad[] =
+                "{\"ok\":false,\"err\":\"ERR_INVALID_ARG\",\"params\":{\"reason\":\"batch_item\"}}";
+            sk_cli_coalesce_writer(bad, sizeof(bad) - 1, out);
+            continue;
+        }
+        size_t n = dispatch_machine_obj(line, toks, item, writer, user, authenticated, out, true);
+        if (n == 0) {
+            double item_id = -1;
+            sk_json_tok_number(line, toks, sk_json_tok_get(line, toks, item, "id"), &item_id);
+            char async[40];
+            int an = snprintf(async, sizeof(async), "{\"id\":%d,\"async\":true}", (int)item_id);
+            sk_cli_coalesce_writer(async, (size_t)an, out);
+        }
+    }
+    sk_cli_coalesce_writer("]}\n", 3, out);
 }
 
-static void dispatch_human(char *line, sk_cli_writer_t writer, void *user, bool authenticated)
+static void dispatch_machine(char *line, sk_cli_writer_t writer, void *user, bool authenticated,
+                             sk_cli_coalesce_t *out)
+{
+    sk_cli_set_mode(SK_CLI_MODE_MACHINE);
+
+    // Tokenized in place — strings are unescaped and terminated inside
+    // `line` (the dispatch_common stack copy), no heap involved.
+    sk_jtok_t toks[SK_CLI_MAX_TOKENS];
+    int ntok = sk_json_tok_parse(line, strlen(line), toks, SK_CLI_MAX_TOKENS);
+    if (ntok <= 0 || toks[0].type != SK_JTOK_OBJECT) {
+        char errbuf[128];
+        snprintf(errbuf, sizeof(errbuf),
+                 "{\"ok\":false,\"err\":\"ERR_INVALID_ARG\",\"params\":{\"reason\":\"%s\"}}\n",
+                 ntok == SK_JTOK_ERR_NOMEM ? "json_too_complex" : "json_parse");
+        writer(errbuf, strlen(errbuf), user);
+        return;
+    }
+
+    int batch_node = sk_json_tok_get(line, toks, 0, "batch");
+    if (batch_node >= 0 && toks[batch_node].type == SK_JTOK_ARRAY) {
+        dispatch_batch(line, toks, batch_node, sk_json_tok_get(line, toks, 0, "id"),
+                       writer, user, authenticated, out);
+        return;
+    }
+    dispatch_machine_obj(line, toks, 0, writer, user, authenticated, out, false);
+}
+
+static void dispatch_human(char *line, sk_cli_writer_t writer, void *user, bool authenticated,
+                           sk_cli_coalesce_t *out)
 {
     sk_cli_set_mode(SK_CLI_MODE_HUMAN);
 
@@ -883,6 +1683,7 @@ static void dispatch_human(char *line, sk_cli_writer_t writer, void *user, bool
         .is_machine_mode = false,
         .writer          = writer,
         .writer_user     = user,
+        .out             = out,
         .machine_id      = -1,
         .human_argv      = tokens + consumed,
         .human_argc      = token_count - consumed,
@@ -946,10 +1747,7 @@ static void dispatch_human(char *line, sk_cli_writer_t writer, void *user, bool
         // hit its own ERR_CONFIRM_TOKEN_REQUIRED check and respond.
     }
 
-    sk_err_t rc = cmd->handler(&ctx);
-    if (!ctx.wrote_envelope && rc != SK_OK) {
-        sk_cli_err(&ctx, rc, NULL);
-    }
+    run_handler(&ctx, cmd);
 }
 
 static esp_err_t dispatch_common(const char *line, sk_cli_writer_t writer, void *user, bool authenticated)
@@ -968,11 +1766,16 @@ static esp_err_t dispatch_common(const char *line, sk_cli_writer_t writer, void
     // Strip trailing CR/LF.
     while (len > 0 && (buf[len - 1] == '\r' || buf[len - 1] == '\n')) buf[--len] = '\0';
 
+    // One coalescer per dispatch: the whole response leaves in as few
+    // transport writes as the segment size allows.
+    sk_cli_coalesce_t out;
+    sk_cli_coalesce_init(&out, writer, user);
     if (buf[0] == '{') {
-        dispatch_machine(buf, writer, user, authenticated);
+        dispatch_machine(buf, writer, user, authenticated, &out);
     } else {
-        dispatch_human(buf, writer, user, authenticated);
+        dispatch_human(buf, writer, user, authenticated, &out);
     }
+    sk_cli_coalesce_flush(&out);
     return ESP_OK;
 }
 
@@ -1002,12 +1805,98 @@ static sk_err_t builtin_json_off(sk_cli_ctx_t *ctx)
     return SK_OK;
 }
 
-// Length of the namespace prefix (chars before first '.') in a command
-// name. Returns 0 for namespaceless commands like "help" or "?".
-static size_t namespace_len(const char *name)
+// -- cli.bench --------------------------------------------------------------
+
+// The pre-index lookup, kept only as the benchmark baseline.
+static const sk_cli_command_t *lookup_linear(const char *name)
 {
-    const char *dot = strchr(name, '.');
-    return dot ? (size_t)(dot - name) : 0;
+    for (int i = 0; i < cmd_total(); i++) {
+        const sk_cli_command_t *c = cmd_at(i);
+        if (c && strcmp(c->name, name) == 0) return c;
+    }
+    return NULL;
+}
+
+static sk_err_t builtin_cli_bench(sk_cli_ctx_t *ctx)
+{
+    long iters = 1000;
+    sk_cli_arg_after_long(ctx, "iters", &iters);
+    if (iters < 1 || iters > 100000) {
+        sk_cli_err(ctx, SK_ERR_INVALID_ARG, "{\"field\":\"iters\",\"min\":1,\"max\":100000}");
+        return SK_OK;
+    }
+    // Every reachable name, static table included.
+    enum { MAX_NAMES = SK_CLI_MAX_COMMANDS * 2 };
+    const char **names = malloc(sizeof(*names) * MAX_NAMES);
+    if (!names) {
+        sk_cli_err(ctx, SK_ERR_INTERNAL, "{\"reason\":\"oom\"}");
+        return SK_OK;
+    }
+    int n = 0;
+    for (int i = 0; i < cmd_total() && n < MAX_NAMES; i++) {
+        const sk_cli_command_t *c = cmd_at(i);
+        if (c) names[n++] = c->name;
+    }
+    static const char *miss = "nosuch.command.name";
+    volatile uintptr_t sink = 0;   // keep the loops from being optimised out
+
+    int64_t t0 = esp_timer_get_time();
+    for (long it = 0; it < iters; it++) {
+        for (int i = 0; i < n; i++) sink += (uintptr_t)sk_cli_lookup(names[i]);
+    }
+    int64_t t1 = esp_timer_get_time();
+    for (long it = 0; it < iters; it++) {
+        for (int i = 0; i < n; i++) sink += (uintptr_t)lookup_linear(names[i]);
+    }
+    int64_t t2 = esp_timer_get_time();
+    for (long it = 0; it < iters; it++) sink += (uintptr_t)sk_cli_lookup(miss);
+    int64_t t3 = esp_timer_get_time();
+    for (long it = 0; it < iters; it++) sink += (uintptr_t)lookup_linear(miss);
+    int64_t t4 = esp_timer_get_time();
+
+    // First 3-segment command plus two arguments, e.g. "api endpoint add
+    // x y": the resolver tries 5 and 4 words before it matches on 3.
+    char words[3][48];
+    const char *tokens[5] = { "api", "endpoint", "add", "x", "y" };
+    for (int i = 0; i < n; i++) {
+        const char *name = names[i];
+        const char *d1 = strchr(name, '.');
+        const char *d2 = d1 ? strchr(d1 + 1, '.') : NULL;
+        if (d2 && !strchr(d2 + 1, '.')) {
+            size_t l0 = (size_t)(d1 - name), l1 = (size_t)(d2 - d1 - 1), l2 = strlen(d2 + 1);
+            if (l0 >= sizeof(words[0]) || l1 >= sizeof(words[0]) || l2 >= sizeof(words[0])) continue;
+            memcpy(words[0], name, l0);       words[0][l0] = '\0';
+            memcpy(words[1], d1 + 1, l1);     words[1][l1] = '\0';
+            memcpy(words[2], d2 + 1, l2 + 1);
+            tokens[0] = words[0]; tokens[1] = words[1]; tokens[2] = words[2];
+            break;
+        }
+    }
+    int consumed = 0;
+    int64_t t5 = esp_timer_get_time();
+    for (long it = 0; it < iters; it++) sink += (uintptr_t)resolve_human(tokens, 5, &consumed);
+    int64_t t6 = esp_timer_get_time();
+    (void)sink;
+    free(names);
+
+    char buf[256];
+    int w = snprintf(buf, sizeof(buf),
+                     "{\"iters\":%ld,\"unit\":\"ns\",\"commands\":%d,"
+                     "\"hit_index\":%lu,\"hit_linear\":%lu,"
+                     "\"miss_index\":%lu,\"miss_linear\":%lu,"
+                     "\"resolve\":%lu}",
+                     iters, n,
+                     (unsigned long)(n ? (t1 - t0) * 1000 / (iters * n) : 0),
+                     (unsigned long)(n ? (t2 - t1) * 1000 / (iters * n) : 0),
+                     (unsigned long)((t3 - t2) * 1000 / iters),
+                     (unsigned long)((t4 - t3) * 1000 / iters),
+                     (unsigned long)((t6 - t5) * 1000 / iters));
+    if (w < 0 || (size_t)w >= sizeof(buf)) {
+        sk_cli_err(ctx, SK_ERR_INTERNAL, NULL);
+        return SK_OK;
+    }
+    sk_cli_ok(ctx, buf);
+    return SK_OK;
 }
 
 // Detail view for a single command — usage, full help body, critical flag.
@@ -1039,14 +1928,15 @@ static void render_topic(sk_cli_ctx_t *ctx, const char *topic)
 {
     size_t tlen = strlen(topic);
     int    hits = 0;
+    ns_iter_t it;
+    ns_iter_init(&it, topic);
     sk_cli_writef(ctx, "%s commands:\n", topic);
-    for (int i = 0; i < s_command_count; i++) {
-        const char *name = s_commands[i]->name;
-        if (s_commands[i]->hidden) continue;
-        if (strncmp(name, topic, tlen) == 0 && name[tlen] == '.') {
+    for (const sk_cli_command_t *c; (c = ns_iter_next(&it)) != NULL; ) {
+        if (c->hidden) continue;
+        if (strncmp(c->name, topic, tlen) == 0 && c->name[tlen] == '.') {
             sk_cli_writef(ctx, "  %-28s %s\n",
-                          name,
-                          s_commands[i]->summary ? s_commands[i]->summary : "");
+                          c->name,
+                          c->summary ? c->summary : "");
             hits++;
         }
     }
@@ -1062,21 +1952,24 @@ static void render_topic(sk_cli_ctx_t *ctx, const char *topic)
 static void render_flat_list(sk_cli_ctx_t *ctx)
 {
     sk_cli_write(ctx, "All commands:\n", 0);
-    for (int i = 0; i < s_command_count; i++) {
+    for (int i = 0; i < cmd_total(); i++) {
+        const sk_cli_command_t *c = cmd_at(i);
+        if (!c) continue;
         sk_cli_writef(ctx, "  %-28s %s%s\n",
-                      s_commands[i]->name,
-                      s_commands[i]->summary ? s_commands[i]->summary : "",
-                      s_commands[i]->hidden ? "  [hidden]" : "");
+                      c->name,
+                      c->summary ? c->summary : "",
+                      c->hidden ? "  [hidden]" : "");
     }
 }
 
 // True if the given namespace has at least one non-hidden command.
 static bool topic_has_visible_commands(const char *topic, size_t tlen)
 {
-    for (int i = 0; i < s_command_count; i++) {
-        if (s_commands[i]->hidden) continue;
-        const char *name = s_commands[i]->name;
-        if (strncmp(name, topic, tlen) == 0 && name[tlen] == '.') return true;
+    ns_iter_t it;
+    ns_iter_init(&it, topic);
+    for (const sk_cli_command_t *c; (c = ns_iter_next(&it)) != NULL; ) {
+        if (c->hidden) continue;
+        if (strncmp(c->name, topic, tlen) == 0 && c->name[tlen] == '.') return true;
     }
     return false;
 }
@@ -1085,10 +1978,11 @@ static bool topic_has_visible_commands(const char *topic, size_t tlen)
 static int topic_visible_command_count(const char *topic, size_t tlen)
 {
     int n = 0;
-    for (int i = 0; i < s_command_count; i++) {
-        if (s_commands[i]->hidden) continue;
-        const char *name = s_commands[i]->name;
-        if (strncmp(name, topic, tlen) == 0 && name[tlen] == '.') n++;
+    ns_iter_t it;
+    ns_iter_init(&it, topic);
+    for (const sk_cli_command_t *c; (c = ns_iter_next(&it)) != NULL; ) {
+        if (c->hidden) continue;
+        if (strncmp(c->name, topic, tlen) == 0 && c->name[tlen] == '.') n++;
     }
     return n;
 }
@@ -1126,7 +2020,8 @@ static bool render_category_topics(sk_cli_ctx_t *ctx, const char *category)
 // the order of their sk_cli_register_topic() calls.
 static void render_overview(sk_cli_ctx_t *ctx)
 {
-    sk_core_write_banner(ctx->writer, ctx->writer_user);
+    if (ctx->out) sk_core_write_banner(sk_cli_coalesce_writer, ctx->out);
+    else          sk_core_write_banner(ctx->writer, ctx->writer_user);
 
     // Walk topic table to discover categories in registration order;
     // dedup as we go. Hidden-only topics still contribute their category
@@ -1176,19 +2071,20 @@ static void render_overview(sk_cli_ctx_t *ctx)
 
     // Namespaceless commands (e.g. `help`). Hidden ones (`json.on/off`)
     // are filtered out.
+    ns_iter_t it;
+    ns_iter_init_root(&it);
     bool any_root = false;
-    for (int i = 0; i < s_command_count; i++) {
-        if (s_commands[i]->hidden) continue;
-        if (namespace_len(s_commands[i]->name) == 0) { any_root = true; break; }
+    for (const sk_cli_command_t *c; (c = ns_iter_next(&it)) != NULL; ) {
+        if (!c->hidden) { any_root = true; break; }
     }
     if (any_root) {
         sk_cli_write(ctx, "\nROOT\n", 0);
-        for (int i = 0; i < s_command_count; i++) {
-            if (s_commands[i]->hidden) continue;
-            if (namespace_len(s_commands[i]->name) != 0) continue;
+        ns_iter_init_root(&it);
+        for (const sk_cli_command_t *c; (c = ns_iter_next(&it)) != NULL; ) {
+            if (c->hidden) continue;
             sk_cli_writef(ctx, "  %-12s %s\n",
-                          s_commands[i]->name,
-                          s_commands[i]->summary ? s_commands[i]->summary : "");
+                          c->name,
+                          c->summary ? c->summary : "");
         }
     }
 
@@ -1254,19 +2150,23 @@ static sk_err_t builtin_help(sk_cli_ctx_t *ctx)
         snprintf(idbuf, sizeof(idbuf), "%d", ctx->machine_id);
         sk_cli_write(ctx, idbuf, 0);
         sk_cli_write(ctx, ",\"ok\":true,\"data\":{\"commands\":[", 0);
-        for (int i = 0; i < s_command_count; i++) {
-            if (i) sk_cli_write(ctx, ",", 1);
+        bool first = true;
+        for (int i = 0; i < cmd_total(); i++) {
+            const sk_cli_command_t *c = cmd_at(i);
+            if (!c) continue;
+            if (!first) sk_cli_write(ctx, ",", 1);
+            first = false;
             sk_cli_write(ctx, "{\"name\":", 8);
-            emit_json_string(ctx, s_commands[i]->name);
+            emit_json_string(ctx, c->name);
             sk_cli_write(ctx, ",\"summary\":", 11);
-            emit_json_string(ctx, s_commands[i]->summary);
+            emit_json_string(ctx, c->summary);
             sk_cli_write(ctx, ",\"usage\":", 9);
-            emit_json_string(ctx, s_commands[i]->usage);
+            emit_json_string(ctx, c->usage);
             sk_cli_write(ctx, ",\"help_block\":", 14);
-            emit_json_string(ctx, s_commands[i]->help_block);
+            emit_json_string(ctx, c->help_block);
             sk_cli_writef(ctx, ",\"critical\":%s,\"hidden\":%s}",
-                          s_commands[i]->critical ? "true" : "false",
-                          s_commands[i]->hidden   ? "true" : "false");
+                          c->critical ? "true" : "false",
+                          c->hidden   ? "true" : "false");
         }
         sk_cli_write(ctx, "],\"topics\":[", 0);
         for (int i = 0; i < s_topic_count; i++) {
@@ -1303,9 +2203,10 @@ static sk_err_t builtin_help(sk_cli_ctx_t *ctx)
 
     // 2) Topic prefix? → list every command under <target>.*.
     size_t tlen = strlen(target);
-    for (int i = 0; i < s_command_count; i++) {
-        const char *name = s_commands[i]->name;
-        if (strncmp(name, target, tlen) == 0 && name[tlen] == '.') {
+    ns_iter_t it;
+    ns_iter_init(&it, target);
+    for (const sk_cli_command_t *c; (c = ns_iter_next(&it)) != NULL; ) {
+        if (strncmp(c->name, target, tlen) == 0 && c->name[tlen] == '.') {
             render_topic(ctx, target);
             return SK_OK;
         }
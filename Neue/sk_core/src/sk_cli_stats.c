@@ -0,0 +1,352 @@
+// sk_cli_stats.c — per-command latency / heap / stack counters (`cli.stats`).
+//
+// Every handler call goes through the dispatcher (sk_cli.c), which marks
+// the clock and free heap before the call and hands both back here
+// afterwards. Nothing is kept per call:
+// latency lands in a power-of-two histogram, so p50/p99 are bucket upper
+// bounds (clamped to the observed max), good enough to tell 200 us from
+// 20 ms.
+//
+// Stack — FreeRTOS only tracks a per-task low-water mark, and reading it
+// scans the unused stack, so it is read once per call, afterwards, and
+// compared with the last value seen for that task (s_task_low). A call
+// that pushed it lower is the deepest thing that task has ever run; we
+// record that value and the task's name against the command. Calls that
+// stay above an older low teach us nothing and are not counted, nor is
+// the first call seen on a task (no baseline yet). The stack overflow in
+// sk_tcp_cli0 would have shown up here as a command with a stack_free_min
+// of a few dozen bytes long before it hit the guard.
+//
+// Heap — free-heap delta over the call, most negative kept. Other tasks
+// allocate meanwhile, so a single odd value is noise; a command that is
+// always negative is holding on to memory.
+//
+// Async work (sk_cli_defer) is timed up to the handler's return only;
+// `pending` counts those calls.
+//
+// Table — one pointer per command-table slot (sk_cli_command_slot: ~100
+// static commands plus the runtime registrations), the entry itself
+// allocated on the command's first call. Commands nobody runs cost four
+// bytes.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "sk_cli.h"
+#include "sk_cli_internal.h"
+#include "sk_errors.h"
+
+#define SK_CLI_STATS_BUCKETS   16     // <128 us, <256 us, ... , >= ~2 s
+#define SK_CLI_STATS_TASK_NAME 16
+#define SK_CLI_STATS_TASKS     12     // dispatching tasks with a stack baseline
+
+typedef struct {
+    const sk_cli_command_t *cmd;
+    uint32_t calls;
+    uint32_t errors;
+    uint32_t pending;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint16_t hist[SK_CLI_STATS_BUCKETS];
+    int32_t  heap_delta_min;
+    uint32_t stack_free_min;                    // UINT32_MAX = never lowered
+    char     stack_task[SK_CLI_STATS_TASK_NAME];
+} cmd_stats_t;
+
+typedef struct {
+    TaskHandle_t task;
+    uint32_t     low;                           // last high-water mark read
+} task_low_t;
+
+static cmd_stats_t **s_stats;                   // [sk_cli_command_slots()]
+static int           s_nslots;
+static task_low_t    s_task_low[SK_CLI_STATS_TASKS];
+static int           s_task_next;               // round-robin reuse when full
+static uint32_t     s_untracked;                // unknown command or no memory
+static uint32_t     s_err_count[SK_ERR__COUNT];
+static int64_t      s_since_us;
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static int bucket_of(uint32_t us)
+{
+    uint32_t v = us >> 7;
+    int b = 0;
+    while (v && b < SK_CLI_STATS_BUCKETS - 1) { v >>= 1; b++; }
+    return b;
+}
+
+// Entry for `cmd`, created on its first call. Not under the lock: it
+// may allocate. NULL when out of memory.
+static cmd_stats_t *entry_for(const sk_cli_command_t *cmd)
+{
+    int slot = sk_cli_command_slot(cmd);
+    if (slot < 0) return NULL;
+    if (!s_stats) {
+        int n = sk_cli_command_slots();
+        cmd_stats_t **t = calloc((size_t)n, sizeof(*t));
+        if (!t) return NULL;
+        portENTER_CRITICAL(&s_stats_lock);
+        if (!s_stats) { s_stats = t; s_nslots = n; t = NULL; }
+        portEXIT_CRITICAL(&s_stats_lock);
+        free(t);
+    }
+    cmd_stats_t *e = s_stats[slot];
+    if (e) return e;
+    cmd_stats_t *fresh = calloc(1, sizeof(*fresh));
+    if (!fresh) return NULL;
+    fresh->stack_free_min = UINT32_MAX;
+    portENTER_CRITICAL(&s_stats_lock);
+    if (!s_stats[slot]) { s_stats[slot] = fresh; fresh = NULL; }
+    e = s_stats[slot];
+    portEXIT_CRITICAL(&s_stats_lock);
+    free(fresh);
+    return e;
+}
+
+// Swap in this task's new low-water mark; true if it went down since the
+// last call seen on this task. Caller holds s_stats_lock.
+static bool task_lowered(TaskHandle_t task, uint32_t low)
+{
+    for (int i = 0; i < SK_CLI_STATS_TASKS; i++) {
+        task_low_t *t = &s_task_low[i];
+        if (t->task != task) continue;
+        bool lower = low < t->low;
+        t->low = low;
+        return lower;
+    }
+    task_low_t *t = &s_task_low[s_task_next];
+    s_task_next = (s_task_next + 1) % SK_CLI_STATS_TASKS;
+    t->task = task;
+    t->low  = low;
+    return false;
+}
+
+void sk_cli_stats_begin(sk_cli_stats_mark_t *m)
+{
+    m->heap0 = esp_get_free_heap_size();
+    m->t0_us = esp_timer_get_time();
+}
+
+void sk_cli_stats_end(const sk_cli_stats_mark_t *m, const sk_cli_command_t *cmd,
+                      sk_err_t rc, sk_err_t err)
+{
+    int64_t  dt     = esp_timer_get_time() - m->t0_us;
+    int32_t  dheap  = (int32_t)(esp_get_free_heap_size() - m->heap0);
+    uint32_t stack1 = (uint32_t)uxTaskGetStackHighWaterMark(NULL);
+    uint32_t us     = dt < 0 ? 0 : dt > UINT32_MAX ? UINT32_MAX : (uint32_t)dt;
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    cmd_stats_t *e    = entry_for(cmd);
+
+    portENTER_CRITICAL(&s_stats_lock);
+    bool lowered = task_lowered(self, stack1);
+    if (!e) {
+        s_untracked++;
+        portEXIT_CRITICAL(&s_stats_lock);
+        return;
+    }
+    e->cmd = cmd;
+    e->calls++;
+    if (err != SK_OK || (rc != SK_OK && rc != SK_PENDING)) e->errors++;
+    if (rc == SK_PENDING) e->pending++;
+    e->total_us += us;
+    if (us > e->max_us) e->max_us = us;
+    uint16_t *h = &e->hist[bucket_of(us)];
+    if (*h < UINT16_MAX) (*h)++;
+    if (e->calls == 1 || dheap < e->heap_delta_min) e->heap_delta_min = dheap;
+    bool name_it = lowered && stack1 < e->stack_free_min;
+    if (name_it) e->stack_free_min = stack1;
+    portEXIT_CRITICAL(&s_stats_lock);
+
+    if (name_it) {
+        // Racy against a concurrent reader at worst a torn name; it only
+        // feeds a diagnostic.
+        strncpy(e->stack_task, pcTaskGetName(NULL), sizeof(e->stack_task) - 1);
+    }
+}
+
+void sk_cli_stats_error(sk_err_t err)
+{
+    if ((int)err <= 0 || (int)err >= SK_ERR__COUNT) return;
+    portENTER_CRITICAL(&s_stats_lock);
+    s_err_count[err]++;
+    portEXIT_CRITICAL(&s_stats_lock);
+}
+
+// -- cli.stats ---------------------------------------------------------------
+
+static uint32_t percentile_us(const cmd_stats_t *e, uint32_t pct)
+{
+    uint32_t n = 0;
+    for (int b = 0; b < SK_CLI_STATS_BUCKETS; b++) n += e->hist[b];
+    if (!n) return 0;
+    uint32_t want = (n * pct + 99) / 100;
+    uint32_t seen = 0;
+    for (int b = 0; b < SK_CLI_STATS_BUCKETS - 1; b++) {
+        seen += e->hist[b];
+        if (seen >= want) {
+            uint32_t bound = 128u << b;
+            return bound < e->max_us ? bound : e->max_us;
+        }
+    }
+    return e->max_us;
+}
+
+// Busiest first: total time spent is what a regression moves.
+static int by_total_desc(const void *a, const void *b)
+{
+    const cmd_stats_t *x = a, *y = b;
+    if (x->total_us != y->total_us) return x->total_us < y->total_us ? 1 : -1;
+    return strcmp(x->cmd->name, y->cmd->name);
+}
+
+static int entries_called(void)
+{
+    int n = 0;
+    for (int i = 0; i < s_nslots; i++) {
+        if (s_stats[i] && s_stats[i]->calls) n++;
+    }
+    return n;
+}
+
+static sk_err_t cmd_cli_stats(sk_cli_ctx_t *ctx)
+{
+    // Sized outside the lock; commands first called meanwhile wait for the
+    // next cli.stats.
+    portENTER_CRITICAL(&s_stats_lock);
+    int cap = entries_called();
+    portEXIT_CRITICAL(&s_stats_lock);
+    cmd_stats_t *snap = malloc(sizeof(*snap) * (size_t)(cap ? cap : 1));
+    if (!snap) {
+        sk_cli_err(ctx, SK_ERR_INTERNAL, "{\"reason\":\"oom\"}");
+        return SK_OK;
+    }
+    uint32_t errs[SK_ERR__COUNT];
+    int n = 0;
+    portENTER_CRITICAL(&s_stats_lock);
+    for (int i = 0; i < s_nslots && n < cap; i++) {
+        if (s_stats[i] && s_stats[i]->calls) snap[n++] = *s_stats[i];
+    }
+    memcpy(errs, s_err_count, sizeof(errs));
+    uint32_t untracked = s_untracked;
+    int64_t  since     = s_since_us;
+    portEXIT_CRITICAL(&s_stats_lock);
+
+    qsort(snap, (size_t)n, sizeof(*snap), by_total_desc);
+
+    if (!sk_cli_is_machine_mode(ctx)) {
+        // One row per command; the pretty-printer's rendering of an array
+        // of objects is unreadable at this width.
+        sk_cli_writef(ctx, "window %llds, untracked calls %lu\n",
+                      (long long)((esp_timer_get_time() - since) / 1000000),
+                      (unsigned long)untracked);
+        sk_cli_writef(ctx, "%-28s %6s %5s %8s %8s %8s %7s  %s\n",
+                      "command", "calls", "err", "p50_us", "p99_us", "max_us", "heap", "stack");
+        for (int i = 0; i < n; i++) {
+            const cmd_stats_t *e = &snap[i];
+            char stack[40] = "-";
+            if (e->stack_free_min != UINT32_MAX) {
+                snprintf(stack, sizeof(stack), "%lu free @%s",
+                         (unsigned long)e->stack_free_min, e->stack_task);
+            }
+            sk_cli_writef(ctx, "%-28s %6lu %5lu %8lu %8lu %8lu %7ld  %s\n",
+                          e->cmd->name, (unsigned long)e->calls, (unsigned long)e->errors,
+                          (unsigned long)percentile_us(e, 50), (unsigned long)percentile_us(e, 99),
+                          (unsigned long)e->max_us, (long)e->heap_delta_min, stack);
+        }
+        for (int c = 1; c < SK_ERR__COUNT; c++) {
+            if (errs[c]) sk_cli_writef(ctx, "  %s: %lu\n", sk_err_code_string((sk_err_t)c),
+                                       (unsigned long)errs[c]);
+        }
+        free(snap);
+        return SK_OK;
+    }
+
+    sk_cli_json_t j;
+    sk_cli_json_begin(&j, ctx);
+    sk_cli_json_begin_object(&j);
+    sk_cli_json_key(&j, "window_s");
+    sk_cli_json_number(&j, (esp_timer_get_time() - since) / 1000000);
+    sk_cli_json_key(&j, "untracked");
+    sk_cli_json_number(&j, untracked);
+    sk_cli_json_key(&j, "commands");
+    sk_cli_json_begin_array(&j);
+    for (int i = 0; i < n; i++) {
+        const cmd_stats_t *e = &snap[i];
+        sk_cli_json_begin_object(&j);
+        sk_cli_json_key(&j, "name");     sk_cli_json_string(&j, e->cmd->name);
+        sk_cli_json_key(&j, "calls");    sk_cli_json_number(&j, e->calls);
+        sk_cli_json_key(&j, "errors");   sk_cli_json_number(&j, e->errors);
+        if (e->pending) {
+            sk_cli_json_key(&j, "pending"); sk_cli_json_number(&j, e->pending);
+        }
+        sk_cli_json_key(&j, "avg_us");   sk_cli_json_number(&j, (int64_t)(e->total_us / e->calls));
+        sk_cli_json_key(&j, "p50_us");   sk_cli_json_number(&j, percentile_us(e, 50));
+        sk_cli_json_key(&j, "p99_us");   sk_cli_json_number(&j, percentile_us(e, 99));
+        sk_cli_json_key(&j, "max_us");   sk_cli_json_number(&j, e->max_us);
+        sk_cli_json_key(&j, "heap_delta_min"); sk_cli_json_number(&j, e->heap_delta_min);
+        if (e->stack_free_min != UINT32_MAX) {
+            sk_cli_json_key(&j, "stack_free_min"); sk_cli_json_number(&j, e->stack_free_min);
+            sk_cli_json_key(&j, "stack_task");     sk_cli_json_string(&j, e->stack_task);
+        }
+        sk_cli_json_end(&j);
+    }
+    sk_cli_json_end(&j);
+    sk_cli_json_key(&j, "errors");
+    sk_cli_json_begin_object(&j);
+    for (int c = 1; c < SK_ERR__COUNT; c++) {
+        if (!errs[c]) continue;
+        sk_cli_json_key(&j, sk_err_code_string((sk_err_t)c));
+        sk_cli_json_number(&j, errs[c]);
+    }
+    sk_cli_json_end(&j);
+    sk_cli_json_finish(&j);
+    free(snap);
+    return SK_OK;
+}
+
+static sk_err_t cmd_cli_stats_reset(sk_cli_ctx_t *ctx)
+{
+    // Entries stay allocated; a zero call count hides them.
+    portENTER_CRITICAL(&s_stats_lock);
+    for (int i = 0; i < s_nslots; i++) {
+        cmd_stats_t *e = s_stats[i];
+        if (!e) continue;
+        memset(e, 0, sizeof(*e));
+        e->stack_free_min = UINT32_MAX;
+    }
+    memset(s_err_count, 0, sizeof(s_err_count));
+    s_untracked = 0;
+    s_since_us  = esp_timer_get_time();
+    portEXIT_CRITICAL(&s_stats_lock);
+    sk_cli_ok(ctx, "{\"reset\":true}");
+    return SK_OK;
+}
+
+SK_CLI_COMMAND(s_cmd_cli_stats, "cli.stats",
+    .summary = "Per-command latency, heap and stack counters",
+    .usage   = "cli stats",
+    .hidden  = true,  // developer diagnostic
+    .help_block =
+        "One entry per command since boot or `cli stats reset`, busiest\n"
+        "(total handler time) first: calls, errors, average / p50 / p99 /\n"
+        "max handler time in us (percentiles are power-of-two bucket\n"
+        "bounds), and the worst free-heap change over one call.\n"
+        "`stack_free_min` / `stack_task` appear when the command pushed\n"
+        "its task's stack lower than anything before it — a few hundred\n"
+        "bytes or less there means that transport task needs a bigger\n"
+        "stack. `errors` at the end counts error replies by code,\n"
+        "including unknown commands. Deferred commands (wifi.scan) are\n"
+        "timed until the handler returns; `pending` counts them.",
+    .handler = cmd_cli_stats);
+
+SK_CLI_COMMAND(s_cmd_cli_stats_reset, "cli.stats.reset",
+    .summary = "Clear cli.stats counters",
+    .usage   = "cli stats reset",
+    .hidden  = true,
+    .handler = cmd_cli_stats_reset);
@@ -29,6 +29,7 @@
 #include "freertos/task.h"
 
 #include "sk_auth.h"
+#include "sk_button.h"
 #include "sk_capabilities.h"
 #include "sk_cli.h"
 #include "sk_errors.h"
@@ -54,14 +55,9 @@ static const char *TAG = "sk_control";
 static void on_button_released(const sk_event_t *evt, void *user)
 {
     (void)user;
-    if (!evt || !evt->payload_json) return;
-
-    const char *p = strstr(evt->payload_json, "\"duration_ms\"");
-    if (!p) return;
-    p = strchr(p, ':');
-    if (!p) return;
-    p++;
-    long ms = strtol(p, NULL, 10);
+    const sk_button_press_evt_t *press = sk_event_data(evt, &sk_button_press_evt_type);
+    if (!press) return;
+    long ms = (long)press->duration_ms;
     if (ms <= 0) return;
 
     // Diagnostic: log every release with measured duration. Lets us tell
@@ -101,13 +97,8 @@ static void on_button_released(const sk_event_t *evt, void *user)
 static void on_button_multi_tap(const sk_event_t *evt, void *user)
 {
     (void)user;
-    int count = -1;
-    if (evt && evt->payload_json) {
-        const char *p = strstr(evt->payload_json, "\"count\"");
-        if (p && (p = strchr(p, ':')) != NULL) {
-            count = (int)strtol(p + 1, NULL, 10);
-        }
-    }
+    const sk_button_tap_evt_t *tap = sk_event_data(evt, &sk_button_tap_evt_type);
+    int count = tap ? (int)tap->count : -1;
     ESP_LOGW(TAG, "multi-tap (×%d) → device.factory-reset", count);
     sk_event_bus_publish("device.factory-reset.requested",
                          "{\"reason\":\"multi_tap\"}");
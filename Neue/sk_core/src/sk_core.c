@@ -97,6 +97,9 @@ void sk_core_write_banner(sk_cli_writer_t writer, void *user)
 // interpreter and registers device.restart/factory-reset CLI commands.
 extern esp_err_t sk_control_init(void);
 
+// Defined in sk_event_cli.c — events.* diagnostics commands.
+extern esp_err_t sk_event_cli_init(void);
+
 esp_err_t sk_core_init(const sk_core_cfg_t *cfg)
 {
     if (!cfg || !cfg->device_type_prefix || !cfg->fw_version) {
@@ -111,6 +114,7 @@ esp_err_t sk_core_init(const sk_core_cfg_t *cfg)
     if ((err = sk_capabilities_init(cfg->fw_version))      != ESP_OK) return err;
     if ((err = sk_baseline_init(cfg->fw_version, cfg->build_info)) != ESP_OK) return err;
     if ((err = sk_control_init())                          != ESP_OK) return err;
+    if ((err = sk_event_cli_init())                        != ESP_OK) return err;
 
     ESP_LOGI(TAG, "sk_core ready: device=%s fw=%s",
              sk_identity_get(), cfg->fw_version);
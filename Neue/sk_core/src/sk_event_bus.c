@@ -1,13 +1,18 @@
 #include "sk_event_bus.h"
+#include "sk_event_bus_internal.h"
 
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "esp_log.h"
 #include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 #include "freertos/semphr.h"
+#include "freertos/task.h"
 
 static const char *TAG = "sk_event_bus";
 
@@ -15,40 +20,1107 @@ static const char *TAG = "sk_event_bus";
 // components) plus the existing sk_core subscribers. BF made the same bump
 // after hitting the ceiling — see project_event_bus_capacity memory.
 #define SK_EVT_MAX_SUBSCRIBERS   64
-#define SK_EVT_FILTER_MAXLEN     48
+#define SK_EVT_FILTER_MAXLEN     SK_EVENT_BUS_FILTER_MAXLEN
 
+// Async delivery defaults. The shared dispatcher is created lazily on the
+// first DISPATCHER-mode subscribe so builds that never use it don't pay
+// for the task stack.
+#define SK_EVT_DISP_QUEUE_DEPTH  32
+#define SK_EVT_DISP_TASK_STACK   4096
+#define SK_EVT_DISP_TASK_PRIO    4
+#define SK_EVT_Q_DEFAULT_DEPTH   16
+#define SK_EVT_Q_DEFAULT_STACK   4096
+#define SK_EVT_Q_DEFAULT_PRIO    4
+#define SK_EVT_COALESCE_DEFAULT_MS 1000
+#define SK_EVT_MAX_RETAIN_FILTERS  8
+#define SK_EVT_GRACE_WAIT_TICKS    10   // subscribe on a full table, see there
+
+// Slab pool for payload objects and async event records. Two fixed block
+// classes cover what the firmware publishes today (timer/button/wifi
+// payloads are 20-90 B, pairing/OTA states stay under 200 B); anything
+// bigger, or a burst that exhausts a class, falls back to the heap. Blocks
+// are recognised by address on free, so no per-block header is needed.
+#define SK_EVT_SLAB_SMALL_SIZE   64
+#define SK_EVT_SLAB_SMALL_COUNT  24
+#define SK_EVT_SLAB_LARGE_SIZE   256
+#define SK_EVT_SLAB_LARGE_COUNT  8
+
+typedef struct {
+    uint8_t  *base;
+    uint16_t  block;
+    uint16_t  count;
+    uint16_t  top;      // entries in `free_idx`
+    uint8_t  *free_idx; // stack of free block indices
+} slab_class_t;
+
+static uint8_t s_slab_small[SK_EVT_SLAB_SMALL_COUNT][SK_EVT_SLAB_SMALL_SIZE] __attribute__((aligned(8)));
+static uint8_t s_slab_large[SK_EVT_SLAB_LARGE_COUNT][SK_EVT_SLAB_LARGE_SIZE] __attribute__((aligned(8)));
+static uint8_t s_slab_small_free[SK_EVT_SLAB_SMALL_COUNT];
+static uint8_t s_slab_large_free[SK_EVT_SLAB_LARGE_COUNT];
+
+static slab_class_t s_slab[2] = {
+    { &s_slab_small[0][0], SK_EVT_SLAB_SMALL_SIZE, SK_EVT_SLAB_SMALL_COUNT, 0, s_slab_small_free },
+    { &s_slab_large[0][0], SK_EVT_SLAB_LARGE_SIZE, SK_EVT_SLAB_LARGE_COUNT, 0, s_slab_large_free },
+};
+static portMUX_TYPE s_slab_lock = portMUX_INITIALIZER_UNLOCKED;
+static atomic_uint  s_slab_heap_allocs;
+
+// Plain payloads keep the JSON text in `json`. Typed payloads keep the
+// producer's struct there instead (`len` = struct size) and render JSON on
+// first demand into a second, plain payload hung off `rendered`.
+struct sk_event_payload {
+    atomic_uint                     refs;
+    uint32_t                        len;
+    const sk_event_type_t          *type;      // NULL = plain JSON
+    _Atomic(sk_event_payload_t *)   rendered;  // typed only, NULL until asked
+    char                            json[] __attribute__((aligned(8)));
+};
+
+// Async fan-out record: one per publish that matched an async subscriber,
+// shared by all of their queues. Holds a reference on the payload; the
+// name is copied inline because publishers may pass a stack buffer.
+typedef struct {
+    atomic_uint refs;
+    sk_event_t  evt;
+    char        name[];
+} evt_rec_t;
+
+// Delivery state of one subscription. Lives on the heap, not in s_subs,
+// because publishers reach it through the lock-free topic index and queued
+// deliveries (and a QUEUE-mode task) can outlive the subscription slot —
+// the slot may be reused by the next subscribe while the old task is still
+// draining. Refs: one for the subscription, one per dispatcher queue item
+// (DISPATCHER) or one for the own task (QUEUE).
+//
+// `latest` holds the newest pending event per coalesced topic (index into
+// s_coalesce). Publishers swap records in, the sink task swaps them out.
+typedef struct {
+    atomic_int              refs;
+    atomic_bool             stopped;   // set on unsubscribe: skip handler
+    sk_event_delivery_t     mode;
+    sk_event_drop_policy_t  drop;
+    sk_event_handler_t      handler;
+    void                   *user_ctx;
+    QueueHandle_t           q;         // QUEUE mode only
+    uint16_t                depth;
+    atomic_uint             hwm;       // raised by any publisher, CAS max
+    atomic_uint             delivered;
+    atomic_uint             dropped;
+    atomic_uint             coalesced;
+    int64_t                 coalesce_us;
+    _Atomic(evt_rec_t *)    latest[SK_EVENT_BUS_MAX_COALESCED];
+} sink_t;
+
+// Queue item. For a QUEUE-mode task ev == NULL is the stop marker, or with
+// `kick` set a wake-up for its latest-value slots.
+typedef struct {
+    sink_t    *sink;
+    evt_rec_t *ev;
+    bool       kick;
+} queued_t;
+
+// Writer-side subscription table. Only subscribe/unsubscribe/stats and
+// grace_collect touch it, always under s_mtx; publish only ever try-takes
+// s_mtx, in grace_poll.
 typedef struct {
     bool                in_use;
+    bool                detach_pending;  // unsubscribed, still in old index
+    bool                detach_armed;    // out of the live index, waiting for
+    uint32_t            detach_epoch;    // ... two epochs past this one
     int                 id;
     char                filter[SK_EVT_FILTER_MAXLEN];
-    sk_event_handler_t  handler;
-    void               *user_ctx;
+    sink_t             *sink;
 } subscriber_t;
 
-static subscriber_t      s_subs[SK_EVT_MAX_SUBSCRIBERS];
-static int               s_next_id = 1;
-static uint32_t          s_seq     = 0;
-static SemaphoreHandle_t s_mtx     = NULL;
-static bool              s_ready   = false;
+// -- Topic index -------------------------------------------------------------
+//
+// Immutable snapshot compiled from s_subs on every subscribe/unsubscribe and
+// swapped in with one atomic store (copy-on-write). Publishers resolve a
+// name with one FNV-1a hash probe for exact filters, a walk down the
+// dot-segment trie for "foo.*" filters, and the "*" list — no mutex, no
+// strcmp against subscribers that cannot match.
+//
+// Each bucket (exact name, trie node, wildcard) owns a contiguous run of
+// `targets`, in subscription order. Delivery order for one event is
+// therefore: exact subscribers, then prefix subscribers shallow → deep,
+// then "*" — not global subscription order. No handler depends on that.
+//
+// The whole snapshot is one heap block. A publisher that loaded the old
+// pointer may still be walking it, so a rebuild retires the previous one
+// instead of freeing it — see "Grace periods" below.
+
+#define IX_NONE 0xFFFF
+
+typedef struct {
+    uint32_t hash;
+    uint16_t name_off;  // into strings
+    uint16_t first;     // into targets
+    uint16_t count;
+} ix_exact_t;
+
+typedef struct {
+    uint16_t seg_off;   // into strings
+    uint16_t seg_len;
+    uint16_t child;     // first child, IX_NONE = leaf
+    uint16_t sibling;
+    uint16_t first;     // subscribers of "<path>.*"
+    uint16_t count;
+} ix_node_t;
+
+typedef struct topic_index {
+    struct topic_index *retired_next;    // grace list, writer side
+    uint32_t     retired_epoch;
+    uint16_t     wild_first;
+    uint16_t     wild_count;
+    uint16_t     hash_mask;
+    uint16_t     n_exact;
+    uint16_t     n_nodes;
+    sink_t     **targets;
+    ix_exact_t  *exact;
+    uint16_t    *hash;      // bucket → exact index, IX_NONE = empty
+    ix_node_t   *nodes;     // nodes[0] = root (empty path)
+    char        *strings;
+} topic_index_t;
+
+static subscriber_t              s_subs[SK_EVT_MAX_SUBSCRIBERS];
+static int                       s_next_id = 1;
+static atomic_uint               s_seq;
+static SemaphoreHandle_t         s_mtx     = NULL;
+static bool                      s_ready   = false;
+static QueueHandle_t             s_disp_q  = NULL;
+static _Atomic(topic_index_t *)  s_index   = NULL;
+
+// -- Grace periods -----------------------------------------------------------
+//
+// A publisher counts itself in s_readers[s_epoch & 1] for its match +
+// enqueue. A rebuild publishes the new index and never waits for them:
+// the old index goes on s_retired tagged with the current epoch, and a
+// sink that only old indexes still reference is armed with that epoch
+// too. Both are released once the epoch has advanced twice past the tag.
+//
+// The epoch advances (grace_advance) only while the counter it moves new
+// publishers into has drained. Only publishers that read the previous
+// epoch can still be counted there, so a steady publish stream never
+// holds it up. Two advances after a retire have each seen one counter at
+// zero, so every publisher that could have loaded the retired pointer has
+// left (one that incremented later loads the new index). Collection runs
+// at each rebuild and, while something is retired, from publish through
+// grace_poll (try-lock only).
+static atomic_uint               s_epoch;
+static atomic_int                s_readers[2];
+static topic_index_t            *s_retired;         // s_mtx
+static atomic_bool               s_grace_pending;   // s_retired or an armed sink
+
+// Coalesced topic names. Append-only: an entry is written before the count
+// that publishes it, so publishers read the table without a lock.
+static char                      s_coalesce[SK_EVENT_BUS_MAX_COALESCED][SK_EVT_FILTER_MAXLEN];
+static atomic_int                s_n_coalesce;
+
+// Retained events, one record per name. Filled by retain_handler, a SYNC
+// subscription per retained filter — the topic index does the matching,
+// so publishes of other topics pay nothing.
+static evt_rec_t                *s_retained[SK_EVENT_BUS_MAX_RETAINED];
+static portMUX_TYPE              s_retain_lock = portMUX_INITIALIZER_UNLOCKED;
+static char                      s_retain_filters[SK_EVT_MAX_RETAIN_FILTERS][SK_EVT_FILTER_MAXLEN];
+static int                       s_n_retain_filters;  // s_mtx
 
-static bool filter_matches(const char *filter, const char *name)
+// Event history: byte ring of [seq u32][len u16][json] records, oldest at
+// s_hist_head. s_hist_lost is the highest seq a peer can no longer get
+// back (evicted, oversized, or dropped before it reached the history).
+#define SK_EVT_HIST_HDR          6
+#define SK_EVT_HIST_STACK_LINE   320
+
+static uint8_t                   s_hist[SK_EVENT_BUS_HISTORY_BYTES];
+static size_t                    s_hist_head;
+static size_t                    s_hist_used;
+static uint32_t                  s_hist_lost;
+static uint32_t                  s_hist_dropped_seen;
+static sink_t                   *s_hist_sink;
+static SemaphoreHandle_t         s_hist_mtx;
+
+static uint32_t fnv1a(const char *s, size_t len)
 {
-    if (filter[0] == '*' && filter[1] == '\0') return true;
-    size_t flen = strlen(filter);
-    if (flen >= 2 && filter[flen - 2] == '.' && filter[flen - 1] == '*') {
-        return strncmp(filter, name, flen - 1) == 0;  // include the dot
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)s[i];
+        h *= 16777619u;
     }
-    return strcmp(filter, name) == 0;
+    return h;
+}
+
+static bool filter_is_prefix(const char *filter, size_t flen)
+{
+    return flen >= 2 && filter[flen - 2] == '.' && filter[flen - 1] == '*';
+}
+
+static uint16_t ix_node_child(topic_index_t *ix, uint16_t parent,
+                              const char *seg, size_t len)
+{
+    for (uint16_t c = ix->nodes[parent].child; c != IX_NONE; c = ix->nodes[c].sibling) {
+        const ix_node_t *n = &ix->nodes[c];
+        if (n->seg_len == len && memcmp(ix->strings + n->seg_off, seg, len) == 0) {
+            return c;
+        }
+    }
+    return IX_NONE;
+}
+
+// Compile a subscriber table into a fresh snapshot. Called with s_mtx held
+// for s_subs; the bench passes its own synthetic table.
+static topic_index_t *index_build(const subscriber_t *subs, int nsubs)
+{
+    // Size pass — upper bounds, so the snapshot is a single allocation.
+    size_t n_subs = 0, n_nodes = 1, str_bytes = 0;
+    for (int i = 0; i < nsubs; i++) {
+        if (!subs[i].in_use) continue;
+        const char *f = subs[i].filter;
+        size_t flen = strlen(f);
+        n_subs++;
+        str_bytes += flen + 1;
+        if (filter_is_prefix(f, flen)) {
+            n_nodes++;
+            for (size_t k = 0; k < flen - 2; k++) if (f[k] == '.') n_nodes++;
+        }
+    }
+    size_t hsize = 8;
+    while (hsize < n_subs * 2) hsize <<= 1;
+
+    size_t sz = sizeof(topic_index_t)
+              + n_subs  * sizeof(sink_t *)
+              + n_subs  * sizeof(ix_exact_t)
+              + n_nodes * sizeof(ix_node_t)
+              + hsize   * sizeof(uint16_t)
+              + str_bytes;
+    uint8_t *blob = calloc(1, sz);
+    if (!blob) return NULL;
+
+    topic_index_t *ix = (topic_index_t *)blob;
+    uint8_t *p = blob + sizeof(*ix);
+    ix->targets = (sink_t **)p;     p += n_subs  * sizeof(sink_t *);
+    ix->exact   = (ix_exact_t *)p;  p += n_subs  * sizeof(ix_exact_t);
+    ix->nodes   = (ix_node_t *)p;   p += n_nodes * sizeof(ix_node_t);
+    ix->hash    = (uint16_t *)p;    p += hsize   * sizeof(uint16_t);
+    ix->strings = (char *)p;
+    ix->hash_mask = (uint16_t)(hsize - 1);
+    memset(ix->hash, 0xFF, hsize * sizeof(uint16_t));
+    ix->nodes[0].child   = IX_NONE;
+    ix->nodes[0].sibling = IX_NONE;
+    ix->n_nodes = 1;
+
+    // Classify pass — assign every subscriber a bucket and count per bucket.
+    enum { B_WILD, B_EXACT, B_NODE };
+    uint8_t  kind[SK_EVT_MAX_SUBSCRIBERS];
+    uint16_t bidx[SK_EVT_MAX_SUBSCRIBERS];
+    size_t str_off = 0;
+    for (int i = 0; i < nsubs; i++) {
+        if (!subs[i].in_use) continue;
+        const char *f = subs[i].filter;
+        size_t flen = strlen(f);
+        char *copy = ix->strings + str_off;
+        memcpy(copy, f, flen + 1);
+
+        if (flen == 1 && f[0] == '*') {
+            kind[i] = B_WILD;
+            ix->wild_count++;
+        } else if (filter_is_prefix(f, flen)) {
+            // "a.b.*" → path "a.b" → segments "a", "b". The node reached
+            // by the last segment holds the subscriber.
+            uint16_t cur = 0;
+            size_t path_len = flen - 2, seg = 0;
+            for (size_t k = 0; k <= path_len; k++) {
+                if (k < path_len && copy[k] != '.') continue;
+                uint16_t c = ix_node_child(ix, cur, copy + seg, k - seg);
+                if (c == IX_NONE) {
+                    c = ix->n_nodes++;
+                    ix->nodes[c] = (ix_node_t){
+                        .seg_off = (uint16_t)(str_off + seg),
+                        .seg_len = (uint16_t)(k - seg),
+                        .child   = IX_NONE,
+                        .sibling = ix->nodes[cur].child,
+                    };
+                    ix->nodes[cur].child = c;
+                }
+                cur = c;
+                seg = k + 1;
+            }
+            kind[i] = B_NODE;
+            bidx[i] = cur;
+            ix->nodes[cur].count++;
+        } else {
+            uint32_t h = fnv1a(f, flen);
+            uint16_t e = IX_NONE;
+            for (uint16_t b = h & ix->hash_mask; ix->hash[b] != IX_NONE;
+                 b = (b + 1) & ix->hash_mask) {
+                const ix_exact_t *x = &ix->exact[ix->hash[b]];
+                if (x->hash == h && strcmp(ix->strings + x->name_off, f) == 0) {
+                    e = ix->hash[b];
+                    break;
+                }
+            }
+            if (e == IX_NONE) {
+                e = ix->n_exact++;
+                ix->exact[e] = (ix_exact_t){ .hash = h, .name_off = (uint16_t)str_off };
+                uint16_t b = h & ix->hash_mask;
+                while (ix->hash[b] != IX_NONE) b = (b + 1) & ix->hash_mask;
+                ix->hash[b] = e;
+            }
+            kind[i] = B_EXACT;
+            bidx[i] = e;
+            ix->exact[e].count++;
+        }
+        str_off += flen + 1;
+    }
+
+    // Layout pass — carve `targets` into per-bucket runs, then fill them in
+    // slot order (count is reset and re-grown as the fill cursor).
+    uint16_t off = 0;
+    ix->wild_first = off; off += ix->wild_count; ix->wild_count = 0;
+    for (uint16_t e = 0; e < ix->n_exact; e++) {
+        ix->exact[e].first = off; off += ix->exact[e].count; ix->exact[e].count = 0;
+    }
+    for (uint16_t n = 0; n < ix->n_nodes; n++) {
+        ix->nodes[n].first = off; off += ix->nodes[n].count; ix->nodes[n].count = 0;
+    }
+    for (int i = 0; i < nsubs; i++) {
+        if (!subs[i].in_use) continue;
+        sink_t *sk = subs[i].sink;
+        switch (kind[i]) {
+            case B_WILD:  ix->targets[ix->wild_first + ix->wild_count++] = sk; break;
+            case B_EXACT: { ix_exact_t *x = &ix->exact[bidx[i]];
+                            ix->targets[x->first + x->count++] = sk; break; }
+            case B_NODE:  { ix_node_t *n = &ix->nodes[bidx[i]];
+                            ix->targets[n->first + n->count++] = sk; break; }
+        }
+    }
+    return ix;
+}
+
+// Collect every sink whose filter matches `name`. Caller is inside the
+// s_readers section so `ix` cannot be freed underneath it.
+static int index_match(const topic_index_t *ix, const char *name, sink_t **hit)
+{
+    int n = 0;
+    size_t nlen = strlen(name);
+
+    uint32_t h = fnv1a(name, nlen);
+    for (uint16_t b = h & ix->hash_mask; ix->hash[b] != IX_NONE;
+         b = (b + 1) & ix->hash_mask) {
+        const ix_exact_t *x = &ix->exact[ix->hash[b]];
+        if (x->hash == h && strcmp(ix->strings + x->name_off, name) == 0) {
+            for (uint16_t k = 0; k < x->count; k++) hit[n++] = ix->targets[x->first + k];
+            break;
+        }
+    }
+
+    // "<path>.*" matches when the name continues with '.' after <path>, so
+    // only segments that are followed by a dot can select trie nodes.
+    uint16_t cur = 0;
+    const char *seg = name;
+    const char *dot;
+    while ((dot = strchr(seg, '.')) != NULL) {
+        uint16_t c = ix_node_child((topic_index_t *)ix, cur, seg, (size_t)(dot - seg));
+        if (c == IX_NONE) break;
+        const ix_node_t *node = &ix->nodes[c];
+        for (uint16_t k = 0; k < node->count; k++) hit[n++] = ix->targets[node->first + k];
+        cur = c;
+        seg = dot + 1;
+    }
+
+    for (uint16_t k = 0; k < ix->wild_count; k++) hit[n++] = ix->targets[ix->wild_first + k];
+    return n;
+}
+
+static void publish_common(const char *name, const char *payload_json,
+                           sk_event_payload_t *payload);
+
+// -- Slab pool + payload objects --------------------------------------------
+
+static void slab_init(void)
+{
+    for (size_t c = 0; c < sizeof(s_slab) / sizeof(s_slab[0]); c++) {
+        for (uint16_t i = 0; i < s_slab[c].count; i++) s_slab[c].free_idx[i] = (uint8_t)i;
+        s_slab[c].top = s_slab[c].count;
+    }
+}
+
+static void *slab_alloc(size_t size)
+{
+    for (size_t c = 0; c < sizeof(s_slab) / sizeof(s_slab[0]); c++) {
+        slab_class_t *sc = &s_slab[c];
+        if (size > sc->block) continue;
+        void *blk = NULL;
+        taskENTER_CRITICAL(&s_slab_lock);
+        if (sc->top > 0) blk = sc->base + (size_t)sc->free_idx[--sc->top] * sc->block;
+        taskEXIT_CRITICAL(&s_slab_lock);
+        if (blk) return blk;
+    }
+    atomic_fetch_add(&s_slab_heap_allocs, 1);
+    return malloc(size);
+}
+
+static void slab_free(void *p)
+{
+    if (!p) return;
+    for (size_t c = 0; c < sizeof(s_slab) / sizeof(s_slab[0]); c++) {
+        slab_class_t *sc = &s_slab[c];
+        uint8_t *b = p;
+        if (b < sc->base || b >= sc->base + (size_t)sc->count * sc->block) continue;
+        taskENTER_CRITICAL(&s_slab_lock);
+        sc->free_idx[sc->top++] = (uint8_t)((size_t)(b - sc->base) / sc->block);
+        taskEXIT_CRITICAL(&s_slab_lock);
+        return;
+    }
+    free(p);
+}
+
+static sk_event_payload_t *payload_alloc(size_t len)
+{
+    sk_event_payload_t *p = slab_alloc(sizeof(*p) + len + 1);
+    if (!p) return NULL;
+    atomic_init(&p->refs, 1);
+    p->len = (uint32_t)len;
+    p->type = NULL;
+    atomic_init(&p->rendered, NULL);
+    p->json[0] = '\0';
+    return p;
 }
 
+// JSON view of a payload: itself when plain, the (lazily rendered, cached)
+// companion when typed. Two subscribers racing to render both format; the
+// loser drops its copy. NULL on OOM / render failure.
+static const sk_event_payload_t *payload_rendered(sk_event_payload_t *p)
+{
+    if (!p->type) return p;
+    sk_event_payload_t *r = atomic_load(&p->rendered);
+    if (r) return r;
+    if (!p->type->render_json) return NULL;
+
+    const size_t first_cap = SK_EVT_SLAB_SMALL_SIZE - sizeof(sk_event_payload_t) - 1;
+    r = payload_alloc(first_cap);
+    int n = r ? p->type->render_json(p->json, r->json, first_cap + 1) : -1;
+    if (n < 0) {
+        sk_event_payload_release(r);
+        return NULL;
+    }
+    if ((size_t)n > first_cap) {
+        sk_event_payload_release(r);
+        r = payload_alloc((size_t)n);
+        if (!r) return NULL;
+        p->type->render_json(p->json, r->json, (size_t)n + 1);
+    }
+    r->len = (uint32_t)n;
+
+    sk_event_payload_t *expected = NULL;
+    if (!atomic_compare_exchange_strong(&p->rendered, &expected, r)) {
+        sk_event_payload_release(r);
+        return expected;
+    }
+    return r;
+}
+
+sk_event_payload_t *sk_event_payload_typed(const sk_event_type_t *type, const void *data)
+{
+    if (!type || !data || type->size == 0) return NULL;
+    sk_event_payload_t *p = slab_alloc(sizeof(*p) + type->size);
+    if (!p) return NULL;
+    atomic_init(&p->refs, 1);
+    p->len  = (uint32_t)type->size;
+    p->type = type;
+    atomic_init(&p->rendered, NULL);
+    memcpy(p->json, data, type->size);
+    return p;
+}
+
+sk_event_payload_t *sk_event_payload_new(const char *json)
+{
+    if (!json) return NULL;
+    size_t len = strlen(json);
+    sk_event_payload_t *p = payload_alloc(len);
+    if (p) memcpy(p->json, json, len + 1);
+    return p;
+}
+
+sk_event_payload_t *sk_event_payload_vprintf(const char *fmt, va_list ap)
+{
+    if (!fmt) return NULL;
+    // Format straight into a small-class block; only payloads that don't
+    // fit pay for a second pass into an exact-size block.
+    const size_t first_cap = SK_EVT_SLAB_SMALL_SIZE - sizeof(sk_event_payload_t) - 1;
+    va_list ap2;
+    va_copy(ap2, ap);
+    sk_event_payload_t *p = payload_alloc(first_cap);
+    int n = p ? vsnprintf(p->json, first_cap + 1, fmt, ap) : -1;
+    if (n < 0) {
+        sk_event_payload_release(p);
+        va_end(ap2);
+        return NULL;
+    }
+    if ((size_t)n > first_cap) {
+        sk_event_payload_release(p);
+        p = payload_alloc((size_t)n);
+        if (p) vsnprintf(p->json, (size_t)n + 1, fmt, ap2);
+    }
+    va_end(ap2);
+    if (p) p->len = (uint32_t)n;
+    return p;
+}
+
+sk_event_payload_t *sk_event_payload_printf(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    sk_event_payload_t *p = sk_event_payload_vprintf(fmt, ap);
+    va_end(ap);
+    return p;
+}
+
+sk_event_payload_t *sk_event_payload_retain(sk_event_payload_t *p)
+{
+    if (p) atomic_fetch_add(&p->refs, 1);
+    return p;
+}
+
+void sk_event_payload_release(sk_event_payload_t *p)
+{
+    if (p && atomic_fetch_sub(&p->refs, 1) == 1) {
+        sk_event_payload_release(atomic_load(&p->rendered));
+        slab_free(p);
+    }
+}
+
+const char *sk_event_payload_json(const sk_event_payload_t *p)
+{
+    if (!p) return NULL;
+    const sk_event_payload_t *r = payload_rendered((sk_event_payload_t *)p);
+    return r ? r->json : NULL;
+}
+
+size_t sk_event_payload_len(const sk_event_payload_t *p)
+{
+    if (!p) return 0;
+    const sk_event_payload_t *r = payload_rendered((sk_event_payload_t *)p);
+    return r ? r->len : 0;
+}
+
+const void *sk_event_data(const sk_event_t *evt, const sk_event_type_t *type)
+{
+    if (!evt || !evt->payload || !type || evt->payload->type != type) return NULL;
+    return evt->payload->json;
+}
+
+const char *sk_event_json(const sk_event_t *evt)
+{
+    if (!evt) return NULL;
+    if (evt->payload_json) return evt->payload_json;
+    return sk_event_payload_json(evt->payload);
+}
+
+void sk_event_bus_publish_typed(const char *name, const sk_event_type_t *type,
+                                const void *data)
+{
+    sk_event_payload_t *p = sk_event_payload_typed(type, data);
+    if (!p) {
+        ESP_LOGW(TAG, "%s: typed payload alloc failed", name ? name : "?");
+        return;
+    }
+    publish_common(name, NULL, p);
+}
+
+sk_event_payload_t *sk_event_payload_get(const sk_event_t *evt)
+{
+    if (!evt) return NULL;
+    if (evt->payload) return sk_event_payload_retain(evt->payload);
+    return sk_event_payload_new(evt->payload_json);
+}
+
+// -- Async event records -----------------------------------------------------
+
+// Takes over the caller's payload reference (may be NULL).
+static evt_rec_t *evt_rec_new(const char *name, sk_event_payload_t *payload,
+                              uint32_t seq, int64_t ts_us)
+{
+    size_t nlen = strlen(name) + 1;
+    evt_rec_t *r = slab_alloc(sizeof(*r) + nlen);
+    if (!r) return NULL;
+    atomic_init(&r->refs, 1);
+    memcpy(r->name, name, nlen);
+    r->evt.name         = r->name;
+    r->evt.seq          = seq;
+    r->evt.ts_uptime_us = ts_us;
+    r->evt.payload      = payload;
+    r->evt.payload_json = (payload && !payload->type) ? payload->json : NULL;
+    return r;
+}
+
+static void evt_rec_release(evt_rec_t *r)
+{
+    if (r && atomic_fetch_sub(&r->refs, 1) == 1) {
+        sk_event_payload_release(r->evt.payload);
+        slab_free(r);
+    }
+}
+
+// -- Retained events ---------------------------------------------------------
+
+static void retain_handler(const sk_event_t *evt, void *user)
+{
+    (void)user;
+    sk_event_payload_t *p = sk_event_payload_get(evt);
+    if (!p && evt->payload_json) return;  // oom — keep the previous value
+    evt_rec_t *rec = evt_rec_new(evt->name, p, evt->seq, evt->ts_uptime_us);
+    if (!rec) {
+        sk_event_payload_release(p);
+        return;
+    }
+
+    evt_rec_t *drop = NULL;
+    bool full = false;
+    taskENTER_CRITICAL(&s_retain_lock);
+    int i, empty = -1;
+    for (i = 0; i < SK_EVENT_BUS_MAX_RETAINED; i++) {
+        if (!s_retained[i]) {
+            if (empty < 0) empty = i;
+        } else if (strcmp(s_retained[i]->name, rec->name) == 0) {
+            break;
+        }
+    }
+    if (i < SK_EVENT_BUS_MAX_RETAINED) {
+        // Two publishers of one name may reach here out of order: keep
+        // the higher seq.
+        if (s_retained[i]->evt.seq < rec->evt.seq) {
+            drop = s_retained[i];
+            s_retained[i] = rec;
+        } else {
+            drop = rec;
+        }
+    } else if (empty >= 0) {
+        s_retained[empty] = rec;
+    } else {
+        drop = rec;
+        full = true;
+    }
+    taskEXIT_CRITICAL(&s_retain_lock);
+
+    evt_rec_release(drop);
+    if (full) ESP_LOGW(TAG, "%s: retained table full, not kept", evt->name);
+}
+
+// -- Sinks -------------------------------------------------------------------
+
+static void sink_release(sink_t *sk)
+{
+    if (atomic_fetch_sub(&sk->refs, 1) == 1) free(sk);
+}
+
+static void sink_deliver(sink_t *sk, evt_rec_t *ev)
+{
+    if (atomic_load(&sk->stopped)) return;
+    sk->handler(&ev->evt, sk->user_ctx);
+    atomic_fetch_add(&sk->delivered, 1);
+}
+
+static void dispatcher_task(void *arg)
+{
+    // Queue handed over as the task argument: the task may run before
+    // ensure_dispatcher() has published s_disp_q.
+    QueueHandle_t q = arg;
+    queued_t it;
+    for (;;) {
+        if (xQueueReceive(q, &it, portMAX_DELAY) != pdTRUE) continue;
+        sink_deliver(it.sink, it.ev);
+        evt_rec_release(it.ev);
+        sink_release(it.sink);
+    }
+}
+
+static int coalesce_slot(const char *name)
+{
+    int n = atomic_load(&s_n_coalesce);
+    for (int i = 0; i < n; i++) {
+        if (strcmp(s_coalesce[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+// Deliver every latest-value slot whose spacing has elapsed. Returns how
+// long the task may block before the next one is due.
+static TickType_t sink_flush_latest(sink_t *sk, int64_t *last_us)
+{
+    int64_t next_us = INT64_MAX;
+    int n = atomic_load(&s_n_coalesce);
+    for (int i = 0; i < n; i++) {
+        if (!atomic_load(&sk->latest[i])) continue;
+        int64_t now = esp_timer_get_time();
+        int64_t due = last_us[i] + sk->coalesce_us;
+        if (now < due) {
+            if (due < next_us) next_us = due;
+            continue;
+        }
+        evt_rec_t *ev = atomic_exchange(&sk->latest[i], NULL);
+        if (!ev) continue;
+        sink_deliver(sk, ev);
+        evt_rec_release(ev);
+        last_us[i] = now;
+    }
+    if (next_us == INT64_MAX) return portMAX_DELAY;
+    int64_t wait_us = next_us - esp_timer_get_time();
+    if (wait_us <= 0) return 0;
+    TickType_t t = pdMS_TO_TICKS((wait_us + 999) / 1000);
+    return t ? t : 1;
+}
+
+static void sink_task(void *arg)
+{
+    sink_t *sk = arg;
+    queued_t it;
+    int64_t last_us[SK_EVENT_BUS_MAX_COALESCED];
+    for (int i = 0; i < SK_EVENT_BUS_MAX_COALESCED; i++) last_us[i] = -sk->coalesce_us;
+    TickType_t wait = portMAX_DELAY;
+    for (;;) {
+        if (xQueueReceive(sk->q, &it, wait) == pdTRUE) {
+            if (!it.ev && !it.kick) break;  // stop marker — always the last item queued
+            if (it.ev) {
+                sink_deliver(sk, it.ev);
+                evt_rec_release(it.ev);
+            }
+        }
+        // After every queued event too, not only when idle: a steady
+        // backlog must not starve the latest-value topics.
+        wait = sink_flush_latest(sk, last_us);
+    }
+    for (int i = 0; i < SK_EVENT_BUS_MAX_COALESCED; i++) {
+        evt_rec_release(atomic_exchange(&sk->latest[i], NULL));
+    }
+    vQueueDelete(sk->q);
+    sink_release(sk);
+    vTaskDelete(NULL);
+}
+
+// Park `ev` in the subscriber's latest-value slot, releasing the event it
+// supersedes. Only the empty → full transition needs a wake-up; a full
+// queue means the task is busy and checks the slots after each item.
+static void sink_coalesce(sink_t *sk, int slot, evt_rec_t *ev)
+{
+    atomic_fetch_add(&ev->refs, 1);
+    evt_rec_t *old = atomic_exchange(&sk->latest[slot], ev);
+    if (old) {
+        evt_rec_release(old);
+        atomic_fetch_add(&sk->coalesced, 1);
+        return;
+    }
+    queued_t kick = { .sink = sk, .ev = NULL, .kick = true };
+    xQueueSend(sk->q, &kick, 0);
+}
+
+// Hand `ev` to an async subscriber. Called from publish inside the
+// s_readers section, never blocks. Two publishers racing on different
+// tasks may enqueue in the opposite order to their seq numbers; events
+// from any single publisher stay in order.
+static void sink_enqueue(sink_t *sk, evt_rec_t *ev)
+{
+    QueueHandle_t q = sk->q ? sk->q : s_disp_q;
+    queued_t item = { .sink = sk, .ev = ev };
+
+    atomic_fetch_add(&ev->refs, 1);
+    if (!sk->q) atomic_fetch_add(&sk->refs, 1);
+
+    if (xQueueSend(q, &item, 0) != pdTRUE) {
+        bool queued = false;
+        if (sk->q && sk->drop == SK_EVT_DROP_OLDEST) {
+            queued_t old;
+            if (xQueueReceive(q, &old, 0) == pdTRUE) evt_rec_release(old.ev);
+            queued = xQueueSend(q, &item, 0) == pdTRUE;
+        }
+        atomic_fetch_add(&sk->dropped, 1);
+        if (!queued) {
+            evt_rec_release(ev);
+            if (!sk->q) sink_release(sk);
+            return;
+        }
+    }
+
+    // Publishers on several tasks race here: a CAS max, so a smaller fill
+    // never overwrites a larger one.
+    unsigned fill = (unsigned)(sk->depth - uxQueueSpacesAvailable(q));
+    unsigned seen = atomic_load(&sk->hwm);
+    while (fill > seen && !atomic_compare_exchange_weak(&sk->hwm, &seen, fill)) {}
+}
+
+// Stop delivery to `sk` and drop the subscription's reference. Called with
+// s_mtx held, once no published index references the sink any more — no
+// publisher can enqueue for it, so the stop marker is the last item in its
+// queue.
+static void sink_detach(sink_t *sk)
+{
+    atomic_store(&sk->stopped, true);
+    if (sk->q) {
+        queued_t stop = { .sink = sk, .ev = NULL };
+        while (xQueueSend(sk->q, &stop, 0) != pdTRUE) {
+            queued_t old;
+            if (xQueueReceive(sk->q, &old, 0) == pdTRUE) evt_rec_release(old.ev);
+        }
+    }
+    sink_release(sk);
+}
+
+static esp_err_t ensure_dispatcher(void)
+{
+    xSemaphoreTake(s_mtx, portMAX_DELAY);
+    esp_err_t err = ESP_OK;
+    if (s_disp_q == NULL) {
+        QueueHandle_t q = xQueueCreate(SK_EVT_DISP_QUEUE_DEPTH, sizeof(queued_t));
+        if (!q) {
+            err = ESP_ERR_NO_MEM;
+        } else if (xTaskCreate(dispatcher_task, "sk_evt_disp",
+                               SK_EVT_DISP_TASK_STACK, q,
+                               SK_EVT_DISP_TASK_PRIO, NULL) != pdPASS) {
+            vQueueDelete(q);
+            err = ESP_ERR_NO_MEM;
+        } else {
+            s_disp_q = q;
+        }
+    }
+    xSemaphoreGive(s_mtx);
+    return err;
+}
+
+// Allocate the sink (and, for QUEUE mode, its queue + task) before the
+// subscriber table is touched so the mutex is never held across a task
+// create.
+static esp_err_t sink_create(const sk_event_sub_opts_t *opts,
+                             sk_event_handler_t handler, void *user_ctx,
+                             sink_t **out)
+{
+    sink_t *sk = calloc(1, sizeof(*sk));
+    if (!sk) return ESP_ERR_NO_MEM;
+    atomic_init(&sk->refs, 1);
+    atomic_init(&sk->stopped, false);
+    atomic_init(&sk->delivered, 0);
+    atomic_init(&sk->dropped, 0);
+    atomic_init(&sk->coalesced, 0);
+    for (int i = 0; i < SK_EVENT_BUS_MAX_COALESCED; i++) atomic_init(&sk->latest[i], NULL);
+    sk->mode     = opts ? opts->delivery : SK_EVT_DELIVER_SYNC;
+    sk->drop     = opts ? opts->drop_policy : SK_EVT_DROP_NEWEST;
+    sk->handler  = handler;
+    sk->user_ctx = user_ctx;
+
+    if (sk->mode == SK_EVT_DELIVER_SYNC) {
+        *out = sk;
+        return ESP_OK;
+    }
+    if (sk->mode == SK_EVT_DELIVER_DISPATCHER) {
+        esp_err_t err = ensure_dispatcher();
+        if (err != ESP_OK) { free(sk); return err; }
+        sk->depth = SK_EVT_DISP_QUEUE_DEPTH;
+        *out = sk;
+        return ESP_OK;
+    }
+
+    sk->depth = opts->queue_depth ? opts->queue_depth : SK_EVT_Q_DEFAULT_DEPTH;
+    sk->coalesce_us = (int64_t)(opts->coalesce_ms ? opts->coalesce_ms
+                                                  : SK_EVT_COALESCE_DEFAULT_MS) * 1000;
+    sk->q = xQueueCreate(sk->depth, sizeof(queued_t));
+    if (!sk->q) { free(sk); return ESP_ERR_NO_MEM; }
+    atomic_fetch_add(&sk->refs, 1);  // owned by sink_task until it exits
+    if (xTaskCreate(sink_task,
+                    opts->task_name ? opts->task_name : "sk_evt_q",
+                    opts->task_stack ? opts->task_stack : SK_EVT_Q_DEFAULT_STACK,
+                    sk,
+                    opts->task_priority ? opts->task_priority : SK_EVT_Q_DEFAULT_PRIO,
+                    NULL) != pdPASS) {
+        vQueueDelete(sk->q);
+        free(sk);
+        return ESP_ERR_NO_MEM;
+    }
+    *out = sk;
+    return ESP_OK;
+}
+
+// Move publishers to the next epoch if the counter they would join has
+// drained. s_mtx held.
+static bool grace_advance(void)
+{
+    uint32_t e = atomic_load(&s_epoch);
+    if (atomic_load(&s_readers[(e + 1) & 1]) != 0) return false;
+    atomic_store(&s_epoch, e + 1);
+    return true;
+}
+
+// Free what every publisher has let go of. s_mtx held.
+static void grace_collect(void)
+{
+    if (grace_advance()) grace_advance();
+    uint32_t e = atomic_load(&s_epoch);
+
+    bool pending = false;
+    for (topic_index_t **pp = &s_retired; *pp; ) {
+        topic_index_t *ix = *pp;
+        if ((int32_t)(e - ix->retired_epoch) >= 2) {
+            *pp = ix->retired_next;
+            free(ix);
+        } else {
+            pp = &ix->retired_next;
+            pending = true;
+        }
+    }
+    for (int i = 0; i < SK_EVT_MAX_SUBSCRIBERS; i++) {
+        subscriber_t *sub = &s_subs[i];
+        if (!sub->detach_armed) continue;
+        if ((int32_t)(e - sub->detach_epoch) < 2) { pending = true; continue; }
+        sink_detach(sub->sink);
+        sub->sink           = NULL;
+        sub->detach_pending = false;
+        sub->detach_armed   = false;
+    }
+    atomic_store(&s_grace_pending, pending);
+}
+
+// Publisher side: finish a grace period if nobody holds s_mtx right now.
+static void grace_poll(void)
+{
+    if (xSemaphoreTake(s_mtx, 0) != pdTRUE) return;
+    grace_collect();
+    xSemaphoreGive(s_mtx);
+}
+
+// Compile and publish a new index, retire the old one. Called with s_mtx
+// held; never waits for publishers.
+static esp_err_t index_rebuild(void)
+{
+    topic_index_t *nx = index_build(s_subs, SK_EVT_MAX_SUBSCRIBERS);
+    if (!nx) return ESP_ERR_NO_MEM;
+    topic_index_t *old = atomic_exchange(&s_index, nx);
+
+    uint32_t e = atomic_load(&s_epoch);
+    old->retired_epoch = e;
+    old->retired_next  = s_retired;
+    s_retired          = old;
+    for (int i = 0; i < SK_EVT_MAX_SUBSCRIBERS; i++) {
+        subscriber_t *sub = &s_subs[i];
+        if (!sub->detach_pending || sub->detach_armed) continue;
+        sub->detach_armed = true;
+        sub->detach_epoch = e;
+    }
+    grace_collect();
+    return ESP_OK;
+}
+
+// -- Event history -----------------------------------------------------------
+
+static void hist_write(size_t off, const void *src, size_t n)
+{
+    const uint8_t *p = src;
+    size_t first = SK_EVENT_BUS_HISTORY_BYTES - off;
+    if (first > n) first = n;
+    memcpy(&s_hist[off], p, first);
+    memcpy(s_hist, p + first, n - first);
+}
+
+static void hist_read(size_t off, void *dst, size_t n)
+{
+    uint8_t *p = dst;
+    size_t first = SK_EVENT_BUS_HISTORY_BYTES - off;
+    if (first > n) first = n;
+    memcpy(p, &s_hist[off], first);
+    memcpy(p + first, s_hist, n - first);
+}
+
+static void hist_header(size_t off, uint32_t *seq, uint16_t *len)
+{
+    uint8_t h[SK_EVT_HIST_HDR];
+    hist_read(off, h, sizeof(h));
+    memcpy(seq, h, 4);
+    memcpy(len, h + 4, 2);
+}
+
+// Called with s_hist_mtx held.
+static void hist_append(uint32_t seq, const char *line, size_t len)
+{
+    size_t need = SK_EVT_HIST_HDR + len;
+    if (need > SK_EVENT_BUS_HISTORY_BYTES / 2) {
+        if (seq > s_hist_lost) s_hist_lost = seq;
+        return;
+    }
+    while (SK_EVENT_BUS_HISTORY_BYTES - s_hist_used < need) {
+        uint32_t old_seq;
+        uint16_t old_len;
+        hist_header(s_hist_head, &old_seq, &old_len);
+        if (old_seq > s_hist_lost) s_hist_lost = old_seq;
+        size_t rec = SK_EVT_HIST_HDR + old_len;
+        s_hist_head = (s_hist_head + rec) % SK_EVENT_BUS_HISTORY_BYTES;
+        s_hist_used -= rec;
+    }
+    uint8_t h[SK_EVT_HIST_HDR];
+    uint16_t l16 = (uint16_t)len;
+    memcpy(h, &seq, 4);
+    memcpy(h + 4, &l16, 2);
+    size_t tail = (s_hist_head + s_hist_used) % SK_EVENT_BUS_HISTORY_BYTES;
+    hist_write(tail, h, sizeof(h));
+    hist_write((tail + SK_EVT_HIST_HDR) % SK_EVENT_BUS_HISTORY_BYTES, line, len);
+    s_hist_used += need;
+}
+
+// Runs on the dispatcher task, so rendering a typed payload here never
+// costs the publisher (some publish from 2 KB system task stacks).
+static void history_handler(const sk_event_t *evt, void *user)
+{
+    (void)user;
+    // Same exclusions as the peer forwarders: auth.* never leaves the
+    // device, and a stale coalesced value is not worth replaying.
+    if (strncmp(evt->name, "auth.", 5) == 0) return;
+    if (coalesce_slot(evt->name) >= 0) return;
+
+    const char *data = sk_event_json(evt);
+    char stack_line[SK_EVT_HIST_STACK_LINE];
+    size_t cap = strlen(evt->name) + (data ? strlen(data) : 0) + 48;
+    char *line = (cap <= sizeof(stack_line)) ? stack_line : malloc(cap);
+    int n = -1;
+    if (line && data) {
+        n = snprintf(line, cap, "{\"evt\":\"%s\",\"seq\":%lu,\"data\":%s}",
+                     evt->name, (unsigned long)evt->seq, data);
+    } else if (line) {
+        n = snprintf(line, cap, "{\"evt\":\"%s\",\"seq\":%lu}",
+                     evt->name, (unsigned long)evt->seq);
+    }
+
+    xSemaphoreTake(s_hist_mtx, portMAX_DELAY);
+    // A full dispatcher queue drops events before they get here; anything
+    // older than this one may be missing.
+    uint32_t dropped = s_hist_sink ? atomic_load(&s_hist_sink->dropped) : 0;
+    if (dropped != s_hist_dropped_seen) {
+        s_hist_dropped_seen = dropped;
+        if (evt->seq - 1 > s_hist_lost) s_hist_lost = evt->seq - 1;
+    }
+    if (n > 0 && (size_t)n < cap) {
+        hist_append(evt->seq, line, (size_t)n);
+    } else if (evt->seq > s_hist_lost) {
+        s_hist_lost = evt->seq;  // oom
+    }
+    xSemaphoreGive(s_hist_mtx);
+
+    if (line != stack_line) free(line);
+}
+
+// -- Public API --------------------------------------------------------------
+
 esp_err_t sk_event_bus_init(void)
 {
     if (s_ready) return ESP_OK;
     s_mtx = xSemaphoreCreateMutex();
     if (s_mtx == NULL) return ESP_ERR_NO_MEM;
     memset(s_subs, 0, sizeof(s_subs));
-    s_seq = 0;
+    slab_init();
+    atomic_store(&s_seq, 0);
+    atomic_store(&s_epoch, 0);
+    atomic_store(&s_readers[0], 0);
+    atomic_store(&s_readers[1], 0);
+    atomic_store(&s_grace_pending, false);
+    s_retired = NULL;
+    atomic_store(&s_n_coalesce, 0);
     s_next_id = 1;
+    topic_index_t *ix = index_build(s_subs, SK_EVT_MAX_SUBSCRIBERS);  // empty
+    if (!ix) return ESP_ERR_NO_MEM;
+    atomic_store(&s_index, ix);
     s_ready = true;
     return ESP_OK;
 }
@@ -57,17 +1129,45 @@ esp_err_t sk_event_bus_subscribe(const char *filter,
                                  sk_event_handler_t handler,
                                  void *user_ctx,
                                  int *out_sub_id)
+{
+    return sk_event_bus_subscribe_ex(filter, handler, user_ctx, NULL, out_sub_id);
+}
+
+esp_err_t sk_event_bus_subscribe_ex(const char *filter,
+                                    sk_event_handler_t handler,
+                                    void *user_ctx,
+                                    const sk_event_sub_opts_t *opts,
+                                    int *out_sub_id)
 {
     if (!s_ready) return ESP_ERR_INVALID_STATE;
     if (!filter || !handler) return ESP_ERR_INVALID_ARG;
     if (strlen(filter) >= SK_EVT_FILTER_MAXLEN) return ESP_ERR_INVALID_ARG;
+    if (opts && opts->delivery > SK_EVT_DELIVER_QUEUE) return ESP_ERR_INVALID_ARG;
+
+    sink_t *sk = NULL;
+    esp_err_t err = sink_create(opts, handler, user_ctx, &sk);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "subscribe '%s' failed: %s", filter, esp_err_to_name(err));
+        return err;
+    }
 
     xSemaphoreTake(s_mtx, portMAX_DELAY);
     int idx = -1;
-    for (int i = 0; i < SK_EVT_MAX_SUBSCRIBERS; i++) {
-        if (!s_subs[i].in_use) { idx = i; break; }
+    // Slots of unsubscribed sinks free up once their grace period ends.
+    // Only if every slot is taken does a subscribe wait for that — a few
+    // ticks for a publisher preempted inside its match.
+    for (int tries = 0; idx < 0 && tries < SK_EVT_GRACE_WAIT_TICKS; tries++) {
+        if (tries) {
+            if (!atomic_load(&s_grace_pending)) break;
+            vTaskDelay(1);
+            grace_collect();
+        }
+        for (int i = 0; i < SK_EVT_MAX_SUBSCRIBERS; i++) {
+            if (!s_subs[i].in_use && !s_subs[i].detach_pending) { idx = i; break; }
+        }
     }
     if (idx < 0) {
+        sink_detach(sk);
         xSemaphoreGive(s_mtx);
         ESP_LOGW(TAG, "subscriber table full");
         return ESP_ERR_NO_MEM;
@@ -76,8 +1176,15 @@ esp_err_t sk_event_bus_subscribe(const char *filter,
     s_subs[idx].id = s_next_id++;
     strncpy(s_subs[idx].filter, filter, SK_EVT_FILTER_MAXLEN - 1);
     s_subs[idx].filter[SK_EVT_FILTER_MAXLEN - 1] = '\0';
-    s_subs[idx].handler = handler;
-    s_subs[idx].user_ctx = user_ctx;
+    s_subs[idx].sink = sk;
+    if (index_rebuild() != ESP_OK) {
+        s_subs[idx].in_use = false;
+        s_subs[idx].sink = NULL;
+        sink_detach(sk);  // never reached an index — safe to drop now
+        xSemaphoreGive(s_mtx);
+        ESP_LOGW(TAG, "no memory for topic index");
+        return ESP_ERR_NO_MEM;
+    }
     if (out_sub_id) *out_sub_id = s_subs[idx].id;
     xSemaphoreGive(s_mtx);
     return ESP_OK;
@@ -89,7 +1196,16 @@ esp_err_t sk_event_bus_unsubscribe(int sub_id)
     xSemaphoreTake(s_mtx, portMAX_DELAY);
     for (int i = 0; i < SK_EVT_MAX_SUBSCRIBERS; i++) {
         if (s_subs[i].in_use && s_subs[i].id == sub_id) {
+            // Stop handler calls right away; the sink itself is detached by
+            // the rebuild once no snapshot can reach it. If the rebuild
+            // fails (OOM) the slot stays pending and the next successful
+            // rebuild finishes the job.
             s_subs[i].in_use = false;
+            s_subs[i].detach_pending = true;
+            atomic_store(&s_subs[i].sink->stopped, true);
+            if (index_rebuild() != ESP_OK) {
+                ESP_LOGW(TAG, "unsubscribe %d: index rebuild deferred (oom)", sub_id);
+            }
             xSemaphoreGive(s_mtx);
             return ESP_OK;
         }
@@ -98,53 +1214,365 @@ esp_err_t sk_event_bus_unsubscribe(int sub_id)
     return ESP_ERR_NOT_FOUND;
 }
 
-void sk_event_bus_publish(const char *name, const char *payload_json)
+// Shared publish path. Exactly one of `payload_json` (borrowed) or
+// `payload` (owned reference, consumed here) is used; both may be NULL.
+static void publish_common(const char *name, const char *payload_json,
+                           sk_event_payload_t *payload)
 {
-    if (!s_ready || !name) return;
+    if (!s_ready || !name) {
+        sk_event_payload_release(payload);
+        return;
+    }
+    if (payload) payload_json = payload->type ? NULL : payload->json;
 
-    // Snapshot matching handlers under the lock, then call without holding it
-    // so handlers are free to re-enter the bus (e.g. publish a follow-up).
+    // Resolve subscribers through the current snapshot without taking any
+    // lock. Async subscribers are fed inside the reader section (the index
+    // keeps their sinks alive); SYNC handlers are copied out and called
+    // after leaving it so they are free to re-enter the bus (publish a
+    // follow-up, even subscribe/unsubscribe).
+    sink_t            *hit[SK_EVT_MAX_SUBSCRIBERS];
     sk_event_handler_t matched_cb[SK_EVT_MAX_SUBSCRIBERS];
     void              *matched_ctx[SK_EVT_MAX_SUBSCRIBERS];
     int matched = 0;
+    int64_t ts_us = esp_timer_get_time();
+    evt_rec_t *rec = NULL;
+    bool rec_failed = false;
+    int coalesce = -2;  // not looked up yet
 
-    xSemaphoreTake(s_mtx, portMAX_DELAY);
-    uint32_t seq = ++s_seq;
-    for (int i = 0; i < SK_EVT_MAX_SUBSCRIBERS; i++) {
-        if (!s_subs[i].in_use) continue;
-        if (!filter_matches(s_subs[i].filter, name)) continue;
-        matched_cb[matched]  = s_subs[i].handler;
-        matched_ctx[matched] = s_subs[i].user_ctx;
-        matched++;
+    atomic_int *readers = &s_readers[atomic_load(&s_epoch) & 1];
+    atomic_fetch_add(readers, 1);
+    const topic_index_t *ix = atomic_load(&s_index);
+    uint32_t seq = atomic_fetch_add(&s_seq, 1) + 1;
+    int nhit = index_match(ix, name, hit);
+    for (int i = 0; i < nhit; i++) {
+        sink_t *sk = hit[i];
+        if (sk->mode == SK_EVT_DELIVER_SYNC) {
+            if (atomic_load(&sk->stopped)) continue;
+            matched_cb[matched]  = sk->handler;
+            matched_ctx[matched] = sk->user_ctx;
+            matched++;
+            atomic_fetch_add(&sk->delivered, 1);
+            continue;
+        }
+        // One record per publish, shared by all async subscribers. A
+        // borrowed string is turned into a payload object here, once.
+        if (!rec && !rec_failed) {
+            if (!payload && payload_json) payload = sk_event_payload_new(payload_json);
+            rec_failed = (payload_json && !payload);
+            if (!rec_failed) {
+                rec = evt_rec_new(name, sk_event_payload_retain(payload), seq, ts_us);
+                if (!rec) {
+                    sk_event_payload_release(payload);  // the retain above
+                    rec_failed = true;
+                }
+            }
+        }
+        if (!rec) {
+            atomic_fetch_add(&sk->dropped, 1);
+            continue;
+        }
+        if (sk->q && coalesce == -2) coalesce = coalesce_slot(name);
+        if (sk->q && coalesce >= 0) {
+            sink_coalesce(sk, coalesce, rec);
+        } else {
+            sink_enqueue(sk, rec);
+        }
     }
-    xSemaphoreGive(s_mtx);
+    atomic_fetch_sub(readers, 1);
+    if (atomic_load(&s_grace_pending)) grace_poll();
 
-    if (matched == 0) return;
+    evt_rec_release(rec);  // publisher's reference
+    if (rec_failed) ESP_LOGW(TAG, "%s: no memory for async delivery", name);
 
-    sk_event_t evt = {
-        .name         = name,
-        .seq          = seq,
-        .ts_uptime_us = esp_timer_get_time(),
-        .payload_json = payload_json,
-    };
-
-    for (int i = 0; i < matched; i++) {
-        matched_cb[i](&evt, matched_ctx[i]);
+    if (matched > 0) {
+        sk_event_t evt = {
+            .name         = name,
+            .seq          = seq,
+            .ts_uptime_us = ts_us,
+            .payload_json = payload_json,
+            .payload      = payload,
+        };
+        for (int i = 0; i < matched; i++) {
+            matched_cb[i](&evt, matched_ctx[i]);
+        }
     }
+    sk_event_payload_release(payload);
+}
+
+void sk_event_bus_publish(const char *name, const char *payload_json)
+{
+    publish_common(name, payload_json, NULL);
+}
+
+void sk_event_bus_publish_payload(const char *name, sk_event_payload_t *payload)
+{
+    publish_common(name, NULL, payload);
 }
 
 void sk_event_bus_publishf(const char *name, const char *payload_fmt, ...)
 {
-    char buf[256];
     va_list ap;
     va_start(ap, payload_fmt);
-    int n = vsnprintf(buf, sizeof(buf), payload_fmt, ap);
+    sk_event_payload_t *p = sk_event_payload_vprintf(payload_fmt, ap);
     va_end(ap);
-    if (n < 0) return;
-    sk_event_bus_publish(name, buf);
+    if (!p) {
+        ESP_LOGW(TAG, "%s: payload format failed (oom)", name ? name : "?");
+        return;
+    }
+    publish_common(name, NULL, p);
+}
+
+esp_err_t sk_event_bus_set_coalesced(const char *name)
+{
+    if (!s_ready) return ESP_ERR_INVALID_STATE;
+    if (!name || !name[0] || strchr(name, '*') ||
+        strlen(name) >= SK_EVT_FILTER_MAXLEN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(s_mtx, portMAX_DELAY);
+    esp_err_t err = ESP_OK;
+    int n = atomic_load(&s_n_coalesce);
+    if (coalesce_slot(name) >= 0) {
+        // already registered
+    } else if (n >= SK_EVENT_BUS_MAX_COALESCED) {
+        err = ESP_ERR_NO_MEM;
+    } else {
+        strcpy(s_coalesce[n], name);
+        atomic_store(&s_n_coalesce, n + 1);
+    }
+    xSemaphoreGive(s_mtx);
+    return err;
+}
+
+bool sk_event_bus_is_coalesced(const char *name)
+{
+    return name && coalesce_slot(name) >= 0;
+}
+
+esp_err_t sk_event_bus_set_retained(const char *filter)
+{
+    if (!s_ready) return ESP_ERR_INVALID_STATE;
+    if (!filter || !filter[0] || strlen(filter) >= SK_EVT_FILTER_MAXLEN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(s_mtx, portMAX_DELAY);
+    bool dup = false;
+    for (int i = 0; i < s_n_retain_filters; i++) {
+        if (strcmp(s_retain_filters[i], filter) == 0) dup = true;
+    }
+    bool full = s_n_retain_filters >= SK_EVT_MAX_RETAIN_FILTERS;
+    if (!dup && !full) strcpy(s_retain_filters[s_n_retain_filters++], filter);
+    xSemaphoreGive(s_mtx);
+    if (dup)  return ESP_OK;
+    if (full) return ESP_ERR_NO_MEM;
+
+    int sub;
+    return sk_event_bus_subscribe(filter, retain_handler, NULL, &sub);
+}
+
+size_t sk_event_bus_for_each_retained(sk_event_handler_t fn, void *user_ctx)
+{
+    if (!fn) return 0;
+    evt_rec_t *snap[SK_EVENT_BUS_MAX_RETAINED];
+    size_t n = 0;
+    taskENTER_CRITICAL(&s_retain_lock);
+    for (int i = 0; i < SK_EVENT_BUS_MAX_RETAINED; i++) {
+        if (!s_retained[i]) continue;
+        atomic_fetch_add(&s_retained[i]->refs, 1);
+        snap[n++] = s_retained[i];
+    }
+    taskEXIT_CRITICAL(&s_retain_lock);
+
+    // Publish order, so a peer replaying relay.fire.start / .end ends up
+    // in the right state.
+    for (size_t i = 1; i < n; i++) {
+        evt_rec_t *r = snap[i];
+        size_t j = i;
+        for (; j > 0 && snap[j - 1]->evt.seq > r->evt.seq; j--) snap[j] = snap[j - 1];
+        snap[j] = r;
+    }
+    for (size_t i = 0; i < n; i++) {
+        fn(&snap[i]->evt, user_ctx);
+        evt_rec_release(snap[i]);
+    }
+    return n;
+}
+
+esp_err_t sk_event_bus_history_enable(void)
+{
+    if (!s_ready) return ESP_ERR_INVALID_STATE;
+    if (s_hist_mtx) return ESP_OK;
+    SemaphoreHandle_t mtx = xSemaphoreCreateMutex();
+    if (!mtx) return ESP_ERR_NO_MEM;
+    s_hist_head = s_hist_used = 0;
+    s_hist_lost = 0;
+    s_hist_dropped_seen = 0;
+    s_hist_mtx = mtx;
+
+    const sk_event_sub_opts_t opts = { .delivery = SK_EVT_DELIVER_DISPATCHER };
+    int sub;
+    esp_err_t err = sk_event_bus_subscribe_ex("*", history_handler, NULL, &opts, &sub);
+    if (err != ESP_OK) return err;
+    xSemaphoreTake(s_mtx, portMAX_DELAY);
+    for (int i = 0; i < SK_EVT_MAX_SUBSCRIBERS; i++) {
+        if (s_subs[i].in_use && s_subs[i].id == sub) s_hist_sink = s_subs[i].sink;
+    }
+    xSemaphoreGive(s_mtx);
+    return ESP_OK;
+}
+
+esp_err_t sk_event_bus_history_since(uint32_t since, char *out, size_t cap,
+                                     sk_event_history_t *res)
+{
+    if (!out || !cap || !res) return ESP_ERR_INVALID_ARG;
+    if (!s_hist_mtx) return ESP_ERR_INVALID_STATE;
+    memset(res, 0, sizeof(*res));
+    out[0] = '\0';
+
+    xSemaphoreTake(s_hist_mtx, portMAX_DELAY);
+    res->seq    = atomic_load(&s_seq);
+    res->oldest = s_hist_lost;
+    if (since < s_hist_lost || since > res->seq) {
+        xSemaphoreGive(s_hist_mtx);
+        return ESP_ERR_NOT_FOUND;
+    }
+    esp_err_t err = ESP_OK;
+    size_t off = s_hist_head, left = s_hist_used, len = 0;
+    while (left > 0) {
+        uint32_t seq;
+        uint16_t l;
+        hist_header(off, &seq, &l);
+        size_t body = (off + SK_EVT_HIST_HDR) % SK_EVENT_BUS_HISTORY_BYTES;
+        off  = (body + l) % SK_EVENT_BUS_HISTORY_BYTES;
+        left -= SK_EVT_HIST_HDR + l;
+        if (seq <= since) continue;
+        size_t sep = res->count ? 1 : 0;
+        if (len + sep + l + 1 > cap) {
+            err = ESP_ERR_INVALID_SIZE;
+            break;
+        }
+        if (sep) out[len++] = ',';
+        hist_read(body, out + len, l);
+        len += l;
+        res->count++;
+    }
+    xSemaphoreGive(s_hist_mtx);
+    out[len] = '\0';
+    res->len = len;
+    return err;
 }
 
 uint32_t sk_event_bus_peek_seq(void)
 {
-    return s_seq;
+    return atomic_load(&s_seq);
+}
+
+size_t sk_event_bus_get_stats(sk_event_sub_stats_t *out, size_t max, size_t *out_total)
+{
+    size_t n = 0, total = 0;
+    if (!s_ready) {
+        if (out_total) *out_total = 0;
+        return 0;
+    }
+    xSemaphoreTake(s_mtx, portMAX_DELAY);
+    for (int i = 0; i < SK_EVT_MAX_SUBSCRIBERS; i++) {
+        if (!s_subs[i].in_use) continue;
+        total++;
+        if (!out || n >= max) continue;
+        sk_event_sub_stats_t *st = &out[n++];
+        sink_t *sk = s_subs[i].sink;
+        memset(st, 0, sizeof(*st));
+        st->sub_id = s_subs[i].id;
+        memcpy(st->filter, s_subs[i].filter, sizeof(st->filter));
+        st->delivery    = sk->mode;
+        st->queue_depth = sk->depth;
+        st->queue_hwm   = (uint16_t)atomic_load(&sk->hwm);
+        st->delivered   = atomic_load(&sk->delivered);
+        st->dropped     = atomic_load(&sk->dropped);
+        st->coalesced   = atomic_load(&sk->coalesced);
+    }
+    xSemaphoreGive(s_mtx);
+    if (out_total) *out_total = total;
+    return n;
+}
+
+void sk_event_bus_pool_stats(sk_event_pool_stats_t *out)
+{
+    if (!out) return;
+    taskENTER_CRITICAL(&s_slab_lock);
+    out->small_free  = s_slab[0].top;
+    out->small_total = s_slab[0].count;
+    out->large_free  = s_slab[1].top;
+    out->large_total = s_slab[1].count;
+    taskEXIT_CRITICAL(&s_slab_lock);
+    out->heap_allocs = atomic_load(&s_slab_heap_allocs);
+}
+
+// -- Micro-benchmark ---------------------------------------------------------
+
+// The pre-index publish path: every slot, strlen + strcmp/strncmp.
+static bool linear_filter_matches(const char *filter, const char *name)
+{
+    if (filter[0] == '*' && filter[1] == '\0') return true;
+    size_t flen = strlen(filter);
+    if (filter_is_prefix(filter, flen)) {
+        return strncmp(filter, name, flen - 1) == 0;  // include the dot
+    }
+    return strcmp(filter, name) == 0;
+}
+
+// Filter mix modelled on a real boot: mostly exact names (factory-reset
+// hooks, timer.*), a few prefixes, one "*" forwarder.
+static void bench_filter(int i, char *out, size_t cap)
+{
+    switch (i % 8) {
+        case 0:  snprintf(out, cap, "device.factory-reset.requested"); break;
+        case 1:  snprintf(out, cap, "timer.triggered"); break;
+        case 2:  snprintf(out, cap, "bench%d.*", i); break;
+        case 3:  snprintf(out, cap, "wifi.state"); break;
+        case 4:  snprintf(out, cap, "bench%d.evt", i); break;
+        case 5:  snprintf(out, cap, i == 5 ? "*" : "pairing.*"); break;
+        case 6:  snprintf(out, cap, "timer.alarm"); break;
+        default: snprintf(out, cap, "button.released"); break;
+    }
+}
+
+esp_err_t sk_event_bus_bench(int n_subs, int iters, sk_event_bench_t *out)
+{
+    if (!out || n_subs < 0 || n_subs > SK_EVT_MAX_SUBSCRIBERS || iters <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    subscriber_t *subs = calloc(SK_EVT_MAX_SUBSCRIBERS, sizeof(*subs));
+    if (!subs) return ESP_ERR_NO_MEM;
+    static sink_t dummy;  // matched, never dereferenced
+    for (int i = 0; i < n_subs; i++) {
+        subs[i].in_use = true;
+        subs[i].sink = &dummy;
+        bench_filter(i, subs[i].filter, sizeof(subs[i].filter));
+    }
+    topic_index_t *ix = index_build(subs, n_subs);
+    if (!ix) { free(subs); return ESP_ERR_NO_MEM; }
+
+    static const char *names[2] = { "timer.tick", "timer.triggered" };
+    sink_t *hit[SK_EVT_MAX_SUBSCRIBERS];
+    volatile int sink_n = 0;  // keep the loops from being optimised out
+    memset(out, 0, sizeof(*out));
+    out->subs = n_subs;
+    for (int k = 0; k < 2; k++) {
+        int64_t t0 = esp_timer_get_time();
+        for (int it = 0; it < iters; it++) sink_n += index_match(ix, names[k], hit);
+        int64_t t1 = esp_timer_get_time();
+        for (int it = 0; it < iters; it++) {
+            for (int i = 0; i < n_subs; i++) {
+                if (linear_filter_matches(subs[i].filter, names[k])) sink_n++;
+            }
+        }
+        int64_t t2 = esp_timer_get_time();
+        out->index_ns[k]  = (uint32_t)((t1 - t0) * 1000 / iters);
+        out->linear_ns[k] = (uint32_t)((t2 - t1) * 1000 / iters);
+    }
+    (void)sink_n;
+    free(ix);
+    free(subs);
+    return ESP_OK;
 }
@@ -0,0 +1,343 @@
+// sk_event_cli.c — diagnostics for the event bus.
+//
+//   events.stats — per-subscriber delivery mode, queue fill high-water mark,
+//                  delivered / dropped / coalesced counters
+//   events.since — replay events missed across a reconnect from the
+//                  bus history, or ERR_EVENTS_GAP when they are gone
+//   events.subscribe / events.unsubscribe — push matching events to the
+//                  calling session (sk_event_push.c)
+//   events.bench — (hidden) publish resolve cost vs. subscriber count,
+//                  topic index against the legacy linear filter scan
+//
+// Kept out of sk_event_bus.c because the bus is initialised before the CLI
+// registry exists (sk_core_init order) and must stay usable without it.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+
+#include "sk_cli.h"
+#include "sk_cli_internal.h"   // events.subscribe keys on the session's writer
+#include "sk_errors.h"
+#include "sk_event_bus.h"
+#include "sk_event_bus_internal.h"
+
+static const char *TAG = "sk_event_cli";
+
+static const char *delivery_str(sk_event_delivery_t d)
+{
+    switch (d) {
+        case SK_EVT_DELIVER_SYNC:       return "sync";
+        case SK_EVT_DELIVER_DISPATCHER: return "dispatcher";
+        case SK_EVT_DELIVER_QUEUE:      return "queue";
+    }
+    return "?";
+}
+
+// === events.stats ===========================================================
+
+static sk_err_t cmd_events_stats(sk_cli_ctx_t *ctx)
+{
+    enum { MAX_SUBS = 64 };
+    sk_event_sub_stats_t *st = malloc(sizeof(*st) * MAX_SUBS);
+    if (!st) {
+        sk_cli_err(ctx, SK_ERR_INTERNAL, "{\"reason\":\"oom\"}");
+        return SK_OK;
+    }
+
+    size_t total = 0;
+    size_t n = sk_event_bus_get_stats(st, MAX_SUBS, &total);
+    sk_event_pool_stats_t pool;
+    sk_event_bus_pool_stats(&pool);
+    sk_event_push_stats_t ps[SK_EVENT_PUSH_MAX];
+    size_t np = sk_event_push_get_stats(ps, SK_EVENT_PUSH_MAX);
+
+    // Streamed: filters are caller-chosen topic strings and get escaped.
+    sk_cli_json_t j;
+    sk_cli_json_begin(&j, ctx);
+    sk_cli_json_begin_object(&j);
+    sk_cli_json_key(&j, "seq");         sk_cli_json_number(&j, sk_event_bus_peek_seq());
+    sk_cli_json_key(&j, "subscribers"); sk_cli_json_number(&j, (int64_t)total);
+    sk_cli_json_key(&j, "pool");
+    sk_cli_json_begin_object(&j);
+    sk_cli_json_key(&j, "small_free");  sk_cli_json_number(&j, pool.small_free);
+    sk_cli_json_key(&j, "small_total"); sk_cli_json_number(&j, pool.small_total);
+    sk_cli_json_key(&j, "large_free");  sk_cli_json_number(&j, pool.large_free);
+    sk_cli_json_key(&j, "large_total"); sk_cli_json_number(&j, pool.large_total);
+    sk_cli_json_key(&j, "heap_allocs"); sk_cli_json_number(&j, pool.heap_allocs);
+    sk_cli_json_end(&j);
+
+    sk_cli_json_key(&j, "subs");
+    sk_cli_json_begin_array(&j);
+    for (size_t i = 0; i < n; i++) {
+        sk_cli_json_begin_object(&j);
+        sk_cli_json_key(&j, "id");        sk_cli_json_number(&j, st[i].sub_id);
+        sk_cli_json_key(&j, "filter");    sk_cli_json_string(&j, st[i].filter);
+        sk_cli_json_key(&j, "mode");      sk_cli_json_string(&j, delivery_str(st[i].delivery));
+        sk_cli_json_key(&j, "depth");     sk_cli_json_number(&j, st[i].queue_depth);
+        sk_cli_json_key(&j, "hwm");       sk_cli_json_number(&j, st[i].queue_hwm);
+        sk_cli_json_key(&j, "delivered"); sk_cli_json_number(&j, st[i].delivered);
+        sk_cli_json_key(&j, "dropped");   sk_cli_json_number(&j, st[i].dropped);
+        sk_cli_json_key(&j, "coalesced"); sk_cli_json_number(&j, st[i].coalesced);
+        sk_cli_json_end(&j);
+    }
+    sk_cli_json_end(&j);
+    free(st);
+
+    sk_cli_json_key(&j, "push");
+    sk_cli_json_begin_array(&j);
+    for (size_t i = 0; i < np; i++) {
+        sk_cli_json_begin_object(&j);
+        sk_cli_json_key(&j, "filters"); sk_cli_json_number(&j, ps[i].filters);
+        sk_cli_json_key(&j, "queued");  sk_cli_json_number(&j, ps[i].queued);
+        sk_cli_json_key(&j, "hwm");     sk_cli_json_number(&j, ps[i].queue_hwm);
+        sk_cli_json_key(&j, "sent");    sk_cli_json_number(&j, ps[i].sent);
+        sk_cli_json_key(&j, "dropped"); sk_cli_json_number(&j, ps[i].dropped);
+        sk_cli_json_end(&j);
+    }
+    sk_cli_json_end(&j);
+    sk_cli_json_finish(&j);
+    return SK_OK;
+}
+
+// === events.since ===========================================================
+
+static sk_err_t cmd_events_since(sk_cli_ctx_t *ctx)
+{
+    // `events since 1234` (positional, human mode) or args {"seq":1234}.
+    long since = -1;
+    if (!sk_cli_arg_long(ctx, "seq", &since) && !sk_cli_is_machine_mode(ctx)) {
+        const char *s = sk_cli_arg(ctx, 0);
+        if (s) since = strtol(s, NULL, 10);
+    }
+    if (since < 0) {
+        sk_cli_err(ctx, SK_ERR_MISSING_ARG, "{\"field\":\"seq\"}");
+        return SK_OK;
+    }
+
+    enum { HEAD = 96 };
+    char *buf = malloc(HEAD + SK_EVENT_BUS_HISTORY_BYTES + 4);
+    if (!buf) {
+        sk_cli_err(ctx, SK_ERR_INTERNAL, "{\"reason\":\"oom\"}");
+        return SK_OK;
+    }
+    sk_event_history_t h;
+    esp_err_t err = sk_event_bus_history_since((uint32_t)since, buf + HEAD,
+                                               SK_EVENT_BUS_HISTORY_BYTES + 1, &h);
+    if (err == ESP_ERR_NOT_FOUND) {
+        char p[96];
+        snprintf(p, sizeof(p), "{\"since\":%ld,\"oldest\":%lu,\"seq\":%lu}",
+                 since, (unsigned long)h.oldest, (unsigned long)h.seq);
+        free(buf);
+        sk_cli_err(ctx, SK_ERR_EVENTS_GAP, p);
+        return SK_OK;
+    }
+    if (err != ESP_OK) {
+        free(buf);
+        sk_cli_err(ctx, SK_ERR_INTERNAL, "{\"reason\":\"history_unavailable\"}");
+        return SK_OK;
+    }
+
+    // Header goes in front of the event list, closing brackets after it —
+    // no second copy of up to 4 KB of history.
+    char head[HEAD];
+    int hn = snprintf(head, sizeof(head), "{\"since\":%ld,\"seq\":%lu,\"count\":%u,\"events\":[",
+                      since, (unsigned long)h.seq, (unsigned)h.count);
+    if (hn <= 0 || hn >= HEAD) {
+        free(buf);
+        sk_cli_err(ctx, SK_ERR_INTERNAL, NULL);
+        return SK_OK;
+    }
+    char *start = buf + HEAD - hn;
+    memcpy(start, head, (size_t)hn);
+    memcpy(buf + HEAD + h.len, "]}", 3);
+    sk_cli_ok(ctx, start);
+    free(buf);
+    return SK_OK;
+}
+
+// === events.subscribe =======================================================
+
+static sk_err_t cmd_events_subscribe(sk_cli_ctx_t *ctx)
+{
+    const char *topics[SK_EVENT_PUSH_FILTERS];
+    int n = sk_cli_arg_list(ctx, "topics", topics, SK_EVENT_PUSH_FILTERS);
+    if (n == 0) {
+        sk_cli_err(ctx, SK_ERR_MISSING_ARG, "{\"field\":\"topics\"}");
+        return SK_OK;
+    }
+
+    // Keyed by this session's writer; the transport drops it in
+    // sk_secure_session_reset() on disconnect.
+    esp_err_t err = (n < 0) ? ESP_ERR_INVALID_ARG
+                            : sk_event_push_start(ctx->writer, ctx->writer_user, topics, n);
+    if (err == ESP_ERR_INVALID_ARG) {
+        char p[96];
+        snprintf(p, sizeof(p), "{\"field\":\"topics\",\"max\":%d,\"max_len\":%d}",
+                 SK_EVENT_PUSH_FILTERS, SK_EVENT_BUS_FILTER_MAXLEN - 1);
+        sk_cli_err(ctx, SK_ERR_INVALID_ARG, p);
+        return SK_OK;
+    }
+    if (err != ESP_OK) {
+        sk_cli_err(ctx, SK_ERR_BUSY, "{\"reason\":\"push_slots_full\"}");
+        return SK_OK;
+    }
+
+    // Filters passed validation: no quotes or backslashes to escape.
+    char out[SK_EVENT_PUSH_FILTERS * SK_EVENT_BUS_FILTER_MAXLEN + 64];
+    size_t off = (size_t)snprintf(out, sizeof(out), "{\"seq\":%lu,\"topics\":[",
+                                  (unsigned long)sk_event_bus_peek_seq());
+    for (int i = 0; i < n; i++) {
+        off += (size_t)snprintf(out + off, sizeof(out) - off, "%s\"%s\"",
+                                i ? "," : "", topics[i]);
+    }
+    snprintf(out + off, sizeof(out) - off, "]}");
+    sk_cli_ok(ctx, out);
+    return SK_OK;
+}
+
+static sk_err_t cmd_events_unsubscribe(sk_cli_ctx_t *ctx)
+{
+    bool was = sk_event_push_stop(ctx->writer, ctx->writer_user);
+    sk_cli_ok(ctx, was ? "{\"stopped\":true}" : "{\"stopped\":false}");
+    return SK_OK;
+}
+
+// === events.bench ===========================================================
+
+static sk_err_t cmd_events_bench(sk_cli_ctx_t *ctx)
+{
+    static const int counts[] = { 0, 8, 16, 32, 48, 64 };
+    long iters = 1000;
+    sk_cli_arg_after_long(ctx, "iters", &iters);
+    if (iters < 1 || iters > 100000) {
+        sk_cli_err(ctx, SK_ERR_INVALID_ARG, "{\"field\":\"iters\",\"min\":1,\"max\":100000}");
+        return SK_OK;
+    }
+
+    char buf[768];
+    size_t off = 0;
+    int w = snprintf(buf, sizeof(buf), "{\"iters\":%ld,\"unit\":\"ns\",\"runs\":[", iters);
+    off = (w > 0) ? (size_t)w : 0;
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        sk_event_bench_t r;
+        esp_err_t err = sk_event_bus_bench(counts[i], (int)iters, &r);
+        if (err != ESP_OK) {
+            sk_cli_err(ctx, SK_ERR_INTERNAL, "{\"reason\":\"oom\"}");
+            return SK_OK;
+        }
+        w = snprintf(buf + off, sizeof(buf) - off,
+                     "%s{\"subs\":%d,\"miss_index\":%lu,\"miss_linear\":%lu,"
+                     "\"hit_index\":%lu,\"hit_linear\":%lu}",
+                     i ? "," : "", r.subs,
+                     (unsigned long)r.index_ns[0], (unsigned long)r.linear_ns[0],
+                     (unsigned long)r.index_ns[1], (unsigned long)r.linear_ns[1]);
+        if (w < 0 || (size_t)w >= sizeof(buf) - off) break;
+        off += (size_t)w;
+    }
+    w = snprintf(buf + off, sizeof(buf) - off, "]}");
+    if (w < 0 || (size_t)w >= sizeof(buf) - off) {
+        sk_cli_err(ctx, SK_ERR_INTERNAL, "{\"reason\":\"bench_truncated\"}");
+        return SK_OK;
+    }
+    sk_cli_ok(ctx, buf);
+    return SK_OK;
+}
+
+// Link-time registered (SK_CLI_COMMAND): all three only read bus state
+// that exists from sk_event_bus_init on.
+SK_CLI_COMMAND(s_cmd_events_stats, "events.stats",
+    .summary = "Event bus subscribers and delivery counters",
+    .usage   = "events stats",
+    .help_block =
+        "One entry per subscriber: filter, delivery mode (sync |\n"
+        "dispatcher | queue), queue depth and high-water mark, handler\n"
+        "calls and events dropped because the queue was full.\n"
+        "`coalesced` counts latest-value events (timer.tick) replaced by a\n"
+        "newer one before a queue subscriber got to them.\n"
+        "\n"
+        "A growing `dropped` on the BLE forwarder means the peer link is\n"
+        "slower than the event rate. `pool` shows the payload slab pool;\n"
+        "a climbing heap_allocs means bursts outgrow it.",
+    .handler = cmd_events_stats);
+
+SK_CLI_COMMAND(s_cmd_events_since, "events.since",
+    .summary = "Replay events missed since a sequence number",
+    .usage   = "events since <seq>",
+    .requires_auth = true,
+    .help_block =
+        "Returns every event published after <seq> that is still in the\n"
+        "bus history (a ~4 KB ring, oldest evicted first), oldest first, in\n"
+        "the same {evt,seq,data} shape as live events. A peer sends this\n"
+        "right after re-authenticating, with the last seq it saw.\n"
+        "\n"
+        "ERR_EVENTS_GAP means events after <seq> were already evicted, or\n"
+        "the device rebooted (<seq> is ahead of the bus): resync state\n"
+        "with the *.status commands instead. timer.tick and auth.* are\n"
+        "not kept.\n"
+        "\n"
+        "Example:\n"
+        "  events since 1234",
+    .handler = cmd_events_since);
+
+SK_CLI_COMMAND(s_cmd_events_subscribe, "events.subscribe",
+    .summary = "Push matching events to this session",
+    .usage   = "events subscribe <topic> [<topic> ...]",
+    .requires_auth = true,
+    .help_block =
+        "After the OK reply, every event whose name matches one of the\n"
+        "topics is pushed to this connection as it is published:\n"
+        "  {\"evt\":\"timer.state\",\"seq\":N,\"data\":{...}}\n"
+        "Topics use the bus grammar: exact name, \"prefix.*\" or \"*\"; up\n"
+        "to 8. Machine mode: args {\"topics\":[\"timer.*\",\"relay.*\"]}.\n"
+        "The reply's `seq` is the first event the push can carry;\n"
+        "events.since fills in anything before it.\n"
+        "\n"
+        "Each session has a 16-event queue. A peer that stops reading loses\n"
+        "the oldest events (see events.stats `push`); timer.tick keeps only\n"
+        "its newest value. auth.* is never pushed.\n"
+        "\n"
+        "Issuing it again replaces the topic list. The subscription ends with\n"
+        "events.unsubscribe or when the connection closes. At most 4\n"
+        "sessions at once (ERR_BUSY). A BLE peer receives every event\n"
+        "without it; once it subscribes it gets only its topics instead,\n"
+        "and events.unsubscribe brings back the full stream.\n"
+        "\n"
+        "Examples:\n"
+        "  events subscribe timer.* relay.*\n"
+        "  events subscribe wifi.state",
+    .handler = cmd_events_subscribe);
+
+SK_CLI_COMMAND(s_cmd_events_unsubscribe, "events.unsubscribe",
+    .summary = "Stop pushing events to this session",
+    .usage   = "events unsubscribe",
+    .requires_auth = true,
+    .handler = cmd_events_unsubscribe);
+
+SK_CLI_COMMAND(s_cmd_events_bench, "events.bench",
+    .summary = "Benchmark event publish resolve cost",
+    .usage   = "events bench [iters <n>]",
+    .hidden  = true,  // developer diagnostic
+    .help_block =
+        "Times subscriber resolution for one publish against synthetic\n"
+        "subscriber tables of 0..64 entries: the topic index used by the\n"
+        "bus vs. the old linear filter scan. No handlers run and nothing\n"
+        "is published. `miss` = name with only prefix/\"*\" subscribers,\n"
+        "`hit` = name with exact subscribers. Default 1000 iterations.",
+    .handler = cmd_events_bench);
+
+esp_err_t sk_event_cli_init(void)
+{
+    esp_err_t err = sk_event_bus_history_enable();
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "event history disabled: %s", esp_err_to_name(err));
+    }
+    err = sk_event_push_init();
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "events.subscribe unavailable: %s", esp_err_to_name(err));
+    }
+    ESP_LOGI(TAG, "event bus diagnostics ready");
+    return ESP_OK;
+}
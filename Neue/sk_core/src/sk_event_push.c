@@ -0,0 +1,408 @@
+// sk_event_push.c — event bus push to subscribed sessions (`events.subscribe`).
+//
+// Only BLE forwarded events (sk_transport_ble.c any_event_handler, one
+// link, everything). A TCP client on the LAN got nothing and polled
+// timer.get for a countdown. A session now names the topics it wants —
+// `events.subscribe ["timer.*","relay.*"]` — and receives them as
+//
+//   {"evt":"<name>","seq":N,"data":{...}}
+//
+// the same line the BLE forwarder and events.since produce, so SKAPP has
+// one parser for all three.
+//
+// Delivery — one dispatcher-mode bus subscriber matches each event against
+// the session filters and appends a payload reference to every matching
+// session's bounded queue (SK_EVENT_PUSH_QUEUE). The publisher only pays
+// the bus's dispatcher hand-off. Each subscription has its own small
+// sender task that drains its queue, batching small lines into one write.
+// A stalled socket or a full BLE ring (the session writer waits on either)
+// therefore holds up only that session's sender — never the publisher and
+// never another subscriber. While it stalls its queue drops the oldest
+// event, and a coalesced topic (timer.tick) replaces its queued value
+// instead of piling up.
+//
+// Lifetime — a subscription is keyed by the session's (writer, user) pair
+// and dropped by sk_secure_session_reset() when the connection goes away.
+// As in sk_log_tail.c, stop only marks the slot CLOSING; its sender frees
+// the queue and exits after the write in flight, which the session writer
+// discards once the session is reset.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "sk_event_bus.h"
+#include "sk_event_bus_internal.h"
+
+static const char *TAG = "sk_evt_push";
+
+#define PUSH_TASK_STACK   3072    // sender: writer -> session -> send()
+#define PUSH_TASK_PRIO    4
+#define PUSH_BATCH        4       // events per session per round
+#define PUSH_BUF          512     // one write; bigger lines go out alone
+
+typedef struct {
+    char                name[SK_EVENT_BUS_FILTER_MAXLEN];
+    uint32_t            seq;
+    sk_event_payload_t *payload;  // one reference, NULL = no data
+} item_t;
+
+typedef enum {
+    PUSH_FREE = 0,
+    PUSH_STARTING,      // claimed by sk_event_push_start, no sender yet
+    PUSH_ACTIVE,
+    PUSH_CLOSING,       // stopped; the sender frees the slot and exits
+} push_state_t;
+
+typedef struct {
+    push_state_t            state;
+    TaskHandle_t            task;
+    sk_event_push_writer_t  writer;
+    void                   *user;
+    uint8_t                 n_filters;
+    char                    filters[SK_EVENT_PUSH_FILTERS][SK_EVENT_BUS_FILTER_MAXLEN];
+    item_t                 *q;          // ring of SK_EVENT_PUSH_QUEUE
+    char                   *buf;        // PUSH_BUF, the sender's batch
+    uint8_t                 head;
+    uint8_t                 count;
+    uint8_t                 hwm;
+    uint32_t                sent;
+    uint32_t                dropped;
+} push_t;
+
+static push_t            s_push[SK_EVENT_PUSH_MAX];
+static SemaphoreHandle_t s_mtx;
+static volatile int      s_active;   // ACTIVE slots; lets the bus handler skip
+
+// === Queue (s_mtx held) =====================================================
+
+static void queue_clear(push_t *t)
+{
+    for (int i = 0; i < t->count; i++) {
+        sk_event_payload_release(t->q[(t->head + i) % SK_EVENT_PUSH_QUEUE].payload);
+    }
+    t->head  = 0;
+    t->count = 0;
+}
+
+static void slot_free(push_t *t)
+{
+    queue_clear(t);
+    free(t->q);
+    free(t->buf);
+    t->q     = NULL;
+    t->buf   = NULL;
+    t->task  = NULL;
+    t->state = PUSH_FREE;
+}
+
+static void queue_put(push_t *t, const sk_event_t *evt, sk_event_payload_t *p,
+                      bool coalesced)
+{
+    if (coalesced) {
+        // Latest value only: refresh the queued one in place.
+        for (int i = 0; i < t->count; i++) {
+            item_t *it = &t->q[(t->head + i) % SK_EVENT_PUSH_QUEUE];
+            if (strcmp(it->name, evt->name) != 0) continue;
+            sk_event_payload_release(it->payload);
+            it->payload = p;
+            it->seq     = evt->seq;
+            return;
+        }
+    }
+    if (t->count == SK_EVENT_PUSH_QUEUE) {
+        sk_event_payload_release(t->q[t->head].payload);
+        t->head = (uint8_t)((t->head + 1) % SK_EVENT_PUSH_QUEUE);
+        t->count--;
+        t->dropped++;
+    }
+    item_t *it = &t->q[(t->head + t->count) % SK_EVENT_PUSH_QUEUE];
+    strcpy(it->name, evt->name);
+    it->seq     = evt->seq;
+    it->payload = p;
+    t->count++;
+    if (t->count > t->hwm) t->hwm = t->count;
+}
+
+static bool filter_match(const char *f, const char *name)
+{
+    size_t n = strlen(f);
+    if (n == 1 && f[0] == '*') return true;
+    if (f[n - 1] == '*') return strncmp(name, f, n - 1) == 0;   // "timer.*"
+    return strcmp(f, name) == 0;
+}
+
+static bool push_matches(const push_t *t, const char *name)
+{
+    for (int i = 0; i < t->n_filters; i++) {
+        if (filter_match(t->filters[i], name)) return true;
+    }
+    return false;
+}
+
+// === Bus side (dispatcher task) =============================================
+
+static void push_handler(const sk_event_t *evt, void *user)
+{
+    (void)user;
+    if (s_active == 0) return;
+    // auth.* never leaves the device, same as the BLE forwarder.
+    if (strncmp(evt->name, "auth.", 5) == 0) return;
+    if (strlen(evt->name) >= SK_EVENT_BUS_FILTER_MAXLEN) return;
+
+    bool coalesced = sk_event_bus_is_coalesced(evt->name);
+    xSemaphoreTake(s_mtx, portMAX_DELAY);
+    for (int i = 0; i < SK_EVENT_PUSH_MAX; i++) {
+        push_t *t = &s_push[i];
+        if (t->state != PUSH_ACTIVE || !push_matches(t, evt->name)) continue;
+        // One reference per queue; NULL (no data) is a valid item.
+        sk_event_payload_t *p = sk_event_payload_get(evt);
+        if (!p && sk_event_json(evt)) { t->dropped++; continue; }   // OOM
+        queue_put(t, evt, p, coalesced);
+        // Under s_mtx: a sender frees its slot (and exits) only with it held.
+        xTaskNotifyGive(t->task);
+    }
+    xSemaphoreGive(s_mtx);
+}
+
+// === Sender tasks ===========================================================
+
+typedef struct {
+    sk_event_push_writer_t writer;
+    void                  *user;
+    size_t                 len;
+    char                  *buf;       // PUSH_BUF
+} out_t;
+
+static void out_flush(out_t *o)
+{
+    if (o->len) o->writer(o->buf, o->len, o->user);
+    o->len = 0;
+}
+
+static void out_item(out_t *o, const item_t *it)
+{
+    const char *data = it->payload ? sk_event_payload_json(it->payload) : NULL;
+    size_t cap = strlen(it->name) + (data ? sk_event_payload_len(it->payload) : 0) + 48;
+    char  *line = (cap <= PUSH_BUF - o->len) ? o->buf + o->len : NULL;
+    if (!line) {
+        out_flush(o);
+        line = (cap <= PUSH_BUF) ? o->buf : malloc(cap);
+        if (!line) return;
+    }
+    int n;
+    if (data) {
+        n = snprintf(line, cap, "{\"evt\":\"%s\",\"seq\":%lu,\"data\":%s}\n",
+                     it->name, (unsigned long)it->seq, data);
+    } else {
+        n = snprintf(line, cap, "{\"evt\":\"%s\",\"seq\":%lu}\n",
+                     it->name, (unsigned long)it->seq);
+    }
+    bool fits = n > 0 && (size_t)n < cap;
+    if (line == o->buf + o->len) {
+        if (fits) o->len += (size_t)n;
+    } else {
+        // Oversized line (pairing / OTA state): written on its own.
+        if (fits) o->writer(line, (size_t)n, o->user);
+        free(line);
+    }
+}
+
+// Write up to PUSH_BATCH queued events. Returns true if more are queued.
+static bool push_drain(push_t *t)
+{
+    item_t items[PUSH_BATCH];
+    int n = 0;
+    xSemaphoreTake(s_mtx, portMAX_DELAY);
+    if (t->state == PUSH_ACTIVE) {
+        for (; n < PUSH_BATCH && t->count; n++) {
+            items[n] = t->q[t->head];
+            t->head = (uint8_t)((t->head + 1) % SK_EVENT_PUSH_QUEUE);
+            t->count--;
+        }
+    }
+    xSemaphoreGive(s_mtx);
+    if (n == 0) return false;
+
+    // `buf` is only freed by this task, on its way out.
+    out_t o = { .writer = t->writer, .user = t->user, .buf = t->buf };
+    for (int i = 0; i < n; i++) {
+        out_item(&o, &items[i]);
+        sk_event_payload_release(items[i].payload);
+    }
+    out_flush(&o);
+
+    xSemaphoreTake(s_mtx, portMAX_DELAY);
+    t->sent += (uint32_t)n;
+    bool more = (t->state == PUSH_ACTIVE && t->count > 0);
+    xSemaphoreGive(s_mtx);
+    return more;
+}
+
+static void push_task(void *arg)
+{
+    push_t *t = arg;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (push_drain(t)) {}
+        xSemaphoreTake(s_mtx, portMAX_DELAY);
+        if (t->state == PUSH_CLOSING) {
+            slot_free(t);
+            xSemaphoreGive(s_mtx);
+            break;
+        }
+        xSemaphoreGive(s_mtx);
+    }
+    vTaskDelete(NULL);
+}
+
+// === Public API =============================================================
+
+static bool filter_valid(const char *f)
+{
+    size_t n = f ? strlen(f) : 0;
+    if (n == 0 || n >= SK_EVENT_BUS_FILTER_MAXLEN) return false;
+    const char *star = strchr(f, '*');
+    if (!star) return true;
+    // "*" or a trailing ".*" — the bus grammar, nothing else.
+    return star == f + n - 1 && (n == 1 || f[n - 2] == '.');
+}
+
+bool sk_event_push_stop(sk_event_push_writer_t writer, void *user)
+{
+    if (!writer || !s_mtx) return false;
+    bool found = false;
+    xSemaphoreTake(s_mtx, portMAX_DELAY);
+    for (int i = 0; i < SK_EVENT_PUSH_MAX; i++) {
+        push_t *t = &s_push[i];
+        if (t->state != PUSH_ACTIVE || t->writer != writer || t->user != user) continue;
+        found    = true;
+        t->state = PUSH_CLOSING;     // the sender frees it after its current write
+        s_active--;
+        xTaskNotifyGive(t->task);
+    }
+    xSemaphoreGive(s_mtx);
+    return found;
+}
+
+bool sk_event_push_active(sk_event_push_writer_t writer, void *user)
+{
+    if (!writer || !s_mtx || s_active == 0) return false;
+    bool found = false;
+    xSemaphoreTake(s_mtx, portMAX_DELAY);
+    for (int i = 0; i < SK_EVENT_PUSH_MAX; i++) {
+        const push_t *t = &s_push[i];
+        if (t->state == PUSH_ACTIVE && t->writer == writer && t->user == user) found = true;
+    }
+    xSemaphoreGive(s_mtx);
+    return found;
+}
+
+esp_err_t sk_event_push_start(sk_event_push_writer_t writer, void *user,
+                              const char *const *filters, int n_filters)
+{
+    if (!writer || !filters || n_filters <= 0 || n_filters > SK_EVENT_PUSH_FILTERS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < n_filters; i++) {
+        if (!filter_valid(filters[i])) return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_mtx) return ESP_ERR_INVALID_STATE;
+
+    // Re-issuing events.subscribe on the same session replaces its filters
+    // in place; events already queued still go out.
+    push_t *t = NULL;
+    xSemaphoreTake(s_mtx, portMAX_DELAY);
+    for (int i = 0; i < SK_EVENT_PUSH_MAX && !t; i++) {
+        push_t *c = &s_push[i];
+        if (c->state == PUSH_ACTIVE && c->writer == writer && c->user == user) t = c;
+    }
+    if (t) {
+        t->n_filters = (uint8_t)n_filters;
+        for (int f = 0; f < n_filters; f++) strcpy(t->filters[f], filters[f]);
+    }
+    xSemaphoreGive(s_mtx);
+    if (t) return ESP_OK;
+
+    item_t *q   = malloc(sizeof(item_t) * SK_EVENT_PUSH_QUEUE);
+    char   *buf = malloc(PUSH_BUF);
+    if (!q || !buf) {
+        free(q);
+        free(buf);
+        return ESP_ERR_NO_MEM;
+    }
+
+    xSemaphoreTake(s_mtx, portMAX_DELAY);
+    for (int i = 0; i < SK_EVENT_PUSH_MAX && !t; i++) {
+        if (s_push[i].state != PUSH_FREE) continue;
+        t = &s_push[i];
+        memset(t, 0, sizeof(*t));
+        t->writer    = writer;
+        t->user      = user;
+        t->n_filters = (uint8_t)n_filters;
+        for (int f = 0; f < n_filters; f++) strcpy(t->filters[f], filters[f]);
+        t->q     = q;
+        t->buf   = buf;
+        t->state = PUSH_STARTING;
+    }
+    xSemaphoreGive(s_mtx);
+    if (!t) {
+        free(q);
+        free(buf);
+        return ESP_ERR_NO_MEM;
+    }
+
+    TaskHandle_t task = NULL;
+    if (xTaskCreate(push_task, "sk_evt_push", PUSH_TASK_STACK, t,
+                    PUSH_TASK_PRIO, &task) != pdPASS) {
+        xSemaphoreTake(s_mtx, portMAX_DELAY);
+        slot_free(t);
+        xSemaphoreGive(s_mtx);
+        return ESP_ERR_NO_MEM;
+    }
+    xSemaphoreTake(s_mtx, portMAX_DELAY);
+    t->task  = task;
+    t->state = PUSH_ACTIVE;
+    s_active++;
+    xSemaphoreGive(s_mtx);
+    return ESP_OK;
+}
+
+size_t sk_event_push_get_stats(sk_event_push_stats_t *out, size_t max)
+{
+    if (!out || !s_mtx) return 0;
+    size_t n = 0;
+    xSemaphoreTake(s_mtx, portMAX_DELAY);
+    for (int i = 0; i < SK_EVENT_PUSH_MAX && n < max; i++) {
+        const push_t *t = &s_push[i];
+        if (t->state != PUSH_ACTIVE) continue;
+        out[n++] = (sk_event_push_stats_t){
+            .filters   = t->n_filters,
+            .queued    = t->count,
+            .queue_hwm = t->hwm,
+            .sent      = t->sent,
+            .dropped   = t->dropped,
+        };
+    }
+    xSemaphoreGive(s_mtx);
+    return n;
+}
+
+esp_err_t sk_event_push_init(void)
+{
+    if (s_mtx) return ESP_OK;
+    s_mtx = xSemaphoreCreateMutex();
+    if (!s_mtx) return ESP_ERR_NO_MEM;
+    // Dispatcher mode: the history ring already keeps that task busy with
+    // every event, one more cheap match costs the publisher nothing.
+    const sk_event_sub_opts_t opts = { .delivery = SK_EVT_DELIVER_DISPATCHER };
+    int sub;
+    esp_err_t err = sk_event_bus_subscribe_ex("*", push_handler, NULL, &opts, &sub);
+    if (err != ESP_OK) ESP_LOGW(TAG, "bus subscribe failed: %s", esp_err_to_name(err));
+    return err;
+}
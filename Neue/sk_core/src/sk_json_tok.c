@@ -0,0 +1,285 @@
+// sk_json_tok.c — in-place JSON tokenizer (see sk_json_tok.h).
+//
+// Replaces cJSON_Parse on the machine-mode dispatch path. cJSON built a
+// heap node per value plus a copy of every string for each NDJSON line;
+// on a BLE/TCP session that runs for days that is steady allocator churn
+// and fragmentation for data that lives exactly one dispatch.
+//
+// Two passes over the buffer: parse() validates and records offsets
+// (structure still intact), then finish() unescapes strings and writes
+// the terminators, which is what clobbers the structure.
+
+#include "sk_json_tok.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    char      *js;
+    size_t     len;
+    size_t     pos;
+    sk_jtok_t *toks;
+    int        max;
+    int        n;
+    int        err;
+} parser_t;
+
+static void skip_ws(parser_t *p)
+{
+    while (p->pos < p->len) {
+        char c = p->js[p->pos];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') break;
+        p->pos++;
+    }
+}
+
+static int tok_alloc(parser_t *p, sk_jtok_type_t type, size_t start)
+{
+    if (p->n >= p->max) { p->err = SK_JTOK_ERR_NOMEM; return -1; }
+    sk_jtok_t *t = &p->toks[p->n];
+    t->type  = (uint8_t)type;
+    t->start = (uint16_t)start;
+    t->end   = (uint16_t)start;
+    t->size  = 0;
+    t->next  = 0;
+    return p->n++;
+}
+
+static int hex4(const char *s)
+{
+    int v = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = s[i];
+        v <<= 4;
+        if      (c >= '0' && c <= '9') v |= c - '0';
+        else if (c >= 'a' && c <= 'f') v |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') v |= c - 'A' + 10;
+        else return -1;
+    }
+    return v;
+}
+
+// \uXXXX (and a following low surrogate) at s → code point; *used = chars
+// consumed after the backslash. -1 when invalid.
+static long decode_u(const char *s, size_t avail, size_t *used)
+{
+    if (avail < 5) return -1;
+    int hi = hex4(s + 1);
+    if (hi <= 0) return -1;                       // \u0000 would cut the string
+    if (hi >= 0xDC00 && hi <= 0xDFFF) return -1;  // lone low surrogate
+    *used = 5;
+    if (hi < 0xD800 || hi > 0xDBFF) return hi;
+    if (avail < 11 || s[5] != '\\' || s[6] != 'u') return -1;
+    int lo = hex4(s + 7);
+    if (lo < 0xDC00 || lo > 0xDFFF) return -1;
+    *used = 11;
+    return 0x10000 + (((long)hi - 0xD800) << 10) + (lo - 0xDC00);
+}
+
+static int parse_value(parser_t *p, int depth);
+
+static int parse_string(parser_t *p)
+{
+    size_t start = ++p->pos;  // past the opening quote
+    while (p->pos < p->len) {
+        unsigned char c = (unsigned char)p->js[p->pos];
+        if (c == '"') {
+            int t = tok_alloc(p, SK_JTOK_STRING, start);
+            if (t < 0) return -1;
+            p->toks[t].end  = (uint16_t)p->pos;
+            p->toks[t].next = (uint16_t)(t + 1);
+            p->pos++;
+            return t;
+        }
+        if (c < 0x20) break;
+        if (c == '\\') {
+            if (p->pos + 1 >= p->len) break;
+            char e = p->js[p->pos + 1];
+            if (e == 'u') {
+                size_t used = 0;
+                if (decode_u(p->js + p->pos + 1, p->len - p->pos - 1, &used) < 0) break;
+                p->pos += 1 + used;
+                continue;
+            }
+            if (!strchr("\"\\/bfnrt", e)) break;
+            p->pos += 2;
+            continue;
+        }
+        p->pos++;
+    }
+    p->err = SK_JTOK_ERR_INVAL;
+    return -1;
+}
+
+static int parse_primitive(parser_t *p)
+{
+    size_t start = p->pos;
+    while (p->pos < p->len) {
+        char c = p->js[p->pos];
+        if (c == ',' || c == '}' || c == ']' || c == ' ' ||
+            c == '\t' || c == '\n' || c == '\r') break;
+        p->pos++;
+    }
+    size_t n = p->pos - start;
+    const char *s = p->js + start;
+    bool ok = (n == 4 && memcmp(s, "true", 4) == 0) ||
+              (n == 5 && memcmp(s, "false", 5) == 0) ||
+              (n == 4 && memcmp(s, "null", 4) == 0);
+    if (!ok && n > 0 && (s[0] == '-' || (s[0] >= '0' && s[0] <= '9'))) {
+        // strtod is laxer than JSON (hex, inf, leading '+') — the first
+        // char check above rules those out; it must consume everything.
+        char tmp[32];
+        if (n < sizeof(tmp)) {
+            memcpy(tmp, s, n);
+            tmp[n] = '\0';
+            char *end = NULL;
+            (void)strtod(tmp, &end);
+            ok = (end == tmp + n);
+        }
+    }
+    if (!ok) { p->err = SK_JTOK_ERR_INVAL; return -1; }
+    int t = tok_alloc(p, SK_JTOK_PRIMITIVE, start);
+    if (t < 0) return -1;
+    p->toks[t].end  = (uint16_t)p->pos;
+    p->toks[t].next = (uint16_t)(t + 1);
+    return t;
+}
+
+static int parse_container(parser_t *p, int depth, bool is_obj)
+{
+    if (depth >= SK_JTOK_MAX_DEPTH) { p->err = SK_JTOK_ERR_INVAL; return -1; }
+    int t = tok_alloc(p, is_obj ? SK_JTOK_OBJECT : SK_JTOK_ARRAY, p->pos);
+    if (t < 0) return -1;
+    char close = is_obj ? '}' : ']';
+    p->pos++;
+    skip_ws(p);
+    if (p->pos < p->len && p->js[p->pos] == close) {
+        p->pos++;
+    } else {
+        for (;;) {
+            if (is_obj) {
+                skip_ws(p);
+                if (p->pos >= p->len || p->js[p->pos] != '"') break;
+                if (parse_string(p) < 0) return -1;
+                skip_ws(p);
+                if (p->pos >= p->len || p->js[p->pos] != ':') break;
+                p->pos++;
+            }
+            if (parse_value(p, depth + 1) < 0) return -1;
+            p->toks[t].size++;
+            skip_ws(p);
+            if (p->pos < p->len && p->js[p->pos] == ',') { p->pos++; continue; }
+            if (p->pos < p->len && p->js[p->pos] == close) { p->pos++; goto done; }
+            break;
+        }
+        if (!p->err) p->err = SK_JTOK_ERR_INVAL;
+        return -1;
+    }
+done:
+    p->toks[t].end  = (uint16_t)p->pos;
+    p->toks[t].next = (uint16_t)p->n;
+    return t;
+}
+
+static int parse_value(parser_t *p, int depth)
+{
+    skip_ws(p);
+    if (p->pos >= p->len) { p->err = SK_JTOK_ERR_INVAL; return -1; }
+    switch (p->js[p->pos]) {
+        case '{': return parse_container(p, depth, true);
+        case '[': return parse_container(p, depth, false);
+        case '"': return parse_string(p);
+        default:  return parse_primitive(p);
+    }
+}
+
+// Unescape a validated string token in place and terminate it.
+static void finish_string(char *js, sk_jtok_t *t)
+{
+    char *in  = js + t->start;
+    char *end = js + t->end;
+    char *out = in;
+    while (in < end) {
+        if (*in != '\\') { *out++ = *in++; continue; }
+        char e = in[1];
+        if (e == 'u') {
+            size_t used = 0;
+            long cp = decode_u(in + 1, (size_t)(end - in - 1), &used);
+            in += 1 + used;
+            if (cp < 0x80) {
+                *out++ = (char)cp;
+            } else if (cp < 0x800) {
+                *out++ = (char)(0xC0 | (cp >> 6));
+                *out++ = (char)(0x80 | (cp & 0x3F));
+            } else if (cp < 0x10000) {
+                *out++ = (char)(0xE0 | (cp >> 12));
+                *out++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+                *out++ = (char)(0x80 | (cp & 0x3F));
+            } else {
+                *out++ = (char)(0xF0 | (cp >> 18));
+                *out++ = (char)(0x80 | ((cp >> 12) & 0x3F));
+                *out++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+                *out++ = (char)(0x80 | (cp & 0x3F));
+            }
+            continue;
+        }
+        switch (e) {
+            case 'b': *out++ = '\b'; break;
+            case 'f': *out++ = '\f'; break;
+            case 'n': *out++ = '\n'; break;
+            case 'r': *out++ = '\r'; break;
+            case 't': *out++ = '\t'; break;
+            default:  *out++ = e;    break;   // " \ /
+        }
+        in += 2;
+    }
+    *out = '\0';
+    t->end = (uint16_t)(out - js);
+}
+
+int sk_json_tok_parse(char *json, size_t len, sk_jtok_t *toks, int max_toks)
+{
+    if (!json || !toks || max_toks <= 0 || len > SK_JTOK_MAX_LEN) return SK_JTOK_ERR_INVAL;
+    parser_t p = { .js = json, .len = len, .toks = toks, .max = max_toks };
+    if (parse_value(&p, 0) < 0) return p.err ? p.err : SK_JTOK_ERR_INVAL;
+    skip_ws(&p);
+    if (p.pos != p.len) return SK_JTOK_ERR_INVAL;
+
+    // Structure no longer needed: terminate in place. A string's closing
+    // quote and a primitive's delimiter are the bytes overwritten.
+    for (int i = 0; i < p.n; i++) {
+        if (toks[i].type == SK_JTOK_STRING) {
+            finish_string(json, &toks[i]);
+        } else if (toks[i].type == SK_JTOK_PRIMITIVE) {
+            json[toks[i].end] = '\0';
+        }
+    }
+    return p.n;
+}
+
+int sk_json_tok_get(const char *json, const sk_jtok_t *toks, int obj, const char *key)
+{
+    if (!json || !toks || obj < 0 || !key || toks[obj].type != SK_JTOK_OBJECT) return -1;
+    int k = obj + 1;
+    for (int m = 0; m < toks[obj].size; m++) {
+        int v = k + 1;
+        if (strcmp(json + toks[k].start, key) == 0) return v;
+        k = toks[v].next;
+    }
+    return -1;
+}
+
+const char *sk_json_tok_str(const char *json, const sk_jtok_t *toks, int idx)
+{
+    if (!json || !toks || idx < 0 || toks[idx].type != SK_JTOK_STRING) return NULL;
+    return json + toks[idx].start;
+}
+
+bool sk_json_tok_number(const char *json, const sk_jtok_t *toks, int idx, double *out)
+{
+    if (!json || !toks || idx < 0 || !out || toks[idx].type != SK_JTOK_PRIMITIVE) return false;
+    const char *s = json + toks[idx].start;
+    if (s[0] != '-' && (s[0] < '0' || s[0] > '9')) return false;
+    *out = strtod(s, NULL);
+    return true;
+}
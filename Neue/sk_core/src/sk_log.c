@@ -6,12 +6,50 @@
 // is latency-sensitive and any blocked mutex acquisition there can stall
 // the BLE handshake (this was the exact symptom of the previous abandoned
 // hook). Here every caller only does:
-//   1. format the message into a stack buffer
-//   2. xQueueSendToBack(0)  (non-blocking, drops on full queue)
+//   1. pack the fmt pointer + raw argument bytes (no formatting)
+//   2. xRingbufferSend(0)  (non-blocking, drops on full buffer)
 // The drain task is the sole writer to the ring. Mutex contention is
 // confined to one pair of tasks (the drain + logs.get reader).
+//
+// Deferred formatting — vsnprintf used to run on the caller's stack (the
+// NimBLE host included) and every entry cost a 160-byte queue copy. Now
+// the caller walks `fmt` once and copies each argument as raw bytes:
+// integers / pointers / doubles by value, %s strings by content (the
+// pointed-to buffer may be gone by the time the drain task runs). The
+// drain task re-walks `fmt` and renders one conversion spec at a time
+// with snprintf. Items are variable-length in an esp_ringbuf, typically
+// 30-50 bytes. A format the packer does not understand (%n, positional
+// %1$, long double, wide strings) falls back to formatting on the spot;
+// the item then carries the finished msg and fmt == NULL.
+//
+// Ring layout — the ring used to be 64 fixed sk_log_record_t slots (~160 B
+// each, mostly an empty msg buffer and two int64 timestamps). It is now a
+// byte ring of variable-length packed records, oldest evicted first:
+//
+//   [hdr u8]      level (bits 0-1) | SK_LOG_REC_REPEAT
+//   [tag u8]      index into s_strs, or SK_LOG_STR_RAW + the raw pointer
+//   [event u8]    same as tag
+//   [varint]      zigzag delta of ts_uptime_us against the previous record
+//   [varint]      zigzag delta of ts_unix against the previous record
+//   [varint]      msg length, then the msg bytes (no NUL)
+//   [varint]      repeat count — only when SK_LOG_REC_REPEAT is set
+//
+// A typical entry is 8 bytes + msg, so the same RAM holds several times
+// the history. Deltas chain from s_base_* (the timestamps the oldest record
+// is relative to), which absorb each evicted record's delta.
+//
+// An entry identical to the newest one (level, tag, event and msg) within
+// SK_LOG_REPEAT_WINDOW_US of its last occurrence is not stored again: the
+// newest record's repeat count is bumped instead. A wifi reconnect loop
+// then costs one entry instead of flushing the whole ring. The collapsed
+// entry keeps the timestamps of its first occurrence.
+//
+// Every entry also goes to the flash store (sk_log_store.c) when the
+// partition table has a log partition; the drain task wakes up on its
+// flush deadline even when no new entries arrive.
 
 #include "sk_log.h"
+#include "sk_log_internal.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -21,20 +59,39 @@
 
 #include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
-#include "freertos/queue.h"
+#include "freertos/ringbuf.h"
 #include "freertos/semphr.h"
 #include "freertos/task.h"
 
 // === Tunables ===============================================================
 
-#define SK_LOG_RING_CAPACITY    64   // entries kept in RAM (oldest dropped)
+#define SK_LOG_RING_BYTES       6144 // packed records kept in RAM (oldest dropped)
 #define SK_LOG_MSG_MAX          128  // bytes per msg payload (excluding NUL)
-#define SK_LOG_QUEUE_DEPTH      32   // backpressure buffer before drop
-#define SK_LOG_TASK_STACK       3072 // drain task stack
+#define SK_LOG_STR_SLOTS        64   // interned tag/event literals
+#define SK_LOG_REPEAT_WINDOW_US (60LL * 1000 * 1000)
+#define SK_LOG_QUEUE_BYTES      2048 // backpressure buffer before drop
+#define SK_LOG_ARGS_MAX         160  // packed argument bytes per entry
+#define SK_LOG_SPEC_MAX         24   // longest conversion spec rendered
+// Drain task stack: renders the entry, appends it to the flash segment
+// store and feeds the logs.tail batches. Never calls a transport.
+#define SK_LOG_TASK_STACK       4096
 #define SK_LOG_TASK_PRIO        3    // low priority; logging is background
 
 // === Storage layout =========================================================
 
+// Queue item: header + packed argument bytes (see arg_pack()). With
+// fmt == NULL, args[] is the already formatted msg (not NUL-terminated).
+typedef struct {
+    int64_t        ts_uptime_us;
+    const char    *tag;
+    const char    *event;
+    const char    *fmt;
+    uint8_t        level;
+    uint16_t       args_len;
+    uint8_t        args[];
+} sk_log_qitem_t;
+
+// Formatted entry — drain-task local, input to the packed ring below.
 typedef struct {
     int64_t        ts_unix;
     int64_t        ts_uptime_us;
@@ -44,12 +101,37 @@ typedef struct {
     char           msg[SK_LOG_MSG_MAX + 1];
 } sk_log_record_t;
 
-static sk_log_record_t   s_ring[SK_LOG_RING_CAPACITY];
-static int               s_ring_head  = 0;   // next slot to write
-static int               s_ring_count = 0;   // 0..CAPACITY
+#define SK_LOG_REC_REPEAT       0x04
+#define SK_LOG_STR_RAW          0xFF
+#define SK_LOG_REC_MAX          (3 + 2 * sizeof(const char *) + 10 + 10 + 2 + SK_LOG_MSG_MAX + 5)
+
+static uint8_t           s_ring[SK_LOG_RING_BYTES];
+static size_t            s_ring_tail  = 0;   // offset of the oldest record
+static size_t            s_ring_used  = 0;   // bytes in use
+static size_t            s_ring_count = 0;   // records in use
+static int64_t           s_base_up    = 0;   // oldest record's deltas apply to these
+static int64_t           s_base_unix  = 0;
 static SemaphoreHandle_t s_ring_mtx   = NULL;
 
-static QueueHandle_t     s_queue      = NULL;
+// Newest record — delta base for the next one and the repeat candidate.
+static struct {
+    int64_t        up, unix_ts;
+    int64_t        seen_up;                  // last occurrence, for the window
+    size_t         off;                      // hdr byte
+    size_t         msg_off;
+    size_t         msg_len;
+    uint32_t       repeat;                   // 1 = not collapsed
+    sk_log_level_t level;
+    const char    *tag;
+    const char    *event;
+} s_last;
+
+// tag/event are static literals; a one-byte index replaces the pointer.
+// Matched by content so the same literal from different TUs shares a slot.
+static const char       *s_strs[SK_LOG_STR_SLOTS];
+static int               s_n_strs     = 0;
+
+static RingbufHandle_t   s_queue      = NULL;
 static TaskHandle_t      s_task       = NULL;
 static bool              s_ready      = false;
 
@@ -84,21 +166,410 @@ static int64_t current_unix_or_zero(void)
     return (now > 1700000000) ? (int64_t)now : 0;
 }
 
-// === Drain task =============================================================
+// === Packed ring ============================================================
+
+static size_t varint_put(uint8_t *p, uint64_t v)
+{
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+static uint64_t zigzag(int64_t v)   { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+static int64_t  unzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+static uint8_t ring_byte(size_t off)
+{
+    return s_ring[off % SK_LOG_RING_BYTES];
+}
+
+static uint64_t ring_varint(size_t *off)
+{
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        uint8_t b = ring_byte((*off)++);
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) break;
+    }
+    return v;
+}
+
+static void ring_copy_out(size_t off, void *dst, size_t n)
+{
+    off %= SK_LOG_RING_BYTES;
+    size_t first = SK_LOG_RING_BYTES - off;
+    if (first > n) first = n;
+    memcpy(dst, &s_ring[off], first);
+    memcpy((uint8_t *)dst + first, s_ring, n - first);
+}
+
+static void ring_append(const uint8_t *src, size_t n)
+{
+    size_t off = (s_ring_tail + s_ring_used) % SK_LOG_RING_BYTES;
+    size_t first = SK_LOG_RING_BYTES - off;
+    if (first > n) first = n;
+    memcpy(&s_ring[off], src, first);
+    memcpy(s_ring, src + first, n - first);
+    s_ring_used += n;
+}
+
+static uint8_t str_intern(const char *str)
+{
+    for (int i = 0; i < s_n_strs; i++) {
+        if (s_strs[i] == str || strcmp(s_strs[i], str) == 0) return (uint8_t)i;
+    }
+    if (s_n_strs >= SK_LOG_STR_SLOTS) return SK_LOG_STR_RAW;
+    s_strs[s_n_strs] = str;
+    return (uint8_t)s_n_strs++;
+}
+
+static const char *ring_str(size_t *off)
+{
+    uint8_t ix = ring_byte((*off)++);
+    if (ix != SK_LOG_STR_RAW) return s_strs[ix];
+    const char *p;
+    ring_copy_out(*off, &p, sizeof(p));
+    *off += sizeof(p);
+    return p;
+}
+
+typedef struct {
+    sk_log_level_t level;
+    const char    *tag;
+    const char    *event;
+    int64_t        d_up;
+    int64_t        d_unix;
+    size_t         msg_off;
+    size_t         msg_len;
+    uint32_t       repeat;
+    size_t         len;            // whole record
+} packed_t;
+
+static void ring_decode(size_t off, packed_t *r)
+{
+    size_t p = off;
+    uint8_t hdr = ring_byte(p++);
+    r->level   = (sk_log_level_t)(hdr & 0x03);
+    r->tag     = ring_str(&p);
+    r->event   = ring_str(&p);
+    r->d_up    = unzigzag(ring_varint(&p));
+    r->d_unix  = unzigzag(ring_varint(&p));
+    r->msg_len = (size_t)ring_varint(&p);
+    r->msg_off = p;
+    p += r->msg_len;
+    r->repeat  = (hdr & SK_LOG_REC_REPEAT) ? (uint32_t)ring_varint(&p) : 1;
+    r->len     = p - off;
+}
+
+static void ring_evict_oldest(void)
+{
+    packed_t r;
+    ring_decode(s_ring_tail, &r);
+    s_base_up   += r.d_up;
+    s_base_unix += r.d_unix;
+    s_ring_tail  = (s_ring_tail + r.len) % SK_LOG_RING_BYTES;
+    s_ring_used -= r.len;
+    s_ring_count--;
+}
+
+static void ring_reserve(size_t n)
+{
+    while (s_ring_count > 0 && s_ring_used + n > SK_LOG_RING_BYTES) {
+        ring_evict_oldest();
+    }
+}
+
+static bool is_repeat_of_last(const sk_log_record_t *rec, size_t msg_len)
+{
+    if (s_ring_count == 0) return false;
+    if (rec->level != s_last.level || msg_len != s_last.msg_len) return false;
+    if (rec->tag != s_last.tag && strcmp(rec->tag, s_last.tag) != 0) return false;
+    if (rec->event != s_last.event && strcmp(rec->event, s_last.event) != 0) return false;
+    if (rec->ts_uptime_us - s_last.seen_up > SK_LOG_REPEAT_WINDOW_US) return false;
+    char prev[SK_LOG_MSG_MAX];
+    ring_copy_out(s_last.msg_off, prev, msg_len);
+    return memcmp(prev, rec->msg, msg_len) == 0;
+}
+
+// Newest record is at the end of the ring, so its repeat varint can be
+// rewritten in place: drop the old one, append the new one.
+static void ring_bump_repeat(int64_t seen_up)
+{
+    uint8_t v[5];
+    if (s_last.repeat > 1) {
+        uint8_t tmp[5];
+        s_ring_used -= varint_put(tmp, s_last.repeat);
+    }
+    s_last.repeat++;
+    size_t n = varint_put(v, s_last.repeat);
+    ring_reserve(n);
+    ring_append(v, n);
+    s_ring[s_last.off % SK_LOG_RING_BYTES] |= SK_LOG_REC_REPEAT;
+    s_last.seen_up = seen_up;
+}
 
 static void ring_write_locked(const sk_log_record_t *rec)
 {
-    s_ring[s_ring_head] = *rec;
-    s_ring_head = (s_ring_head + 1) % SK_LOG_RING_CAPACITY;
-    if (s_ring_count < SK_LOG_RING_CAPACITY) s_ring_count++;
+    size_t msg_len = strnlen(rec->msg, SK_LOG_MSG_MAX);
+    if (is_repeat_of_last(rec, msg_len)) {
+        ring_bump_repeat(rec->ts_uptime_us);
+        return;
+    }
+
+    uint8_t buf[SK_LOG_REC_MAX];
+    size_t n = 0;
+    buf[n++] = (uint8_t)(rec->level & 0x03);
+    const char *strs[2] = { rec->tag, rec->event };
+    for (int i = 0; i < 2; i++) {
+        uint8_t ix = str_intern(strs[i]);
+        buf[n++] = ix;
+        if (ix == SK_LOG_STR_RAW) {
+            memcpy(&buf[n], &strs[i], sizeof(strs[i]));
+            n += sizeof(strs[i]);
+        }
+    }
+    // s_last keeps the newest timestamps even after eviction has emptied
+    // the ring, so s_base_* + sum(deltas) stays consistent either way.
+    n += varint_put(&buf[n], zigzag(rec->ts_uptime_us - s_last.up));
+    n += varint_put(&buf[n], zigzag(rec->ts_unix - s_last.unix_ts));
+    n += varint_put(&buf[n], msg_len);
+    size_t msg_at = n;
+    memcpy(&buf[n], rec->msg, msg_len);
+    n += msg_len;
+
+    ring_reserve(n);
+    size_t off = (s_ring_tail + s_ring_used) % SK_LOG_RING_BYTES;
+    ring_append(buf, n);
+    s_ring_count++;
+
+    s_last.up      = rec->ts_uptime_us;
+    s_last.unix_ts = rec->ts_unix;
+    s_last.seen_up = rec->ts_uptime_us;
+    s_last.off     = off;
+    s_last.msg_off = (off + msg_at) % SK_LOG_RING_BYTES;
+    s_last.msg_len = msg_len;
+    s_last.repeat  = 1;
+    s_last.level   = rec->level;
+    s_last.tag     = rec->tag;
+    s_last.event   = rec->event;
+}
+
+// === Deferred formatting ====================================================
+
+typedef enum {
+    ARG_NONE,       // "%%"
+    ARG_INT,
+    ARG_LONG,
+    ARG_LLONG,
+    ARG_SIZE,
+    ARG_PTR,
+    ARG_DBL,
+    ARG_STR,
+    ARG_BAD,        // not deferrable → format eagerly
+} arg_class_t;
+
+// Parse the conversion spec starting at fmt[0] == '%'. Returns its length
+// (including '%' and the conversion char), its argument class and the
+// number of '*' width/precision ints that precede the value.
+static size_t spec_parse(const char *fmt, arg_class_t *cls, int *stars)
+{
+    size_t i = 1;
+    int len_mod = 0;        // 'h', 'l', 'L' ('l'+1 = ll), 'j', 'z', 't'
+    *stars = 0;
+    if (fmt[i] == '%') { *cls = ARG_NONE; return 2; }
+    while (fmt[i] && strchr("-+ #0", fmt[i])) i++;
+    if (fmt[i] == '*') { (*stars)++; i++; }
+    while (fmt[i] >= '0' && fmt[i] <= '9') i++;
+    if (fmt[i] == '.') {
+        i++;
+        if (fmt[i] == '*') { (*stars)++; i++; }
+        while (fmt[i] >= '0' && fmt[i] <= '9') i++;
+    }
+    if (fmt[i] == '$') { *cls = ARG_BAD; return i; }
+    if (fmt[i] == 'h') { len_mod = 'h'; i++; if (fmt[i] == 'h') i++; }
+    else if (fmt[i] == 'l') { len_mod = 'l'; i++; if (fmt[i] == 'l') { len_mod = 'l' + 1; i++; } }
+    else if (fmt[i] && strchr("Ljzt", fmt[i])) { len_mod = fmt[i]; i++; }
+
+    switch (fmt[i]) {
+        case 'd': case 'i': case 'o': case 'u': case 'x': case 'X': case 'c':
+            *cls = (len_mod == 'l')              ? ARG_LONG
+                 : (len_mod == 'l' + 1 || len_mod == 'j') ? ARG_LLONG
+                 : (len_mod == 'z' || len_mod == 't')     ? ARG_SIZE
+                 : (len_mod == 'L')              ? ARG_BAD
+                 :                                 ARG_INT;
+            break;
+        case 's': *cls = len_mod ? ARG_BAD : ARG_STR; break;
+        case 'p': *cls = ARG_PTR; break;
+        case 'f': case 'F': case 'e': case 'E':
+        case 'g': case 'G': case 'a': case 'A':
+            *cls = (len_mod == 'L') ? ARG_BAD : ARG_DBL;
+            break;
+        default:  *cls = ARG_BAD; return fmt[i] ? i + 1 : i;
+    }
+    return i + 1;
 }
 
+#define ARG_PUT(T) do {                                              \
+        T v_ = va_arg(ap, T);                                        \
+        if (n + sizeof(v_) > cap) return -1;                         \
+        memcpy(out + n, &v_, sizeof(v_));                            \
+        n += sizeof(v_);                                             \
+    } while (0)
+
+// Copy the arguments `fmt` consumes into out[]. Returns the byte count,
+// or -1 if fmt is not deferrable or the arguments do not fit.
+static int arg_pack(const char *fmt, va_list ap, uint8_t *out, size_t cap)
+{
+    size_t n = 0;
+    for (const char *f = fmt; *f; ) {
+        if (*f != '%') { f++; continue; }
+        arg_class_t cls;
+        int stars;
+        size_t sl = spec_parse(f, &cls, &stars);
+        if (cls == ARG_BAD || sl > SK_LOG_SPEC_MAX) return -1;
+        f += sl;
+        for (int k = 0; k < stars; k++) ARG_PUT(int);
+        switch (cls) {
+            case ARG_INT:   ARG_PUT(int);                break;
+            case ARG_LONG:  ARG_PUT(long);               break;
+            case ARG_LLONG: ARG_PUT(long long);          break;
+            case ARG_SIZE:  ARG_PUT(size_t);             break;
+            case ARG_PTR:   ARG_PUT(void *);             break;
+            case ARG_DBL:   ARG_PUT(double);             break;
+            case ARG_STR: {
+                const char *str = va_arg(ap, const char *);
+                if (!str) str = "(null)";
+                // The msg is capped at SK_LOG_MSG_MAX anyway; a longer
+                // string only needs enough bytes to fill it.
+                size_t sl2 = strnlen(str, SK_LOG_MSG_MAX);
+                if (n + sl2 + 1 > cap) return -1;
+                memcpy(out + n, str, sl2);
+                out[n + sl2] = '\0';
+                n += sl2 + 1;
+                break;
+            }
+            default: break;
+        }
+    }
+    return (int)n;
+}
+
+#undef ARG_PUT
+
+#define ARG_GET(T, dst) do {                                         \
+        if (a + sizeof(T) > alen) goto out;                          \
+        memcpy(&(dst), args + a, sizeof(T));                         \
+        a += sizeof(T);                                              \
+    } while (0)
+
+#define ARG_EMIT(v)                                                  \
+    (stars == 0 ? snprintf(out + o, cap - o, spec, (v))              \
+   : stars == 1 ? snprintf(out + o, cap - o, spec, st[0], (v))       \
+   :              snprintf(out + o, cap - o, spec, st[0], st[1], (v)))
+
+// Render a packed entry into out (NUL-terminated, truncated to cap).
+static void arg_render(const char *fmt, const uint8_t *args, size_t alen,
+                       char *out, size_t cap)
+{
+    size_t o = 0, a = 0;
+    for (const char *f = fmt; *f && o + 1 < cap; ) {
+        if (*f != '%') { out[o++] = *f++; continue; }
+        arg_class_t cls;
+        int stars, st[2] = { 0, 0 }, w = 0;
+        size_t sl = spec_parse(f, &cls, &stars);
+        if (cls == ARG_NONE) { out[o++] = '%'; f += sl; continue; }
+        char spec[SK_LOG_SPEC_MAX + 1];
+        memcpy(spec, f, sl);
+        spec[sl] = '\0';
+        f += sl;
+        for (int k = 0; k < stars; k++) ARG_GET(int, st[k]);
+        switch (cls) {
+            case ARG_INT:   { int v;       ARG_GET(int, v);       w = ARG_EMIT(v); break; }
+            case ARG_LONG:  { long v;      ARG_GET(long, v);      w = ARG_EMIT(v); break; }
+            case ARG_LLONG: { long long v; ARG_GET(long long, v); w = ARG_EMIT(v); break; }
+            case ARG_SIZE:  { size_t v;    ARG_GET(size_t, v);    w = ARG_EMIT(v); break; }
+            case ARG_PTR:   { void *v;     ARG_GET(void *, v);    w = ARG_EMIT(v); break; }
+            case ARG_DBL:   { double v;    ARG_GET(double, v);    w = ARG_EMIT(v); break; }
+            case ARG_STR: {
+                const char *v = (const char *)args + a;
+                size_t vl = strnlen(v, alen - a);
+                if (a + vl >= alen) goto out;
+                a += vl + 1;
+                w = ARG_EMIT(v);
+                break;
+            }
+            default: goto out;
+        }
+        if (w < 0) break;
+        o += (size_t)w;
+        if (o >= cap) o = cap - 1;
+    }
+out:
+    out[o] = '\0';
+}
+
+#undef ARG_GET
+#undef ARG_EMIT
+
+// === Drain task =============================================================
+
 static void log_task(void *arg)
 {
     (void)arg;
     sk_log_record_t rec;
     for (;;) {
-        if (xQueueReceive(s_queue, &rec, portMAX_DELAY) != pdTRUE) continue;
+        // Deadlines are checked on every wake, not only on timeout: a
+        // steady trickle of entries would otherwise keep both batches
+        // pending until they fill.
+        uint32_t store_ms = sk_log_store_flush_in_ms();
+        uint32_t tail_ms  = sk_log_tail_flush_in_ms();
+        if (store_ms == 0) sk_log_store_flush();
+        if (tail_ms == 0)  sk_log_tail_flush();
+        if (store_ms == 0) store_ms = sk_log_store_flush_in_ms();
+        if (tail_ms == 0)  tail_ms  = sk_log_tail_flush_in_ms();
+
+        uint32_t due_ms = store_ms < tail_ms ? store_ms : tail_ms;
+        TickType_t wait = (due_ms == UINT32_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(due_ms);
+        size_t sz = 0;
+        sk_log_qitem_t *q = xRingbufferReceive(s_queue, &sz, wait);
+        if (!q) continue;
+
+        rec.ts_uptime_us = q->ts_uptime_us;
+        rec.level        = (sk_log_level_t)q->level;
+        rec.tag          = q->tag;
+        rec.event        = q->event;
+        if (q->fmt) {
+            arg_render(q->fmt, q->args, q->args_len, rec.msg, sizeof(rec.msg));
+        } else {
+            size_t n = q->args_len < SK_LOG_MSG_MAX ? q->args_len : SK_LOG_MSG_MAX;
+            memcpy(rec.msg, q->args, n);
+            rec.msg[n] = '\0';
+        }
+        vRingbufferReturnItem(s_queue, q);
+
+        // Wall clock is read here, not by the caller; back-date it by the
+        // time the item spent in the buffer.
+        rec.ts_unix = current_unix_or_zero();
+        if (rec.ts_unix) {
+            rec.ts_unix -= (esp_timer_get_time() - rec.ts_uptime_us) / 1000000;
+        }
+
+        sk_log_entry_view_t v = {
+            .ts_unix      = rec.ts_unix,
+            .ts_uptime_us = rec.ts_uptime_us,
+            .level        = rec.level,
+            .tag          = rec.tag,
+            .event        = rec.event,
+            .msg          = rec.msg,
+            .repeat       = 1,
+        };
+        sk_log_store_append(&v);
+        sk_log_tail_feed(&v);
+
         if (!s_ring_mtx) continue;
         if (xSemaphoreTake(s_ring_mtx, pdMS_TO_TICKS(50)) != pdTRUE) continue;
         ring_write_locked(&rec);
@@ -115,7 +586,10 @@ esp_err_t sk_log_init(void)
     s_ring_mtx = xSemaphoreCreateMutex();
     if (!s_ring_mtx) return ESP_ERR_NO_MEM;
 
-    s_queue = xQueueCreate(SK_LOG_QUEUE_DEPTH, sizeof(sk_log_record_t));
+    // Optional: without the partition sk_log keeps working RAM-only.
+    (void)sk_log_store_init();
+
+    s_queue = xRingbufferCreate(SK_LOG_QUEUE_BYTES, RINGBUF_TYPE_NOSPLIT);
     if (!s_queue) {
         vSemaphoreDelete(s_ring_mtx);
         s_ring_mtx = NULL;
@@ -125,7 +599,7 @@ esp_err_t sk_log_init(void)
     BaseType_t ok = xTaskCreate(log_task, "sk_log", SK_LOG_TASK_STACK, NULL,
                                 SK_LOG_TASK_PRIO, &s_task);
     if (ok != pdPASS) {
-        vQueueDelete(s_queue);
+        vRingbufferDelete(s_queue);
         s_queue = NULL;
         vSemaphoreDelete(s_ring_mtx);
         s_ring_mtx = NULL;
@@ -144,26 +618,36 @@ void sk_log_eventv(sk_log_level_t level,
     if (!tag) tag = "?";
     if (!event) event = "?";
 
-    sk_log_record_t rec = {
-        .ts_unix      = current_unix_or_zero(),
-        .ts_uptime_us = esp_timer_get_time(),
-        .level        = level,
-        .tag          = tag,
-        .event        = event,
-    };
+    uint8_t raw[sizeof(sk_log_qitem_t) + SK_LOG_ARGS_MAX] __attribute__((aligned(8)));
+    sk_log_qitem_t *q = (sk_log_qitem_t *)raw;
+    q->ts_uptime_us = esp_timer_get_time();
+    q->tag          = tag;
+    q->event        = event;
+    q->fmt          = NULL;
+    q->level        = (uint8_t)level;
+    q->args_len     = 0;
 
     if (fmt && fmt[0]) {
-        int n = vsnprintf(rec.msg, sizeof(rec.msg), fmt, ap);
-        if (n < 0) rec.msg[0] = '\0';
-        // vsnprintf already NUL-terminates within buffer bounds
-        (void)n;
-    } else {
-        rec.msg[0] = '\0';
+        va_list cp;
+        va_copy(cp, ap);
+        int n = arg_pack(fmt, cp, q->args, SK_LOG_ARGS_MAX);
+        va_end(cp);
+        if (n >= 0) {
+            q->fmt      = fmt;
+            q->args_len = (uint16_t)n;
+        } else {
+            // Eager fallback; output is capped to the ring's msg size.
+            char *msg = (char *)q->args;
+            n = vsnprintf(msg, SK_LOG_MSG_MAX + 1, fmt, ap);
+            if (n < 0) n = 0;
+            if (n > SK_LOG_MSG_MAX) n = SK_LOG_MSG_MAX;
+            q->args_len = (uint16_t)n;
+        }
     }
 
-    // Non-blocking: if the queue is full we drop the entry rather than
+    // Non-blocking: if the buffer is full we drop the entry rather than
     // stall the caller (critical for NimBLE host task).
-    (void)xQueueSendToBack(s_queue, &rec, 0);
+    (void)xRingbufferSend(s_queue, q, sizeof(sk_log_qitem_t) + q->args_len, 0);
 }
 
 void sk_log_event(sk_log_level_t level,
@@ -182,22 +666,30 @@ void sk_log_walk(sk_log_level_t min_level, size_t max_count,
     if (!s_ready || !cb || !s_ring_mtx) return;
     if (xSemaphoreTake(s_ring_mtx, portMAX_DELAY) != pdTRUE) return;
 
-    int total = s_ring_count;
-    int start = (s_ring_head - total + SK_LOG_RING_CAPACITY) % SK_LOG_RING_CAPACITY;
-    size_t emitted = 0;
-    for (int i = 0; i < total; i++) {
+    char    msg[SK_LOG_MSG_MAX + 1];
+    int64_t up = s_base_up, unix_ts = s_base_unix;
+    size_t  off = s_ring_tail;
+    size_t  emitted = 0;
+    for (size_t i = 0; i < s_ring_count; i++) {
         if (emitted >= max_count) break;
-        int idx = (start + i) % SK_LOG_RING_CAPACITY;
-        const sk_log_record_t *r = &s_ring[idx];
-        if (r->level < min_level) continue;
+        packed_t r;
+        ring_decode(off, &r);
+        off     += r.len;
+        up      += r.d_up;
+        unix_ts += r.d_unix;
+        if (r.level < min_level) continue;
 
+        ring_copy_out(r.msg_off, msg, r.msg_len);
+        msg[r.msg_len] = '\0';
         sk_log_entry_view_t v = {
-            .ts_unix      = r->ts_unix,
-            .ts_uptime_us = r->ts_uptime_us,
-            .level        = r->level,
-            .tag          = r->tag,
-            .event        = r->event,
-            .msg          = r->msg,
+            .ts_unix      = unix_ts,
+            .ts_uptime_us = up,
+            .level        = r.level,
+            .tag          = r.tag,
+            .event        = r.event,
+            .msg          = msg,
+            .repeat       = r.repeat,
+            .boot         = sk_log_boot_count(),
         };
         bool keep = cb(&v, user);
         emitted++;
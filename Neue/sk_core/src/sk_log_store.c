@@ -0,0 +1,515 @@
+// sk_log_store.c — append-only flash history behind sk_log.
+//
+// The RAM ring in sk_log.c is gone after a reboot, which is exactly when
+// a field report needs it. This store keeps every entry on the "sklog"
+// data partition (see partitions.csv) so `logs.get --boot -1` can show
+// what the previous run did before it died.
+//
+// Layout — the partition is split into 4 KB segments (one flash sector
+// each), used as a circular log:
+//
+//   segment:  [magic u32][seq u32][boot u32] record record ... 0xFF...
+//   record:   [len u16][crc8 u8][type u8][payload len bytes]
+//   BOOT:     [boot u32]                       — first record of every boot
+//   ENTRY:    [unix u32][up_us u64][level u8][repeat u16]
+//             [tag_len u8][tag][event_len u8][event][msg_len u8][msg]
+//
+// `seq` increases by one per opened segment; the highest is the active
+// one, the lowest the oldest. When the active segment is full the one
+// after it is erased and reopened, so every sector is erased once per
+// lap — wear levelling with no extra metadata. Records never straddle
+// segments. A cursor is (seq << 16) | offset: it only grows, survives
+// reboots, and a cursor into an evicted segment just means "from oldest".
+// The offset field is wider than a segment, so the end of a full segment
+// (offset == SK_LOG_STORE_SEG) never reads as the start of the next one.
+//
+// Writes — entries are collected in a 512-byte batch and written in one
+// go when it fills, SK_LOG_STORE_FLUSH_MS after the first pending entry,
+// or at once for SK_LOG_ERROR. The batch lives in RTC_NOINIT memory: a
+// panic or watchdog reset keeps it, and the next boot writes it out
+// before anything else, so the last seconds before a crash are not lost.
+// Only a power cut loses the pending batch.
+//
+// Boot counter — not stored separately: the next boot number is one more
+// than the newest BOOT marker / segment header found while mounting.
+//
+// Torn writes — a record whose crc does not match, or dirty bytes after
+// the last record, seal the active segment; appends resume in a freshly
+// erased one.
+
+#include <string.h>
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "sk_log.h"
+#include "sk_log_internal.h"
+
+static const char *TAG = "sk_log_store";
+
+// === Tunables ===============================================================
+
+#define SK_LOG_STORE_LABEL      "sklog"
+#define SK_LOG_STORE_SUBTYPE    0x40
+#define SK_LOG_STORE_SEG        4096
+#define SK_LOG_STORE_MAX_SEGS   32
+#define SK_LOG_STORE_BATCH      512
+#define SK_LOG_STORE_FLUSH_MS   5000
+#define SK_LOG_STORE_STR_MAX    31    // tag / event bytes kept
+
+// === Format =================================================================
+
+#define SEG_MAGIC               0x474C4B53u   // "SKLG"
+#define SEG_HDR                 12
+#define REC_HDR                 4
+#define REC_BOOT                1
+#define REC_ENTRY               2
+#define REC_MAX                 (REC_HDR + 4 + 8 + 1 + 2 + 3 \
+                                 + 2 * SK_LOG_STORE_STR_MAX + 255)
+#define BATCH_MAGIC             0x42474C53u   // "SLGB"
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t boot;
+} seg_hdr_t;
+
+static const esp_partition_t *s_part;
+static SemaphoreHandle_t      s_mtx;
+static uint32_t               s_nseg;
+static uint32_t               s_seq[SK_LOG_STORE_MAX_SEGS];   // 0 = erased / invalid
+static uint32_t               s_active;
+static uint32_t               s_write_off;
+static uint32_t               s_boot;
+static int64_t                s_pending_since_us;
+static size_t                 s_last_entry = SIZE_MAX;        // batch offset, repeat candidate
+
+// Survives panic / WDT resets (not power loss). len_inv guards against the
+// random contents after a cold boot.
+RTC_NOINIT_ATTR static struct {
+    uint32_t magic;
+    uint32_t boot;
+    uint32_t len;
+    uint32_t len_inv;
+    uint8_t  buf[SK_LOG_STORE_BATCH];
+} s_batch;
+
+static uint8_t crc8(const uint8_t *p, size_t n)
+{
+    uint8_t c = 0;
+    for (size_t i = 0; i < n; i++) {
+        c ^= p[i];
+        for (int b = 0; b < 8; b++) c = (c & 0x80) ? (uint8_t)((c << 1) ^ 0x07) : (uint8_t)(c << 1);
+    }
+    return c;
+}
+
+static size_t seg_addr(uint32_t idx) { return (size_t)idx * SK_LOG_STORE_SEG; }
+
+#define CURSOR_OFF_BITS         16
+_Static_assert(SK_LOG_STORE_SEG < (1u << CURSOR_OFF_BITS),
+               "segment offsets must fit the cursor's offset field");
+
+static uint64_t cursor_of(uint32_t seq, uint32_t off)
+{
+    return ((uint64_t)seq << CURSOR_OFF_BITS) | off;
+}
+
+// === Batch ==================================================================
+
+static bool batch_valid(void)
+{
+    return s_batch.magic == BATCH_MAGIC
+        && s_batch.len <= SK_LOG_STORE_BATCH
+        && s_batch.len_inv == ~s_batch.len;
+}
+
+static void batch_set_len(uint32_t len)
+{
+    s_batch.len     = len;
+    s_batch.len_inv = ~len;
+}
+
+static void batch_reset(void)
+{
+    s_batch.magic = BATCH_MAGIC;
+    s_batch.boot  = s_boot;
+    batch_set_len(0);
+    s_last_entry       = SIZE_MAX;
+    s_pending_since_us = 0;
+}
+
+// Finish a record whose payload is already at buf[len + REC_HDR].
+static void batch_commit(uint8_t type, size_t payload_len)
+{
+    uint8_t *r = &s_batch.buf[s_batch.len];
+    r[0] = (uint8_t)(payload_len & 0xFF);
+    r[1] = (uint8_t)(payload_len >> 8);
+    r[2] = crc8(r + REC_HDR, payload_len);
+    r[3] = type;
+    if (s_batch.len == 0) s_pending_since_us = esp_timer_get_time();
+    // len last: a crash mid-record leaves the batch without it.
+    batch_set_len(s_batch.len + REC_HDR + payload_len);
+}
+
+// === Segments ===============================================================
+
+static bool seg_open_next(void)
+{
+    uint32_t next = (s_active + 1) % s_nseg;
+    uint32_t seq  = s_seq[s_active] + 1;
+    s_seq[next]   = 0;
+    if (esp_partition_erase_range(s_part, seg_addr(next), SK_LOG_STORE_SEG) != ESP_OK) {
+        ESP_LOGW(TAG, "erase seg %lu failed", (unsigned long)next);
+        return false;
+    }
+    seg_hdr_t h = { .magic = SEG_MAGIC, .seq = seq, .boot = s_boot };
+    if (esp_partition_write(s_part, seg_addr(next), &h, sizeof(h)) != ESP_OK) {
+        ESP_LOGW(TAG, "header seg %lu failed", (unsigned long)next);
+        return false;
+    }
+    s_seq[next]  = seq;
+    s_active     = next;
+    s_write_off  = SEG_HDR;
+    return true;
+}
+
+static size_t rec_len_at(const uint8_t *r)
+{
+    return REC_HDR + ((size_t)r[0] | ((size_t)r[1] << 8));
+}
+
+static void flush_locked(void)
+{
+    if (!s_part || !batch_valid() || s_batch.len == 0) return;
+    size_t off = 0, len = s_batch.len;
+    while (off < len) {
+        // Longest run of whole records that fits the active segment.
+        size_t run = 0;
+        while (off + run < len) {
+            size_t rl = rec_len_at(&s_batch.buf[off + run]);
+            if (s_write_off + run + rl > SK_LOG_STORE_SEG) break;
+            run += rl;
+        }
+        if (run == 0) {
+            if (!seg_open_next()) break;
+            continue;
+        }
+        if (esp_partition_write(s_part, seg_addr(s_active) + s_write_off,
+                                &s_batch.buf[off], run) != ESP_OK) {
+            ESP_LOGW(TAG, "write failed; sealing seg %lu", (unsigned long)s_active);
+            s_write_off = SK_LOG_STORE_SEG;
+            break;
+        }
+        s_write_off += run;
+        off += run;
+    }
+    batch_reset();
+}
+
+// === Mount ==================================================================
+
+// RTC memory is only trusted record by record: cut the batch at the first
+// record that is malformed or half-written when the reset hit.
+static void batch_sanitize(void)
+{
+    size_t off = 0;
+    while (off + REC_HDR <= s_batch.len) {
+        const uint8_t *r = &s_batch.buf[off];
+        size_t rl = rec_len_at(r);
+        if (rl > REC_MAX || off + rl > s_batch.len
+            || crc8(r + REC_HDR, rl - REC_HDR) != r[2]) {
+            break;
+        }
+        off += rl;
+    }
+    batch_set_len((uint32_t)off);
+}
+
+// Walk the active segment to its end. Returns the newest boot seen in it
+// and leaves s_write_off at the first free byte (or sealed).
+static uint32_t scan_active(uint32_t hdr_boot)
+{
+    uint32_t boot = hdr_boot;
+    uint32_t off  = SEG_HDR;
+    uint8_t  rec[REC_MAX];
+    bool     torn = false;
+    while (off + REC_HDR <= SK_LOG_STORE_SEG) {
+        if (esp_partition_read(s_part, seg_addr(s_active) + off, rec, REC_HDR) != ESP_OK) {
+            torn = true;
+            break;
+        }
+        if (rec[0] == 0xFF && rec[1] == 0xFF) break;
+        size_t pl = (size_t)rec[0] | ((size_t)rec[1] << 8);
+        if (REC_HDR + pl > sizeof(rec) || off + REC_HDR + pl > SK_LOG_STORE_SEG
+            || esp_partition_read(s_part, seg_addr(s_active) + off + REC_HDR,
+                                  rec + REC_HDR, pl) != ESP_OK
+            || crc8(rec + REC_HDR, pl) != rec[2]) {
+            torn = true;
+            break;
+        }
+        if (rec[3] == REC_BOOT && pl >= 4) {
+            uint32_t b;
+            memcpy(&b, rec + REC_HDR, 4);
+            if (b > boot) boot = b;
+        }
+        off += REC_HDR + (uint32_t)pl;
+    }
+    // Bytes after the end must still be erased, or the next append would
+    // program over a half-written record.
+    for (uint32_t p = off; !torn && p < SK_LOG_STORE_SEG; p += sizeof(rec)) {
+        size_t n = SK_LOG_STORE_SEG - p < sizeof(rec) ? SK_LOG_STORE_SEG - p : sizeof(rec);
+        if (esp_partition_read(s_part, seg_addr(s_active) + p, rec, n) != ESP_OK) { torn = true; break; }
+        for (size_t i = 0; i < n; i++) if (rec[i] != 0xFF) { torn = true; break; }
+    }
+    s_write_off = torn ? SK_LOG_STORE_SEG : off;
+    return boot;
+}
+
+esp_err_t sk_log_store_init(void)
+{
+    if (s_part) return ESP_OK;
+    const esp_partition_t *p = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                        (esp_partition_subtype_t)SK_LOG_STORE_SUBTYPE,
+                                                        SK_LOG_STORE_LABEL);
+    if (!p) {
+        ESP_LOGW(TAG, "no \"" SK_LOG_STORE_LABEL "\" partition; log history is RAM-only");
+        return ESP_ERR_NOT_FOUND;
+    }
+    uint32_t nseg = p->size / SK_LOG_STORE_SEG;
+    if (nseg < 2) return ESP_ERR_INVALID_SIZE;
+    if (nseg > SK_LOG_STORE_MAX_SEGS) nseg = SK_LOG_STORE_MAX_SEGS;
+
+    s_mtx = xSemaphoreCreateMutex();
+    if (!s_mtx) return ESP_ERR_NO_MEM;
+    s_part = p;
+    s_nseg = nseg;
+
+    uint32_t last_boot = 0, active_boot = 0;
+    bool any = false;
+    for (uint32_t i = 0; i < nseg; i++) {
+        seg_hdr_t h;
+        s_seq[i] = 0;
+        if (esp_partition_read(p, seg_addr(i), &h, sizeof(h)) != ESP_OK) continue;
+        if (h.magic != SEG_MAGIC || h.seq == 0 || h.seq == UINT32_MAX) continue;
+        s_seq[i] = h.seq;
+        if (!any || h.seq > s_seq[s_active]) {
+            s_active    = i;
+            active_boot = h.boot;
+        }
+        any = true;
+    }
+
+    if (any) {
+        last_boot = scan_active(active_boot);
+    } else {
+        // Blank or foreign partition: start the lap at segment 0.
+        s_active = nseg - 1;
+        s_seq[s_active] = 0;
+        s_write_off = SK_LOG_STORE_SEG;
+    }
+
+    // A batch that outlived a panic / WDT reset belongs to the previous
+    // boot; write it under that number before opening the new one.
+    if (batch_valid()) batch_sanitize();
+    if (batch_valid() && s_batch.len > 0) {
+        if (s_batch.boot > last_boot) last_boot = s_batch.boot;
+        s_boot = s_batch.boot;
+        ESP_LOGI(TAG, "recovering %lu unsaved bytes of boot %lu",
+                 (unsigned long)s_batch.len, (unsigned long)s_batch.boot);
+        flush_locked();
+    }
+
+    s_boot = last_boot + 1;
+    batch_reset();
+    memcpy(&s_batch.buf[REC_HDR], &s_boot, 4);
+    batch_commit(REC_BOOT, 4);
+    flush_locked();
+
+    ESP_LOGI(TAG, "boot %lu, %lu segments, active %lu @%lu",
+             (unsigned long)s_boot, (unsigned long)nseg,
+             (unsigned long)s_active, (unsigned long)s_write_off);
+    return ESP_OK;
+}
+
+// === Append =================================================================
+
+static size_t put_str(uint8_t *dst, const char *s, size_t max)
+{
+    size_t n = s ? strnlen(s, max) : 0;
+    dst[0] = (uint8_t)n;
+    if (n) memcpy(dst + 1, s, n);
+    return n + 1;
+}
+
+void sk_log_store_append(const sk_log_entry_view_t *e)
+{
+    if (!s_part || !e) return;
+    if (xSemaphoreTake(s_mtx, portMAX_DELAY) != pdTRUE) return;
+
+    uint8_t  tmp[REC_MAX];
+    uint8_t *p = tmp + REC_HDR;
+    uint32_t unix_ts = (uint32_t)e->ts_unix;
+    uint64_t up      = (uint64_t)e->ts_uptime_us;
+    uint16_t repeat  = 1;
+    memcpy(p, &unix_ts, 4); p += 4;
+    memcpy(p, &up, 8);      p += 8;
+    *p++ = (uint8_t)e->level;
+    memcpy(p, &repeat, 2);  p += 2;
+    uint8_t *ident = p;
+    p += put_str(p, e->tag, SK_LOG_STORE_STR_MAX);
+    p += put_str(p, e->event, SK_LOG_STORE_STR_MAX);
+    p += put_str(p, e->msg, 255);
+    size_t pl = (size_t)(p - (tmp + REC_HDR));
+    size_t ident_len = (size_t)(p - ident);
+
+    // Same collapsing as the RAM ring, within one batch: bump the previous
+    // entry's repeat instead of writing it again.
+    if (s_last_entry != SIZE_MAX) {
+        uint8_t *prev = &s_batch.buf[s_last_entry];
+        size_t   ppl  = rec_len_at(prev) - REC_HDR;
+        uint8_t *pp   = prev + REC_HDR;
+        if (ppl == pl && pp[12] == (uint8_t)e->level
+            && memcmp(pp + 15, ident, ident_len) == 0) {
+            uint16_t r;
+            memcpy(&r, pp + 13, 2);
+            if (r < UINT16_MAX) r++;
+            memcpy(pp + 13, &r, 2);
+            prev[2] = crc8(pp, ppl);
+            xSemaphoreGive(s_mtx);
+            return;
+        }
+    }
+
+    if (s_batch.len + REC_HDR + pl > SK_LOG_STORE_BATCH) flush_locked();
+    memcpy(&s_batch.buf[s_batch.len + REC_HDR], tmp + REC_HDR, pl);
+    s_last_entry = s_batch.len;
+    batch_commit(REC_ENTRY, pl);
+    if (e->level >= SK_LOG_ERROR) flush_locked();
+
+    xSemaphoreGive(s_mtx);
+}
+
+uint32_t sk_log_store_flush_in_ms(void)
+{
+    if (!s_part || s_batch.len == 0) return UINT32_MAX;
+    int64_t due = s_pending_since_us + (int64_t)SK_LOG_STORE_FLUSH_MS * 1000;
+    int64_t now = esp_timer_get_time();
+    return (now >= due) ? 0 : (uint32_t)((due - now) / 1000);
+}
+
+void sk_log_store_flush(void)
+{
+    if (!s_part) return;
+    if (xSemaphoreTake(s_mtx, portMAX_DELAY) != pdTRUE) return;
+    flush_locked();
+    xSemaphoreGive(s_mtx);
+}
+
+// === Read ===================================================================
+
+uint32_t sk_log_boot_count(void)
+{
+    return s_part ? s_boot : 0;
+}
+
+// Segment index holding the smallest seq greater than after; -1 if none.
+static int seg_next_by_seq(uint32_t after)
+{
+    int best = -1;
+    for (uint32_t i = 0; i < s_nseg; i++) {
+        if (s_seq[i] == 0 || s_seq[i] <= after) continue;
+        if (best < 0 || s_seq[i] < s_seq[best]) best = (int)i;
+    }
+    return best;
+}
+
+esp_err_t sk_log_walk_stored(uint32_t boot, uint64_t since,
+                             sk_log_level_t min_level, size_t max_count,
+                             sk_log_walk_cb_t cb, void *user, uint64_t *next)
+{
+    if (!s_part) return ESP_ERR_NOT_SUPPORTED;
+    if (!cb) return ESP_ERR_INVALID_ARG;
+    if (xSemaphoreTake(s_mtx, portMAX_DELAY) != pdTRUE) return ESP_ERR_TIMEOUT;
+    // Pending entries are part of the answer; cursors are flash positions.
+    flush_locked();
+
+    uint8_t  rec[REC_MAX];
+    char     tag[SK_LOG_STORE_STR_MAX + 1], event[SK_LOG_STORE_STR_MAX + 1], msg[256];
+    size_t   emitted = 0;
+    uint64_t resume  = cursor_of(s_seq[s_active], s_write_off);
+    bool     done    = false;
+
+    for (int si = seg_next_by_seq(0); si >= 0 && !done; si = seg_next_by_seq(s_seq[si])) {
+        uint32_t seq = s_seq[si];
+        uint32_t end = (uint32_t)si == s_active ? s_write_off : SK_LOG_STORE_SEG;
+        if (cursor_of(seq, end) <= since && (uint32_t)si != s_active) continue;
+        seg_hdr_t h;
+        if (esp_partition_read(s_part, seg_addr(si), &h, sizeof(h)) != ESP_OK) continue;
+        uint32_t cur_boot = h.boot;
+        if (boot && cur_boot > boot) { resume = cursor_of(seq, SEG_HDR); break; }
+
+        for (uint32_t off = SEG_HDR; off + REC_HDR <= end; ) {
+            if (esp_partition_read(s_part, seg_addr(si) + off, rec, REC_HDR) != ESP_OK) break;
+            if (rec[0] == 0xFF && rec[1] == 0xFF) break;
+            size_t pl = (size_t)rec[0] | ((size_t)rec[1] << 8);
+            if (REC_HDR + pl > sizeof(rec) || off + REC_HDR + pl > end) break;
+            if (esp_partition_read(s_part, seg_addr(si) + off + REC_HDR, rec + REC_HDR, pl) != ESP_OK
+                || crc8(rec + REC_HDR, pl) != rec[2]) {
+                break;
+            }
+            uint64_t pos = cursor_of(seq, off);
+            off += REC_HDR + (uint32_t)pl;
+            const uint8_t *p = rec + REC_HDR;
+            if (rec[3] == REC_BOOT && pl >= 4) {
+                memcpy(&cur_boot, p, 4);
+                if (boot && cur_boot > boot) { done = true; resume = pos; break; }
+                continue;
+            }
+            if (rec[3] != REC_ENTRY || pl < 18) continue;
+            if (pos < since || (boot && cur_boot != boot)) continue;
+            if (p[12] < (uint8_t)min_level) continue;
+            if (emitted >= max_count) { done = true; resume = pos; break; }
+
+            uint32_t unix_ts;
+            uint64_t up;
+            uint16_t repeat;
+            memcpy(&unix_ts, p, 4);
+            memcpy(&up, p + 4, 8);
+            memcpy(&repeat, p + 13, 2);
+            const uint8_t *q = p + 15, *lim = p + pl;
+            char *dst[3] = { tag, event, msg };
+            size_t cap[3] = { sizeof(tag), sizeof(event), sizeof(msg) };
+            bool ok = true;
+            for (int k = 0; k < 3; k++) {
+                size_t n = (q < lim) ? *q++ : 0;
+                if (q + n > lim || n >= cap[k]) { ok = false; break; }
+                memcpy(dst[k], q, n);
+                dst[k][n] = '\0';
+                q += n;
+            }
+            if (!ok) continue;
+
+            sk_log_entry_view_t v = {
+                .ts_unix      = unix_ts,
+                .ts_uptime_us = (int64_t)up,
+                .level        = (sk_log_level_t)p[12],
+                .tag          = tag,
+                .event        = event,
+                .msg          = msg,
+                .repeat       = repeat,
+                .boot         = cur_boot,
+            };
+            if (!cb(&v, user)) { done = true; resume = pos; break; }
+            emitted++;
+        }
+    }
+
+    xSemaphoreGive(s_mtx);
+    if (next) *next = resume;
+    return ESP_OK;
+}
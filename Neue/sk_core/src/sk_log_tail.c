@@ -0,0 +1,385 @@
+// sk_log_tail.c — live log push to authenticated sessions (`logs.tail`).
+//
+// logs.get is poll-only: SKAPP had to re-download the whole ring to see
+// one new line. A tail subscription instead pushes each new entry (after
+// the level / tag filter) to the session that asked for it, batched so a
+// burst costs one write:
+//
+//   {"evt":"log.lines","data":{"lines":[{ts,up_us,lvl,tag,event,msg},...]}}
+//
+// A batch is sealed SK_LOG_TAIL_FLUSH_MS after its first line, or earlier
+// when the buffer fills. Lines have the same shape as logs.get entries.
+//
+// Two sides per subscription. The sk_log drain task renders lines into
+// the slot's `fill` buffer and seals it — memory only, it never calls a
+// writer. Each subscription has its own small sender task that writes
+// the sealed `out` buffer through the session writer, which may wait on
+// the session's reply lock or a full socket / BLE ring. A slow peer
+// therefore holds up nothing but its own sender: the drain task keeps
+// persisting and tailing for everyone else, and while the previous batch
+// is still on its way a new one is dropped, counted in the next batch as
+// "dropped":N.
+//
+// Lifetime — a subscription is keyed by the session's (writer, user) pair
+// and dropped by sk_secure_session_reset() when the connection goes away.
+// Stop only marks the slot CLOSING; its sender frees the buffers (once
+// the drain task is out of `fill`) and exits. A write still in flight
+// goes through the session writer, which discards it after the reset.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "sk_log.h"
+#include "sk_log_internal.h"
+
+#define SK_LOG_TAIL_BUF        1024
+#define SK_LOG_TAIL_FLUSH_MS   500
+#define SK_LOG_TAIL_LINE       400    // one rendered line, msg escaped
+#define SK_LOG_TAIL_SUFFIX_MAX 32     // TAIL_SUFFIX or the "dropped" variant
+#define SK_LOG_TAIL_STACK      3072   // sender: writer -> session -> send()
+#define SK_LOG_TAIL_PRIO       3      // same as the drain task
+
+#define TAIL_PREFIX            "{\"evt\":\"log.lines\",\"data\":{\"lines\":["
+#define TAIL_SUFFIX            "]}}\n"
+
+typedef enum {
+    TAIL_FREE = 0,
+    TAIL_STARTING,      // claimed by sk_log_tail_start, not fed yet
+    TAIL_ACTIVE,
+    TAIL_CLOSING,       // stopped; the sender frees the slot and exits
+} tail_state_t;
+
+typedef struct {
+    tail_state_t          state;
+    bool                  busy;           // drain task is inside `fill`
+    sk_log_tail_writer_t  writer;
+    void                 *user;
+    sk_log_level_t        min_level;
+    uint8_t               n_tags;
+    char                  tags[SK_LOG_TAIL_TAGS][SK_LOG_TAIL_TAG_MAX + 1];
+    TaskHandle_t          task;
+    char                 *fill;           // drain task: batch being built
+    size_t                len;            // 0 = no batch pending
+    uint16_t              lines;          // entries in `fill`
+    int64_t               first_us;
+    uint32_t              dropped;        // lines lost since the last sealed batch
+    char                 *out;            // sealed batch, owned by the sender
+    size_t                out_len;        // 0 = sender idle
+} tail_t;
+
+static tail_t       s_tail[SK_LOG_TAIL_MAX];
+static portMUX_TYPE s_tail_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Rendered once per entry, for every matching tail. Only the drain task
+// uses it; off its 4 KB stack.
+static char         s_line[SK_LOG_TAIL_LINE];
+
+// === Drain task side ========================================================
+
+static bool tail_acquire(tail_t *t)
+{
+    bool ok;
+    portENTER_CRITICAL(&s_tail_lock);
+    ok = (t->state == TAIL_ACTIVE);
+    if (ok) t->busy = true;
+    portEXIT_CRITICAL(&s_tail_lock);
+    return ok;
+}
+
+static void tail_release(tail_t *t)
+{
+    portENTER_CRITICAL(&s_tail_lock);
+    t->busy = false;
+    portEXIT_CRITICAL(&s_tail_lock);
+}
+
+// Hand the pending batch to the sender. If it is still writing the last
+// one, this batch is dropped instead of waiting for it.
+static void tail_seal(tail_t *t)
+{
+    if (t->len == 0) return;
+    bool handed = false;
+    portENTER_CRITICAL(&s_tail_lock);
+    if (t->out_len == 0) {
+        int n;
+        if (t->dropped) {
+            n = snprintf(t->fill + t->len, SK_LOG_TAIL_SUFFIX_MAX,
+                         "],\"dropped\":%lu}}\n", (unsigned long)t->dropped);
+        } else {
+            n = snprintf(t->fill + t->len, SK_LOG_TAIL_SUFFIX_MAX, "%s", TAIL_SUFFIX);
+        }
+        char *o    = t->out;
+        t->out     = t->fill;
+        t->out_len = t->len + (size_t)n;
+        t->fill    = o;
+        t->dropped = 0;
+        handed     = true;
+    }
+    portEXIT_CRITICAL(&s_tail_lock);
+    if (handed) {
+        xTaskNotifyGive(t->task);
+    } else {
+        t->dropped += t->lines;
+    }
+    t->len   = 0;
+    t->lines = 0;
+}
+
+static bool tail_matches(const tail_t *t, const sk_log_entry_view_t *e)
+{
+    if (e->level < t->min_level) return false;
+    if (t->n_tags == 0) return true;
+    for (int i = 0; i < t->n_tags; i++) {
+        if (strcmp(t->tags[i], e->tag) == 0) return true;
+    }
+    return false;
+}
+
+static size_t json_escape_into(char *out, size_t cap, const char *in)
+{
+    size_t o = 0;
+    for (; in && *in && o + 7 < cap; in++) {
+        unsigned char c = (unsigned char)*in;
+        if (c == '"' || c == '\\') {
+            out[o++] = '\\';
+            out[o++] = (char)c;
+        } else if (c < 0x20) {
+            o += (size_t)snprintf(out + o, cap - o, "\\u%04x", c);
+        } else {
+            out[o++] = (char)c;
+        }
+    }
+    out[o] = '\0';
+    return o;
+}
+
+void sk_log_tail_feed(const sk_log_entry_view_t *e)
+{
+    char  *line     = s_line;
+    size_t line_len = 0;
+
+    for (int i = 0; i < SK_LOG_TAIL_MAX; i++) {
+        tail_t *t = &s_tail[i];
+        if (!tail_acquire(t)) continue;
+        if (!tail_matches(t, e)) { tail_release(t); continue; }
+
+        if (line_len == 0) {
+            int n = snprintf(line, SK_LOG_TAIL_LINE,
+                             "{\"ts\":%lld,\"up_us\":%lld,\"lvl\":\"%s\",\"tag\":\"%s\","
+                             "\"event\":\"%s\",\"msg\":\"",
+                             (long long)e->ts_unix, (long long)e->ts_uptime_us,
+                             sk_log_level_str(e->level), e->tag, e->event);
+            if (n < 0 || n >= SK_LOG_TAIL_LINE) { tail_release(t); return; }
+            line_len = (size_t)n;
+            line_len += json_escape_into(line + line_len, SK_LOG_TAIL_LINE - line_len - 2, e->msg);
+            line[line_len++] = '"';
+            line[line_len++] = '}';
+        }
+
+        // prefix or ',' + line, and room left for the suffix
+        const size_t room = SK_LOG_TAIL_BUF - SK_LOG_TAIL_SUFFIX_MAX;
+        size_t need = (t->len ? 1 : sizeof(TAIL_PREFIX) - 1) + line_len;
+        if (t->len && t->len + need > room) {
+            tail_seal(t);
+            need = sizeof(TAIL_PREFIX) - 1 + line_len;
+        }
+        if (need <= room) {
+            if (t->len == 0) {
+                memcpy(t->fill, TAIL_PREFIX, sizeof(TAIL_PREFIX) - 1);
+                t->len = sizeof(TAIL_PREFIX) - 1;
+                t->first_us = e->ts_uptime_us;
+            } else {
+                t->fill[t->len++] = ',';
+            }
+            memcpy(t->fill + t->len, line, line_len);
+            t->len += line_len;
+            t->lines++;
+        }
+        tail_release(t);
+    }
+}
+
+uint32_t sk_log_tail_flush_in_ms(void)
+{
+    uint32_t best = UINT32_MAX;
+    int64_t  now  = esp_timer_get_time();
+    for (int i = 0; i < SK_LOG_TAIL_MAX; i++) {
+        const tail_t *t = &s_tail[i];
+        if (t->state != TAIL_ACTIVE || t->len == 0) continue;
+        int64_t due = t->first_us + (int64_t)SK_LOG_TAIL_FLUSH_MS * 1000;
+        uint32_t ms = (now >= due) ? 0 : (uint32_t)((due - now) / 1000);
+        if (ms < best) best = ms;
+    }
+    return best;
+}
+
+void sk_log_tail_flush(void)
+{
+    int64_t now = esp_timer_get_time();
+    for (int i = 0; i < SK_LOG_TAIL_MAX; i++) {
+        tail_t *t = &s_tail[i];
+        if (!tail_acquire(t)) continue;
+        if (t->len && now - t->first_us >= (int64_t)SK_LOG_TAIL_FLUSH_MS * 1000) {
+            tail_seal(t);
+        }
+        tail_release(t);
+    }
+}
+
+// === Sender tasks ===========================================================
+
+static void tail_task(void *arg)
+{
+    tail_t *t = arg;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        portENTER_CRITICAL(&s_tail_lock);
+        tail_state_t state = t->state;
+        size_t       len   = t->out_len;
+        portEXIT_CRITICAL(&s_tail_lock);
+        if (state == TAIL_CLOSING) break;
+        if (len == 0) continue;
+        t->writer(t->out, len, t->user);
+        portENTER_CRITICAL(&s_tail_lock);
+        t->out_len = 0;
+        portEXIT_CRITICAL(&s_tail_lock);
+    }
+
+    // Stopped. The drain task may still be inside `fill` for one entry.
+    for (;;) {
+        portENTER_CRITICAL(&s_tail_lock);
+        bool busy = t->busy;
+        portEXIT_CRITICAL(&s_tail_lock);
+        if (!busy) break;
+        vTaskDelay(1);
+    }
+    free(t->fill);
+    free(t->out);
+    portENTER_CRITICAL(&s_tail_lock);
+    t->fill    = NULL;
+    t->out     = NULL;
+    t->out_len = 0;
+    t->task    = NULL;
+    t->state   = TAIL_FREE;
+    portEXIT_CRITICAL(&s_tail_lock);
+    vTaskDelete(NULL);
+}
+
+// === Public API =============================================================
+
+bool sk_log_tail_stop(sk_log_tail_writer_t writer, void *user)
+{
+    if (!writer) return false;
+    bool found = false;
+    for (int i = 0; i < SK_LOG_TAIL_MAX; i++) {
+        tail_t      *t    = &s_tail[i];
+        TaskHandle_t task = NULL;
+        portENTER_CRITICAL(&s_tail_lock);
+        if (t->state == TAIL_ACTIVE && t->writer == writer && t->user == user) {
+            found    = true;
+            t->state = TAIL_CLOSING;
+            task     = t->task;
+        }
+        portEXIT_CRITICAL(&s_tail_lock);
+        // The sender frees the slot once its current write (if any) is done.
+        if (task) xTaskNotifyGive(task);
+    }
+    return found;
+}
+
+esp_err_t sk_log_tail_start(sk_log_tail_writer_t writer, void *user,
+                            sk_log_level_t min_level, const char *tags_csv)
+{
+    if (!writer) return ESP_ERR_INVALID_ARG;
+
+    tail_t cfg = { .min_level = min_level };
+    for (const char *p = tags_csv; p && *p; ) {
+        const char *end = strchr(p, ',');
+        size_t n = end ? (size_t)(end - p) : strlen(p);
+        if (n > 0) {
+            if (n > SK_LOG_TAIL_TAG_MAX || cfg.n_tags >= SK_LOG_TAIL_TAGS) {
+                return ESP_ERR_INVALID_ARG;
+            }
+            memcpy(cfg.tags[cfg.n_tags], p, n);
+            cfg.tags[cfg.n_tags][n] = '\0';
+            cfg.n_tags++;
+        }
+        p = end ? end + 1 : p + n;
+    }
+
+    // Re-issuing logs.tail on the same session replaces its filter in
+    // place; the drain task is only ever inside a slot for one entry.
+    for (int i = 0; i < SK_LOG_TAIL_MAX; i++) {
+        tail_t *t = &s_tail[i];
+        for (;;) {
+            bool done = false, retry = false;
+            portENTER_CRITICAL(&s_tail_lock);
+            if (t->state == TAIL_ACTIVE && t->writer == writer && t->user == user) {
+                if (t->busy) {
+                    retry = true;
+                } else {
+                    t->min_level = cfg.min_level;
+                    t->n_tags    = cfg.n_tags;
+                    memcpy(t->tags, cfg.tags, sizeof(t->tags));
+                    done = true;
+                }
+            }
+            portEXIT_CRITICAL(&s_tail_lock);
+            if (done) return ESP_OK;
+            if (!retry) break;
+            vTaskDelay(1);
+        }
+    }
+
+    char *fill = malloc(SK_LOG_TAIL_BUF);
+    char *out  = malloc(SK_LOG_TAIL_BUF);
+    if (!fill || !out) {
+        free(fill);
+        free(out);
+        return ESP_ERR_NO_MEM;
+    }
+
+    tail_t *t = NULL;
+    portENTER_CRITICAL(&s_tail_lock);
+    for (int i = 0; i < SK_LOG_TAIL_MAX; i++) {
+        if (s_tail[i].state != TAIL_FREE) continue;
+        t = &s_tail[i];
+        t->state = TAIL_STARTING;
+        break;
+    }
+    portEXIT_CRITICAL(&s_tail_lock);
+    if (!t) {
+        free(fill);
+        free(out);
+        return ESP_ERR_NO_MEM;
+    }
+
+    *t = cfg;
+    t->state  = TAIL_STARTING;
+    t->writer = writer;
+    t->user   = user;
+    t->fill   = fill;
+    t->out    = out;
+    TaskHandle_t task = NULL;
+    if (xTaskCreate(tail_task, "sk_log_tail", SK_LOG_TAIL_STACK, t,
+                    SK_LOG_TAIL_PRIO, &task) != pdPASS) {
+        free(fill);
+        free(out);
+        portENTER_CRITICAL(&s_tail_lock);
+        t->fill  = NULL;
+        t->out   = NULL;
+        t->state = TAIL_FREE;
+        portEXIT_CRITICAL(&s_tail_lock);
+        return ESP_ERR_NO_MEM;
+    }
+    portENTER_CRITICAL(&s_tail_lock);
+    t->task  = task;
+    t->state = TAIL_ACTIVE;
+    portEXIT_CRITICAL(&s_tail_lock);
+    return ESP_OK;
+}
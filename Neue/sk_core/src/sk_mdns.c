@@ -1,6 +1,7 @@
 #include "sk_mdns.h"
 #include "sk_event_bus.h"
 #include "sk_identity.h"
+#include "sk_wifi.h"
 
 #include <string.h>
 
@@ -43,9 +44,9 @@ static void announce(void)
 static void on_wifi(const sk_event_t *evt, void *user)
 {
     (void)user;
-    if (!evt->payload_json) return;
-    // Cheap check instead of JSON parse.
-    if (strstr(evt->payload_json, "\"state\":\"connected\"")) {
+    const sk_wifi_state_evt_t *ws = sk_event_data(evt, &sk_wifi_state_evt_type);
+    if (!ws) return;
+    if (strcmp(ws->state, "connected") == 0) {
         announce();
     }
 }
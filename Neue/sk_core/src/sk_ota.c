@@ -650,6 +650,8 @@ esp_err_t sk_ota_init(const sk_ota_cfg_t *cfg)
         sk_cli_register(&s_cmds[i]);
     }
     sk_capabilities_register_book("sk_ota", "0.2.0");
+    // Last ota.fw.state goes out in the retained burst of every new session.
+    sk_event_bus_set_retained("ota.fw.state");
 
     // Mark current image valid so the bootloader doesn't roll back on the
     // next reboot. Idempotent — safe on every boot.
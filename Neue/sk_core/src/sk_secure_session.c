@@ -1,13 +1,19 @@
 #include "sk_secure_session.h"
 #include "sk_passphrase.h"
 #include "sk_event_bus.h"
+#include "sk_event_bus_internal.h"   // events.subscribe is dropped on reset
+#include "sk_json_tok.h"
+#include "sk_log.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "cJSON.h"
 #include "esp_log.h"
 #include "esp_timer.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
 
 static const char *TAG = "sk_session";
 
@@ -42,6 +48,312 @@ static bool hex_to_bytes(const char *hex, size_t expect_bytes, uint8_t *out)
     return true;
 }
 
+// -- Command pipeline --------------------------------------------------------
+//
+// Verified commands used to run inline on the transport task, so one slow
+// handler (wifi.scan, smtp.test) stalled every later line of the session.
+// They now go to a small worker pool shared by all sessions. Replies keep
+// their `id` and leave in completion order.
+//
+// Workers never hold a session pointer across a disconnect. A job and every
+// writer handed to sk_cli carry a handle = (gen << 8) | slot. Here `slot`
+// indexes the session registry and `gen` must still match. Async replies
+// (wifi.scan) and logs.tail capture that same handle, so they fall silent
+// with the session too. The session structs are static, so registry entries
+// are never freed.
+//
+// tx_lock keeps one reply frame (NDJSON line) contiguous. Whatever task
+// writes — a worker, the sk_cli async task finishing a deferred reply, an
+// inline dispatch — takes it at the frame's first chunk and gives it back
+// at the chunk ending in '\n'; tx_holder remembers which task that is. So
+// a line spanning several coalescer flushes is not cut by another one,
+// and nobody waits on a whole multi-line reply. Every take is bounded by
+// SK_SESSION_TX_WAIT_MS: behind a peer that stopped reading, a frame is
+// dropped (and counted) rather than parking a worker, the push sender or
+// the log tail on it, and the writer skips to its '\n' (tx_skip). Nothing
+// else ever waits on the lock — reset() only moves the generation on.
+
+#define SK_SESSION_MAX           6      // 1 BLE + TCP clients
+#define SK_SESSION_WORKERS       2
+#define SK_SESSION_WORKER_STACK  8192   // handlers ran on 8-10 KB transport stacks
+#define SK_SESSION_WORKER_PRIO   5
+#define SK_SESSION_TX_WAIT_MS    1000
+
+typedef struct {
+    uint8_t  slot;                      // 0 = transport job (`run`)
+    uint16_t gen;
+    void   (*run)(void *arg);
+    void    *arg;
+    char     body[];
+} job_t;
+
+static sk_secure_session_t *s_reg[SK_SESSION_MAX];
+static TaskHandle_t         s_workers[SK_SESSION_WORKERS];
+static QueueHandle_t        s_jobs;
+static bool                 s_pool_claimed;
+static portMUX_TYPE         s_pipe_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void *session_handle(const sk_secure_session_t *s)
+{
+    return (void *)(uintptr_t)(((uint32_t)s->gen << 8) | s->slot);
+}
+
+// True while `me` skips the rest of a frame that lost its lock wait; the
+// frame's '\n' ends the skip.
+static bool tx_skipping(sk_secure_session_t *s, TaskHandle_t me, bool eol)
+{
+    bool skip = false;
+    portENTER_CRITICAL(&s_pipe_lock);
+    for (int i = 0; i < SK_SESSION_TX_SKIP; i++) {
+        if (s->tx_skip[i] != me) continue;
+        skip = true;
+        if (eol) s->tx_skip[i] = NULL;
+        break;
+    }
+    portEXIT_CRITICAL(&s_pipe_lock);
+    return skip;
+}
+
+// With every entry taken the rest of the frame goes out unframed; only a
+// peer that stopped reading under more than SK_SESSION_TX_SKIP writers
+// gets there.
+static void tx_skip_begin(sk_secure_session_t *s, TaskHandle_t me)
+{
+    portENTER_CRITICAL(&s_pipe_lock);
+    for (int i = 0; i < SK_SESSION_TX_SKIP; i++) {
+        if (!s->tx_skip[i]) {
+            s->tx_skip[i] = me;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_pipe_lock);
+}
+
+// Close a frame `me` left without its '\n' (a handler returning mid-line).
+static void tx_frame_abandon(sk_secure_session_t *s, TaskHandle_t me)
+{
+    if (s->tx_holder == me) {
+        s->tx_holder = NULL;
+        xSemaphoreGiveRecursive(s->tx_lock);
+    }
+    tx_skipping(s, me, true);
+}
+
+// sk_cli_writer_t over a session handle.
+static void session_tx(const char *chunk, size_t len, void *user)
+{
+    uintptr_t h    = (uintptr_t)user;
+    uint8_t   slot = (uint8_t)(h & 0xFF);
+    uint16_t  gen  = (uint16_t)(h >> 8);
+    if (!slot || slot > SK_SESSION_MAX || !chunk || !len) return;
+    sk_secure_session_t *s = s_reg[slot - 1];
+    if (!s || !s->tx_lock) return;
+
+    TaskHandle_t me  = xTaskGetCurrentTaskHandle();
+    bool         eol = chunk[len - 1] == '\n';
+    if (tx_skipping(s, me, eol)) return;
+    // Only the holder itself can read its own handle here.
+    bool held = s->tx_holder == me;
+    if (!held &&
+        xSemaphoreTakeRecursive(s->tx_lock, pdMS_TO_TICKS(SK_SESSION_TX_WAIT_MS)) != pdTRUE) {
+        portENTER_CRITICAL(&s_pipe_lock);
+        s->tx_dropped++;
+        portEXIT_CRITICAL(&s_pipe_lock);
+        if (!eol) tx_skip_begin(s, me);
+        return;
+    }
+
+    // Snapshot the sink: reset() may clear it while we are in send().
+    portENTER_CRITICAL(&s_pipe_lock);
+    sk_session_send_fn send      = (s->gen == gen) ? s->send : NULL;
+    void              *send_user = s->send_user;
+    if (send) s->sending++;
+    portEXIT_CRITICAL(&s_pipe_lock);
+    if (send) {
+        send(chunk, len, send_user);
+        portENTER_CRITICAL(&s_pipe_lock);
+        s->sending--;
+        portEXIT_CRITICAL(&s_pipe_lock);
+    }
+
+    if (eol) {
+        s->tx_holder = NULL;
+        xSemaphoreGiveRecursive(s->tx_lock);
+    } else if (!held) {
+        s->tx_holder = me;                       // until the '\n' chunk
+    }
+}
+
+static void worker_task(void *arg)
+{
+    (void)arg;
+    TaskHandle_t me = xTaskGetCurrentTaskHandle();
+    for (;;) {
+        job_t *job = NULL;
+        if (xQueueReceive(s_jobs, &job, portMAX_DELAY) != pdTRUE) continue;
+        if (!job->slot) {
+            job->run(job->arg);
+            free(job);
+            continue;
+        }
+        sk_secure_session_t *s = s_reg[job->slot - 1];
+
+        portENTER_CRITICAL(&s_pipe_lock);
+        bool live = (s->gen == job->gen);
+        portEXIT_CRITICAL(&s_pipe_lock);
+        if (live) {
+            sk_cli_dispatch_line_authenticated(job->body, session_tx,
+                                               (void *)(uintptr_t)(((uint32_t)job->gen << 8) | job->slot));
+        }
+        tx_frame_abandon(s, me);
+
+        portENTER_CRITICAL(&s_pipe_lock);
+        if (s->gen == job->gen && s->inflight) s->inflight--;
+        portEXIT_CRITICAL(&s_pipe_lock);
+        free(job);
+    }
+}
+
+// Started by the first session; on failure commands keep running inline.
+static void pool_start(void)
+{
+    portENTER_CRITICAL(&s_pipe_lock);
+    bool mine = !s_pool_claimed;
+    s_pool_claimed = true;
+    portEXIT_CRITICAL(&s_pipe_lock);
+    if (!mine) return;
+
+    QueueHandle_t q = xQueueCreate(SK_SESSION_MAX * SK_SESSION_INFLIGHT, sizeof(job_t *));
+    if (!q) {
+        ESP_LOGE(TAG, "pipeline queue alloc failed — inline dispatch");
+        return;
+    }
+    s_jobs = q;
+    int started = 0;
+    for (int i = 0; i < SK_SESSION_WORKERS; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "sk_cmd%d", i);
+        if (xTaskCreate(worker_task, name, SK_SESSION_WORKER_STACK, NULL,
+                        SK_SESSION_WORKER_PRIO, &s_workers[i]) == pdPASS) {
+            started++;
+        }
+    }
+    if (started == 0) {
+        // Nobody would drain the queue; keep dispatching inline.
+        s_jobs = NULL;
+        vQueueDelete(q);
+        ESP_LOGE(TAG, "pipeline workers failed to start — inline dispatch");
+    }
+}
+
+bool sk_secure_session_run(void (*fn)(void *arg), void *arg)
+{
+    if (!fn) return false;
+    pool_start();
+    if (!s_jobs) return false;
+    job_t *job = malloc(sizeof(*job));
+    if (!job) return false;
+    job->slot = 0;
+    job->gen  = 0;
+    job->run  = fn;
+    job->arg  = arg;
+    if (xQueueSend(s_jobs, &job, 0) == pdTRUE) return true;
+    free(job);
+    return false;
+}
+
+static void session_register(sk_secure_session_t *s)
+{
+    if (s->slot) return;
+    SemaphoreHandle_t lock = xSemaphoreCreateRecursiveMutex();
+    if (!lock) return;
+    portENTER_CRITICAL(&s_pipe_lock);
+    for (int i = 0; i < SK_SESSION_MAX; i++) {
+        if (!s_reg[i]) {
+            s_reg[i]   = s;
+            s->slot    = (uint8_t)(i + 1);
+            s->tx_lock = lock;
+            lock       = NULL;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&s_pipe_lock);
+    if (lock) {
+        vSemaphoreDelete(lock);
+        ESP_LOGW(TAG, "session registry full — inline dispatch, unserialized writes");
+    }
+}
+
+// Coalescer packet size for this session's handle writer. The handle
+// changes with every generation, so the registration follows it.
+static void session_segment_sync(sk_secure_session_t *s, void *old_handle)
+{
+    if (!s->slot) return;
+    if (old_handle) sk_cli_set_writer_segment(session_tx, old_handle, 0);
+    if (s->segment) sk_cli_set_writer_segment(session_tx, session_handle(s), s->segment);
+}
+
+// Zero the protocol state and start a new generation: anything still
+// holding the previous handle writes nothing from here on. Never waits —
+// a send() already under way finishes on its own (see sending).
+static void session_rearm(sk_secure_session_t *s)
+{
+    void *old = s->slot ? session_handle(s) : NULL;
+    portENTER_CRITICAL(&s_pipe_lock);
+    uint8_t           slot    = s->slot;
+    uint16_t          gen     = s->gen;
+    SemaphoreHandle_t lock    = s->tx_lock;
+    uint8_t           sending = s->sending;
+    uint16_t          segment = s->segment;
+    uint32_t          dropped = s->tx_dropped;
+    // A writer mid-frame still owns the lock; it lets go at its '\n'.
+    TaskHandle_t      holder  = s->tx_holder;
+    TaskHandle_t      skip[SK_SESSION_TX_SKIP];
+    memcpy(skip, s->tx_skip, sizeof(skip));
+    memset(s, 0, sizeof(*s));
+    s->slot       = slot;
+    s->gen        = (uint16_t)(gen + 1);
+    s->tx_lock    = lock;
+    s->sending    = sending;
+    s->segment    = segment;
+    s->tx_dropped = dropped;
+    s->tx_holder  = holder;
+    memcpy(s->tx_skip, skip, sizeof(skip));
+    portEXIT_CRITICAL(&s_pipe_lock);
+    session_segment_sync(s, old);
+}
+
+bool sk_secure_session_tx_busy(const sk_secure_session_t *s)
+{
+    if (!s) return false;
+    portENTER_CRITICAL(&s_pipe_lock);
+    bool busy = s->sending != 0;
+    portEXIT_CRITICAL(&s_pipe_lock);
+    return busy;
+}
+
+bool sk_secure_session_push_active(const sk_secure_session_t *s)
+{
+    if (!s || !s->send) return false;
+    // Same keys events.subscribe used, see sk_secure_session_reset().
+    if (s->slot) return sk_event_push_active(session_tx, session_handle(s));
+    return sk_event_push_active(s->send, s->send_user);
+}
+
+void sk_secure_session_set_segment(sk_secure_session_t *s, size_t segment)
+{
+    if (!s || segment > UINT16_MAX) return;
+    s->segment = (uint16_t)segment;
+    session_segment_sync(s, NULL);
+}
+
+void sk_secure_session_send(sk_secure_session_t *s, const char *chunk, size_t len)
+{
+    if (!s || !chunk || !len) return;
+    if (s->slot)      session_tx(chunk, len, session_handle(s));
+    else if (s->send) s->send(chunk, len, s->send_user);
+}
+
 esp_err_t sk_secure_session_begin(sk_secure_session_t *s,
                                   sk_session_send_fn   send,
                                   void                *send_user)
@@ -53,7 +365,9 @@ esp_err_t sk_secure_session_begin(sk_secure_session_t *s,
         return ESP_ERR_INVALID_STATE;
     }
 
-    memset(s, 0, sizeof(*s));
+    pool_start();
+    session_register(s);
+    session_rearm(s);
     s->send      = send;
     s->send_user = send_user;
 
@@ -75,6 +389,59 @@ esp_err_t sk_secure_session_begin(sk_secure_session_t *s,
     return ESP_OK;
 }
 
+// -- Retained state burst ----------------------------------------------------
+//
+// As soon as a session is let in (authenticated and past the passphrase
+// gate) the peer gets the bus's retained events — timer.state, wifi.state,
+// relay.fire.*, ota.fw.state — in one write, so SKAPP can draw its screens
+// without first calling every *.status command. Same line format as the
+// BLE event forwarder, flagged "retained":true; seq tells the peer how it
+// orders against the live events that follow.
+
+typedef struct {
+    char   *buf;
+    size_t  len;
+    size_t  cap;
+} burst_t;
+
+static void burst_add(const sk_event_t *evt, void *user)
+{
+    burst_t *b = user;
+    const char *data = sk_event_json(evt);
+    size_t need = strlen(evt->name) + (data ? strlen(data) : 0) + 64;
+    if (b->cap - b->len < need) {
+        size_t cap = b->cap ? b->cap : 512;
+        while (cap - b->len < need) cap *= 2;
+        char *nb = realloc(b->buf, cap);
+        if (!nb) return;  // send what fits so far
+        b->buf = nb;
+        b->cap = cap;
+    }
+    int n;
+    if (data) {
+        n = snprintf(b->buf + b->len, b->cap - b->len,
+                     "{\"evt\":\"%s\",\"seq\":%lu,\"retained\":true,\"data\":%s}\n",
+                     evt->name, (unsigned long)evt->seq, data);
+    } else {
+        n = snprintf(b->buf + b->len, b->cap - b->len,
+                     "{\"evt\":\"%s\",\"seq\":%lu,\"retained\":true}\n",
+                     evt->name, (unsigned long)evt->seq);
+    }
+    if (n > 0 && (size_t)n < b->cap - b->len) b->len += (size_t)n;
+}
+
+static void send_retained(sk_session_send_fn send, void *user)
+{
+    if (!send) return;
+    burst_t b = { 0 };
+    size_t n = sk_event_bus_for_each_retained(burst_add, &b);
+    if (b.len) {
+        send(b.buf, b.len, user);
+        ESP_LOGI(TAG, "retained burst: %u events, %u bytes", (unsigned)n, (unsigned)b.len);
+    }
+    free(b.buf);
+}
+
 sk_session_feed_t sk_secure_session_feed_line(sk_secure_session_t *s,
                                               const char           *line)
 {
@@ -173,6 +540,10 @@ sk_session_feed_t sk_secure_session_feed_line(sk_secure_session_t *s,
                  (unsigned)left);
     } else {
         ESP_LOGI(TAG, "session authenticated");
+        // Through tx_lock like every other line: a worker's reply or the
+        // log tail must not land inside the burst.
+        if (s->slot) send_retained(session_tx, session_handle(s));
+        else         send_retained(s->send, s->send_user);
     }
     return SK_SESSION_FEED_AUTH_PROGRESSED;
 }
@@ -188,7 +559,18 @@ bool sk_secure_session_timed_out(const sk_secure_session_t *s)
 void sk_secure_session_reset(sk_secure_session_t *s)
 {
     if (!s) return;
-    memset(s, 0, sizeof(*s));
+    // A live log tail or event push writes through this session's
+    // transport; it must not outlive the connection. logs.tail and
+    // events.subscribe captured the session handle.
+    if (s->send) {
+        if (s->slot) {
+            sk_log_tail_stop(session_tx, session_handle(s));
+            sk_event_push_stop(session_tx, session_handle(s));
+        }
+        sk_log_tail_stop(s->send, s->send_user);
+        sk_event_push_stop(s->send, s->send_user);
+    }
+    session_rearm(s);
     s->state = SK_SESSION_FRESH;
 }
 
@@ -222,42 +604,25 @@ static void emit_session_locked(sk_cli_writer_t writer, void *user,
     if (n > 0 && writer) writer(buf, (size_t)n, user);
 }
 
-// Intercepts auth.passphrase.verify before the regular CLI dispatcher sees
+// Answers auth.passphrase.verify before the regular CLI dispatcher sees
 // it: the result has to mutate session state (passphrase_unlocked) which
-// the CLI layer doesn't know about. Inputs are already HMAC-verified.
-// Returns true if the line was handled here (caller skips normal dispatch).
-static bool handle_passphrase_verify(sk_secure_session_t *s,
-                                     const char *body,
+// the CLI layer doesn't know about. Inputs are already HMAC-verified;
+// `plain` is NULL when args.plain is missing.
+static void handle_passphrase_verify(sk_secure_session_t *s, int id,
+                                     const char *plain,
                                      sk_cli_writer_t writer, void *user)
 {
-    cJSON *inner = cJSON_Parse(body);
-    if (!inner) return false;
-
-    cJSON *cmd = cJSON_GetObjectItemCaseSensitive(inner, "cmd");
-    if (!cJSON_IsString(cmd) ||
-        strcmp(cmd->valuestring, "auth.passphrase.verify") != 0) {
-        cJSON_Delete(inner);
-        return false;
-    }
-
-    int id = 0;
-    cJSON *id_node = cJSON_GetObjectItemCaseSensitive(inner, "id");
-    if (cJSON_IsNumber(id_node)) id = (int)id_node->valuedouble;
-
-    cJSON *args      = cJSON_GetObjectItemCaseSensitive(inner, "args");
-    cJSON *plain_node = args ? cJSON_GetObjectItemCaseSensitive(args, "plain") : NULL;
-    if (!cJSON_IsString(plain_node)) {
+    if (!plain) {
         char buf[96];
         int n = snprintf(buf, sizeof(buf),
                          "{\"id\":%d,\"ok\":false,\"err\":\"ERR_MISSING_ARG\"}\n", id);
         if (n > 0 && writer) writer(buf, (size_t)n, user);
-        cJSON_Delete(inner);
-        return true;
+        return;
     }
 
+    bool was_locked = s && !s->passphrase_unlocked;
     uint8_t left = 0;
-    esp_err_t err = sk_passphrase_verify(plain_node->valuestring, &left);
-    cJSON_Delete(inner);
+    esp_err_t err = sk_passphrase_verify(plain, &left);
 
     if (err == ESP_OK) {
         if (s) s->passphrase_unlocked = true;
@@ -268,6 +633,7 @@ static bool handle_passphrase_verify(sk_secure_session_t *s,
         if (n > 0 && writer) writer(buf, (size_t)n, user);
         sk_event_bus_publish("auth.passphrase.unlocked", NULL);
         ESP_LOGI(TAG, "session unlocked via passphrase");
+        if (was_locked) send_retained(writer, user);
     } else if (err == ESP_ERR_INVALID_RESPONSE) {
         // Wrong passphrase. sk_passphrase already incremented the persistent
         // fail counter and (at lockout) published device.factory-reset.
@@ -285,13 +651,99 @@ static bool handle_passphrase_verify(sk_secure_session_t *s,
         int n = snprintf(buf, sizeof(buf),
                          "{\"id\":%d,\"ok\":true,\"data\":{\"unlocked\":true,\"set\":false}}\n", id);
         if (n > 0 && writer) writer(buf, (size_t)n, user);
+        if (was_locked) send_retained(writer, user);
     } else {
         char buf[96];
         int n = snprintf(buf, sizeof(buf),
                          "{\"id\":%d,\"ok\":false,\"err\":\"ERR_INTERNAL\"}\n", id);
         if (n > 0 && writer) writer(buf, (size_t)n, user);
     }
-    return true;
+}
+
+// Budget for a verified body: what sk_cli's own tokenizer accepts
+// (SK_CLI_MAX_TOKENS); anything bigger sk_cli would refuse anyway.
+#define SK_SESSION_BODY_TOKENS  96
+#define SK_SESSION_BODY_INLINE  256    // bodies this short are copied on the stack
+
+// Look at a verified body before it is dispatched. auth.passphrase.verify
+// is answered here, and a locked session refuses every other command.
+// Only `cmd`, `id` and args.plain are needed, so a scratch copy of the
+// body is tokenized in place (sk_json_tok; `body` itself goes on intact)
+// rather than parsed into a cJSON tree on every line. Returns true if the
+// line was answered here; *id gets the request id either way (0 = none).
+static bool session_intercept(sk_secure_session_t *s, const char *body,
+                              sk_cli_writer_t writer, void *user, int *id)
+{
+    *id = 0;
+    size_t len = strlen(body);
+    char   small[SK_SESSION_BODY_INLINE];
+    char  *json = len < sizeof(small) ? small : malloc(len + 1);
+    sk_jtok_t toks[SK_SESSION_BODY_TOKENS];
+    int ntok = -1;
+    if (json && len <= SK_JTOK_MAX_LEN) {
+        memcpy(json, body, len + 1);
+        ntok = sk_json_tok_parse(json, len, toks, SK_SESSION_BODY_TOKENS);
+    }
+    // Unparseable (or no memory for the copy): not the verify command, id 0.
+    const char *cmd = NULL;
+    if (ntok > 0) {
+        double d;
+        if (sk_json_tok_number(json, toks, sk_json_tok_get(json, toks, 0, "id"), &d)) *id = (int)d;
+        cmd = sk_json_tok_str(json, toks, sk_json_tok_get(json, toks, 0, "cmd"));
+    }
+
+    bool answered = true;
+    if (cmd && strcmp(cmd, "auth.passphrase.verify") == 0) {
+        int args = sk_json_tok_get(json, toks, 0, "args");
+        handle_passphrase_verify(s, *id,
+                                 sk_json_tok_str(json, toks, sk_json_tok_get(json, toks, args, "plain")),
+                                 writer, user);
+    } else if (s && !s->passphrase_unlocked) {
+        emit_session_locked(writer, user, *id, sk_passphrase_attempts_left());
+    } else {
+        answered = false;
+    }
+    if (json != small) free(json);
+    return answered;
+}
+
+static void pipeline_submit(sk_secure_session_t *s, const char *body, int id,
+                            sk_cli_writer_t writer, void *user)
+{
+    if (!s || !s->slot || !s_jobs) {
+        sk_cli_dispatch_line_authenticated(body, writer, user);
+        return;
+    }
+
+    portENTER_CRITICAL(&s_pipe_lock);
+    bool busy = s->inflight >= SK_SESSION_INFLIGHT;
+    if (!busy) s->inflight++;
+    portEXIT_CRITICAL(&s_pipe_lock);
+    if (busy) {
+        char buf[128];
+        int n = snprintf(buf, sizeof(buf),
+                         "{\"id\":%d,\"ok\":false,\"err\":\"ERR_BUSY\","
+                         "\"params\":{\"reason\":\"inflight_limit\",\"limit\":%d}}\n",
+                         id, SK_SESSION_INFLIGHT);
+        if (n > 0) writer(buf, (size_t)n, user);
+        return;
+    }
+
+    size_t len = strlen(body);
+    job_t *job = malloc(sizeof(*job) + len + 1);
+    if (job) {
+        job->slot = s->slot;
+        job->gen  = s->gen;
+        job->run  = NULL;
+        memcpy(job->body, body, len + 1);
+        if (xQueueSend(s_jobs, &job, 0) == pdTRUE) return;
+        free(job);
+    }
+    // OOM or queue full: run it here, as before the pipeline.
+    portENTER_CRITICAL(&s_pipe_lock);
+    if (s->inflight) s->inflight--;
+    portEXIT_CRITICAL(&s_pipe_lock);
+    sk_cli_dispatch_line_authenticated(body, writer, user);
 }
 
 void sk_secure_session_dispatch_signed(sk_secure_session_t *s,
@@ -300,6 +752,12 @@ void sk_secure_session_dispatch_signed(sk_secure_session_t *s,
                                        void                *user)
 {
     if (!line || !writer) return;
+    // Every reply on a registered session, inline ones included, goes
+    // through the serialized handle writer.
+    if (s && s->slot) {
+        writer = session_tx;
+        user   = session_handle(s);
+    }
 
     cJSON *env = cJSON_Parse(line);
     if (!env) {
@@ -349,34 +807,12 @@ void sk_secure_session_dispatch_signed(sk_secure_session_t *s,
     // HMAC verified. If the passphrase gate is engaged we admit *only*
     // auth.passphrase.verify; everything else gets ERR_SESSION_LOCKED so
     // SKAPP can show its prompt without exposing other commands' params
-    // to a thief who somehow stole the bond key.
-    bool gate_open = (s == NULL) || s->passphrase_unlocked;
-
-    if (!gate_open) {
-        // Try to handle verify here. If it's a different command, refuse.
-        if (handle_passphrase_verify(s, body, writer, user)) {
-            cJSON_Delete(env);
-            return;
-        }
-        // Pull the inner id (best-effort) so SKAPP can correlate.
-        int id = 0;
-        cJSON *inner = cJSON_Parse(body);
-        if (inner) {
-            cJSON *id_node = cJSON_GetObjectItemCaseSensitive(inner, "id");
-            if (cJSON_IsNumber(id_node)) id = (int)id_node->valuedouble;
-            cJSON_Delete(inner);
-        }
-        emit_session_locked(writer, user, id, sk_passphrase_attempts_left());
-        cJSON_Delete(env);
-        return;
-    }
-
-    // Gate is open — verify command is also welcome here (SKAPP may send
-    // it when the user changes their passphrase mid-session); but normal
-    // dispatch on a no-op verify works too, since auth.passphrase.verify
-    // will be a registered CLI command in step 6. Intercept anyway to
-    // keep gate state consistent.
-    if (handle_passphrase_verify(s, body, writer, user)) {
+    // to a thief who somehow stole the bond key. With the gate open the
+    // verify command is still answered here (SKAPP may send it when the
+    // user changes their passphrase mid-session) to keep gate state
+    // consistent.
+    int id;
+    if (session_intercept(s, body, writer, user, &id)) {
         cJSON_Delete(env);
         return;
     }
@@ -384,7 +820,7 @@ void sk_secure_session_dispatch_signed(sk_secure_session_t *s,
     // Verified — dispatch inner body to sk_cli through the *authenticated*
     // entrypoint so that commands marked `requires_auth` (encrypted store,
     // user scratch area) are allowed to run. Note `body` points into the
-    // cJSON-owned string, so we hand it off before deleting the envelope.
-    sk_cli_dispatch_line_authenticated(body, writer, user);
+    // cJSON-owned string; the pipeline copies it before we delete it.
+    pipeline_submit(s, body, id, writer, user);
     cJSON_Delete(env);
 }
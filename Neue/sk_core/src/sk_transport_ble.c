@@ -16,6 +16,7 @@
 #include "sk_identity.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "esp_log.h"
@@ -55,6 +56,255 @@ static int64_t            s_peer_activity_us = 0;
 
 static void start_advertising(void);
 
+// -- Link tuning ---------------------------------------------------------------
+//
+// Large replies (device.info, api.endpoint.list, userdata.read at ~5.5 KB
+// of base64) went out at whatever the phone picked on connect: typically
+// 1M PHY, 27-byte LL payloads and a 30-50 ms interval, i.e. a handful of
+// MTU-3 notifies per interval. Once the secure session is up we ask for
+// Data Length Extension (251-byte LL payloads) and the 2M PHY — one-off
+// upgrades the peer may refuse, the link keeps working either way.
+//
+// After that the connection parameters follow an activity policy:
+//
+//   bulk         skbt_tx holds a backlog (large reply draining)
+//   interactive  the peer sent a command in the last SK_BLE_INTERACTIVE_US
+//   idle         connected, nothing going on (SKAPP watching the countdown)
+//   low_power    idle while power.state says low_power — multi-day
+//                countdowns spend nearly all their time here
+//
+// Higher rows win. Slave latency on the quiet levels lets our radio skip
+// connection events while we have nothing to send; the phone still gets
+// timer.tick within one interval because latency only applies to the
+// peripheral. Every set stays inside Apple's accessory rules (min >= 15
+// ms, max >= min + 15 ms, timeout 2-6 s, max * (latency + 1) <= 2 s and
+// timeout > 3 * max * (latency + 1)), otherwise iOS rejects the update.
+
+#define SK_BLE_DLE_TX_OCTETS  251
+#define SK_BLE_DLE_TX_TIME    2120     // us: 251 B on the 1M PHY
+#define SK_BLE_INTERACTIVE_US (20LL * 1000 * 1000)
+
+typedef enum {
+    LINK_ACT_DEFAULT = 0,    // not tuned yet: whatever the phone picked
+    LINK_ACT_BULK,
+    LINK_ACT_INTERACTIVE,
+    LINK_ACT_IDLE,
+    LINK_ACT_LOW_POWER,
+} link_act_t;
+
+// Interval in 1.25 ms units, supervision timeout in 10 ms units.
+static const struct {
+    const char                *name;
+    struct ble_gap_upd_params  p;
+} s_link_policy[] = {
+    [LINK_ACT_DEFAULT]     = { "default",     { 0 } },
+    [LINK_ACT_BULK]        = { "bulk",        { .itvl_min = 12,  .itvl_max = 24,   // 15-30 ms
+                                                .latency  = 0,   .supervision_timeout = 400 } },
+    [LINK_ACT_INTERACTIVE] = { "interactive", { .itvl_min = 24,  .itvl_max = 40,   // 30-50 ms
+                                                .latency  = 0,   .supervision_timeout = 400 } },
+    [LINK_ACT_IDLE]        = { "idle",        { .itvl_min = 48,  .itvl_max = 72,   // 60-90 ms
+                                                .latency  = 2,   .supervision_timeout = 400 } },
+    [LINK_ACT_LOW_POWER]   = { "low_power",   { .itvl_min = 240, .itvl_max = 264,  // 300-330 ms
+                                                .latency  = 4,   .supervision_timeout = 600 } },
+};
+
+// power.state as sk_button reads it; nothing published yet = active.
+typedef enum { POWER_ACTIVE = 0, POWER_SCREEN_OFF, POWER_LOW } power_level_t;
+static const char *const s_power_names[] = { "active", "screen_off", "low_power" };
+static volatile power_level_t s_power = POWER_ACTIVE;
+
+typedef struct {
+    uint16_t   itvl;         // 1.25 ms units, as the controller reports it
+    uint16_t   latency;
+    uint16_t   timeout;      // 10 ms units
+    uint8_t    tx_phy;
+    uint8_t    rx_phy;
+    uint16_t   dle_tx;       // LL payload octets
+    uint16_t   dle_rx;
+    bool       tuned;        // negotiate() ran on this link
+    bool       bulk;         // skbt_tx reports a backlog
+    link_act_t act;          // level last requested
+    int64_t    last_cmd_us;
+    int        upd_rc;       // last update request / CONN_UPDATE status
+} link_t;
+
+static link_t             s_link;
+static portMUX_TYPE       s_link_lock    = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t s_link_decay_t = NULL;   // interactive → idle
+
+static void link_read_params(uint16_t conn)
+{
+    struct ble_gap_conn_desc d;
+    if (ble_gap_conn_find(conn, &d) != 0) return;
+    s_link.itvl    = d.conn_itvl;
+    s_link.latency = d.conn_latency;
+    s_link.timeout = d.supervision_timeout;
+}
+
+static void link_reset(uint16_t conn)
+{
+    portENTER_CRITICAL(&s_link_lock);
+    s_link = (link_t){
+        .tx_phy = BLE_GAP_LE_PHY_1M, .rx_phy = BLE_GAP_LE_PHY_1M,
+        .dle_tx = 27, .dle_rx = 27,
+        .last_cmd_us = esp_timer_get_time(),
+    };
+    portEXIT_CRITICAL(&s_link_lock);
+    if (conn != SK_BLE_NO_CONN) link_read_params(conn);
+}
+
+// Caller holds s_link_lock.
+static link_act_t link_pick(int64_t now)
+{
+    if (s_link.bulk)                                     return LINK_ACT_BULK;
+    if (now - s_link.last_cmd_us < SK_BLE_INTERACTIVE_US) return LINK_ACT_INTERACTIVE;
+    if (s_power == POWER_LOW)                            return LINK_ACT_LOW_POWER;
+    return LINK_ACT_IDLE;
+}
+
+// Re-evaluate the policy and request new parameters if the level moved.
+// Called from skbt_tx, the NimBLE host task (commands), the decay timer
+// and the power.state subscriber; the decision is made under the lock,
+// the request itself outside it.
+static void link_apply(void)
+{
+    uint16_t conn = s_conn_handle;
+    if (conn == SK_BLE_NO_CONN) return;
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_link_lock);
+    link_act_t next = s_link.tuned ? link_pick(now) : LINK_ACT_DEFAULT;
+    bool change = next != LINK_ACT_DEFAULT && next != s_link.act;
+    if (change) s_link.act = next;
+    portEXIT_CRITICAL(&s_link_lock);
+    if (!change) return;
+    int rc = ble_gap_update_params(conn, &s_link_policy[next].p);
+    s_link.upd_rc = rc;
+    ESP_LOGI(TAG, "conn interval → %s (rc=%d)", s_link_policy[next].name, rc);
+}
+
+static void link_decay_cb(void *arg)
+{
+    (void)arg;
+    portENTER_CRITICAL(&s_link_lock);
+    int64_t left = s_link.last_cmd_us + SK_BLE_INTERACTIVE_US - esp_timer_get_time();
+    portEXIT_CRITICAL(&s_link_lock);
+    if (left > 0) {
+        esp_timer_start_once(s_link_decay_t, left);
+        return;
+    }
+    link_apply();
+}
+
+void skbt_link_negotiate(uint16_t conn)
+{
+    if (conn == SK_BLE_NO_CONN || s_link.tuned) return;
+    int rc = ble_gap_set_data_len(conn, SK_BLE_DLE_TX_OCTETS, SK_BLE_DLE_TX_TIME);
+    if (rc != 0) ESP_LOGW(TAG, "DLE request rc=%d", rc);
+    rc = ble_gap_set_prefered_le_phy(conn, BLE_GAP_LE_PHY_2M_MASK,
+                                     BLE_GAP_LE_PHY_2M_MASK,
+                                     BLE_GAP_LE_PHY_CODED_ANY);
+    if (rc != 0) ESP_LOGW(TAG, "2M PHY request rc=%d", rc);
+    s_link.tuned = true;
+    skbt_link_note_cmd();
+}
+
+void skbt_link_note_cmd(void)
+{
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_link_lock);
+    s_link.last_cmd_us = now;
+    portEXIT_CRITICAL(&s_link_lock);
+    if (s_link.act != LINK_ACT_INTERACTIVE && s_link.act != LINK_ACT_BULK) link_apply();
+    if (s_link_decay_t && !esp_timer_is_active(s_link_decay_t)) {
+        esp_timer_start_once(s_link_decay_t, SK_BLE_INTERACTIVE_US);
+    }
+}
+
+void skbt_link_set_bulk(bool bulk)
+{
+    if (s_link.bulk == bulk) return;
+    s_link.bulk = bulk;
+    link_apply();
+}
+
+bool skbt_link_is_bulk(void)
+{
+    return s_link.bulk;
+}
+
+// -- Advertising policy --------------------------------------------------------
+//
+// Advertising used to run at 30-60 ms for as long as the radio was up —
+// with a bond that is forever. Apple's guidance (and what iOS scans for):
+// advertise fast for the first 30 s so a phone that is actively looking
+// connects at once, then back off. Every fresh start (boot, disconnect,
+// pairing window opening, WiFi hand-back) opens a new fast window; after
+// it the interval depends on power.state. A bonded SKAPP reconnecting
+// from the background scans with a long window anyway, so ~1.1 s costs
+// it a second or two and saves the bulk of our idle radio current.
+
+#define SK_BLE_ADV_FAST_US  (30LL * 1000 * 1000)
+
+typedef enum { ADV_FAST = 0, ADV_NORMAL, ADV_LOW } adv_tier_t;
+
+// 0.625 ms units; the slow values are from Apple's recommended list.
+static const struct {
+    const char *name;
+    uint16_t    itvl_min, itvl_max;
+} s_adv_policy[] = {
+    [ADV_FAST]   = { "fast",   BLE_GAP_ADV_FAST_INTERVAL1_MIN,
+                               BLE_GAP_ADV_FAST_INTERVAL1_MAX },  // 30-60 ms
+    [ADV_NORMAL] = { "normal", 338, 510 },                        // 211.25-318.75 ms
+    [ADV_LOW]    = { "low",    1636, 2056 },                      // 1022.5-1285 ms
+};
+
+static adv_tier_t         s_adv_tier       = ADV_FAST;
+static int64_t            s_adv_fast_until = 0;
+static esp_timer_handle_t s_adv_tier_t     = NULL;   // ends the fast window
+
+static adv_tier_t adv_pick(void)
+{
+    if (esp_timer_get_time() < s_adv_fast_until) return ADV_FAST;
+    return s_power == POWER_LOW ? ADV_LOW : ADV_NORMAL;
+}
+
+// Next start_advertising() begins a new fast window.
+static void adv_fast_window(void)
+{
+    s_adv_fast_until = esp_timer_get_time() + SK_BLE_ADV_FAST_US;
+}
+
+// Restart advertising if the tier it runs at is no longer the right one.
+static void adv_refresh_tier(void)
+{
+    if (!s_radio_active || s_conn_handle != SK_BLE_NO_CONN) return;
+    if (adv_pick() == s_adv_tier) return;
+    ble_gap_adv_stop();
+    start_advertising();
+}
+
+static void adv_tier_cb(void *arg)
+{
+    (void)arg;
+    adv_refresh_tier();
+}
+
+// power.state subscriber: same payload parsing as sk_button.
+static void on_power_state(const sk_event_t *evt, void *user)
+{
+    (void)user;
+    if (!evt || !evt->payload_json) return;
+    power_level_t next;
+    if      (strstr(evt->payload_json, "\"low_power\""))  next = POWER_LOW;
+    else if (strstr(evt->payload_json, "\"screen_off\"")) next = POWER_SCREEN_OFF;
+    else                                                  next = POWER_ACTIVE;
+    if (next == s_power) return;
+    ESP_LOGI(TAG, "power.state %s → %s", s_power_names[s_power], s_power_names[next]);
+    s_power = next;
+    link_apply();
+    adv_refresh_tier();
+}
+
 static int gap_event_cb(struct ble_gap_event *event, void *arg)
 {
     switch (event->type) {
@@ -64,6 +314,7 @@ static int gap_event_cb(struct ble_gap_event *event, void *arg)
             if (s_idle_timer) esp_timer_stop(s_idle_timer);
             s_conn_handle = event->connect.conn_handle;
             s_peer_activity_us = esp_timer_get_time();
+            link_reset(s_conn_handle);
             if (s_peer_check_t && !esp_timer_is_active(s_peer_check_t)) {
                 esp_timer_start_periodic(s_peer_check_t, SK_BLE_PEER_CHECK_US);
             }
@@ -72,6 +323,7 @@ static int gap_event_cb(struct ble_gap_event *event, void *arg)
                                  "{\"state\":\"connected\"}");
         } else {
             ESP_LOGW(TAG, "connect failed status=%d", event->connect.status);
+            adv_fast_window();
             start_advertising();
         }
         break;
@@ -79,12 +331,14 @@ static int gap_event_cb(struct ble_gap_event *event, void *arg)
         ESP_LOGI(TAG, "disconnected conn=%d reason=0x%02X",
                  event->disconnect.conn.conn_handle, event->disconnect.reason);
         s_conn_handle = SK_BLE_NO_CONN;
+        link_reset(SK_BLE_NO_CONN);
         if (s_peer_check_t && esp_timer_is_active(s_peer_check_t)) {
             esp_timer_stop(s_peer_check_t);
         }
         skbt_gatt_on_disconnect(event->disconnect.conn.conn_handle);
         // Resume advertising so the peer (or owner) can quickly reconnect.
         // start_advertising() will publish the "advertising" state itself.
+        adv_fast_window();
         start_advertising();
         if (s_idle_timer) esp_timer_start_once(s_idle_timer, SK_BLE_IDLE_TIMEOUT_US);
         break;
@@ -104,7 +358,32 @@ static int gap_event_cb(struct ble_gap_event *event, void *arg)
     case BLE_GAP_EVENT_MTU:
         ESP_LOGI(TAG, "MTU update conn=%d mtu=%d",
                  event->mtu.conn_handle, event->mtu.value);
+        skbt_gatt_set_mtu(event->mtu.value);
+        break;
+    case BLE_GAP_EVENT_CONN_UPDATE:
+        // Our request answered, or the phone changed the parameters itself.
+        s_link.upd_rc = event->conn_update.status;
+        if (event->conn_update.status == 0) link_read_params(event->conn_update.conn_handle);
+        ESP_LOGI(TAG, "conn params status=%d itvl=%u latency=%u timeout=%u",
+                 event->conn_update.status, (unsigned)s_link.itvl,
+                 (unsigned)s_link.latency, (unsigned)s_link.timeout);
         break;
+    case BLE_GAP_EVENT_PHY_UPDATE_COMPLETE:
+        if (event->phy_updated.status == 0) {
+            s_link.tx_phy = event->phy_updated.tx_phy;
+            s_link.rx_phy = event->phy_updated.rx_phy;
+        }
+        ESP_LOGI(TAG, "PHY update status=%d tx=%u rx=%u", event->phy_updated.status,
+                 (unsigned)event->phy_updated.tx_phy, (unsigned)event->phy_updated.rx_phy);
+        break;
+#ifdef BLE_GAP_EVENT_DATA_LEN_CHG
+    case BLE_GAP_EVENT_DATA_LEN_CHG:
+        s_link.dle_tx = event->data_len_chg.max_tx_octets;
+        s_link.dle_rx = event->data_len_chg.max_rx_octets;
+        ESP_LOGI(TAG, "data length tx=%u rx=%u",
+                 (unsigned)s_link.dle_tx, (unsigned)s_link.dle_rx);
+        break;
+#endif
     case BLE_GAP_EVENT_ENC_CHANGE:
         ESP_LOGI(TAG, "encryption change status=%d", event->enc_change.status);
         break;
@@ -141,11 +420,12 @@ static void start_advertising(void)
     int rc = ble_gap_adv_set_fields(&fields);
     if (rc != 0) { ESP_LOGE(TAG, "adv_set_fields rc=%d", rc); return; }
 
+    adv_tier_t tier = adv_pick();
     struct ble_gap_adv_params adv = {
         .conn_mode = BLE_GAP_CONN_MODE_UND,
         .disc_mode = BLE_GAP_DISC_MODE_GEN,
-        .itvl_min  = BLE_GAP_ADV_FAST_INTERVAL1_MIN,
-        .itvl_max  = BLE_GAP_ADV_FAST_INTERVAL1_MAX,
+        .itvl_min  = s_adv_policy[tier].itvl_min,
+        .itvl_max  = s_adv_policy[tier].itvl_max,
     };
     rc = ble_gap_adv_start(s_own_addr_type, NULL, BLE_HS_FOREVER, &adv, gap_event_cb, NULL);
     if (rc != 0 && rc != BLE_HS_EALREADY) {
@@ -153,8 +433,15 @@ static void start_advertising(void)
         return;
     }
     s_radio_active = true;
-    ESP_LOGI(TAG, "advertising as \"%s\" (rc=%d, pairable=%d)",
-             sk_identity_get(), rc, (int)pairable);
+    s_adv_tier     = tier;
+    if (tier == ADV_FAST && s_adv_tier_t) {
+        // Drop to the slower tier when the fast window runs out.
+        esp_timer_stop(s_adv_tier_t);
+        int64_t left = s_adv_fast_until - esp_timer_get_time();
+        esp_timer_start_once(s_adv_tier_t, left > 0 ? left : 1);
+    }
+    ESP_LOGI(TAG, "advertising as \"%s\" (rc=%d, pairable=%d, %s)",
+             sk_identity_get(), rc, (int)pairable, s_adv_policy[tier].name);
     // Publish only when there's no peer connected yet — once a peer
     // connects we'll (re-)publish "connected" from the GAP event handler.
     if (s_conn_handle == SK_BLE_NO_CONN) {
@@ -203,6 +490,7 @@ esp_err_t sk_transport_ble_start(void)
 {
     if (s_radio_active) return ESP_OK;
     if (!s_initialized) return ESP_ERR_INVALID_STATE;
+    adv_fast_window();
     start_advertising();
     return ESP_OK;
 }
@@ -229,6 +517,7 @@ static void on_sync(void)
     int rc = ble_hs_id_infer_auto(0, &s_own_addr_type);
     if (rc != 0) { ESP_LOGE(TAG, "infer_auto rc=%d", rc); return; }
     ble_svc_gap_device_name_set(sk_identity_get());
+    adv_fast_window();
     start_advertising();
 }
 
@@ -261,6 +550,7 @@ static void on_resume_after_wifi(const sk_event_t *evt, void *user)
     (void)evt; (void)user;
     if (s_radio_active) return;     // zaten açık
     ESP_LOGI(TAG, "WiFi GOT_IP — BLE advertising'i geri açıyorum");
+    adv_fast_window();
     start_advertising();
 }
 
@@ -296,7 +586,9 @@ static void pairing_event_handler(const sk_event_t *evt, void *user)
     }
 
     // Otherwise refresh advertising so manufacturer-data flags
-    // (pairable / bonded) match the new pairing state.
+    // (pairable / bonded) match the new pairing state. An opening window
+    // means the owner is standing there with the phone: advertise fast.
+    if (sk_auth_pairing_state() == SK_AUTH_PAIRING_OPEN) adv_fast_window();
     if (s_radio_active) {
         ble_gap_adv_stop();
         start_advertising();
@@ -342,22 +634,49 @@ static void any_event_handler(const sk_event_t *evt, void *user)
     // care about the ECDH reply, which goes through a different path.
     if (!skbt_gatt_is_authenticated()) return;
 
-    // Build a compact NDJSON line.
-    char buf[512];
+    // A peer that ran events.subscribe chose its topics; the push sender
+    // delivers those, so forwarding everything here would send them twice.
+    if (skbt_gatt_event_push_active()) return;
+
+    // Build a compact NDJSON line, sized exactly: the payload object knows
+    // its length, so large payloads (pairing/OTA state) are forwarded whole
+    // instead of being cut at a fixed buffer. Typical events fit the stack
+    // buffer; only the rare big one touches the heap.
+    // Typed events (timer.tick, wifi.state, ...) are rendered here, once —
+    // the rendered JSON is cached on the payload for any other transport.
+    const char *data = sk_event_json(evt);
+    size_t name_len = strlen(evt->name);
+    size_t data_len = evt->payload ? sk_event_payload_len(evt->payload)
+                    : (data ? strlen(data) : 0);
+    size_t cap = name_len + data_len + 48;  // {"evt":"","seq":4294967295,"data":}\n
+
+    // Replies first: while the TX ring is congested the event waits here,
+    // on this task, and is dropped if the link stays busy — or at once if
+    // the line is bigger than the ring's event share. The bus queue
+    // behind us then sheds its oldest events.
+    if (!skbt_gatt_tx_wait_room(cap, 1000)) {
+        ESP_LOGD(TAG, "tx congested — %s dropped", evt->name);
+        return;
+    }
+    char   stack_buf[256];
+    char  *buf = (cap <= sizeof(stack_buf)) ? stack_buf : malloc(cap);
+    if (!buf) return;
+
     int n;
     // evt->seq is uint32_t — on RISC-V that's `unsigned long`, so %u
     // mismatches under -Werror=format=. Cast to unsigned long + %lu
     // is portable across all ESP32 targets.
-    if (evt->payload_json) {
-        n = snprintf(buf, sizeof(buf),
+    if (data) {
+        n = snprintf(buf, cap,
                      "{\"evt\":\"%s\",\"seq\":%lu,\"data\":%s}\n",
-                     evt->name, (unsigned long)evt->seq, evt->payload_json);
+                     evt->name, (unsigned long)evt->seq, data);
     } else {
-        n = snprintf(buf, sizeof(buf),
+        n = snprintf(buf, cap,
                      "{\"evt\":\"%s\",\"seq\":%lu}\n",
                      evt->name, (unsigned long)evt->seq);
     }
-    if (n > 0) skbt_gatt_notify_event(buf, (size_t)n);
+    if (n > 0 && (size_t)n < cap) skbt_gatt_notify_event(buf, (size_t)n);
+    if (buf != stack_buf) free(buf);
 }
 
 // CLI: ble.status — report current advertising/connection state. Lets
@@ -367,10 +686,36 @@ static sk_err_t cmd_ble_status(sk_cli_ctx_t *ctx)
 {
     const char *radio = s_radio_active ? "advertising" : "off";
     const char *peer  = (s_conn_handle != SK_BLE_NO_CONN) ? "connected" : "none";
-    char buf[160];
+    skbt_tx_stats_t tx;
+    skbt_gatt_tx_stats(&tx);
+    char link[224] = "null";
+    if (s_conn_handle != SK_BLE_NO_CONN) {
+        static const char *const phy[] = { "?", "1M", "2M", "coded" };
+        link_t l = s_link;
+        snprintf(link, sizeof(link),
+                 "{\"mtu\":%u,\"itvl_us\":%lu,\"latency\":%u,\"timeout_ms\":%lu,"
+                 "\"phy_tx\":\"%s\",\"phy_rx\":\"%s\",\"dle_tx\":%u,\"dle_rx\":%u,"
+                 "\"mode\":\"%s\",\"update_rc\":%d}",
+                 (unsigned)skbt_gatt_mtu(), (unsigned long)l.itvl * 1250,
+                 (unsigned)l.latency, (unsigned long)l.timeout * 10,
+                 phy[l.tx_phy < 4 ? l.tx_phy : 0], phy[l.rx_phy < 4 ? l.rx_phy : 0],
+                 (unsigned)l.dle_tx, (unsigned)l.dle_rx,
+                 s_link_policy[l.act].name, l.upd_rc);
+    }
+    char buf[640];
     snprintf(buf, sizeof(buf),
-             "{\"name\":\"%s\",\"radio\":\"%s\",\"peer\":\"%s\",\"conn_handle\":%d}",
-             sk_identity_get(), radio, peer, (int)s_conn_handle);
+             "{\"name\":\"%s\",\"radio\":\"%s\",\"peer\":\"%s\",\"conn_handle\":%d,"
+             "\"power\":\"%s\",\"adv\":{\"tier\":\"%s\",\"itvl_min_us\":%lu,"
+             "\"itvl_max_us\":%lu},\"link\":%s,"
+             "\"tx\":{\"queued\":%u,\"hwm\":%u,\"pdus\":%lu,"
+             "\"enomem\":%lu,\"dropped_bytes\":%lu}}",
+             sk_identity_get(), radio, peer, (int)s_conn_handle,
+             s_power_names[s_power], s_adv_policy[s_adv_tier].name,
+             (unsigned long)s_adv_policy[s_adv_tier].itvl_min * 625,
+             (unsigned long)s_adv_policy[s_adv_tier].itvl_max * 625, link,
+             (unsigned)tx.queued, (unsigned)tx.ring_hwm,
+             (unsigned long)tx.pdus, (unsigned long)tx.enomem,
+             (unsigned long)tx.dropped_bytes);
     sk_cli_ok(ctx, buf);
     return SK_OK;
 }
@@ -383,6 +728,17 @@ static const sk_cli_command_t s_cli_status = {
         "Returns radio state and the currently connected peer (the SKAPP\n"
         "phone). Fields: state (idle | advertising | connected), peer\n"
         "identifier when connected, MTU, signal strength.\n"
+        "link (null when no peer): ATT MTU, connection interval / latency /\n"
+        "supervision timeout, PHY per direction, LL payload octets (DLE) and\n"
+        "mode — default until the session authenticates, then the activity\n"
+        "level: bulk (large reply draining), interactive (command in the\n"
+        "last 20 s), idle, or low_power (idle and power.state low_power).\n"
+        "power: last power.state seen. adv: advertising tier (fast for 30 s\n"
+        "after each start, then normal, or low under low_power) and interval.\n"
+        "update_rc is the last interval request's status, non-zero = refused.\n"
+        "tx: notify ring fill (queued / hwm bytes), PDUs sent, ENOMEM\n"
+        "retries (NimBLE out of TX buffers; the sender backs off 5-40 ms)\n"
+        "and bytes dropped because the ring stayed full.\n"
         "\n"
         "Example:\n"
         "  ble status",
@@ -432,7 +788,25 @@ esp_err_t sk_transport_ble_init(const sk_transport_ble_cfg_t *cfg)
                            on_terminate_before_wifi, NULL, &sub);
     sk_event_bus_subscribe("ble.resume.after-wifi",
                            on_resume_after_wifi, NULL, &sub);
-    sk_event_bus_subscribe("*",               any_event_handler,     NULL, &sub);
+    // Same power.state sk_button throttles its poll on: picks the idle
+    // connection level and the advertising tier.
+    sk_event_bus_subscribe("power.state", on_power_state, NULL, &sub);
+    // The forwarder waits for TX ring room (skbt_gatt_tx_wait_room) for up
+    // to a second when the peer stops draining notifies. Give it its own
+    // task + queue so publishers (timer engine, button ISR task) never wait
+    // on the radio; a stalled link loses the oldest events, not the newest.
+    // Coalesced topics (timer.tick) bypass the queue: the peer gets the
+    // newest value at most once a second, never a backlog of stale ticks.
+    const sk_event_sub_opts_t fwd_opts = {
+        .delivery      = SK_EVT_DELIVER_QUEUE,
+        .drop_policy   = SK_EVT_DROP_OLDEST,
+        .queue_depth   = 24,
+        .task_stack    = 4096,
+        .task_priority = 4,
+        .task_name     = "sk_ble_evt",
+        .coalesce_ms   = 1000,
+    };
+    sk_event_bus_subscribe_ex("*", any_event_handler, NULL, &fwd_opts, &sub);
 
     // Idle-after-disconnect timer (created here, started on disconnect).
     const esp_timer_create_args_t idle_args = {
@@ -450,6 +824,19 @@ esp_err_t sk_transport_ble_init(const sk_transport_ble_cfg_t *cfg)
     };
     esp_timer_create(&peer_check_args, &s_peer_check_t);
 
+    // Activity policy timers: interactive → idle after the last command,
+    // end of the fast advertising window.
+    const esp_timer_create_args_t decay_args = {
+        .callback = link_decay_cb,
+        .name     = "sk_ble_link",
+    };
+    esp_timer_create(&decay_args, &s_link_decay_t);
+    const esp_timer_create_args_t adv_tier_args = {
+        .callback = adv_tier_cb,
+        .name     = "sk_ble_adv",
+    };
+    esp_timer_create(&adv_tier_args, &s_adv_tier_t);
+
     nimble_port_freertos_init(host_task);
 
     sk_cli_register(&s_cli_status);
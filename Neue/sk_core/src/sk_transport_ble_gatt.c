@@ -14,7 +14,9 @@
 #include <string.h>
 
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "freertos/task.h"
 #include "host/ble_hs.h"
 #include "host/ble_uuid.h"
@@ -69,62 +71,293 @@ static bool                  s_pairing_hint_sent   = false;
 // on '\n' as before.
 static uint16_t s_att_mtu = 23;  // default ATT_MTU until negotiation
 
+// -- TX ring + sender task ---------------------------------------------------
+//
+// ble_writer used to call ble_gatts_notify_custom itself and, on
+// BLE_HS_ENOMEM, retry the chunk with vTaskDelay(10) up to 60 times — up
+// to 600 ms per chunk on whatever task was writing: a CLI worker, the
+// event forwarder, or the NimBLE host task during pairing. Under WiFi/BLE
+// coexistence that turned radio congestion straight into command latency.
+//
+// Writers now only copy into a byte ring; the skbt_tx task cuts it into
+// (ATT_MTU - 3) PDUs and hands them to NimBLE back to back. NimBLE gives
+// no "TX buffer freed" signal we can wait on — BLE_GAP_EVENT_NOTIFY_TX
+// for a notification is raised synchronously inside
+// ble_gatts_notify_custom with that same call's rc — so BLE_HS_ENOMEM
+// (mbuf pool / controller queue dry) is the only backpressure there is.
+// On ENOMEM the sender polls: it retries the same PDU after
+// SKBT_TX_BACKOFF_MIN_MS, doubling up to SKBT_TX_BACKOFF_MAX_MS (about one
+// idle connection interval) while it keeps failing, and back to full speed
+// on the first success. Writers waking it in between don't cut the
+// backoff short. Only the sender waits while the radio is congested.
+//
+// Backpressure — a writer whose bytes don't fit waits for the task to
+// free room, at most SKBT_TX_WAIT_MS in total, then drops the rest and
+// counts it (ble.status "tx"). The event forwarder asks for room first
+// (skbt_gatt_tx_wait_room) and keeps SKBT_TX_RESERVE free for replies.
+#define SKBT_TX_RING      4096
+#define SKBT_TX_BACKOFF_MIN_MS  5
+#define SKBT_TX_BACKOFF_MAX_MS  40
+#define SKBT_TX_WAIT_MS   1000
+#define SKBT_TX_RESERVE   1024
+#define SKBT_TX_STACK     4096
+// A backlog this deep means a bulk reply is on its way out: skbt_tx asks
+// for the bulk connection level (skbt_link_set_bulk) and leaves it
+// SKBT_BULK_IDLE_MS after the last backlog.
+#define SKBT_BULK_BYTES   1024
+#define SKBT_BULK_IDLE_MS 2000
+#define SKBT_TX_PRIO      5
+
+static char              s_tx_ring[SKBT_TX_RING];
+static size_t            s_tx_head;           // oldest unsent byte
+static size_t            s_tx_len;
+static uint32_t          s_tx_gen;            // bumped on (dis)connect
+static SemaphoreHandle_t s_tx_mtx;
+static SemaphoreHandle_t s_tx_room;           // given whenever bytes leave the ring
+static TaskHandle_t      s_tx_task;
+static skbt_tx_stats_t   s_tx_stats;
+
+static void ble_writer(const char *chunk, size_t len, void *user);
+
+uint16_t skbt_gatt_mtu(void)
+{
+    return s_att_mtu;
+}
+
 void skbt_gatt_set_mtu(uint16_t mtu)
 {
     if (mtu < 23) mtu = 23;
     s_att_mtu = mtu;
+    // CLI responses are coalesced into whole notify payloads. Authenticated
+    // replies leave through the session's handle writer, not ble_writer.
+    sk_secure_session_set_segment(&s_session, (size_t)(mtu - 3));
+}
+
+// Drop everything queued; blocked writers wake and see the new state.
+static void tx_reset(void)
+{
+    if (!s_tx_mtx) return;
+    xSemaphoreTake(s_tx_mtx, portMAX_DELAY);
+    s_tx_head    = 0;
+    s_tx_len     = 0;
+    s_tx_gen++;
+    xSemaphoreGive(s_tx_mtx);
+    xSemaphoreGive(s_tx_room);
+}
+
+// Copy up to `len` bytes in; returns how many fit.
+static size_t tx_put(const char *src, size_t len, uint32_t gen)
+{
+    xSemaphoreTake(s_tx_mtx, portMAX_DELAY);
+    size_t n = 0;
+    if (gen == s_tx_gen) {
+        n = SKBT_TX_RING - s_tx_len;
+        if (n > len) n = len;
+        size_t tail  = (s_tx_head + s_tx_len) % SKBT_TX_RING;
+        size_t first = SKBT_TX_RING - tail;
+        if (first > n) first = n;
+        memcpy(s_tx_ring + tail, src, first);
+        memcpy(s_tx_ring, src + first, n - first);
+        s_tx_len += n;
+        if (s_tx_len > s_tx_stats.ring_hwm) s_tx_stats.ring_hwm = (uint16_t)s_tx_len;
+    }
+    xSemaphoreGive(s_tx_mtx);
+    return n;
 }
 
 static void ble_writer(const char *chunk, size_t len, void *user)
 {
     (void)user;
     if (s_conn_handle == 0xFFFF || s_event_tx_val_handle == 0 || !chunk || !len) return;
+    if (!s_tx_task) return;
 
-    // ATT_MTU minus 3 bytes of notify header is the maximum payload per
-    // PDU. NimBLE will return BLE_HS_EMSGSIZE if we hand it more than
-    // that in a single call.
-    const size_t max_payload = (s_att_mtu > 3) ? (size_t)(s_att_mtu - 3) : 20;
-
-    size_t off = 0;
+    uint32_t   gen      = s_tx_gen;
+    TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(SKBT_TX_WAIT_MS);
+    size_t     off      = 0;
     while (off < len) {
-        size_t take = len - off;
-        if (take > max_payload) take = max_payload;
-
-        // Flow control. Under WiFi/BLE coexistence a wifi.scan hogs the
-        // radio for ~1.5 s, and a large reply is many notify PDUs back to
-        // back; either way the controller's TX path can briefly run dry and
-        // ble_gatts_notify_custom returns BLE_HS_ENOMEM (or the mbuf pool is
-        // momentarily empty). Bailing on the first ENOMEM truncated the
-        // reply, so the peer's NDJSON line never ended in '\n' and the
-        // request timed out — the peer cannot "retry" a line it never saw
-        // the end of. Retry the same chunk with a short yield so the
-        // controller can drain, up to ~600 ms before giving up.
-        // ble_gatts_notify_custom consumes the mbuf on every outcome (see
-        // ble_gatt.h), so each attempt allocates a fresh one and we never
-        // free it ourselves (doing so would double-free).
-        int rc = BLE_HS_ENOMEM;
-        for (int attempt = 0; attempt < 60; attempt++) {
-            struct os_mbuf *om = ble_hs_mbuf_from_flat(chunk + off, take);
-            if (!om) {
-                vTaskDelay(pdMS_TO_TICKS(10));     // mbuf pool empty — wait, retry
+        size_t n = tx_put(chunk + off, len - off, gen);
+        off += n;
+        if (n) xTaskNotifyGive(s_tx_task);
+        if (off == len) break;
+        // Ring full: wait for the sender to make room.
+        TickType_t now = xTaskGetTickCount();
+        if (gen != s_tx_gen || (int32_t)(deadline - now) <= 0 ||
+            xSemaphoreTake(s_tx_room, deadline - now) != pdTRUE) {
+            break;
+        }
+    }
+    if (off < len && gen == s_tx_gen) {
+        s_tx_stats.dropped_bytes += (uint32_t)(len - off);
+        ESP_LOGW(TAG, "tx ring full — %u of %u bytes dropped",
+                 (unsigned)(len - off), (unsigned)len);
+    }
+}
+
+static void tx_task(void *arg)
+{
+    (void)arg;
+    static char pdu[BLE_ATT_MTU_MAX];
+    TickType_t wait      = portMAX_DELAY;
+    uint32_t   backoff   = 0;      // ms; non-zero while NimBLE reports ENOMEM
+    TickType_t retry_at  = 0;
+    int64_t    bulk_seen = 0;      // last time the ring held a bulk backlog
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, wait);
+        wait = portMAX_DELAY;
+        if (backoff) {
+            TickType_t now = xTaskGetTickCount();
+            if ((int32_t)(retry_at - now) > 0) {
+                wait = retry_at - now;      // woken by a writer: keep backing off
                 continue;
             }
-            rc = ble_gatts_notify_custom(s_conn_handle, s_event_tx_val_handle, om);
-            if (rc == 0 || rc != BLE_HS_ENOMEM) break;
-            vTaskDelay(pdMS_TO_TICKS(10));         // tx buffers full — drain, retry
         }
-        if (rc != 0) {
-            ESP_LOGW(TAG, "notify rc=%d after retries (chunk %zu/%zu)",
-                     rc, off + take, len);
-            return;
+
+        for (;;) {
+            const size_t max_payload = (s_att_mtu > 3) ? (size_t)(s_att_mtu - 3) : 20;
+            xSemaphoreTake(s_tx_mtx, portMAX_DELAY);
+            if (s_tx_len == 0 || s_conn_handle == 0xFFFF) {
+                xSemaphoreGive(s_tx_mtx);
+                backoff = 0;
+                break;
+            }
+            bool backlog = s_tx_len >= SKBT_BULK_BYTES;
+            size_t take  = s_tx_len < max_payload ? s_tx_len : max_payload;
+            if (take > sizeof(pdu)) take = sizeof(pdu);
+            size_t first = SKBT_TX_RING - s_tx_head;
+            if (first > take) first = take;
+            memcpy(pdu, s_tx_ring + s_tx_head, first);
+            memcpy(pdu + first, s_tx_ring, take - first);
+            uint32_t gen = s_tx_gen;
+            xSemaphoreGive(s_tx_mtx);
+
+            if (backlog) {
+                bulk_seen = esp_timer_get_time();
+                if (!skbt_link_is_bulk()) skbt_link_set_bulk(true);
+            }
+
+            // ble_gatts_notify_custom consumes the mbuf on every outcome
+            // (see ble_gatt.h); never free it here.
+            int rc = BLE_HS_ENOMEM;
+            struct os_mbuf *om = ble_hs_mbuf_from_flat(pdu, take);
+            if (om) rc = ble_gatts_notify_custom(s_conn_handle, s_event_tx_val_handle, om);
+
+            xSemaphoreTake(s_tx_mtx, portMAX_DELAY);
+            if (gen != s_tx_gen) {
+                // (Dis)connect while we were sending: the ring was reset.
+            } else if (rc == 0) {
+                s_tx_head = (s_tx_head + take) % SKBT_TX_RING;
+                s_tx_len -= take;
+                s_tx_stats.pdus++;
+            } else if (rc == BLE_HS_ENOMEM) {
+                // Controller / mbuf pool dry: the PDU stays queued.
+                s_tx_stats.enomem++;
+            } else {
+                // Link-level failure; the disconnect event follows.
+                ESP_LOGW(TAG, "notify rc=%d — dropping %u queued bytes",
+                         rc, (unsigned)s_tx_len);
+                s_tx_stats.dropped_bytes += (uint32_t)s_tx_len;
+                s_tx_head = 0;
+                s_tx_len  = 0;
+            }
+            xSemaphoreGive(s_tx_mtx);
+            if (rc != BLE_HS_ENOMEM) {
+                backoff = 0;
+                xSemaphoreGive(s_tx_room);
+                continue;
+            }
+            backoff = backoff ? backoff * 2 : SKBT_TX_BACKOFF_MIN_MS;
+            if (backoff > SKBT_TX_BACKOFF_MAX_MS) backoff = SKBT_TX_BACKOFF_MAX_MS;
+            wait = pdMS_TO_TICKS(backoff);
+            if (wait == 0) wait = 1;
+            retry_at = xTaskGetTickCount() + wait;
+            break;
         }
-        off += take;
+
+        // Back to the long interval once no backlog has built up for
+        // SKBT_BULK_IDLE_MS. Small traffic (timer.tick) doesn't count.
+        if (skbt_link_is_bulk()) {
+            int64_t left_us = bulk_seen + (int64_t)SKBT_BULK_IDLE_MS * 1000
+                            - esp_timer_get_time();
+            if (left_us <= 0) {
+                skbt_link_set_bulk(false);
+            } else if (!backoff) {
+                wait = pdMS_TO_TICKS(left_us / 1000) + 1;
+            }
+        }
+    }
+}
+
+static void tx_count_drop(size_t len)
+{
+    xSemaphoreTake(s_tx_mtx, portMAX_DELAY);
+    s_tx_stats.dropped_bytes += (uint32_t)len;
+    xSemaphoreGive(s_tx_mtx);
+}
+
+bool skbt_gatt_tx_wait_room(size_t len, uint32_t timeout_ms)
+{
+    if (!s_tx_mtx) return false;
+    // Even an empty ring would not take it: waiting only stalls the caller.
+    if (len > SKBT_TX_RING - SKBT_TX_RESERVE) {
+        tx_count_drop(len);
+        return false;
+    }
+    TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(timeout_ms);
+    for (;;) {
+        if (s_conn_handle == 0xFFFF) return false;
+        xSemaphoreTake(s_tx_mtx, portMAX_DELAY);
+        bool room = SKBT_TX_RING - s_tx_len >= len + SKBT_TX_RESERVE;
+        xSemaphoreGive(s_tx_mtx);
+        if (room) return true;
+        TickType_t now = xTaskGetTickCount();
+        if ((int32_t)(deadline - now) <= 0 ||
+            xSemaphoreTake(s_tx_room, deadline - now) != pdTRUE) {
+            tx_count_drop(len);
+            return false;
+        }
+    }
+}
+
+void skbt_gatt_tx_stats(skbt_tx_stats_t *out)
+{
+    if (!out) return;
+    if (!s_tx_mtx) { memset(out, 0, sizeof(*out)); return; }
+    xSemaphoreTake(s_tx_mtx, portMAX_DELAY);
+    *out         = s_tx_stats;
+    out->queued  = (uint16_t)s_tx_len;
+    xSemaphoreGive(s_tx_mtx);
+}
+
+// Wait (bounded) until everything queued has been handed to the
+// controller — for the paths that terminate the link right after a reply.
+static void tx_drain(uint32_t timeout_ms)
+{
+    for (uint32_t waited = 0; waited < timeout_ms; waited += 10) {
+        xSemaphoreTake(s_tx_mtx, portMAX_DELAY);
+        bool empty = (s_tx_len == 0);
+        xSemaphoreGive(s_tx_mtx);
+        if (empty) return;
+        vTaskDelay(pdMS_TO_TICKS(10));
     }
 }
 
+static esp_err_t tx_start(void)
+{
+    s_tx_mtx  = xSemaphoreCreateMutex();
+    s_tx_room = xSemaphoreCreateBinary();
+    if (!s_tx_mtx || !s_tx_room) return ESP_ERR_NO_MEM;
+    if (xTaskCreate(tx_task, "skbt_tx", SKBT_TX_STACK, NULL, SKBT_TX_PRIO,
+                    &s_tx_task) != pdPASS) {
+        s_tx_task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
 void skbt_gatt_notify_event(const char *payload, size_t len)
 {
-    ble_writer(payload, len, NULL);
+    // Through the session so an event never lands inside a pipelined reply.
+    sk_secure_session_send(&s_session, payload, len);
 }
 
 // -- NDJSON line reassembly --------------------------------------------------
@@ -178,9 +411,11 @@ static void pairing_finish_and_disconnect(void)
     // Race fix: ble_writer just queued our `our_pub` reply for transmit,
     // but NimBLE notify is async — if we terminate the link before the
     // controller actually pushes the PDU, the peer never sees the
-    // answer and times out at "Doğrulanıyor". Sleeping 250 ms here lets
-    // the controller drain the TX queue. (We're already in a one-shot
-    // pairing connection, so the extra latency is invisible to the user.)
+    // answer and times out at "Doğrulanıyor". First let skbt_tx hand the
+    // reply to NimBLE, then sleep 250 ms so the controller drains its TX
+    // queue. (We're already in a one-shot pairing connection, so the
+    // extra latency is invisible to the user.)
+    tx_drain(1000);
     vTaskDelay(pdMS_TO_TICKS(250));
     ble_gap_terminate(s_conn_handle, BLE_ERR_REM_USER_CONN_TERM);
 }
@@ -217,6 +452,7 @@ static void pairing_handle_line(const char *line, size_t len)
         ESP_LOGI(TAG, "ECDH pairing complete; closing connection for bonded reconnect");
         pairing_finish_and_disconnect();
     } else {
+        tx_drain(1000);     // the JSON error goes out before the link does
         ble_gap_terminate(s_conn_handle, BLE_ERR_REM_USER_CONN_TERM);
     }
 }
@@ -229,6 +465,7 @@ void skbt_gatt_on_connect(uint16_t conn_handle)
     s_rx_len            = 0;
     s_pairing_hint_sent = false;
     sk_secure_session_reset(&s_session);
+    tx_reset();
 
     // Önce bond. Bonded peer (zaten eşleşmiş SKAPP) tipik vakadır:
     // pairing modu açık olsa bile (kullanıcı butona yanlışlıkla bastı,
@@ -310,9 +547,10 @@ void skbt_gatt_on_disconnect(uint16_t conn_handle)
     s_conn_handle       = 0xFFFF;
     s_mode              = SKBT_CONN_IDLE;
     s_rx_len            = 0;
-    s_att_mtu           = 23;  // reset to default; next peer will renegotiate
+    skbt_gatt_set_mtu(23);     // reset to default; next peer will renegotiate
     s_pairing_hint_sent = false;
     sk_secure_session_reset(&s_session);
+    tx_reset();
 }
 
 bool skbt_gatt_is_connected(void)
@@ -326,6 +564,11 @@ bool skbt_gatt_is_authenticated(void)
            sk_secure_session_authed(&s_session);
 }
 
+bool skbt_gatt_event_push_active(void)
+{
+    return sk_secure_session_push_active(&s_session);
+}
+
 // -- CLI dispatch gate -------------------------------------------------------
 
 void skbt_gatt_on_cmd_rx(uint16_t conn_handle, const char *line, size_t len)
@@ -364,7 +607,10 @@ void skbt_gatt_on_cmd_rx(uint16_t conn_handle, const char *line, size_t len)
     sk_session_feed_t r = sk_secure_session_feed_line(&s_session, line);
     switch (r) {
     case SK_SESSION_FEED_AUTH_PROGRESSED:
-        // Handshake message handled internally — nothing more to do here.
+        // Handshake message handled internally. Once it completes, ask for
+        // the faster link (DLE + 2M PHY) and start the activity policy —
+        // the peer is ours now.
+        if (sk_secure_session_authed(&s_session)) skbt_link_negotiate(s_conn_handle);
         return;
 
     case SK_SESSION_FEED_AUTH_INVALID:
@@ -376,6 +622,7 @@ void skbt_gatt_on_cmd_rx(uint16_t conn_handle, const char *line, size_t len)
         if (sk_secure_session_authed(&s_session)) {
             // Every command must come as a signed envelope; the helper
             // verifies HMAC + nonce, then dispatches the inner body.
+            skbt_link_note_cmd();
             sk_secure_session_dispatch_signed(&s_session, line, ble_writer, NULL);
         } else {
             // Pre-auth, peer tried a non-handshake line. Reject.
@@ -456,6 +703,9 @@ static const struct ble_gatt_svc_def s_svcs[] = {
 
 esp_err_t skbt_gatt_init(void)
 {
+    skbt_gatt_set_mtu(23);
+    esp_err_t err = tx_start();
+    if (err != ESP_OK) return err;
     int rc = ble_gatts_count_cfg(s_svcs);
     if (rc != 0) return ESP_FAIL;
     rc = ble_gatts_add_svcs(s_svcs);
@@ -1,8 +1,45 @@
-// TCP NDJSON transport for the SKAPP CLI. One listener task accepts
-// clients; each client gets its own task that performs the Mutual
-// Challenge-Response handshake (via sk_secure_session) and then shuttles
-// CLI lines. TCP only serves bonded peers — pairing must happen over BLE
-// first.
+// TCP NDJSON transport for the SKAPP CLI. A single task multiplexes the
+// listener and every client socket with select(): it accepts, performs
+// the Mutual Challenge-Response handshake (via sk_secure_session) and
+// shuttles CLI lines. TCP only serves bonded peers — pairing must happen
+// over BLE first.
+//
+// RAM — clients used to get a task each (10 KB stack) plus an 8 KB line
+// buffer in client_t, ~72 KB at four slots. Now there is one task, and a
+// line buffer is borrowed from a small pool only while a client has a
+// partial line pending; NDJSON lines arrive whole in one or two segments,
+// so a buffer is rarely held for longer than one recv. A client needing a
+// buffer while the pool is empty is simply not read until one frees up
+// (TCP flow control holds the bytes). Verified commands run on the
+// sk_secure_session worker pool, so a slow handler does not stall the
+// loop; so does a pairing line (X25519 ECDH), and the client is not read
+// again until it has been answered.
+//
+// Writes never block on the socket. Every writer — the loop, workers,
+// the push sender, the log tail — sends with MSG_DONTWAIT and parks what
+// the stack would not take in the client's pending buffer; the loop
+// flushes it when select() reports the socket writable. A writer other
+// than the loop that finds the buffer full waits for room, at most
+// SK_TCP_SEND_TIMEOUT_MS; the loop itself never waits. A chunk that
+// cannot be written whole closes the client — the NDJSON stream would
+// be broken from there on. Writers poke the loop out of select() through
+// a loopback UDP socket (lwIP has no pipe).
+//
+// Dead sockets — a phone that walks out of WiFi range never sends FIN.
+// TCP keepalive finds those; an unauthenticated socket gets
+// SK_TCP_AUTH_TIMEOUT_MS to finish the handshake, any socket
+// SK_TCP_IDLE_MS of silence. When every slot is taken, a new connection
+// may only evict a client still in its handshake / pairing, or an
+// authenticated one silent for SK_TCP_EVICT_IDLE_MS (a reconnecting
+// SKAPP's previous socket that keepalive has not caught yet). Otherwise
+// the newcomer is refused: any host on the LAN can connect, and it must
+// not be able to knock a working SKAPP session off.
+//
+// Closing never waits on a sender. client_close() resets the session,
+// which stops any further session write, and moves the client's `gen`
+// on under tx_mtx before it closes the fd. Writers send under tx_mtx and
+// check `gen` first, so none can reach a reused fd number, and one
+// waiting for room is woken to find its client gone.
 
 #include "sk_transport_tcp.h"
 #include "sk_secure_session.h"
@@ -11,39 +48,54 @@
 #include "sk_capabilities.h"
 #include "sk_event_bus.h"
 #include "sk_errors.h"
+#include "sk_wifi.h"
 
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/select.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <fcntl.h>
 
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "freertos/task.h"
 
 static const char *TAG = "sk_tcp";
 
 #define CLIENT_MAX 4
 
+#define SK_TCP_LINE_POOL          2        // line buffers, shared by all clients
+#define SK_TCP_AUTH_TIMEOUT_MS    5000     // accept → handshake complete
+#define SK_TCP_PAIRING_TIMEOUT_MS 60000    // pairing on TCP: a human types the passphrase
+#define SK_TCP_IDLE_MS            600000   // no bytes at all from an authed client
+#define SK_TCP_EVICT_IDLE_MS      120000   // authed client silent this long may be evicted
+#define SK_TCP_SEND_TIMEOUT_MS    5000     // a peer that stops reading can't wedge a sender
+#define SK_TCP_TX_PENDING         2048     // per-client bytes the stack would not take yet
+#define SK_TCP_TICK_MS            1000     // select() timeout = reaper granularity
+#define SK_TCP_NOWAKE_TICK_MS     50       // no wake socket: poll for writers instead
+
 static sk_transport_tcp_cfg_t s_cfg = {
-    // task_stack: the client task runs the ENTIRE dispatch chain inline —
-    // ECDH X25519 pairing, HMAC-SHA256 handshake, JSON parse, command
-    // handler, JSON response build. 6144 overflowed in the field on the
-    // SynDimm C6 ("Stack protection fault" in sk_tcp_cli0, ~10 s reboot
-    // loop while SKAPP reconnects over TCP); LebensSpur runs the same chain
-    // on the same chip, so it carried the same latent crash. 10240 gives
-    // the deepest chain (pairing + signed dispatch) real headroom.
+    // task_stack: the loop task runs the handshake chain inline —
+    // HMAC-SHA256 challenge-response, envelope verify — and, when the
+    // worker pool cannot take them, ECDH X25519 pairing and the signed
+    // dispatch. 6144 overflowed in the field on the SynDimm C6 ("Stack
+    // protection fault" in sk_tcp_cli0, ~10 s reboot loop while SKAPP
+    // reconnects over TCP); LebensSpur runs the same chain on the same
+    // chip, so it carried the same latent crash. 10240 gives the deepest
+    // chain (pairing + signed dispatch fallback) real headroom.
     //
-    // max_clients defaults to the full slot count: the setting was ignored
-    // until now (accept ran to CLIENT_MAX), so lowering it here would be a
-    // silent behaviour change — a reconnecting SKAPP whose previous socket
-    // has not been reaped yet needs the spare slots.
+    // max_clients defaults to the full slot count: a reconnecting SKAPP
+    // whose previous socket has not been reaped yet needs the spare slots.
     .port = 8080, .max_clients = CLIENT_MAX, .task_priority = 4,
     .task_stack = 10240,
 };
-// Per-client line buffer. Sized for the worst-case signed write request:
+// Line buffer size. Sized for the worst-case signed write request:
 //   body  = {"cmd":"userdata.write","id":N,"args":{"offset":N,"data_b64":"<base64>"}}
 //   wire  = {"body":"...","sig":"<32hex>","nonce":N,"ts":N}
 // One userdata chunk is USERDATA_CLI_CHUNK = 4096 bytes; base64 inflates
@@ -57,30 +109,324 @@ static sk_transport_tcp_cfg_t s_cfg = {
 typedef struct {
     int                 sock;
     sk_secure_session_t session;
-    char                line[CLIENT_LINE_BUF];
+    char               *line;        // pool buffer while a line is partial
     size_t              line_len;
+    bool                overflow;    // discarding up to the next newline
+    // No bond when accepted, pairing window open: lines go to the pairing
+    // dispatcher until it reports a final result.
+    bool                pairing_mode;
     // Set once a bonded-path client has been routed into the pairing
     // dispatcher (re-pair recovery). Every subsequent line on this socket
     // then goes to the pairing dispatcher too — the passphrase follow-up is
     // `pairing.passphrase.verify`, which the ecdh substring gate below would
     // not match, and feeding it to the secure session closes the socket.
     bool                pairing_repair;
+    int64_t             accepted_us;
+    int64_t             last_rx_us;
+
+    // Writers' side; the fields below are under tx_mtx. Writers address
+    // the client as (gen << 8) | index, see client_handle().
+    SemaphoreHandle_t   tx_mtx;      // sock, gen, pending buffer; held briefly
+    SemaphoreHandle_t   tx_writer;   // one chunk at a time, kept across a room wait
+    SemaphoreHandle_t   tx_room;     // given by the loop after a flush
+    uint16_t            gen;         // moved on by accept and close
+    char               *tx_buf;      // SK_TCP_TX_PENDING, only while backed up
+    size_t              tx_len;
+    bool                tx_failed;   // send error or stalled peer: loop closes
+    bool                pair_done;   // the worker's answer to the line below
+    sk_auth_pairing_result_t pair_result;
+
+    // Loop only: a pairing line is out on the worker pool. The socket is
+    // not read until it is answered; bytes that came after it wait in
+    // rx_held.
+    bool                pair_wait;
+    char               *rx_held;
+    size_t              rx_held_len;
 } client_t;
 
 static client_t s_clients[CLIENT_MAX];
 
-static bool s_listening = false;
+static bool         s_listening = false;
+static TaskHandle_t s_loop_task;
+static int          s_wake = -1;     // loopback UDP socket, see loop_wake()
+
+// -- Line buffer pool -------------------------------------------------------
+//
+// Only the loop task touches it. Buffers are malloc'd on first demand and
+// handed back to the heap once no client is connected.
+
+static char *s_line_free[SK_TCP_LINE_POOL];
+static int   s_line_free_n;
+static int   s_line_alloc;
+
+static bool line_available(void)
+{
+    return s_line_free_n > 0 || s_line_alloc < SK_TCP_LINE_POOL;
+}
+
+static char *line_get(void)
+{
+    if (s_line_free_n) return s_line_free[--s_line_free_n];
+    if (s_line_alloc >= SK_TCP_LINE_POOL) return NULL;
+    char *b = malloc(CLIENT_LINE_BUF);
+    if (b) s_line_alloc++;
+    return b;
+}
+
+static void line_put(client_t *c)
+{
+    if (!c->line) return;
+    s_line_free[s_line_free_n++] = c->line;
+    c->line     = NULL;
+    c->line_len = 0;
+}
+
+static void line_pool_trim(void)
+{
+    while (s_line_free_n) {
+        free(s_line_free[--s_line_free_n]);
+        s_line_alloc--;
+    }
+}
+
+// -- Wake-up ----------------------------------------------------------------
+//
+// A datagram to ourselves over loopback: the loop's select() watches the
+// socket, so any task can end the wait (new pending bytes, a pairing
+// result, a failed client).
+
+static void wake_open(void)
+{
+    int ws = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (ws < 0) return;
+    struct sockaddr_in a = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    socklen_t al = sizeof(a);
+    if (bind(ws, (struct sockaddr *)&a, sizeof(a)) < 0 ||
+        getsockname(ws, (struct sockaddr *)&a, &al) < 0 ||
+        connect(ws, (struct sockaddr *)&a, al) < 0 || ws >= FD_SETSIZE) {
+        close(ws);
+        ESP_LOGW(TAG, "no wake socket — polling every %d ms", SK_TCP_NOWAKE_TICK_MS);
+        return;
+    }
+    s_wake = ws;
+}
+
+static void loop_wake(void)
+{
+    if (s_wake < 0) return;
+    char b = 0;
+    send(s_wake, &b, 1, MSG_DONTWAIT);
+}
+
+static void wake_drain(void)
+{
+    char b[16];
+    while (recv(s_wake, b, sizeof(b), MSG_DONTWAIT) > 0) {}
+}
+
+// -- Client I/O -------------------------------------------------------------
+
+static void *client_handle(const client_t *c)
+{
+    return (void *)(uintptr_t)(((uint32_t)c->gen << 8) | (uint32_t)(c - s_clients));
+}
+
+// Caller holds tx_mtx. Takes what it can of `len` bytes: straight to the
+// socket while nothing is pending, then into the pending buffer.
+static size_t tx_push(client_t *c, const char *p, size_t len)
+{
+    size_t done = 0;
+    if (!c->tx_len) {
+        int n = send(c->sock, p, len, MSG_DONTWAIT);
+        if (n > 0) {
+            done = (size_t)n;
+        } else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            c->tx_failed = true;
+            return 0;
+        }
+    }
+    if (done == len) return done;
+    if (!c->tx_buf && !(c->tx_buf = malloc(SK_TCP_TX_PENDING))) return done;
+    size_t take = SK_TCP_TX_PENDING - c->tx_len;
+    if (take > len - done) take = len - done;
+    memcpy(c->tx_buf + c->tx_len, p + done, take);
+    c->tx_len += take;
+    return done + take;
+}
+
+static void client_tx_fail(client_t *c, uint16_t gen)
+{
+    xSemaphoreTake(c->tx_mtx, portMAX_DELAY);
+    if (c->gen == gen && c->sock >= 0) c->tx_failed = true;
+    xSemaphoreGive(c->tx_mtx);
+    loop_wake();
+}
 
+// sk_cli_writer_t over client_handle(). Never blocks on the socket; see
+// the header for who waits for buffer room and who does not.
 static void client_writer(const char *chunk, size_t len, void *user)
 {
-    int sock = (int)(intptr_t)user;
-    if (sock < 0 || !chunk || !len) return;
-    send(sock, chunk, len, 0);
+    uintptr_t h   = (uintptr_t)user;
+    uint32_t  idx = h & 0xFF;
+    uint16_t  gen = (uint16_t)(h >> 8);
+    if (idx >= CLIENT_MAX || !chunk || !len) return;
+    client_t *c = &s_clients[idx];
+
+    TickType_t wait = (xTaskGetCurrentTaskHandle() == s_loop_task)
+                          ? 0 : pdMS_TO_TICKS(SK_TCP_SEND_TIMEOUT_MS);
+    TickType_t deadline = xTaskGetTickCount() + wait;
+    if (xSemaphoreTake(c->tx_writer, wait) != pdTRUE) {
+        client_tx_fail(c, gen);
+        return;
+    }
+    while (len) {
+        xSemaphoreTake(c->tx_mtx, portMAX_DELAY);
+        if (c->gen != gen || c->sock < 0 || c->tx_failed) {
+            xSemaphoreGive(c->tx_mtx);
+            break;
+        }
+        bool   was_idle = c->tx_len == 0;
+        size_t done     = tx_push(c, chunk, len);
+        bool   poke     = was_idle && c->tx_len;
+        xSemaphoreGive(c->tx_mtx);
+        if (poke) loop_wake();
+        chunk += done;
+        len   -= done;
+        if (!len) break;
+        TickType_t now = xTaskGetTickCount();
+        if ((int32_t)(deadline - now) <= 0 ||
+            xSemaphoreTake(c->tx_room, deadline - now) != pdTRUE) {
+            client_tx_fail(c, gen);
+            break;
+        }
+    }
+    xSemaphoreGive(c->tx_writer);
+}
+
+static void send_line(client_t *c, const char *s)
+{
+    client_writer(s, strlen(s), client_handle(c));
+}
+
+// select() said writable: hand the stack what it takes now.
+static void client_writable(client_t *c)
+{
+    xSemaphoreTake(c->tx_mtx, portMAX_DELAY);
+    if (c->tx_len) {
+        int n = send(c->sock, c->tx_buf, c->tx_len, MSG_DONTWAIT);
+        if (n > 0) {
+            c->tx_len -= (size_t)n;
+            memmove(c->tx_buf, c->tx_buf + n, c->tx_len);
+        } else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            c->tx_failed = true;
+        }
+        if (!c->tx_len) {
+            free(c->tx_buf);
+            c->tx_buf = NULL;
+        }
+    }
+    xSemaphoreGive(c->tx_mtx);
+    xSemaphoreGive(c->tx_room);
+}
+
+static bool client_open(const client_t *c)
+{
+    return c->sock >= 0;
+}
+
+static void client_close(client_t *c, const char *why)
+{
+    if (c->sock < 0) return;
+    ESP_LOGI(TAG, "client %d closed (%s)", (int)(c - s_clients), why);
+    // Reset first: it ends this socket's logs.tail / events.subscribe and
+    // turns every later session write into a no-op.
+    sk_secure_session_reset(&c->session);
+    c->overflow       = false;
+    c->pairing_mode   = false;
+    c->pairing_repair = false;
+    line_put(c);
+    free(c->rx_held);
+    c->rx_held     = NULL;
+    c->rx_held_len = 0;
+
+    xSemaphoreTake(c->tx_mtx, portMAX_DELAY);
+    c->gen++;
+    close(c->sock);
+    c->sock      = -1;
+    free(c->tx_buf);
+    c->tx_buf    = NULL;
+    c->tx_len    = 0;
+    c->tx_failed = false;
+    c->pair_done = false;
+    xSemaphoreGive(c->tx_mtx);
+    c->pair_wait = false;
+    // A writer waiting for room finds its client gone.
+    xSemaphoreGive(c->tx_room);
+}
+
+// -- Pairing ------------------------------------------------------------------
+//
+// sk_auth_pairing_dispatch_line() runs X25519 ECDH: far too slow for the
+// loop, which every other client waits on. The line goes to the session
+// worker pool; the answer comes back through pair_done, which the loop
+// picks up in pairing_poll().
+
+typedef struct {
+    uint8_t  idx;
+    uint16_t gen;
+    size_t   len;
+    char     line[];
+} pair_job_t;
+
+static void pair_job_run(void *arg)
+{
+    pair_job_t *j = arg;
+    client_t   *c = &s_clients[j->idx];
+    void *h = (void *)(uintptr_t)(((uint32_t)j->gen << 8) | j->idx);
+    sk_auth_pairing_result_t r =
+        sk_auth_pairing_dispatch_line(j->line, j->len, client_writer, h);
+    xSemaphoreTake(c->tx_mtx, portMAX_DELAY);
+    if (c->gen == j->gen) {
+        c->pair_done   = true;
+        c->pair_result = r;
+    }
+    xSemaphoreGive(c->tx_mtx);
+    free(j);
+    loop_wake();
+}
+
+// PENDING = passphrase gate armed: the bond is derived but RAM-only until
+// the peer proves the passphrase on THIS socket, so keep reading. Anything
+// else is final — OK: peer reconnects bonded; ERR/NOT_OPEN: peer saw the
+// JSON error — and the socket is dropped.
+static void pairing_result(client_t *c, sk_auth_pairing_result_t r)
+{
+    if (r != SK_AUTH_PAIRING_PENDING) {
+        client_close(c, c->pairing_repair ? "repair done" : "pairing done");
+    }
 }
 
-static void send_line(int sock, const char *s)
+static void pairing_submit(client_t *c, const char *line)
 {
-    send(sock, s, strlen(s), 0);
+    size_t      len = strlen(line);
+    pair_job_t *j   = malloc(sizeof(*j) + len + 1);
+    if (j) {
+        j->idx = (uint8_t)(c - s_clients);
+        j->gen = c->gen;
+        j->len = len;
+        memcpy(j->line, line, len + 1);
+        if (sk_secure_session_run(pair_job_run, j)) {
+            c->pair_wait = true;
+            return;
+        }
+        free(j);
+    }
+    // No pool (or no memory): answer here, as before the pool took it.
+    pairing_result(c, sk_auth_pairing_dispatch_line(line, len, client_writer,
+                                                    client_handle(c)));
 }
 
 static void handle_line(client_t *c, const char *line)
@@ -105,18 +451,12 @@ static void handle_line(client_t *c, const char *line)
          strstr(line, "\"cmd\":\"pairing.ecdh.exchange\"") != NULL)) {
         ESP_LOGI(TAG, "bonded path → repair: pairing line routed to dispatcher");
         c->pairing_repair = true;
-        sk_auth_pairing_result_t r =
-            sk_auth_pairing_dispatch_line(line, strlen(line),
-                                          client_writer,
-                                          (void *)(intptr_t)c->sock);
         // PENDING = passphrase gate armed; the RAM-only pending bond needs
-        // the peer's `pairing.passphrase.verify` on THIS socket. Closing here
-        // (the old unconditional one-shot) dropped it and made passphrase-
-        // gated re-pairing impossible over WiFi.
-        if (r == SK_AUTH_PAIRING_PENDING) return;
-        // Otherwise one-shot: peer reconnects bonded after the OK reply.
-        close(c->sock);
-        c->sock = -1;
+        // the peer's `pairing.passphrase.verify` on THIS socket. Closing on
+        // every result (the old unconditional one-shot) dropped it and made
+        // passphrase-gated re-pairing impossible over WiFi. Otherwise
+        // one-shot: peer reconnects bonded after the OK reply.
+        pairing_submit(c, line);
         return;
     }
 
@@ -127,8 +467,7 @@ static void handle_line(client_t *c, const char *line)
 
     case SK_SESSION_FEED_AUTH_INVALID:
         ESP_LOGW(TAG, "invalid handshake — closing sock %d", c->sock);
-        close(c->sock);
-        c->sock = -1;
+        client_close(c, "bad handshake");
         return;
 
     case SK_SESSION_FEED_PASSTHROUGH:
@@ -136,119 +475,231 @@ static void handle_line(client_t *c, const char *line)
             // Every command must come as a signed envelope; the helper
             // verifies HMAC + nonce, then dispatches the inner body.
             sk_secure_session_dispatch_signed(&c->session, line, client_writer,
-                                              (void *)(intptr_t)c->sock);
+                                              client_handle(c));
         } else {
-            send_line(c->sock, "{\"ok\":false,\"err\":\"ERR_NOT_AUTHENTICATED\"}\n");
+            send_line(c, "{\"ok\":false,\"err\":\"ERR_NOT_AUTHENTICATED\"}\n");
         }
         return;
     }
 }
 
-// Pairing-mode line handler for TCP. Used only when sk_secure_session
-// can't begin (no bond) and pairing mode is currently OPEN. Reads one
-// `pairing.ecdh.exchange` line, runs the transport-agnostic dispatcher,
-// then signals the caller via the return value whether to expect more
-// data (NOT_OPEN keeps the socket open just long enough to flush the
-// error JSON; OK / ERR closes immediately so the peer reconnects on
-// the bonded path).
-static sk_auth_pairing_result_t pairing_handle_one_line(client_t *c,
-                                                       const char *line)
+// Split `n` received bytes into lines and dispatch them. Stops after a
+// line that went to the worker pool for pairing and keeps the rest in
+// rx_held. The caller has given the client a line buffer.
+static void client_feed(client_t *c, const char *rx, size_t n)
 {
-    return sk_auth_pairing_dispatch_line(line, strlen(line),
-                                         client_writer,
-                                         (void *)(intptr_t)c->sock);
+    for (size_t i = 0; i < n && client_open(c); i++) {
+        char ch = rx[i];
+        if (ch == '\n' || ch == '\r') {
+            if (c->line_len > 0 && !c->overflow) {
+                c->line[c->line_len] = '\0';
+                if (c->pairing_mode) pairing_submit(c, c->line);
+                else                 handle_line(c, c->line);
+            }
+            c->line_len = 0;
+            c->overflow = false;
+            if (c->pair_wait && client_open(c) && i + 1 < n) {
+                char *held = malloc(n - i - 1);
+                if (held) memcpy(held, rx + i + 1, n - i - 1);
+                free(c->rx_held);
+                c->rx_held     = held;
+                c->rx_held_len = held ? n - i - 1 : 0;
+                break;
+            }
+            if (c->pair_wait) break;
+        } else if (c->overflow) {
+            // rest of an oversized line
+        } else if (c->line_len < CLIENT_LINE_BUF - 1) {
+            c->line[c->line_len++] = ch;
+        } else {
+            // Overflow: drop the whole line. Resuming mid-line would hand
+            // the dispatcher its tail as if it were a request.
+            ESP_LOGW(TAG, "client %d: line > %d bytes dropped",
+                     (int)(c - s_clients), CLIENT_LINE_BUF - 1);
+            c->line_len = 0;
+            c->overflow = true;
+        }
+    }
+    // Nothing partial left — the buffer goes back for the next reader.
+    if (client_open(c) && c->line_len == 0) line_put(c);
 }
 
-static void client_task(void *arg)
+// Read what select() reported and dispatch every completed line. The
+// caller guarantees a line buffer is obtainable (line_available()).
+static void client_readable(client_t *c)
 {
-    int idx = (int)(intptr_t)arg;
-    client_t *c = &s_clients[idx];
+    if (!c->line && !(c->line = line_get())) return;
+
+    char rx[512];
+    int n = recv(c->sock, rx, sizeof(rx), 0);
+    if (n <= 0) {
+        client_close(c, n == 0 ? "peer closed" : "recv error");
+        return;
+    }
+    c->last_rx_us = esp_timer_get_time();
+    client_feed(c, rx, (size_t)n);
+}
+
+// A pairing line came back from the worker pool: act on the result.
+static void pairing_poll(client_t *c)
+{
+    if (!c->pair_wait) return;
+    xSemaphoreTake(c->tx_mtx, portMAX_DELAY);
+    bool                     done = c->pair_done;
+    sk_auth_pairing_result_t r    = c->pair_result;
+    c->pair_done = false;
+    xSemaphoreGive(c->tx_mtx);
+    if (!done) return;
+    c->pair_wait = false;
+    pairing_result(c, r);
+}
+
+// Go on with what the peer sent after its pairing line, before reading
+// the socket again.
+static void client_replay(client_t *c)
+{
+    if (!client_open(c) || c->pair_wait || !c->rx_held) return;
+    if (!c->line && !(c->line = line_get())) return;
+    char  *held = c->rx_held;
+    size_t len  = c->rx_held_len;
+    c->rx_held     = NULL;
+    c->rx_held_len = 0;
+    client_feed(c, held, len);
+    free(held);
+}
+
+// -- Accept / reap ----------------------------------------------------------
+
+static int client_cap(void)
+{
+    // Honour the configured ceiling (it used to be parsed, stored and then
+    // ignored).
+    int cap = (int)s_cfg.max_clients;
+    if (cap <= 0 || cap > CLIENT_MAX) cap = CLIENT_MAX;
+    return cap;
+}
+
+// A full table may give up a client that is still in its handshake or
+// pairing, or an authenticated one that has been silent for
+// SK_TCP_EVICT_IDLE_MS. A live SKAPP session is never evicted.
+static bool client_evictable(const client_t *c, int64_t now)
+{
+    if (!sk_secure_session_authed(&c->session)) return true;
+    return now - c->last_rx_us > (int64_t)SK_TCP_EVICT_IDLE_MS * 1000;
+}
+
+// Free slot, or an evictable client closed to make one (unauthenticated
+// first, then the longest-silent). -1 = refuse the newcomer.
+static int alloc_client_slot(void)
+{
+    int     cap    = client_cap();
+    int     victim = -1;
+    int64_t now    = esp_timer_get_time();
+    for (int i = 0; i < cap; i++) {
+        client_t *c = &s_clients[i];
+        if (c->sock < 0) return i;
+        if (!client_evictable(c, now)) continue;
+        if (victim < 0) { victim = i; continue; }
+        client_t *v = &s_clients[victim];
+        bool c_auth = sk_secure_session_authed(&c->session);
+        bool v_auth = sk_secure_session_authed(&v->session);
+        if (c_auth != v_auth ? !c_auth : c->last_rx_us < v->last_rx_us) victim = i;
+    }
+    if (victim < 0) return -1;
+    client_close(&s_clients[victim], "evicted for new connection");
+    return victim;
+}
+
+static void set_client_sockopts(int cs)
+{
+    int one = 1;
+    setsockopt(cs, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+    int idle = 30, intvl = 5, cnt = 3;    // dead peer noticed in ~45 s
+    setsockopt(cs, IPPROTO_TCP, TCP_KEEPIDLE,  &idle,  sizeof(idle));
+    setsockopt(cs, IPPROTO_TCP, TCP_KEEPINTVL, &intvl, sizeof(intvl));
+    setsockopt(cs, IPPROTO_TCP, TCP_KEEPCNT,   &cnt,   sizeof(cnt));
+    setsockopt(cs, IPPROTO_TCP, TCP_NODELAY,   &one,   sizeof(one));
+}
+
+static void accept_client(int listen_sock)
+{
+    struct sockaddr_in ca;
+    socklen_t cl = sizeof(ca);
+    int cs = accept(listen_sock, (struct sockaddr *)&ca, &cl);
+    if (cs < 0) return;
+    if (cs >= FD_SETSIZE) { close(cs); return; }
+    int slot = alloc_client_slot();
+    if (slot < 0) {
+        ESP_LOGW(TAG, "all %d slots busy — connection refused", client_cap());
+        close(cs);
+        return;
+    }
+
+    client_t *c = &s_clients[slot];
+    set_client_sockopts(cs);
+    xSemaphoreTake(c->tx_mtx, portMAX_DELAY);
+    c->gen++;
+    c->sock = cs;
+    xSemaphoreGive(c->tx_mtx);
+    c->line_len       = 0;
+    c->overflow       = false;
+    c->pairing_mode   = false;
+    c->pairing_repair = false;
+    c->accepted_us    = esp_timer_get_time();
+    c->last_rx_us     = c->accepted_us;
 
+    // Auth state lives inside `session`; begin() sends our challenge.
     sk_secure_session_reset(&c->session);
     esp_err_t err = sk_secure_session_begin(&c->session, client_writer,
-                                            (void *)(intptr_t)c->sock);
+                                            client_handle(c));
+    if (err == ESP_OK) return;
 
     // No bond yet → if pairing window is open, run the same ECDH flow
     // BLE GATT does. Otherwise drop. The peer is expected to send
     // exactly one pairing.ecdh.exchange line, then reconnect on the
     // bonded path for the secure-session handshake.
-    bool pairing_mode = false;
-    if (err != ESP_OK) {
-        if (sk_auth_pairing_state() == SK_AUTH_PAIRING_OPEN) {
-            ESP_LOGI(TAG, "client %d: bond missing, pairing window open — "
-                          "accepting pairing.ecdh.exchange", idx);
-            pairing_mode = true;
-        } else {
-            ESP_LOGW(TAG, "session begin failed (%s) — closing",
-                     esp_err_to_name(err));
-            close(c->sock);
-            c->sock = -1;
-            vTaskDelete(NULL);
-            return;
-        }
+    if (sk_auth_pairing_state() == SK_AUTH_PAIRING_OPEN) {
+        ESP_LOGI(TAG, "client %d: bond missing, pairing window open — "
+                      "accepting pairing.ecdh.exchange", slot);
+        c->pairing_mode = true;
+        return;
     }
+    ESP_LOGW(TAG, "session begin failed (%s) — closing", esp_err_to_name(err));
+    client_close(c, "no bond");
+}
 
-    char rx[512];
-    while (c->sock >= 0) {
-        int n = recv(c->sock, rx, sizeof(rx), 0);
-        if (n <= 0) break;
-        for (int i = 0; i < n; i++) {
-            char ch = rx[i];
-            if (ch == '\n' || ch == '\r') {
-                if (c->line_len > 0) {
-                    c->line[c->line_len] = '\0';
-                    if (pairing_mode) {
-                        sk_auth_pairing_result_t r =
-                            pairing_handle_one_line(c, c->line);
-                        c->line_len = 0;
-                        // PENDING = passphrase gate armed: the bond is
-                        // derived but RAM-only until the peer proves the
-                        // passphrase on THIS socket. Keep reading.
-                        if (r == SK_AUTH_PAIRING_PENDING) continue;
-                        // Otherwise pairing is one-shot — OK: peer
-                        // reconnects bonded; ERR/NOT_OPEN: peer saw the JSON
-                        // error and we close. Drop the socket either way.
-                        goto done;
-                    }
-                    handle_line(c, c->line);
-                    c->line_len = 0;
-                }
-            } else if (c->line_len < sizeof(c->line) - 1) {
-                c->line[c->line_len++] = ch;
-            } else {
-                c->line_len = 0;  // overflow => drop
+static void reap_clients(void)
+{
+    int64_t now = esp_timer_get_time();
+    for (int i = 0; i < CLIENT_MAX; i++) {
+        client_t *c = &s_clients[i];
+        if (!client_open(c)) continue;
+        xSemaphoreTake(c->tx_mtx, portMAX_DELAY);
+        bool failed = c->tx_failed;
+        xSemaphoreGive(c->tx_mtx);
+        if (failed) {
+            client_close(c, "tx failed or peer not reading");
+        } else if (c->pairing_mode || c->pairing_repair) {
+            if (now - c->accepted_us > (int64_t)SK_TCP_PAIRING_TIMEOUT_MS * 1000) {
+                client_close(c, "pairing timeout");
+            }
+        } else if (!sk_secure_session_authed(&c->session)) {
+            if (now - c->accepted_us > (int64_t)SK_TCP_AUTH_TIMEOUT_MS * 1000) {
+                client_close(c, "handshake timeout");
             }
+        } else if (now - c->last_rx_us > (int64_t)SK_TCP_IDLE_MS * 1000) {
+            client_close(c, "idle");
         }
     }
-done:
-    ESP_LOGI(TAG, "client %d closed", idx);
-    if (c->sock >= 0) close(c->sock);
-    c->sock = -1;
-    c->line_len = 0;
-    c->pairing_repair = false;
-    sk_secure_session_reset(&c->session);
-    vTaskDelete(NULL);
 }
 
-static int alloc_client_slot(void)
-{
-    // Honour the configured ceiling. It used to be parsed, stored and then
-    // ignored (the loop ran to CLIENT_MAX), so a caller asking for 2 clients
-    // silently got 4 — each one a task with `task_stack` bytes plus an 8 KB
-    // line buffer, i.e. the RAM budget the setting exists to bound.
-    int cap = (int)s_cfg.max_clients;
-    if (cap <= 0 || cap > CLIENT_MAX) cap = CLIENT_MAX;
-    for (int i = 0; i < cap; i++) {
-        if (s_clients[i].sock < 0) return i;
-    }
-    return -1;
-}
+// -- Event loop -------------------------------------------------------------
 
-static void listen_task(void *arg)
+static void tcp_loop_task(void *arg)
 {
     (void)arg;
     int listen_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (listen_sock < 0) { ESP_LOGE(TAG, "socket: %d", errno); vTaskDelete(NULL); return; }
+    if (listen_sock < 0) { ESP_LOGE(TAG, "socket: %d", errno); s_listening = false; vTaskDelete(NULL); return; }
     int one = 1; setsockopt(listen_sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
 
     struct sockaddr_in sa = {
@@ -257,39 +708,83 @@ static void listen_task(void *arg)
         .sin_port = htons(s_cfg.port),
     };
     if (bind(listen_sock, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
-        ESP_LOGE(TAG, "bind: %d", errno); close(listen_sock); vTaskDelete(NULL); return;
+        ESP_LOGE(TAG, "bind: %d", errno); close(listen_sock); s_listening = false; vTaskDelete(NULL); return;
     }
     if (listen(listen_sock, 2) < 0) {
-        ESP_LOGE(TAG, "listen: %d", errno); close(listen_sock); vTaskDelete(NULL); return;
+        ESP_LOGE(TAG, "listen: %d", errno); close(listen_sock); s_listening = false; vTaskDelete(NULL); return;
     }
     ESP_LOGI(TAG, "listening on port %u", (unsigned)s_cfg.port);
+    s_loop_task = xTaskGetCurrentTaskHandle();
+    if (s_wake < 0) wake_open();
 
     while (1) {
-        struct sockaddr_in ca;
-        socklen_t cl = sizeof(ca);
-        int cs = accept(listen_sock, (struct sockaddr *)&ca, &cl);
-        if (cs < 0) continue;
-        int slot = alloc_client_slot();
-        if (slot < 0) { close(cs); continue; }
-        s_clients[slot].sock = cs;
-        s_clients[slot].line_len = 0;
-        s_clients[slot].pairing_repair = false;
-        // Auth state lives inside `session` and is reset by client_task
-        // via sk_secure_session_reset() — no separate flag on client_t.
-        char name[24]; snprintf(name, sizeof(name), "sk_tcp_cli%d", slot);
-        xTaskCreate(client_task, name, s_cfg.task_stack, (void *)(intptr_t)slot,
-                    s_cfg.task_priority, NULL);
+        fd_set rd, wr;
+        FD_ZERO(&rd);
+        FD_ZERO(&wr);
+        FD_SET(listen_sock, &rd);
+        int maxfd = listen_sock;
+        if (s_wake >= 0) {
+            FD_SET(s_wake, &rd);
+            if (s_wake > maxfd) maxfd = s_wake;
+        }
+        bool any = false;
+        for (int i = 0; i < CLIENT_MAX; i++) {
+            client_t *c = &s_clients[i];
+            pairing_poll(c);
+            client_replay(c);
+            if (c->sock < 0) continue;
+            any = true;
+            xSemaphoreTake(c->tx_mtx, portMAX_DELAY);
+            bool backed_up = c->tx_len > 0;
+            xSemaphoreGive(c->tx_mtx);
+            if (backed_up) {
+                FD_SET(c->sock, &wr);
+                if (c->sock > maxfd) maxfd = c->sock;
+            }
+            // Only read a client that can get a line buffer and has no
+            // pairing line out; the rest wait in their socket's receive
+            // window.
+            if (c->pair_wait || c->rx_held) continue;
+            if (!c->line && !line_available()) continue;
+            FD_SET(c->sock, &rd);
+            if (c->sock > maxfd) maxfd = c->sock;
+        }
+        if (!any) line_pool_trim();
+
+        struct timeval tv = { .tv_sec = SK_TCP_TICK_MS / 1000 };
+        if (s_wake < 0) tv = (struct timeval){ .tv_usec = SK_TCP_NOWAKE_TICK_MS * 1000 };
+        int n = select(maxfd + 1, &rd, &wr, NULL, &tv);
+        if (n < 0) {
+            if (errno != EINTR) {
+                ESP_LOGE(TAG, "select: %d", errno);
+                vTaskDelay(pdMS_TO_TICKS(100));
+            }
+            continue;
+        }
+        if (n > 0 && s_wake >= 0 && FD_ISSET(s_wake, &rd)) wake_drain();
+        for (int i = 0; n > 0 && i < CLIENT_MAX; i++) {
+            client_t *c = &s_clients[i];
+            if (client_open(c) && FD_ISSET(c->sock, &wr)) client_writable(c);
+            if (client_open(c) && FD_ISSET(c->sock, &rd)) client_readable(c);
+        }
+        // After the clients: an eviction must not close an fd that is
+        // still marked in `rd` for this round.
+        if (n > 0 && FD_ISSET(listen_sock, &rd)) accept_client(listen_sock);
+        reap_clients();
     }
 }
 
 static void on_wifi_event(const sk_event_t *evt, void *user)
 {
     (void)user;
-    if (!evt->payload_json) return;
-    if (strstr(evt->payload_json, "\"state\":\"connected\"") && !s_listening) {
-        xTaskCreate(listen_task, "sk_tcp_listen", s_cfg.task_stack, NULL,
-                    s_cfg.task_priority, NULL);
+    const sk_wifi_state_evt_t *ws = sk_event_data(evt, &sk_wifi_state_evt_type);
+    if (!ws) return;
+    if (strcmp(ws->state, "connected") == 0 && !s_listening) {
         s_listening = true;
+        if (xTaskCreate(tcp_loop_task, "sk_tcp", s_cfg.task_stack, NULL,
+                        s_cfg.task_priority, NULL) != pdPASS) {
+            s_listening = false;
+        }
     }
 }
 
@@ -307,18 +802,29 @@ esp_err_t sk_transport_tcp_init(const sk_transport_tcp_cfg_t *cfg)
         if (cfg->task_stack)    s_cfg.task_stack    = cfg->task_stack;
     }
     if (!s_cfg.port) s_cfg.port = 8080;
-    for (int i = 0; i < CLIENT_MAX; i++) s_clients[i].sock = -1;
+    for (int i = 0; i < CLIENT_MAX; i++) {
+        client_t *c = &s_clients[i];
+        c->sock = -1;
+        if (c->tx_mtx) continue;
+        c->tx_mtx    = xSemaphoreCreateMutex();
+        c->tx_writer = xSemaphoreCreateMutex();
+        c->tx_room   = xSemaphoreCreateBinary();
+        if (!c->tx_mtx || !c->tx_writer || !c->tx_room) {
+            ESP_LOGE(TAG, "client %d: tx lock alloc failed", i);
+            return ESP_ERR_NO_MEM;
+        }
+    }
 
-    // Spawn the listener IMMEDIATELY — don't wait for the wifi.state
-    // event. lwIP is already up by the time main_app_init() reaches us
+    // Spawn the loop IMMEDIATELY — don't wait for the wifi.state event.
+    // lwIP is already up by the time main_app_init() reaches us
     // (esp_netif_init + sk_wifi_init both ran earlier in main.c), so
-    // bind(INADDR_ANY:8080) succeeds even before WiFi associates. The
-    // accept() call simply waits until traffic shows up. This eliminates
-    // two races we hit in the field: (1) xTaskCreate silently failing
-    // and leaving s_listening=true forever; (2) the wifi.state.connected
-    // event being missed because subscribe ordering put us after the
-    // first publish_state() call.
-    BaseType_t ok = xTaskCreate(listen_task, "sk_tcp_listen",
+    // bind(INADDR_ANY:8080) succeeds even before WiFi associates. select()
+    // simply waits until traffic shows up. This eliminates two races we
+    // hit in the field: (1) xTaskCreate silently failing and leaving
+    // s_listening=true forever; (2) the wifi.state.connected event being
+    // missed because subscribe ordering put us after the first
+    // publish_state() call.
+    BaseType_t ok = xTaskCreate(tcp_loop_task, "sk_tcp",
                                 s_cfg.task_stack, NULL,
                                 s_cfg.task_priority, NULL);
     if (ok != pdPASS) {
@@ -330,12 +836,12 @@ esp_err_t sk_transport_tcp_init(const sk_transport_tcp_cfg_t *cfg)
     // Eager-listener confirmation: appears at boot, before WiFi associates.
     // Lets us tell from a single monitor capture whether the new firmware
     // is actually running on the device.
-    ESP_LOGI(TAG, "init OK — listener task spawned for port %u",
+    ESP_LOGI(TAG, "init OK — loop task spawned for port %u",
              (unsigned)s_cfg.port);
 
-    // Keep the wifi.state subscription as a defensive no-op: if the
-    // listener task crashes for any reason and clears s_listening
-    // (future-proofing), a wifi-up event will respawn it.
+    // wifi.state subscription as a fallback: if the loop task could not
+    // set up its socket it clears s_listening and exits, and a wifi-up
+    // event respawns it.
     int sub;
     sk_event_bus_subscribe("wifi.state", on_wifi_event, NULL, &sub);
     sk_capabilities_register_book("sk_transport_tcp", "0.1.0");
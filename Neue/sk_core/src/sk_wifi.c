@@ -2,8 +2,6 @@
 #include "sk_auth.h"
 #include "sk_capabilities.h"
 #include "sk_cli.h"
-#include "sk_cli_internal.h"   // wifi.scan worker captures writer + machine_id
-                               // off ctx — needs the struct definition.
 #include "sk_errors.h"
 #include "sk_event_bus.h"
 
@@ -86,16 +84,36 @@ static const char *slot_name(int slot)
     }
 }
 
+static int render_state(const void *data, char *out, size_t cap)
+{
+    const sk_wifi_state_evt_t *e = data;
+    return snprintf(out, cap,
+                    "{\"state\":\"%s\",\"ssid\":\"%s\",\"ip\":\"%s\",\"rssi\":%d,"
+                    "\"static\":%s,\"slot\":\"%s\"}",
+                    e->state, e->ssid, e->ip, e->rssi,
+                    e->static_ip ? "true" : "false", e->slot);
+}
+
+const sk_event_type_t sk_wifi_state_evt_type = {
+    .name        = "wifi.state",
+    .size        = sizeof(sk_wifi_state_evt_t),
+    .render_json = render_state,
+};
+
+// Snapshot copied into the event payload — mdns / tcp only look at
+// `state`, so the JSON form is rendered only when a transport forwards
+// the event to a peer.
 static void publish_state(const char *state)
 {
-    char buf[192];
-    snprintf(buf, sizeof(buf),
-             "{\"state\":\"%s\",\"ssid\":\"%s\",\"ip\":\"%s\",\"rssi\":%d,"
-             "\"static\":%s,\"slot\":\"%s\"}",
-             state, s_ssid, s_ip, s_rssi,
-             s_static_ip ? "true" : "false",
-             slot_name(s_active_slot));
-    sk_event_bus_publish("wifi.state", buf);
+    sk_wifi_state_evt_t ev = {
+        .state     = state,
+        .rssi      = s_rssi,
+        .static_ip = s_static_ip,
+        .slot      = slot_name(s_active_slot),
+    };
+    strncpy(ev.ssid, s_ssid, sizeof(ev.ssid) - 1);
+    strncpy(ev.ip,   s_ip,   sizeof(ev.ip) - 1);
+    sk_event_bus_publish_typed("wifi.state", &sk_wifi_state_evt_type, &ev);
 }
 
 static void wifi_event_cb(void *arg, esp_event_base_t base, int32_t id, void *data)
@@ -200,6 +218,10 @@ esp_err_t sk_wifi_init(void)
 {
     if (s_ready) return ESP_OK;
 
+    // Newly authenticated sessions get the last wifi.state in their
+    // retained burst instead of asking wifi.status.
+    sk_event_bus_set_retained("wifi.state");
+
     // Defer-timer for resuming BLE advertising after GOT_IP. Created
     // here once; started inside the IP event handler.
     const esp_timer_create_args_t resume_args = {
@@ -492,7 +514,7 @@ int sk_wifi_scan(sk_wifi_scan_entry_t *out, int max)
         ESP_LOGE(TAG, "esp_wifi_scan_start failed: %s",
                  esp_err_to_name(serr));
         // Negative return signals "scan rejected by driver" to the
-        // worker, which surfaces an explicit error envelope to SKAPP
+        // scan job, which surfaces an explicit error envelope to SKAPP
         // instead of an empty data array (the latter would look like
         // "no networks in range" to the user — a misleading symptom).
         return -1;
@@ -551,41 +573,35 @@ static sk_err_t cmd_wifi_status(sk_cli_ctx_t *ctx)
 // caller for 2-5 seconds. Inline that on the BLE GATT path and the
 // NimBLE host task is blocked the entire time → connection-supervision
 // timeout fires → peer drops (or in pathological cases the radio coex
-// arbiter panics). Same pattern as wifi.connect: defer to a worker task
-// and emit the response via the captured writer once the scan completes.
+// arbiter panics). The handler defers its reply (sk_cli_defer) and the
+// scan runs on an sk_cli async worker, which completes the token with the
+// list once the driver is done.
 //
 // Single-flight: a second scan request while the first is in flight is
-// rejected with SK_ERR_BUSY. Reusing the scan worker across multiple
-// callers would need to merge their writers, which is more complexity
-// than this 5-second-rare command warrants.
-
-typedef struct {
-    sk_cli_writer_t writer;
-    void           *writer_user;
-    int             machine_id;
-    bool            is_machine_mode;
-} wifi_scan_job_t;
+// rejected with SK_ERR_BUSY. Reusing the scan across multiple callers
+// would need to fan the result out to several tokens, which is more
+// complexity than this 5-second-rare command warrants.
 
 static volatile bool s_scan_active = false;
 
-static void wifi_scan_worker(void *arg)
+static void wifi_scan_job(sk_cli_pending_t *p, void *arg)
 {
-    wifi_scan_job_t *job = (wifi_scan_job_t *)arg;
-
+    (void)arg;
     enum { MAX = 12 };
     sk_wifi_scan_entry_t *list = calloc(MAX, sizeof(*list));
-    if (!list) {
-        const char *err = job->is_machine_mode
-            ? "{\"id\":-1,\"ok\":false,\"err\":\"ERR_INTERNAL\",\"params\":{\"reason\":\"oom\"}}\n"
-            : "error: ERR_INTERNAL — out of memory\n";
-        if (job->writer) job->writer(err, strlen(err), job->writer_user);
+    // 12 entries × ~80 bytes (ssid+rssi+auth) + per-entry comma →
+    // comfortably under 1 KB.
+    char *buf = malloc(1024);
+    if (!list || !buf) {
+        free(list);
+        free(buf);
         s_scan_active = false;
-        free(job);
-        vTaskDelete(NULL);
+        sk_cli_complete_err(p, SK_ERR_INTERNAL, "{\"reason\":\"oom\"}");
         return;
     }
 
     int n = sk_wifi_scan(list, MAX);
+    s_scan_active = false;
 
     // Driver-level failure (e.g. ESP_ERR_WIFI_STATE because the driver is
     // still mid-association, or PHY init incomplete). Surface this to SKAPP
@@ -593,73 +609,25 @@ static void wifi_scan_worker(void *arg)
     // looks like "no APs visible" to the wizard, which is the wrong
     // diagnosis when the real problem is "scan was refused by the driver".
     if (n < 0) {
+        free(buf);
         free(list);
-        const char *err = job->is_machine_mode
-            ? "{\"id\":-1,\"ok\":false,\"err\":\"ERR_INTERNAL\",\"params\":{\"reason\":\"scan_rejected\"}}\n"
-            : "error: ERR_INTERNAL — scan rejected by wifi driver\n";
-        // Patch in the real id for machine mode (the -1 placeholder above
-        // is just the static template).
-        if (job->is_machine_mode) {
-            char *dyn = malloc(192);
-            if (dyn) {
-                int dn = snprintf(dyn, 192,
-                    "{\"id\":%d,\"ok\":false,\"err\":\"ERR_INTERNAL\",\"params\":{\"reason\":\"scan_rejected\"}}\n",
-                    job->machine_id);
-                if (job->writer && dn > 0) job->writer(dyn, (size_t)dn, job->writer_user);
-                free(dyn);
-            } else if (job->writer) {
-                job->writer(err, strlen(err), job->writer_user);
-            }
-        } else if (job->writer) {
-            job->writer(err, strlen(err), job->writer_user);
-        }
-        s_scan_active = false;
-        free(job);
-        vTaskDelete(NULL);
-        return;
-    }
-
-    // 12 entries × ~80 bytes (ssid+rssi+auth) + 64 byte envelope
-    // + per-entry comma → comfortably under 1.5 KB.
-    char *buf = malloc(2048);
-    if (!buf) {
-        free(list);
-        const char *err = job->is_machine_mode
-            ? "{\"id\":-1,\"ok\":false,\"err\":\"ERR_INTERNAL\",\"params\":{\"reason\":\"oom\"}}\n"
-            : "error: ERR_INTERNAL — out of memory\n";
-        if (job->writer) job->writer(err, strlen(err), job->writer_user);
-        s_scan_active = false;
-        free(job);
-        vTaskDelete(NULL);
+        sk_cli_complete_err(p, SK_ERR_INTERNAL, "{\"reason\":\"scan_rejected\"}");
         return;
     }
 
     size_t off = 0;
-    if (job->is_machine_mode) {
-        off += snprintf(buf + off, 2048 - off,
-                        "{\"id\":%d,\"ok\":true,\"data\":[", job->machine_id);
-    } else {
-        off += snprintf(buf + off, 2048 - off, "ok. [");
-    }
-    for (int i = 0; i < n && off < 1900; i++) {
-        off += snprintf(buf + off, 2048 - off,
+    buf[off++] = '[';
+    for (int i = 0; i < n && off < 900; i++) {
+        off += snprintf(buf + off, 1024 - off,
                         "%s{\"ssid\":\"%s\",\"rssi\":%d,\"auth\":%d}",
                         i == 0 ? "" : ",",
                         list[i].ssid, list[i].rssi, list[i].auth);
     }
-    if (job->is_machine_mode) {
-        off += snprintf(buf + off, 2048 - off, "]}\n");
-    } else {
-        off += snprintf(buf + off, 2048 - off, "]\n");
-    }
-
-    if (job->writer) job->writer(buf, off, job->writer_user);
+    snprintf(buf + off, 1024 - off, "]");
 
+    sk_cli_complete(p, buf);
     free(buf);
     free(list);
-    s_scan_active = false;
-    free(job);
-    vTaskDelete(NULL);
 }
 
 static sk_err_t cmd_wifi_scan(sk_cli_ctx_t *ctx)
@@ -669,34 +637,18 @@ static sk_err_t cmd_wifi_scan(sk_cli_ctx_t *ctx)
         return SK_OK;
     }
 
-    wifi_scan_job_t *job = calloc(1, sizeof(*job));
-    if (!job) {
-        sk_cli_err(ctx, SK_ERR_INTERNAL, "{\"reason\":\"oom\"}");
+    sk_cli_pending_t *p = sk_cli_defer(ctx);
+    if (!p) {
+        sk_cli_err(ctx, SK_ERR_BUSY, "{\"reason\":\"pending_full\"}");
         return SK_OK;
     }
-    // Capture writer + machine_id at handler call time — ctx is a stack
-    // var that goes out of scope when this function returns, but the
-    // writer fn pointer (usb_writer / ble_writer) is a stable global.
-    job->writer          = ctx->writer;
-    job->writer_user     = ctx->writer_user;
-    job->machine_id      = ctx->machine_id;
-    job->is_machine_mode = ctx->is_machine_mode;
-
     s_scan_active = true;
-    BaseType_t ok = xTaskCreate(wifi_scan_worker, "sk_wifi_scan",
-                                4096, job, 4, NULL);
-    if (ok != pdPASS) {
+    if (sk_cli_async(p, wifi_scan_job, NULL) != ESP_OK) {
         s_scan_active = false;
-        free(job);
-        sk_cli_err(ctx, SK_ERR_INTERNAL, "{\"reason\":\"task_spawn\"}");
-        return SK_OK;
+        sk_cli_complete_err(p, SK_ERR_INTERNAL, "{\"reason\":\"async_queue\"}");
     }
-    // The worker writes the actual response (with full scan list) when it
-    // finishes ~2-5 seconds from now. Mark `wrote_envelope = true` on the
-    // ctx so the dispatcher doesn't emit an empty error envelope when we
-    // return SK_OK without having called sk_cli_ok ourselves.
-    ctx->wrote_envelope = true;
-    return SK_OK;
+    // The reply (with the full scan list) follows ~2-5 seconds from now.
+    return SK_PENDING;
 }
 
 // "primary" / "backup" → slot index; returns -1 if the token does not look
@@ -743,7 +695,7 @@ static int parse_slot_arg(sk_cli_ctx_t *ctx)
 // dispatch → handler). Re-entering the GAP layer + blocking that task
 // for 300ms + heavy esp_wifi_* calls on its small stack was the source of
 // the SKAPP-driven "constant reboot" crash. The handler now hands the
-// work to a dedicated worker task instead.
+// work to an sk_cli async worker instead.
 //
 // Single-flight: two concurrent workers calling esp_wifi_disconnect /
 // set_config / connect end up racing on the WiFi driver's internal state
@@ -758,8 +710,9 @@ typedef struct {
 
 static volatile bool s_worker_active = false;
 
-static void wifi_connect_worker(void *arg)
+static void wifi_connect_job(sk_cli_pending_t *p, void *arg)
 {
+    (void)p;    // already answered by cmd_wifi_connect
     wifi_connect_job_t *job = (wifi_connect_job_t *)arg;
 
     // 1) Let the response envelope (sk_cli_ok from cmd_wifi_connect) leave
@@ -787,11 +740,9 @@ static void wifi_connect_worker(void *arg)
 
     // Release the single-flight slot so the next wifi.connect can proceed.
     // Done after sk_wifi_connect_sta returns, NOT after GOT_IP — connect_sta
-    // is fully synchronous on the worker task, association then happens on
+    // is fully synchronous on the async worker, association then happens on
     // the WiFi event task which doesn't need the slot.
     s_worker_active = false;
-
-    vTaskDelete(NULL);
 }
 
 static esp_err_t schedule_wifi_connect(const sk_wifi_cred_t *c)
@@ -805,12 +756,10 @@ static esp_err_t schedule_wifi_connect(const sk_wifi_cred_t *c)
     if (!job) return ESP_ERR_NO_MEM;
     memcpy(&job->cred, c, sizeof(*c));
 
-    // Set the flag BEFORE xTaskCreate so a racing schedule call is
-    // rejected even if the new worker hasn't yet been scheduled.
+    // Set the flag BEFORE queueing so a racing schedule call is rejected
+    // even if no async worker has picked the job up yet.
     s_worker_active = true;
-    BaseType_t ok = xTaskCreate(wifi_connect_worker, "sk_wifi_conn",
-                                4096, job, 4, NULL);
-    if (ok != pdPASS) {
+    if (sk_cli_async(NULL, wifi_connect_job, job) != ESP_OK) {
         s_worker_active = false;
         free(job);
         return ESP_ERR_NO_MEM;